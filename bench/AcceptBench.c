@@ -0,0 +1,160 @@
+// Cost of computing Sec-WebSocket-Accept: the original snprintf + SHA1() +
+// malloc'ing base64_encode path against each HandshakeCrypto kernel, and the
+// base64 codec on its own.
+// Usage: AcceptBench [seconds-per-case]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/sha.h>
+
+#include "HandshakeCrypto.h"
+
+#define NUM_KEYS 1024
+
+static char keys[NUM_KEYS][WS_KEY_LEN + 1];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// What handle_handshake did before the shared module existed
+static char *legacy_base64_encode(const unsigned char *input, int length) {
+    static const char encoding_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const int mod_table[] = {0, 2, 1};
+    char *encoded_data = malloc(((length + 2) / 3) * 4 + 1);
+    if (!encoded_data) return NULL;
+
+    int i, j;
+    for (i = 0, j = 0; i < length;) {
+        uint32_t octet_a = i < length ? (unsigned char)input[i++] : 0;
+        uint32_t octet_b = i < length ? (unsigned char)input[i++] : 0;
+        uint32_t octet_c = i < length ? (unsigned char)input[i++] : 0;
+
+        uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
+
+        encoded_data[j++] = encoding_table[(triple >> 18) & 0x3F];
+        encoded_data[j++] = encoding_table[(triple >> 12) & 0x3F];
+        encoded_data[j++] = encoding_table[(triple >> 6) & 0x3F];
+        encoded_data[j++] = encoding_table[triple & 0x3F];
+    }
+    for (int k = 0; k < mod_table[length % 3]; k++)
+        encoded_data[j - 1 - k] = '=';
+    encoded_data[j] = '\0';
+    return encoded_data;
+}
+
+static void legacy_accept(const char *key, char accept[WS_ACCEPT_LEN + 1]) {
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    char concat_key[128];
+    snprintf(concat_key, sizeof(concat_key), "%s%s", key, WEBSOCKET_MAGIC_GUID);
+    SHA1((unsigned char *)concat_key, strlen(concat_key), digest);
+    char *encoded = legacy_base64_encode(digest, SHA_DIGEST_LENGTH);
+    memcpy(accept, encoded, WS_ACCEPT_LEN + 1);
+    free(encoded);
+}
+
+// impl == WS_SHA1_IMPL_COUNT is the dispatched ws_accept_key, -1 the legacy path
+static void compute(int impl, const char *key, char accept[WS_ACCEPT_LEN + 1]) {
+    if (impl < 0)
+        legacy_accept(key, accept);
+    else if (impl == WS_SHA1_IMPL_COUNT)
+        ws_accept_key(key, accept);
+    else
+        ws_accept_key_with(impl, key, accept);
+}
+
+static double time_accept(int impl, double budget) {
+    char accept[WS_ACCEPT_LEN + 1];
+    size_t iters = 0;
+    double start = now_sec(), elapsed;
+    do {
+        for (int i = 0; i < NUM_KEYS; i++)
+            compute(impl, keys[i], accept);
+        iters += NUM_KEYS;
+        elapsed = now_sec() - start;
+    } while (elapsed < budget);
+    return elapsed / iters * 1e9;
+}
+
+static int verify(void) {
+    // RFC 6455 1.3
+    char accept[WS_ACCEPT_LEN + 1];
+    ws_accept_key("dGhlIHNhbXBsZSBub25jZQ==", accept);
+    if (strcmp(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != 0)
+        return 0;
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        char want[WS_ACCEPT_LEN + 1], got[WS_ACCEPT_LEN + 1];
+        legacy_accept(keys[i], want);
+        for (int impl = 0; impl <= WS_SHA1_IMPL_COUNT; impl++) {
+            if (impl < WS_SHA1_IMPL_COUNT && !ws_sha1_impl_supported(impl))
+                continue;
+            compute(impl, keys[i], got);
+            if (strcmp(want, got) != 0)
+                return 0;
+        }
+    }
+
+    // Round trip every length around the padding cases
+    uint8_t raw[64], back[64];
+    char text[WS_BASE64_LEN(64) + 1];
+    for (size_t len = 0; len <= sizeof(raw); len++) {
+        for (size_t i = 0; i < len; i++)
+            raw[i] = (uint8_t)(i * 53 + len);
+        size_t n = ws_base64_encode(raw, len, text);
+        if (n != WS_BASE64_LEN(len) || ws_base64_decode(text, n, back) != (int)len || memcmp(raw, back, len) != 0)
+            return 0;
+    }
+    return ws_base64_decode("ab$d", 4, back) < 0 && ws_base64_decode("a=bc", 4, back) < 0;
+}
+
+int main(int argc, char **argv) {
+    double budget = argc > 1 ? atof(argv[1]) : 0.5;
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        if (ws_generate_key(keys[i]) < 0) {
+            fprintf(stderr, "RAND_bytes failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (!verify()) {
+        fprintf(stderr, "accept computation disagrees with the reference\n");
+        return EXIT_FAILURE;
+    }
+
+    double legacy = time_accept(-1, budget);
+    printf("%-24s %8.1f ns/accept\n", "snprintf+SHA1+malloc", legacy);
+    for (int impl = 0; impl <= WS_SHA1_IMPL_COUNT; impl++) {
+        const char *name = impl == WS_SHA1_IMPL_COUNT ? "dispatch" : ws_sha1_impl_name(impl);
+        if (impl < WS_SHA1_IMPL_COUNT && !ws_sha1_impl_supported(impl)) {
+            printf("%-24s %8s\n", name, "n/a");
+            continue;
+        }
+        double ns = time_accept(impl, budget);
+        printf("%-24s %8.1f ns/accept  (%.1fx)\n", name, ns, legacy / ns);
+    }
+
+    // The codec alone, on a digest-sized and a key-sized input
+    static const size_t sizes[] = { 16, 20 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint8_t raw[20] = { 0 }, back[21];
+        char text[WS_BASE64_LEN(20) + 1];
+        size_t iters = 0, n = 0;
+        double start = now_sec(), elapsed;
+        do {
+            for (int i = 0; i < 4096; i++) {
+                raw[0] = (uint8_t)i;
+                n = ws_base64_encode(raw, sizes[s], text);
+                ws_base64_decode(text, n, back);
+            }
+            iters += 4096;
+            elapsed = now_sec() - start;
+        } while (elapsed < budget);
+        printf("base64 %2zu bytes          %8.1f ns/encode+decode\n", sizes[s], elapsed / iters * 1e9);
+    }
+    return EXIT_SUCCESS;
+}
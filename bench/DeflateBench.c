@@ -0,0 +1,134 @@
+// permessage-deflate on OCPP traffic: for each window size, with and without
+// context takeover, connections take turns sending realistic messages that
+// are compressed by one endpoint and inflated by the other. Reports the
+// compression ratio, CPU per message on each side and the zlib memory each
+// connection holds.
+// Usage: DeflateBench [connections] [messages]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Deflate.h"
+#include "BufferPool.h"
+#include "WebSocketFrame.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// What a station sends most: meter values, status changes and heartbeats,
+// with the ids, timestamps and readings moving on
+static size_t build_message(long n, int conn, char *buf, size_t size) {
+    int sec = (int)(n % 60), min = (int)(n / 60 % 60);
+    switch (n % 4) {
+    case 0:
+    case 1:
+        return (size_t)snprintf(buf, size,
+            "[2,\"%ld\",\"MeterValues\",{\"connectorId\":%d,\"transactionId\":%d,\"meterValue\":[{\"timestamp\":"
+            "\"2024-12-26T12:%02d:%02dZ\",\"sampledValue\":[{\"value\":\"%ld.%ld\",\"context\":\"Sample.Periodic\","
+            "\"measurand\":\"Energy.Active.Import.Register\",\"unit\":\"Wh\"},{\"value\":\"%ld\","
+            "\"context\":\"Sample.Periodic\",\"measurand\":\"Power.Active.Import\",\"unit\":\"W\"}]}]}]",
+            n, 1 + conn % 2, 1000 + conn, min, sec, 5000 + n * 7, n % 10, 7000 + n % 400);
+    case 2:
+        return (size_t)snprintf(buf, size,
+            "[2,\"%ld\",\"StatusNotification\",{\"connectorId\":%d,\"errorCode\":\"NoError\",\"status\":\"%s\","
+            "\"timestamp\":\"2024-12-26T12:%02d:%02dZ\"}]",
+            n, 1 + conn % 2, n % 8 == 2 ? "Charging" : "Available", min, sec);
+    default:
+        return (size_t)snprintf(buf, size, "[2,\"%ld\",\"Heartbeat\",{}]", n);
+    }
+}
+
+static void run(int connections, long messages, int bits, int no_takeover) {
+    ws_deflate_params_t params = {
+        .enabled = 1,
+        .server_no_context_takeover = (uint8_t)no_takeover,
+        .client_no_context_takeover = (uint8_t)no_takeover,
+        .server_max_window_bits = (uint8_t)bits,
+        .client_max_window_bits = (uint8_t)bits,
+    };
+    ws_deflate_t *tx = calloc((size_t)connections, sizeof(*tx));
+    ws_deflate_t *rx = calloc((size_t)connections, sizeof(*rx));
+    if (!tx || !rx)
+        exit(EXIT_FAILURE);
+    for (int c = 0; c < connections; c++) {
+        ws_deflate_init(&tx[c], &params, 1);
+        ws_deflate_init(&rx[c], &params, 0);
+    }
+
+    size_t tx_memory = 0, rx_memory = 0;
+    size_t raw = 0, wire = 0;
+    double deflating = 0, inflating = 0;
+    char text[1024];
+    for (long n = 0; n < messages; n++) {
+        int c = (int)(n % connections);
+        size_t len = build_message(n / connections, c, text, sizeof(text));
+        struct iovec iov = { text, len };
+
+        size_t before = ws_deflate_memory();
+        double start = now_sec();
+        uint8_t *packed;
+        size_t packed_len;
+        int rc = ws_deflate_message(&tx[c], &iov, 1, 0, &packed, &packed_len);
+        double mid = now_sec();
+        size_t between = ws_deflate_memory();
+        tx_memory += between - before;
+        if (rc < 0) {
+            fprintf(stderr, "deflate failed\n");
+            exit(EXIT_FAILURE);
+        }
+        raw += len;
+        if (rc == 0) {
+            wire += len;
+            deflating += mid - start;
+            continue;
+        }
+        wire += packed_len;
+
+        const uint8_t *plain;
+        size_t plain_len;
+        if (ws_inflate_message(&rx[c], packed, packed_len, WS_DEFAULT_MAX_MESSAGE, &plain, &plain_len) < 0 ||
+            plain_len != len || memcmp(plain, text, len) != 0) {
+            fprintf(stderr, "round trip failed at message %ld\n", n);
+            exit(EXIT_FAILURE);
+        }
+        double end = now_sec();
+        deflating += mid - start;
+        inflating += end - mid;
+        rx_memory += ws_deflate_memory() - between;
+        buf_pool_put(packed);
+    }
+
+    printf("%2d bits  %-11s  ratio %5.3f  deflate %6.2f us  inflate %6.2f us  memory %7.1f kB + %6.1f kB per connection\n",
+           bits, no_takeover ? "no takeover" : "takeover", (double)wire / raw,
+           deflating * 1e6 / messages, inflating * 1e6 / messages,
+           tx_memory / 1024.0 / connections, rx_memory / 1024.0 / connections);
+
+    for (int c = 0; c < connections; c++) {
+        ws_deflate_free(&tx[c]);
+        ws_deflate_free(&rx[c]);
+    }
+    free(tx);
+    free(rx);
+}
+
+int main(int argc, char **argv) {
+    int connections = argc > 1 ? atoi(argv[1]) : 100;
+    long messages = argc > 2 ? atol(argv[2]) : 100000;
+    if (connections < 1 || messages < connections) {
+        fprintf(stderr, "Usage: %s [connections] [messages]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%d connections, %ld messages; memory is compressor + decompressor\n", connections, messages);
+    for (int bits = WS_DEFLATE_MIN_WINDOW; bits <= WS_DEFLATE_MAX_WINDOW; bits++)
+        run(connections, messages, bits, 0);
+    // Streams shared by all connections: the memory is the process's, not theirs
+    for (int bits = WS_DEFLATE_MIN_WINDOW; bits <= WS_DEFLATE_MAX_WINDOW; bits += 3)
+        run(connections, messages, bits, 1);
+    return EXIT_SUCCESS;
+}
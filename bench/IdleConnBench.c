@@ -0,0 +1,177 @@
+// Memory held per idle station. A worker is forked for each backend and
+// clients open WebSocket connections to it and leave them quiet; the
+// worker's resident set is read before and after. With "tls", the worker
+// loads server.crt and server.key from the current directory.
+// Usage: IdleConnBench [connections] [plain|tls] [port]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "TLSServer.h"
+
+#define WARM_CONNECTIONS 16     // opened before the baseline is taken
+
+typedef struct {
+    int fd;
+    SSL *ssl;
+} idle_client_t;
+
+static void run_worker(int port, int tls, int io_uring) {
+    if (!freopen("/dev/null", "w", stdout))
+        exit(EXIT_FAILURE);
+    server_config.port = port;
+    server_config.plain = !tls;
+    server_config.io_uring = io_uring;
+    server_config.session_cache_slots = 0;
+    websocket_server();
+    exit(EXIT_SUCCESS);
+}
+
+// Resident set of pid in bytes, 0 if it cannot be read
+static size_t rss_bytes(pid_t pid) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "VmRSS: %zu kB", &kb) == 1)
+            break;
+    fclose(f);
+    return kb * 1024;
+}
+
+static int client_io(idle_client_t *c, void *buf, size_t len, int writing) {
+    if (c->ssl)
+        return writing ? SSL_write(c->ssl, buf, (int)len) : SSL_read(c->ssl, buf, (int)len);
+    return (int)(writing ? write(c->fd, buf, len) : read(c->fd, buf, len));
+}
+
+// Connect and complete the upgrade, retrying while the worker starts
+static int client_open(idle_client_t *c, SSL_CTX *ctx, int port) {
+    static char req[] =
+        "GET /CP001 HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+        "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\nSec-WebSocket-Protocol: ocpp1.6\r\n\r\n";
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    for (int attempt = 0; attempt < 500; attempt++, usleep(10000)) {
+        c->ssl = NULL;
+        if ((c->fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+            return -1;
+        if (connect(c->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+            goto retry;
+        if (ctx) {
+            if (!(c->ssl = SSL_new(ctx)))
+                goto retry;
+            SSL_set_fd(c->ssl, c->fd);
+            if (SSL_connect(c->ssl) != 1)
+                goto retry;
+        }
+        if (client_io(c, req, sizeof(req) - 1, 1) != (int)(sizeof(req) - 1))
+            goto retry;
+
+        char buf[1024];
+        size_t got = 0;
+        int n;
+        while (got < sizeof(buf) - 1 && (n = client_io(c, buf + got, sizeof(buf) - 1 - got, 0)) > 0) {
+            got += (size_t)n;
+            buf[got] = '\0';
+            if (strstr(buf, "\r\n\r\n"))
+                return strncmp(buf, "HTTP/1.1 101", 12) == 0 ? 0 : -1;
+        }
+retry:
+        SSL_free(c->ssl);
+        close(c->fd);
+    }
+    return -1;
+}
+
+static void client_close(idle_client_t *c) {
+    SSL_free(c->ssl);
+    close(c->fd);
+}
+
+static void bench_backend(int connections, SSL_CTX *ctx, int port, int io_uring) {
+    fflush(stdout);
+    pid_t worker = fork();
+    if (worker == 0)
+        run_worker(port, ctx != NULL, io_uring);
+
+    idle_client_t *clients = calloc((size_t)connections + WARM_CONNECTIONS, sizeof(*clients));
+    int opened = 0;
+    size_t before = 0;
+    for (; opened < connections + WARM_CONNECTIONS; opened++) {
+        if (opened == WARM_CONNECTIONS) {
+            usleep(100000);
+            before = rss_bytes(worker);
+        }
+        if (client_open(&clients[opened], ctx, port) < 0) {
+            fprintf(stderr, "Connection %d failed: %s\n", opened, strerror(errno));
+            break;
+        }
+    }
+    usleep(100000);
+    size_t after = rss_bytes(worker);
+    int idle = opened - WARM_CONNECTIONS;
+
+    printf("%-9s %-5s %7d idle  %8.0f bytes each  (%zu kB -> %zu kB)\n",
+           io_uring ? "io_uring" : "epoll", ctx ? "tls" : "plain", idle,
+           idle > 0 ? (double)(after - before) / idle : 0.0, before / 1024, after / 1024);
+
+    kill(worker, SIGKILL);
+    waitpid(worker, NULL, 0);
+    for (int i = 0; i < opened; i++)
+        client_close(&clients[i]);
+    free(clients);
+}
+
+int main(int argc, char **argv) {
+    int connections = argc > 1 ? atoi(argv[1]) : 5000;
+    int tls = argc > 2 && strcmp(argv[2], "tls") == 0;
+    int port = argc > 3 ? atoi(argv[3]) : 12398;
+    if (connections < 1) {
+        fprintf(stderr, "Usage: %s [connections] [plain|tls] [port]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // Both ends of every connection live on this machine
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0) {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
+    }
+
+    SSL_CTX *ctx = NULL;
+    if (tls) {
+        ctx = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+    printf("connection slot %zu bytes (hot %zu, cold %zu)\n", conn_pool_slot_size(),
+           sizeof(connection_t), sizeof(conn_cold_t));
+
+    bench_backend(connections, ctx, port, 0);
+    int err = uring_probe();
+    if (err)
+        printf("io_uring  unavailable (%s)\n", strerror(err));
+    else
+        bench_backend(connections, ctx, port, 1);
+    SSL_CTX_free(ctx);
+    return EXIT_SUCCESS;
+}
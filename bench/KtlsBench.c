@@ -0,0 +1,252 @@
+// User-space TLS against kernel TLS over loopback: CPU time per GB moved in
+// each direction, and round-trip latency for OCPP-sized messages. The server
+// side sends the way the event loop does: SSL_write, or plain write() once
+// the kernel owns the send path.
+// Usage: KtlsBench [megabytes] [round-trips]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/x509.h>
+
+#include "Ktls.h"
+
+#define CHUNK 16384
+#define PING_SIZE 256
+
+typedef struct {
+    int ktls;
+    int version;            // TLS1_2_VERSION or TLS1_3_VERSION
+    size_t bytes;           // per bulk direction
+    int round_trips;
+    int listen_fd;
+    int send_offload[2];    // server, client
+    int recv_offload[2];
+    double server_tx_cpu, server_rx_cpu;   // seconds of server thread CPU
+    double tx_wall, rx_wall;
+} bench_t;
+
+static EVP_PKEY *pkey;
+static X509 *cert;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double thread_cpu(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static int make_cert(void) {
+    pkey = EVP_EC_gen("P-256");
+    cert = X509_new();
+    if (!pkey || !cert) return -1;
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, pkey);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    return X509_sign(cert, pkey, EVP_sha256()) > 0 ? 0 : -1;
+}
+
+static SSL_CTX *make_ctx(const bench_t *b, int server) {
+    SSL_CTX *ctx = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+    SSL_CTX_set_min_proto_version(ctx, b->version);
+    SSL_CTX_set_max_proto_version(ctx, b->version);
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    if (b->ktls)
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    if (server) {
+        SSL_CTX_use_certificate(ctx, cert);
+        SSL_CTX_use_PrivateKey(ctx, pkey);
+    }
+    return ctx;
+}
+
+static int read_full(SSL *ssl, char *buf, size_t len) {
+    while (len > 0) {
+        int n = SSL_read(ssl, buf, (int)(len < CHUNK ? len : CHUNK));
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int write_full(SSL *ssl, int fd, int kernel, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = kernel ? write(fd, buf, len) : SSL_write(ssl, buf, (int)len);
+        if (n <= 0) {
+            if (kernel && errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void *server_main(void *arg) {
+    bench_t *b = arg;
+    static char buf[CHUNK];
+    SSL_CTX *ctx = make_ctx(b, 1);
+    int fd = accept(b->listen_fd, NULL, NULL);
+    SSL *ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    if (SSL_accept(ssl) <= 0) {
+        ERR_print_errors_fp(stderr);
+        exit(EXIT_FAILURE);
+    }
+    int kernel = b->send_offload[0] = ktls_send_active(ssl);
+    b->recv_offload[0] = ktls_recv_active(ssl);
+
+    // Server to client
+    double cpu = thread_cpu(), wall = now_sec();
+    for (size_t sent = 0; sent < b->bytes; sent += CHUNK)
+        write_full(ssl, fd, kernel, buf, CHUNK);
+    read_full(ssl, buf, 1);     // the client has everything
+    b->server_tx_cpu = thread_cpu() - cpu;
+    b->tx_wall = now_sec() - wall;
+
+    // Client to server
+    cpu = thread_cpu();
+    wall = now_sec();
+    for (size_t got = 0; got < b->bytes; got += CHUNK)
+        read_full(ssl, buf, CHUNK);
+    b->server_rx_cpu = thread_cpu() - cpu;
+    b->rx_wall = now_sec() - wall;
+    write_full(ssl, fd, kernel, buf, 1);
+
+    // Echo
+    for (int i = 0; i < b->round_trips; i++) {
+        read_full(ssl, buf, PING_SIZE);
+        write_full(ssl, fd, kernel, buf, PING_SIZE);
+    }
+
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    close(fd);
+    SSL_CTX_free(ctx);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int run(bench_t *b) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    b->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (bind(b->listen_fd, (struct sockaddr *)&addr, len) < 0 || listen(b->listen_fd, 1) < 0 ||
+        getsockname(b->listen_fd, (struct sockaddr *)&addr, &len) < 0)
+        return -1;
+
+    pthread_t server;
+    pthread_create(&server, NULL, server_main, b);
+
+    SSL_CTX *ctx = make_ctx(b, 0);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *)&addr, len) < 0)
+        return -1;
+    SSL *ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    if (SSL_connect(ssl) <= 0) {
+        ERR_print_errors_fp(stderr);
+        return -1;
+    }
+    b->send_offload[1] = ktls_send_active(ssl);
+    b->recv_offload[1] = ktls_recv_active(ssl);
+
+    static char buf[CHUNK];
+    for (size_t got = 0; got < b->bytes; got += CHUNK)
+        read_full(ssl, buf, CHUNK);
+    write_full(ssl, fd, 0, buf, 1);
+    for (size_t sent = 0; sent < b->bytes; sent += CHUNK)
+        write_full(ssl, fd, 0, buf, CHUNK);
+    read_full(ssl, buf, 1);
+
+    double *rtt = malloc(sizeof(double) * (size_t)b->round_trips);
+    for (int i = 0; i < b->round_trips; i++) {
+        double start = now_sec();
+        write_full(ssl, fd, 0, buf, PING_SIZE);
+        read_full(ssl, buf, PING_SIZE);
+        rtt[i] = (now_sec() - start) * 1e6;
+    }
+    qsort(rtt, (size_t)b->round_trips, sizeof(double), cmp_double);
+
+    pthread_join(server, NULL);
+    SSL_free(ssl);
+    close(fd);
+    SSL_CTX_free(ctx);
+    close(b->listen_fd);
+
+    double gb = b->bytes / 1e9;
+    printf("%-8s %-7s %4s/%-4s %4s/%-4s %8.3f %8.3f %8.2f %8.2f %8.1f %8.1f\n",
+           b->ktls ? "ktls" : "user", b->version == TLS1_3_VERSION ? "TLSv1.3" : "TLSv1.2",
+           b->send_offload[0] ? "yes" : "no", b->recv_offload[0] ? "yes" : "no",
+           b->send_offload[1] ? "yes" : "no", b->recv_offload[1] ? "yes" : "no",
+           b->server_tx_cpu / gb, b->server_rx_cpu / gb,
+           gb / b->tx_wall, gb / b->rx_wall,
+           rtt[b->round_trips / 2], rtt[(size_t)(b->round_trips * 0.99)]);
+    free(rtt);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 1024;
+    int round_trips = argc > 2 ? atoi(argv[2]) : 20000;
+    if (megabytes == 0 || round_trips < 1) {
+        fprintf(stderr, "Usage: %s [megabytes] [round-trips]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (make_cert() < 0) {
+        fprintf(stderr, "Unable to create a test certificate\n");
+        return EXIT_FAILURE;
+    }
+
+    int err = ktls_probe();
+    if (err)
+        printf("Kernel TLS unavailable (%s), measuring user-space TLS only\n", strerror(err));
+
+    printf("%-8s %-7s %-9s %-9s %8s %8s %8s %8s %8s %8s\n", "mode", "version",
+           "srv tx/rx", "cli tx/rx", "cpu s/GB", "cpu s/GB", "GB/s", "GB/s", "p50 us", "p99 us");
+    printf("%-8s %-7s %-9s %-9s %8s %8s %8s %8s %8s %8s\n", "", "", "offload", "offload",
+           "srv send", "srv recv", "send", "recv", "rtt", "rtt");
+
+    static const int versions[] = { TLS1_2_VERSION, TLS1_3_VERSION };
+    for (int ktls = 0; ktls <= (err ? 0 : 1); ktls++) {
+        for (size_t v = 0; v < sizeof(versions) / sizeof(versions[0]); v++) {
+            bench_t b = {
+                .ktls = ktls,
+                .version = versions[v],
+                .bytes = megabytes << 20,
+                .round_trips = round_trips
+            };
+            if (run(&b) < 0) {
+                perror("loopback run");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
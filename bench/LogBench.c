@@ -0,0 +1,91 @@
+// What a log call costs the thread that makes it: below the level, a record
+// of a few numbers, of a station id, and of a 200-byte OCPP payload, against
+// the snprintf the formatter then does for it. Records go out in bursts a
+// quarter of the ring long, flushed between bursts, so none are dropped; the
+// output goes to /dev/null.
+// Usage: LogBench [records]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Log.h"
+
+#define BURST_BYTES (LOG_RING_SIZE / 4)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char station[] = "CP-000123";
+static const char payload[] =
+    "[2,\"19223201\",\"MeterValues\",{\"connectorId\":1,\"transactionId\":4711,\"meterValue\":[{\"timestamp\":"
+    "\"2026-10-18T10:00:00Z\",\"sampledValue\":[{\"value\":\"1234.5\",\"measurand\":\"Energy.Active.Import.Register\","
+    "\"unit\":\"Wh\"}]}]}]";
+
+// Seconds per record over count records, in bursts of burst
+#define TIME_BURSTS(count, burst, stmt) ({ \
+        double total_ = 0; \
+        for (long done_ = 0; done_ < (count); done_ += (burst)) { \
+            double start_ = now_sec(); \
+            for (long i = 0; i < (burst); i++) \
+                stmt; \
+            total_ += now_sec() - start_; \
+            log_stop(); \
+            log_start(); \
+        } \
+        total_ / (double)(count); \
+    })
+
+int main(int argc, char **argv) {
+    long count = argc > 1 ? atol(argv[1]) : 2000000;
+    if (count < 1) {
+        fprintf(stderr, "Usage: %s [records]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null < 0 || dup2(null, STDOUT_FILENO) < 0) {
+        perror("/dev/null");
+        return EXIT_FAILURE;
+    }
+    log_set_level(LOG_LEVEL_INFO);
+    if (log_start() < 0) {
+        perror("log_start");
+        return EXIT_FAILURE;
+    }
+
+    double start = now_sec();
+    for (long i = 0; i < count; i++)
+        LOG_DEBUG("Received from %s: %s", station, LOG_SPAN(payload, sizeof(payload) - 1));
+    double disabled = (now_sec() - start) / (double)count;
+
+    double numbers = TIME_BURSTS(count, BURST_BYTES / 64,
+        LOG_INFO("Dropping slow connection (fd %d, %zu bytes queued)", (int)i, (size_t)i * 3));
+    double string = TIME_BURSTS(count, BURST_BYTES / 64,
+        LOG_INFO("Station %s disconnected after %ld s, %u messages", station, (long)i, (unsigned)i));
+    log_set_level(LOG_LEVEL_DEBUG);
+    double span = TIME_BURSTS(count, BURST_BYTES / 256,
+        LOG_DEBUG("Received from %s: %s", station, LOG_SPAN(payload, sizeof(payload) - 1)));
+    log_stop();
+
+    char line[512];
+    start = now_sec();
+    for (long i = 0; i < count; i++)
+        snprintf(line, sizeof(line), "Station %s disconnected after %ld s, %u messages\n", station, (long)i, (unsigned)i);
+    double formatted = (now_sec() - start) / (double)count;
+
+    dup2(saved, STDOUT_FILENO);
+    printf("%ld records\n", count);
+    printf("  below the level    %6.2f ns\n", disabled * 1e9);
+    printf("  two numbers        %6.2f ns\n", numbers * 1e9);
+    printf("  string, numbers    %6.2f ns\n", string * 1e9);
+    printf("  %3zu-byte payload   %6.2f ns\n", sizeof(payload) - 1, span * 1e9);
+    printf("  snprintf instead   %6.2f ns\n", formatted * 1e9);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+// Recording metrics into a worker's shard of shared memory: a counter, a
+// frame by opcode, an OCPP message by action and a latency, against a locked
+// atomic add for scale. Then the same counter bumped by several forked
+// workers at once, checked against what they did, and what a scrape costs.
+// Usage: MetricsBench [iterations] [workers]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "Metrics.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t shared_counter;
+static volatile uint64_t sink;
+
+int main(int argc, char **argv) {
+    long count = argc > 1 ? atol(argv[1]) : 100000000;
+    int workers = argc > 2 ? atoi(argv[2]) : 4;
+    if (count < 1 || workers < 1 || workers > 256) {
+        fprintf(stderr, "Usage: %s [iterations] [workers]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (metrics_init(workers) < 0) {
+        perror("metrics_init");
+        return EXIT_FAILURE;
+    }
+    metrics_attach(0);
+
+    double start = now_sec();
+    for (long i = 0; i < count; i++)
+        metric_inc(METRIC_BYTES_RECEIVED);
+    double counter = now_sec() - start;
+
+    start = now_sec();
+    for (long i = 0; i < count; i++)
+        metric_frame(i & 1, (uint8_t)(i & 3));
+    double frame = now_sec() - start;
+
+    start = now_sec();
+    for (long i = 0; i < count; i++)
+        metric_ocpp_received(2 + (int)(i % 3), (int)(i % OCPP_ACTION_COUNT));
+    double ocpp = now_sec() - start;
+
+    start = now_sec();
+    for (long i = 0; i < count; i++)
+        metric_observe(METRIC_DISPATCH, (uint64_t)i & 0xFFFFF);
+    double observe = now_sec() - start;
+
+    start = now_sec();
+    for (long i = 0; i < count; i++)
+        __atomic_fetch_add(&shared_counter, 1, __ATOMIC_RELAXED);
+    double locked = now_sec() - start;
+
+    long timed = count / 10 + 1;
+    start = now_sec();
+    for (long i = 0; i < timed; i++)
+        sink = metrics_clock_ns();
+    double clock = now_sec() - start;
+
+    printf("%ld records\n", count);
+    printf("  counter            %6.2f ns\n", counter * 1e9 / count);
+    printf("  frame by opcode    %6.2f ns\n", frame * 1e9 / count);
+    printf("  OCPP by action     %6.2f ns\n", ocpp * 1e9 / count);
+    printf("  histogram          %6.2f ns\n", observe * 1e9 / count);
+    printf("  locked atomic add  %6.2f ns\n", locked * 1e9 / count);
+    printf("  clock read         %6.2f ns\n", clock * 1e9 / timed);
+
+    // Every worker in its own shard, none waiting on another
+    long each = count / workers;
+    pid_t pids[256];
+    start = now_sec();
+    for (int w = 0; w < workers; w++) {
+        pids[w] = fork();
+        if (pids[w] == 0) {
+            metrics_attach(w);
+            for (long i = 0; i < each; i++)
+                metric_inc(METRIC_ACCEPTED);
+            _exit(0);
+        }
+    }
+    for (int w = 0; w < workers; w++)
+        waitpid(pids[w], NULL, 0);
+    double parallel = now_sec() - start;
+    printf("  %d workers          %6.2f ns per record, wall clock\n", workers, parallel * 1e9 / (double)(each * workers));
+
+    char *text = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&text, &len);
+    start = now_sec();
+    metrics_write(f);
+    fflush(f);
+    double scrape = now_sec() - start;
+    printf("  scrape             %6.1f us, %zu bytes\n", scrape * 1e6, len);
+
+    // Everything the workers counted, and nothing else, summed up
+    unsigned long long expected = (unsigned long long)(each * workers), found = 0;
+    char *line = strstr(text, "\nws_connections_accepted_total ");
+    if (line)
+        found = strtoull(line + sizeof("\nws_connections_accepted_total ") - 1, NULL, 10);
+    fclose(f);
+    free(text);
+    if (found != expected) {
+        fprintf(stderr, "accepted: %llu counted, %llu recorded\n", found, expected);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
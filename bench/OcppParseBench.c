@@ -0,0 +1,210 @@
+// OCPP payloads: the generated one-pass parsers and writers against cJSON
+// building a tree and walking it for the same fields. The cJSON side is only
+// built when the library was found (BENCH_HAVE_CJSON).
+// Usage: OcppParseBench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "OcppMessages.h"
+#ifdef BENCH_HAVE_CJSON
+#include <cjson/cJSON.h>
+#endif
+
+static const char meter_values_16[] =
+    "{\"connectorId\":1,\"transactionId\":12345,\"meterValue\":[{\"timestamp\":\"2024-12-26T12:00:00Z\","
+    "\"sampledValue\":[{\"value\":\"50.5\",\"context\":\"Sample.Periodic\",\"measurand\":\"Energy.Active.Import.Register\","
+    "\"unit\":\"Wh\"},{\"value\":\"230.1\",\"context\":\"Sample.Periodic\",\"measurand\":\"Voltage\",\"phase\":\"L1-N\","
+    "\"unit\":\"V\"},{\"value\":\"16.0\",\"context\":\"Sample.Periodic\",\"measurand\":\"Current.Import\",\"phase\":\"L1\","
+    "\"unit\":\"A\"}]}]}";
+
+static const char meter_values_201[] =
+    "{\"evseId\":1,\"meterValue\":[{\"timestamp\":\"2024-12-26T12:00:00Z\",\"sampledValue\":["
+    "{\"value\":50.5,\"context\":\"Sample.Periodic\",\"measurand\":\"Energy.Active.Import.Register\","
+    "\"unitOfMeasure\":{\"unit\":\"Wh\"}},{\"value\":230.1,\"context\":\"Sample.Periodic\",\"measurand\":\"Voltage\","
+    "\"phase\":\"L1-N\",\"unitOfMeasure\":{\"unit\":\"V\"}},{\"value\":16,\"context\":\"Sample.Periodic\","
+    "\"measurand\":\"Current.Import\",\"phase\":\"L1\",\"unitOfMeasure\":{\"unit\":\"A\"}}]}]}";
+
+static const char status_16[] =
+    "{\"connectorId\":1,\"errorCode\":\"NoError\",\"status\":\"Charging\",\"timestamp\":\"2024-12-26T12:00:00Z\"}";
+
+static const char status_201[] =
+    "{\"timestamp\":\"2024-12-26T12:00:00Z\",\"connectorStatus\":\"Occupied\",\"evseId\":1,\"connectorId\":1}";
+
+static char scratch[4096];
+static volatile size_t sink;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *what, double seconds, long iterations, size_t bytes) {
+    printf("%-36s %8.1f ns/msg %8.1f MB/s\n", what, seconds / iterations * 1e9,
+           bytes * (double)iterations / seconds / 1e6);
+}
+
+static int parse_meter_values_16(const char *text, size_t len) {
+    ocpp16_meter_values_request_t v;
+    ocpp_json_t j;
+    ocpp_json_init(&j, text, len, scratch, sizeof(scratch));
+    if (ocpp16_meter_values_request_parse(&j, &v) < 0)
+        return -1;
+    sink += v.meter_value[0].sampled_value_count + v.meter_value[0].sampled_value[0].measurand;
+    return 0;
+}
+
+static int parse_meter_values_201(const char *text, size_t len) {
+    ocpp201_meter_values_request_t v;
+    ocpp_json_t j;
+    ocpp_json_init(&j, text, len, scratch, sizeof(scratch));
+    if (ocpp201_meter_values_request_parse(&j, &v) < 0)
+        return -1;
+    sink += v.meter_value[0].sampled_value_count + (size_t)v.meter_value[0].sampled_value[0].value;
+    return 0;
+}
+
+static int parse_status_16(const char *text, size_t len) {
+    ocpp16_status_notification_request_t v;
+    ocpp_json_t j;
+    ocpp_json_init(&j, text, len, scratch, sizeof(scratch));
+    if (ocpp16_status_notification_request_parse(&j, &v) < 0)
+        return -1;
+    sink += v.status;
+    return 0;
+}
+
+static int parse_status_201(const char *text, size_t len) {
+    ocpp201_status_notification_request_t v;
+    ocpp_json_t j;
+    ocpp_json_init(&j, text, len, scratch, sizeof(scratch));
+    if (ocpp201_status_notification_request_parse(&j, &v) < 0)
+        return -1;
+    sink += v.connector_status;
+    return 0;
+}
+
+static size_t write_status_16(char *out, size_t size) {
+    ocpp16_status_notification_request_t v = {
+        .connector_id = 1,
+        .error_code = OCPP16_STATUS_NOTIFICATION_ERROR_CODE_NO_ERROR,
+        .status = OCPP16_STATUS_NOTIFICATION_STATUS_CHARGING,
+        .has_timestamp = true,
+        .timestamp = OCPP_STR("2024-12-26T12:00:00Z")
+    };
+    ocpp_writer_t w;
+    ocpp_writer_init(&w, out, size);
+    ocpp16_status_notification_request_write(&w, &v);
+    return w.len;
+}
+
+#ifdef BENCH_HAVE_CJSON
+// What a handler does with cJSON: build the tree, then look up and check
+// the fields it needs
+static int cjson_meter_values(const char *text, size_t len) {
+    cJSON *root = cJSON_ParseWithLength(text, len);
+    if (!root)
+        return -1;
+    int rc = -1;
+    cJSON *connector = cJSON_GetObjectItemCaseSensitive(root, "connectorId");
+    cJSON *evse = cJSON_GetObjectItemCaseSensitive(root, "evseId");
+    cJSON *values = cJSON_GetObjectItemCaseSensitive(root, "meterValue");
+    if ((cJSON_IsNumber(connector) || cJSON_IsNumber(evse)) && cJSON_IsArray(values)) {
+        cJSON *mv;
+        cJSON_ArrayForEach(mv, values) {
+            cJSON *ts = cJSON_GetObjectItemCaseSensitive(mv, "timestamp");
+            cJSON *samples = cJSON_GetObjectItemCaseSensitive(mv, "sampledValue");
+            if (!cJSON_IsString(ts) || !cJSON_IsArray(samples))
+                goto out;
+            cJSON *sv;
+            cJSON_ArrayForEach(sv, samples) {
+                cJSON *value = cJSON_GetObjectItemCaseSensitive(sv, "value");
+                cJSON *measurand = cJSON_GetObjectItemCaseSensitive(sv, "measurand");
+                if (!value || (measurand && !cJSON_IsString(measurand)))
+                    goto out;
+                sink += measurand ? strlen(measurand->valuestring) : 0;
+            }
+        }
+        rc = 0;
+    }
+out:
+    cJSON_Delete(root);
+    return rc;
+}
+
+static int cjson_status(const char *text, size_t len) {
+    cJSON *root = cJSON_ParseWithLength(text, len);
+    if (!root)
+        return -1;
+    cJSON *status = cJSON_GetObjectItemCaseSensitive(root, "status");
+    if (!status)
+        status = cJSON_GetObjectItemCaseSensitive(root, "connectorStatus");
+    cJSON *connector = cJSON_GetObjectItemCaseSensitive(root, "connectorId");
+    int rc = cJSON_IsString(status) && cJSON_IsNumber(connector) ? 0 : -1;
+    if (rc == 0)
+        sink += strlen(status->valuestring);
+    cJSON_Delete(root);
+    return rc;
+}
+
+static size_t cjson_write_status(void) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "connectorId", 1);
+    cJSON_AddStringToObject(json, "errorCode", "NoError");
+    cJSON_AddStringToObject(json, "status", "Charging");
+    cJSON_AddStringToObject(json, "timestamp", "2024-12-26T12:00:00Z");
+    char *text = cJSON_PrintUnformatted(json);
+    size_t len = strlen(text);
+    cJSON_Delete(json);
+    free(text);
+    return len;
+}
+#endif
+
+typedef int (*parse_fn)(const char *text, size_t len);
+
+static void run(const char *what, parse_fn fn, const char *text, long iterations) {
+    size_t len = strlen(text);
+    if (fn(text, len) < 0) {
+        printf("%-36s rejected its input\n", what);
+        exit(EXIT_FAILURE);
+    }
+    double start = now_sec();
+    for (long i = 0; i < iterations; i++)
+        fn(text, len);
+    report(what, now_sec() - start, iterations, len);
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+
+    run("MeterValues 1.6 generated", parse_meter_values_16, meter_values_16, iterations);
+    run("MeterValues 2.0.1 generated", parse_meter_values_201, meter_values_201, iterations);
+    run("StatusNotification 1.6 generated", parse_status_16, status_16, iterations);
+    run("StatusNotification 2.0.1 generated", parse_status_201, status_201, iterations);
+#ifdef BENCH_HAVE_CJSON
+    run("MeterValues 1.6 cJSON", cjson_meter_values, meter_values_16, iterations);
+    run("MeterValues 2.0.1 cJSON", cjson_meter_values, meter_values_201, iterations);
+    run("StatusNotification 1.6 cJSON", cjson_status, status_16, iterations);
+    run("StatusNotification 2.0.1 cJSON", cjson_status, status_201, iterations);
+#endif
+
+    char out[256];
+    size_t len = write_status_16(out, sizeof(out));
+    double start = now_sec();
+    for (long i = 0; i < iterations; i++)
+        sink += write_status_16(out, sizeof(out));
+    report("StatusNotification write generated", now_sec() - start, iterations, len);
+#ifdef BENCH_HAVE_CJSON
+    start = now_sec();
+    for (long i = 0; i < iterations; i++)
+        sink += cjson_write_status();
+    report("StatusNotification write cJSON", now_sec() - start, iterations, len);
+#else
+    printf("(built without cJSON, nothing to compare against)\n");
+#endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+// OCPP-J dispatch: action lookup through the hash table against the strcmp
+// chain it replaces, and whole messages split and routed to a handler.
+// Usage: OcppRouterBench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "OcppJ.h"
+
+static const char *const actions[] = {
+#define BENCH_ACTION_NAME(id, name) name,
+    OCPP_ACTIONS(BENCH_ACTION_NAME)
+#undef BENCH_ACTION_NAME
+};
+
+static const char *const messages[] = {
+    "[2,\"19223201\",\"Heartbeat\",{}]",
+    "[2,\"19223202\",\"StatusNotification\",{\"connectorId\":1,\"errorCode\":\"NoError\",\"status\":\"Available\"}]",
+    "[2,\"19223203\",\"MeterValues\",{\"connectorId\":1,\"transactionId\":12345,\"meterValue\":[{\"timestamp\":"
+        "\"2024-12-26T12:00:00Z\",\"sampledValue\":[{\"value\":\"50.5\",\"context\":\"Sample.Periodic\","
+        "\"measurand\":\"Energy.Active.Import.Register\",\"unit\":\"Wh\"}]}]}]",
+    "[2,\"19223204\",\"UpdateFirmware\",{\"location\":\"https://example.com/fw.bin\",\"retrieveDate\":\"2024-12-26T12:00:00Z\"}]",
+};
+
+static size_t handled, sent_bytes;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int linear_lookup(const char *name, size_t len) {
+    for (int a = 0; a < OCPP_ACTION_COUNT; a++)
+        if (strlen(actions[a]) == len && memcmp(actions[a], name, len) == 0)
+            return a;
+    return -1;
+}
+
+static int count_send(void *transport, const struct iovec *iov, int iovcnt) {
+    (void)transport;
+    for (int i = 0; i < iovcnt; i++)
+        sent_bytes += iov[i].iov_len;
+    return 0;
+}
+
+static int on_call(ocpp_session_t *s, const ocpp_message_t *call) {
+    handled++;
+    return ocpp_reply(s, call, "{}", 2);
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+    volatile int sink = 0;
+
+    double start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        const char *name = actions[i % OCPP_ACTION_COUNT];
+        sink += ocpp_action_lookup(name, strlen(name));
+    }
+    double hashed = now_sec() - start;
+
+    start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        const char *name = actions[i % OCPP_ACTION_COUNT];
+        sink += linear_lookup(name, strlen(name));
+    }
+    double linear = now_sec() - start;
+
+    printf("%d actions\n", OCPP_ACTION_COUNT);
+    printf("hash lookup     %8.1f ns/lookup\n", hashed / iterations * 1e9);
+    printf("strcmp chain    %8.1f ns/lookup\n", linear / iterations * 1e9);
+
+    ocpp_router_t router;
+    ocpp_router_init(&router);
+    for (int a = 0; a < OCPP_ACTION_COUNT; a++)
+        ocpp_router_register(&router, (ocpp_action_t)a, on_call);
+    ocpp_session_t session;
+    ocpp_session_init(&session, &router, OCPP_V16, count_send, NULL);
+
+    size_t nmessages = sizeof(messages) / sizeof(messages[0]);
+    size_t lens[sizeof(messages) / sizeof(messages[0])];
+    for (size_t m = 0; m < nmessages; m++)
+        lens[m] = strlen(messages[m]);
+
+    start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        size_t m = (size_t)i % nmessages;
+        ocpp_session_dispatch(&session, messages[m], lens[m]);
+    }
+    double routed = now_sec() - start;
+    printf("parse + route   %8.1f ns/message  (%zu handled, %zu reply bytes)\n",
+           routed / iterations * 1e9, handled, sent_bytes);
+
+    ocpp_session_free(&session);
+    return sink == 42 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+// The cross-worker station route table: filling it, lookups that hit and
+// miss, and stations reconnecting. Then the same lookups from the main
+// process while forked workers keep moving their own stations around, with
+// every route found checked against the worker that owns the station.
+// Usage: RouteBench [stations] [workers]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "RouteTable.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define NAME_LEN 11             // CP-%08d
+
+static char *names;             // every station's id, and as many that never connect
+
+static const char *station_name(int i) {
+    return names + (size_t)i * NAME_LEN;
+}
+
+// Handles with the station in the slot half and the worker's pass in the generation
+static conn_handle_t station_handle(int i, uint32_t pass) {
+    return (uint64_t)(pass * 2 + 1) << 32 | (uint32_t)i;
+}
+
+static void churn(int worker, int workers, int count) {
+    route_table_attach(worker);
+    for (uint32_t pass = 1;; pass++) {
+        for (int i = worker; i < count; i += workers) {
+            route_table_clear(station_name(i), NAME_LEN, station_handle(i, pass - 1));
+            route_table_set(station_name(i), NAME_LEN, station_handle(i, pass));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    int workers = argc > 2 ? atoi(argv[2]) : 2;
+    if (count < 1 || count >= 50000000 || workers < 1 || workers > 255) {
+        fprintf(stderr, "Usage: %s [stations] [workers]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (route_table_init((unsigned)count) < 0) {
+        perror("route_table_init");
+        return EXIT_FAILURE;
+    }
+    names = malloc((size_t)count * 2 * NAME_LEN + 1);
+    if (!names)
+        return EXIT_FAILURE;
+    for (int i = 0; i < 2 * count; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "CP-%08d", i);
+        memcpy(names + (size_t)i * NAME_LEN, name, NAME_LEN);
+    }
+    route_t route;
+
+    // Every station connects to the worker it will churn on later
+    double start = now_sec();
+    for (int i = 0; i < count; i++) {
+        route_table_attach(i % workers);
+        route_table_set(station_name(i), NAME_LEN, station_handle(i, 0));
+    }
+    double fill = now_sec() - start;
+
+    size_t found = 0;
+    start = now_sec();
+    for (int i = 0; i < count; i++) {
+        int s = (int)(((uint64_t)i * 2654435761u) % (uint64_t)count);
+        found += route_table_lookup(station_name(s), NAME_LEN, &route) == 0;
+    }
+    double hit = now_sec() - start;
+
+    size_t missed = 0;
+    start = now_sec();
+    for (int i = 0; i < count; i++)
+        missed += route_table_lookup(station_name(count + i), NAME_LEN, &route) < 0;
+    double miss = now_sec() - start;
+
+    printf("%d stations, %d workers\n", count, workers);
+    printf("  set            %8.1f ns per station\n", fill * 1e9 / count);
+    printf("  lookup hit     %8.1f ns (%zu found)\n", hit * 1e9 / count, found);
+    printf("  lookup miss    %8.1f ns (%zu missed)\n", miss * 1e9 / count, missed);
+
+    // The workers move their stations to new connections as fast as they can
+    // while the main process routes commands
+    pid_t pids[255];
+    for (int w = 0; w < workers; w++) {
+        pids[w] = fork();
+        if (pids[w] == 0) {
+            churn(w, workers, count);
+            _exit(0);
+        }
+    }
+    size_t lookups = 0, misrouted = 0;
+    found = 0;
+    start = now_sec();
+    while (now_sec() - start < 2.0) {
+        for (int i = 0; i < 100000; i++, lookups++) {
+            int s = (int)((lookups * 2654435761u) % (uint64_t)count);
+            if (route_table_lookup(station_name(s), NAME_LEN, &route) == 0) {
+                found++;
+                if (route.worker != s % workers || (uint32_t)route.handle != (uint32_t)s)
+                    misrouted++;
+            }
+        }
+    }
+    double contended = now_sec() - start;
+    for (int w = 0; w < workers; w++)
+        kill(pids[w], SIGKILL);
+    for (int w = 0; w < workers; w++) {
+        waitpid(pids[w], NULL, 0);
+        route_table_worker_exited(w);
+    }
+
+    printf("  lookup churn   %8.1f ns (%zu lookups, %.1f%% found, %zu misrouted)\n",
+           contended * 1e9 / (double)lookups, lookups, 100.0 * (double)found / (double)lookups, misrouted);
+    route_table_report(stdout);
+    free(names);
+    return misrouted ? EXIT_FAILURE : EXIT_SUCCESS;
+}
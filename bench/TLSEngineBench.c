@@ -0,0 +1,177 @@
+// The TLS engine with no sockets at all: a client and a server engine joined
+// by memcpy. Measures handshake rate (full and resumed), bulk record
+// throughput, and how many small messages fit into one batch of ciphertext,
+// i.e. what a single send carries when records are flushed together.
+// Usage: TLSEngineBench [seconds-per-case]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/err.h>
+#include <openssl/x509.h>
+
+#include "TLSEngine.h"
+
+#define BULK_SIZE 16384
+#define SMALL_SIZE 256
+
+static EVP_PKEY *pkey;
+static X509 *cert;
+static SSL_CTX *server_ctx, *client_ctx;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int make_cert(void) {
+    pkey = EVP_EC_gen("P-256");
+    cert = X509_new();
+    if (!pkey || !cert) return -1;
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, pkey);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    return X509_sign(cert, pkey, EVP_sha256()) > 0 ? 0 : -1;
+}
+
+// Move ciphertext from one engine to the other. Returns the bytes moved.
+static size_t transfer(tls_engine_t *from, tls_engine_t *to) {
+    size_t moved = 0;
+    for (;;) {
+        size_t len, avail;
+        const uint8_t *src = tls_engine_output(from, &len);
+        uint8_t *dst = src ? tls_engine_input(to, &avail) : NULL;
+        if (!dst)
+            return moved;
+        size_t n = len < avail ? len : avail;
+        memcpy(dst, src, n);
+        tls_engine_commit(to, n);
+        tls_engine_consume(from, n);
+        moved += n;
+    }
+}
+
+static int pump(tls_engine_t *a, tls_engine_t *b) {
+    return transfer(a, b) + transfer(b, a) > 0;
+}
+
+static int connect_pair(tls_engine_t *client, tls_engine_t *server, SSL_SESSION *resume) {
+    if (tls_engine_init(client, client_ctx, 0, -1) < 0 || tls_engine_init(server, server_ctx, 1, -1) < 0)
+        return -1;
+    if (resume)
+        SSL_set_session(client->ssl, resume);
+
+    int c = 0, s = 0;
+    do {
+        if (c <= 0 && (c = tls_engine_handshake(client)) < 0) return -1;
+        if (s <= 0 && (s = tls_engine_handshake(server)) < 0) return -1;
+    } while (pump(client, server) || c <= 0 || s <= 0);
+    return 0;
+}
+
+// The ticket a TLS 1.3 server sends once the handshake is over. A server
+// that resumed writes it on its next read, so let both sides run first. The
+// client gets a copy, as it would from disk: the live object is retired once
+// a connection has resumed from it.
+static SSL_SESSION *take_session(tls_engine_t *client, tls_engine_t *server) {
+    uint8_t byte;
+    tls_engine_read(server, &byte, 1);
+    transfer(server, client);
+    tls_engine_read(client, &byte, 1);
+    return SSL_SESSION_dup(SSL_get0_session(client->ssl));
+}
+
+// With resume set each connection offers the ticket from the previous one:
+// TLS 1.3 clients use a ticket only once.
+static void bench_handshakes(double budget, SSL_SESSION **resume) {
+    size_t count = 0, reused = 0;
+    double start = now_sec(), elapsed;
+    do {
+        tls_engine_t client, server;
+        if (connect_pair(&client, &server, resume ? *resume : NULL) < 0) {
+            ERR_print_errors_fp(stderr);
+            exit(EXIT_FAILURE);
+        }
+        reused += SSL_session_reused(client.ssl);
+        if (resume) {
+            SSL_SESSION_free(*resume);
+            *resume = take_session(&client, &server);
+        }
+        tls_engine_free(&client);
+        tls_engine_free(&server);
+        count++;
+        elapsed = now_sec() - start;
+    } while (elapsed < budget);
+    printf("%-28s %10.0f handshakes/s  (%zu/%zu resumed)\n",
+           resume ? "resumed handshake" : "full handshake", count / elapsed, reused, count);
+}
+
+// Write messages of size bytes from client to server, flushing the ciphertext
+// every batch writes. Reports plaintext throughput and bytes per flush.
+static void bench_stream(tls_engine_t *client, tls_engine_t *server, size_t size, int batch, double budget) {
+    static uint8_t buf[BULK_SIZE];
+    size_t bytes = 0, flushes = 0, wire = 0;
+    double start = now_sec(), elapsed;
+    do {
+        for (int i = 0; i < batch; i++) {
+            while (tls_engine_write(client, buf, size) == 0) {
+                wire += transfer(client, server);
+                flushes++;
+                while (tls_engine_read(server, buf, sizeof(buf)) > 0)
+                    ;
+            }
+            bytes += size;
+        }
+        wire += transfer(client, server);
+        flushes++;
+        while (tls_engine_read(server, buf, sizeof(buf)) > 0)
+            ;
+        elapsed = now_sec() - start;
+    } while (elapsed < budget);
+    printf("%5zu-byte writes x%-3d        %10.2f MB/s  %8.0f writes/s  %7.0f bytes/flush\n",
+           size, batch, bytes / elapsed / 1e6, bytes / size / elapsed, (double)wire / flushes);
+}
+
+int main(int argc, char **argv) {
+    double budget = argc > 1 ? atof(argv[1]) : 1.0;
+    if (make_cert() < 0) {
+        fprintf(stderr, "Unable to create a test certificate\n");
+        return EXIT_FAILURE;
+    }
+    server_ctx = SSL_CTX_new(TLS_server_method());
+    client_ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_use_certificate(server_ctx, cert);
+    SSL_CTX_use_PrivateKey(server_ctx, pkey);
+    SSL_CTX_set_mode(server_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    SSL_CTX_set_mode(client_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    tls_engine_t client, server;
+    if (connect_pair(&client, &server, NULL) < 0) {
+        ERR_print_errors_fp(stderr);
+        return EXIT_FAILURE;
+    }
+    printf("%s %s, %d-byte engine buffers\n", SSL_get_version(client.ssl),
+           SSL_get_cipher(client.ssl), TLS_ENGINE_BUFFER_SIZE);
+    SSL_SESSION *session = take_session(&client, &server);
+
+    bench_handshakes(budget, NULL);
+    bench_handshakes(budget, &session);
+    bench_stream(&client, &server, BULK_SIZE, 1, budget);
+    bench_stream(&client, &server, SMALL_SIZE, 1, budget);
+    bench_stream(&client, &server, SMALL_SIZE, 16, budget);
+    bench_stream(&client, &server, SMALL_SIZE, 64, budget);
+
+    SSL_SESSION_free(session);
+    tls_engine_free(&client);
+    tls_engine_free(&server);
+    SSL_CTX_free(server_ctx);
+    SSL_CTX_free(client_ctx);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+// Connection timers on a simulated clock: arming, then ten minutes of ticks
+// with every station's liveness timer firing and re-arming once a minute,
+// against sweeping all deadlines every tick. Also the cost of a tick when
+// nothing is due for an hour.
+// Usage: TimerWheelBench [timers]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "TimerWheel.h"
+
+#define INTERVAL_MS (60 * 1000)
+#define SIM_MS      (10 * 60 * 1000)
+
+typedef struct {
+    wheel_timer_t timer;
+    uint64_t deadline;          // for the sweep
+} station_t;
+
+static size_t fired;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void on_expire(timer_wheel_t *w, wheel_timer_t *t) {
+    fired++;
+    timer_arm(w, t, INTERVAL_MS);
+}
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    if (count < 1) {
+        fprintf(stderr, "Usage: %s [timers]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    station_t *stations = calloc((size_t)count, sizeof(*stations));
+    timer_wheel_t *w = malloc(sizeof(*w));
+    if (!stations || !w)
+        return EXIT_FAILURE;
+    srand(1);
+
+    // Stations connected at random points of the last minute
+    timer_wheel_init(w, 0);
+    double start = now_sec();
+    for (int i = 0; i < count; i++) {
+        timer_init(&stations[i].timer, on_expire);
+        timer_arm(w, &stations[i].timer, (uint64_t)(rand() % INTERVAL_MS));
+    }
+    double armed = now_sec() - start;
+
+    start = now_sec();
+    size_t ticks = 0;
+    for (uint64_t ms = TIMER_TICK_MS; ms <= SIM_MS; ms += TIMER_TICK_MS, ticks++)
+        timer_wheel_advance(w, ms);
+    double wheel = now_sec() - start;
+    size_t wheel_fired = fired;
+
+    // The same schedule, found by looking at every station each tick
+    for (int i = 0; i < count; i++)
+        stations[i].deadline = (uint64_t)(rand() % INTERVAL_MS);
+    fired = 0;
+    start = now_sec();
+    for (uint64_t ms = TIMER_TICK_MS; ms <= SIM_MS; ms += TIMER_TICK_MS) {
+        for (int i = 0; i < count; i++) {
+            if (stations[i].deadline <= ms) {
+                fired++;
+                stations[i].deadline = ms + INTERVAL_MS;
+            }
+        }
+    }
+    double sweep = now_sec() - start;
+
+    // Everything an hour away: ticks should find nothing to do
+    timer_wheel_init(w, 0);
+    for (int i = 0; i < count; i++) {
+        timer_init(&stations[i].timer, on_expire);
+        timer_arm(w, &stations[i].timer, 3600 * 1000 + (uint64_t)(rand() % INTERVAL_MS));
+    }
+    start = now_sec();
+    for (uint64_t ms = TIMER_TICK_MS; ms <= SIM_MS; ms += TIMER_TICK_MS)
+        timer_wheel_advance(w, ms);
+    double quiet = now_sec() - start;
+
+    printf("%d timers, %zu ticks of %d ms\n", count, ticks, TIMER_TICK_MS);
+    printf("  arm            %8.1f ns per timer\n", armed * 1e9 / count);
+    printf("  wheel          %8.1f us per tick  %6.1f ns per expiry (%zu fired)\n",
+           wheel * 1e6 / ticks, wheel * 1e9 / wheel_fired, wheel_fired);
+    printf("  sweep          %8.1f us per tick  (%zu fired)\n", sweep * 1e6 / ticks, fired);
+    printf("  quiet wheel    %8.1f ns per tick\n", quiet * 1e9 / ticks);
+
+    free(w);
+    free(stations);
+    return EXIT_SUCCESS;
+}
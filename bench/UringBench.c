@@ -0,0 +1,270 @@
+// The server's event loop on epoll and on io_uring, over loopback ws://.
+// A worker is forked for each backend and clients pipeline Heartbeats at it:
+// one untraced run for messages per second, then a run under ptrace that
+// counts the worker's system calls per message.
+// Usage: UringBench [connections] [window] [seconds] [port]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "TLSServer.h"
+
+#define HEARTBEAT "[2,\"1\",\"Heartbeat\",{}]"
+#define MAX_WINDOW 256
+
+typedef struct {
+    int connections;
+    int window;             // requests in flight per connection
+    double seconds;
+    int port;
+    volatile int stop;
+    size_t messages;        // replies received, all clients
+} load_t;
+
+static volatile unsigned long syscalls;   // worker syscall entries, traced runs
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run_worker(int port, int io_uring) {
+    // Replies are logged per message; keep that off the terminal and cheap
+    if (!freopen("/dev/null", "w", stdout))
+        exit(EXIT_FAILURE);
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+    server_config.port = port;
+    server_config.plain = 1;
+    server_config.io_uring = io_uring;
+    websocket_server();
+    exit(EXIT_SUCCESS);
+}
+
+// Retries while the worker starts, and while a killed worker's listener
+// lingers: the kernel tears its ring (and the accept holding the socket)
+// down asynchronously, resetting whatever connected in the meantime.
+static int client_connect(int port) {
+    static const char req[] =
+        "GET /CP001 HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+        "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    for (int attempt = 0; attempt < 500; attempt++, usleep(10000)) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+            write(fd, req, sizeof(req) - 1) != (ssize_t)(sizeof(req) - 1)) {
+            close(fd);
+            continue;
+        }
+        char buf[1024];
+        size_t got = 0;
+        ssize_t n;
+        while (got < sizeof(buf) - 1 && (n = read(fd, buf + got, sizeof(buf) - 1 - got)) > 0) {
+            got += (size_t)n;
+            buf[got] = '\0';
+            if (strstr(buf, "\r\n\r\n")) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                return fd;
+            }
+        }
+        close(fd);
+    }
+    return -1;
+}
+
+// Count the server frames in buf, keeping a partial one for the next read
+static size_t count_frames(uint8_t *buf, size_t *len) {
+    size_t off = 0, frames = 0;
+    while (*len - off >= 2) {
+        size_t n = buf[off + 1] & 0x7f, h = 2;
+        if (n == 126) {
+            if (*len - off < 4) break;
+            n = (size_t)buf[off + 2] << 8 | buf[off + 3];
+            h = 4;
+        } else if (n == 127) {
+            break;  // no reply is that large
+        }
+        if (*len - off < h + n)
+            break;
+        off += h + n;
+        frames++;
+    }
+    memmove(buf, buf + off, *len - off);
+    *len -= off;
+    return frames;
+}
+
+static void *client_thread(void *arg) {
+    load_t *load = arg;
+    int fd = client_connect(load->port);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to connect to the worker\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // One masked Heartbeat, repeated window times per write
+    uint8_t frame[64];
+    size_t flen = sizeof(HEARTBEAT) - 1;
+    static const uint8_t key[4] = { 0x12, 0x34, 0x56, 0x78 };
+    frame[0] = 0x81;
+    frame[1] = 0x80 | (uint8_t)flen;
+    memcpy(frame + 2, key, 4);
+    for (size_t i = 0; i < flen; i++)
+        frame[6 + i] = (uint8_t)HEARTBEAT[i] ^ key[i & 3];
+    flen += 6;
+    static __thread uint8_t batch[MAX_WINDOW * 64];
+    for (int i = 0; i < load->window; i++)
+        memcpy(batch + i * flen, frame, flen);
+
+    uint8_t buf[65536];
+    size_t have = 0;
+    while (!load->stop) {
+        if (write(fd, batch, load->window * flen) < 0)
+            break;
+        for (size_t pending = (size_t)load->window; pending > 0;) {
+            ssize_t n = read(fd, buf + have, sizeof(buf) - have);
+            if (n <= 0)
+                goto out;
+            have += (size_t)n;
+            size_t frames = count_frames(buf, &have);
+            pending -= frames < pending ? frames : pending;
+        }
+        __atomic_fetch_add(&load->messages, (size_t)load->window, __ATOMIC_RELAXED);
+    }
+out:
+    close(fd);
+    return NULL;
+}
+
+// Drive the worker for load->seconds. Returns messages/s and leaves the
+// count in load->messages; *calls gets the worker's syscalls over the same
+// span when traced.
+static double run_load(load_t *load, unsigned long *calls) {
+    pthread_t threads[load->connections];
+    load->stop = 0;
+    load->messages = 0;
+    for (int i = 0; i < load->connections; i++)
+        pthread_create(&threads[i], NULL, client_thread, load);
+
+    // Connections are set up and warm before the clock starts
+    usleep(200000);
+    size_t start_messages = __atomic_load_n(&load->messages, __ATOMIC_RELAXED);
+    unsigned long start_calls = syscalls;
+    double start = now_sec();
+    usleep((useconds_t)(load->seconds * 1e6));
+    size_t messages = __atomic_load_n(&load->messages, __ATOMIC_RELAXED) - start_messages;
+    unsigned long end_calls = syscalls;
+    double elapsed = now_sec() - start;
+    load->stop = 1;
+    for (int i = 0; i < load->connections; i++)
+        pthread_join(threads[i], NULL);
+    load->messages = messages;
+    if (calls)
+        *calls = end_calls - start_calls;
+    return messages / elapsed;
+}
+
+typedef struct {
+    load_t *load;
+    pid_t worker;
+    double rate;
+    unsigned long calls;
+    size_t messages;
+} traced_t;
+
+static void *traced_load(void *arg) {
+    traced_t *t = arg;
+    t->rate = run_load(t->load, &t->calls);
+    t->messages = t->load->messages;
+    kill(t->worker, SIGKILL);
+    return NULL;
+}
+
+static void bench_backend(load_t *load, int io_uring) {
+    const char *name = io_uring ? "io_uring" : "epoll";
+
+    fflush(stdout);
+    pid_t worker = fork();
+    if (worker == 0)
+        run_worker(load->port, io_uring);
+    double rate = run_load(load, NULL);
+    kill(worker, SIGKILL);
+    waitpid(worker, NULL, 0);
+
+    // ptrace stops are only delivered to the thread that forked the tracee,
+    // so this thread traces and another drives the load
+    fflush(stdout);
+    worker = fork();
+    if (worker == 0) {
+        ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+        raise(SIGSTOP);
+        run_worker(load->port, io_uring);
+    }
+    int status;
+    waitpid(worker, &status, 0);
+    ptrace(PTRACE_SETOPTIONS, worker, NULL, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+    syscalls = 0;
+    traced_t t = { load, worker, 0, 0, 0 };
+    pthread_t driver;
+    pthread_create(&driver, NULL, traced_load, &t);
+
+    unsigned long stops = 0;
+    int sig = 0;
+    while (ptrace(PTRACE_SYSCALL, worker, NULL, (void *)(long)sig) == 0 &&
+           waitpid(worker, &status, 0) == worker && WIFSTOPPED(status)) {
+        sig = 0;
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+            syscalls = ++stops / 2;   // an entry and an exit stop per call
+        else
+            sig = WSTOPSIG(status);
+    }
+    pthread_join(driver, NULL);
+    waitpid(worker, NULL, 0);
+
+    printf("%-9s %10.0f msgs/s  %6.3f syscalls/msg  (%.0f msgs/s traced)\n",
+           name, rate, t.messages ? (double)t.calls / t.messages : 0.0, t.rate);
+}
+
+int main(int argc, char **argv) {
+    load_t load = {
+        .connections = argc > 1 ? atoi(argv[1]) : 8,
+        .window = argc > 2 ? atoi(argv[2]) : 16,
+        .seconds = argc > 3 ? atof(argv[3]) : 2.0,
+        .port = argc > 4 ? atoi(argv[4]) : 12399
+    };
+    if (load.connections < 1 || load.window < 1 || load.window > MAX_WINDOW) {
+        fprintf(stderr, "Usage: %s [connections] [window 1-%d] [seconds] [port]\n", argv[0], MAX_WINDOW);
+        return EXIT_FAILURE;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    printf("%d connections x %d Heartbeats in flight, one worker\n", load.connections, load.window);
+
+    bench_backend(&load, 0);
+    int err = uring_probe();
+    if (err)
+        printf("io_uring   unavailable (%s)\n", strerror(err));
+    else
+        bench_backend(&load, 1);
+    return EXIT_SUCCESS;
+}
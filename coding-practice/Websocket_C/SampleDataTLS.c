@@ -1,3 +1,6 @@
+// Build: gcc SampleDataTLS.c ../../src/Communication/WebSocket/Common/HandshakeCrypto.c
+//            -I../../src/Communication/WebSocket/Common -lssl -lcrypto -lcjson
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,57 +8,18 @@
 #include <arpa/inet.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
-#include <openssl/sha.h>
 #include <cjson/cJSON.h>
 #include <time.h>
 
+#include "HandshakeCrypto.h"
+
 #define PORT 12345
 #define BUFFER_SIZE 1024
-#define WEBSOCKET_MAGIC_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
-
-static const int mod_table[] = {0, 2, 1};
-
-
-// Helper to Base64 encode
-char *base64_encode(const unsigned char *input, int length) {
-    static const char encoding_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    char *encoded_data = malloc(((length + 2) / 3) * 4 + 1);
-    if (!encoded_data) return NULL;
-
-    int i, j;
-    for (i = 0, j = 0; i < length;) {
-        uint32_t octet_a = i < length ? (unsigned char)input[i++] : 0;
-        uint32_t octet_b = i < length ? (unsigned char)input[i++] : 0;
-        uint32_t octet_c = i < length ? (unsigned char)input[i++] : 0;
-
-        uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
-
-        encoded_data[j++] = encoding_table[(triple >> 18) & 0x3F];
-        encoded_data[j++] = encoding_table[(triple >> 12) & 0x3F];
-        encoded_data[j++] = encoding_table[(triple >> 6) & 0x3F];
-        encoded_data[j++] = encoding_table[triple & 0x3F];
-    }
-
-    for (int k = 0; k < mod_table[length % 3]; k++)
-        encoded_data[--j] = '=';
-
-    encoded_data[j] = '\0';
-    return encoded_data;
-}
-
-// Generate a Sec-WebSocket-Key
-void generate_websocket_key(char *key, size_t len) {
-    srand((unsigned int)time(NULL));
-    for (size_t i = 0; i < len - 1; ++i) {
-        key[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"[rand() % 62];
-    }
-    key[len - 1] = '\0';
-}
 
 // Send WebSocket Handshake Request
 void send_handshake_request(SSL *ssl) {
-    char sec_websocket_key[25];
-    generate_websocket_key(sec_websocket_key, sizeof(sec_websocket_key));
+    char sec_websocket_key[WS_KEY_LEN + 1];
+    if (ws_generate_key(sec_websocket_key) < 0) return;
 
     char request[BUFFER_SIZE];
     snprintf(request, sizeof(request),
@@ -86,21 +50,16 @@ int process_handshake_response(SSL *ssl) {
 // Handle WebSocket Handshake on Server
 int handle_handshake(SSL *ssl) {
     char buffer[BUFFER_SIZE];
-    SSL_read(ssl, buffer, sizeof(buffer));
+    int n = SSL_read(ssl, buffer, sizeof(buffer) - 1);
+    buffer[n > 0 ? n : 0] = '\0';
 
     char *key_start = strstr(buffer, "Sec-WebSocket-Key: ");
     if (!key_start) return 0;
 
     key_start += strlen("Sec-WebSocket-Key: ");
-    char sec_websocket_key[25];
-    sscanf(key_start, "%24s", sec_websocket_key);
-
-    char accept_key[SHA_DIGEST_LENGTH];
-    char concat_key[128];
-    snprintf(concat_key, sizeof(concat_key), "%s%s", sec_websocket_key, WEBSOCKET_MAGIC_GUID);
-
-    SHA1((unsigned char *)concat_key, strlen(concat_key), (unsigned char *)accept_key);
-    char *accept_key_base64 = base64_encode((unsigned char *)accept_key, SHA_DIGEST_LENGTH);
+    if (strcspn(key_start, "\r\n") != WS_KEY_LEN) return 0;
+    char accept_key_base64[WS_ACCEPT_LEN + 1];
+    ws_accept_key(key_start, accept_key_base64);
 
     char response[BUFFER_SIZE];
     snprintf(response, sizeof(response),
@@ -112,7 +71,6 @@ int handle_handshake(SSL *ssl) {
              accept_key_base64);
 
     SSL_write(ssl, response, strlen(response));
-    free(accept_key_base64);
     return 1;
 }
 
@@ -1,21 +1,257 @@
+#define _GNU_SOURCE
+#include <poll.h>
+
 #include "ProcessUtils.h"
+#include "TLSServer.h"
+#include "WorkerIpc.h"
+#include "Control.h"
+#include "MetricsHttp.h"
+
+#define RESPAWN_BACKOFF_SEC 1
+
+typedef struct {
+	pid_t pid;  /* 0 while it waits to be respawned */
+	time_t startedAt;
+	long long respawnAt;  /* CLOCK_MONOTONIC ms, while pid is 0 */
+} WorkerInfo;
+
+static WorkerInfo workers[MAX_WORKERS];
+static int numWorkers;
+static volatile sig_atomic_t shutdownRequested;
+static volatile sig_atomic_t reportRequested;
+static volatile sig_atomic_t levelToggleRequested;
+static volatile sig_atomic_t childExited;
+
+static void OnShutdownSignal(int sig)
+{
+	(void)sig;
+	shutdownRequested = 1;
+}
+
+static void OnReportSignal(int sig)
+{
+	(void)sig;
+	reportRequested = 1;
+}
+
+static void OnLevelSignal(int sig)
+{
+	(void)sig;
+	levelToggleRequested = 1;
+}
+
+static void OnChildSignal(int sig)
+{
+	(void)sig;
+	childExited = 1;
+}
+
+static long long NowMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* A fork that fails (EAGAIN, ENOMEM...) is tried again after the backoff
+ * rather than taking the supervisor, and every worker with it, down */
+static void StartWorker(int id)
+{
+	pid_t pid = SpawnWebSocketServer(id);
+	if (pid < 0) {
+		workers[id].pid = 0;
+		workers[id].respawnAt = NowMs() + RESPAWN_BACKOFF_SEC * 1000;
+		return;
+	}
+	workers[id].pid = pid;
+	workers[id].startedAt = time(NULL);
+}
 
 void SetProcessName(const char* procName)
 {
 	prctl(PR_SET_NAME, (unsigned long)procName, 0, 0, 0);
 }
 
-void SpawnOtherProcess()
+void SpawnOtherProcess(int workerCount)
 {
-	SpawnWebSocketServer();
+	if (workerCount < 1)
+		workerCount = 1;
+	if (workerCount > MAX_WORKERS)
+		workerCount = MAX_WORKERS;
+
+	numWorkers = workerCount;
+	for (int i = 0; i < numWorkers; i++)
+		StartWorker(i);
 }
 
-void SpawnWebSocketServer()
+pid_t SpawnWebSocketServer(int workerId)
 {
-	const char * procName  = "WebSocketServer";
-	PROCESS_CREATION(procName);
-	while(1){
-		//printf("WebSocket Server Running...\n");
-	}; //Start implementing Websockets from here
-	return;
+	char procName[16];
+	pid_t pid;
+
+	snprintf(procName, sizeof(procName), "WebSocketSrv%d", workerId);
+	PROCESS_CREATION(procName, pid);
+
+	/* Worker: die with the supervisor, then serve on our own SO_REUSEPORT listener */
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+	signal(SIGTERM, SIG_DFL);  /* respawned workers inherit the supervisor's handlers and mask; the loop takes it over */
+	signal(SIGINT, SIG_IGN);
+	signal(SIGUSR1, SIG_IGN);  /* only the supervisor reports */
+	signal(SIGUSR2, SIG_IGN);  /* and changes the log level, which the workers share */
+	signal(SIGCHLD, SIG_DFL);
+	sigset_t none;
+	sigemptyset(&none);
+	sigprocmask(SIG_SETMASK, &none, NULL);
+	control_close();  /* the supervisor's clients are not ours to hold open */
+	metrics_http_close();
+	worker_ipc_attach(workerId);
+	route_table_attach(workerId);
+	metrics_attach(workerId);
+	websocket_server();
+	exit(EXIT_SUCCESS);
+}
+
+static int FindWorker(pid_t pid)
+{
+	for (int i = 0; i < numWorkers; i++) {
+		if (workers[i].pid == pid)
+			return i;
+	}
+	return -1;
+}
+
+static void StopWorkers()
+{
+	for (int i = 0; i < numWorkers; i++) {
+		if (workers[i].pid > 0)
+			kill(workers[i].pid, SIGTERM);
+	}
+	while (waitpid(-1, NULL, 0) > 0 || errno == EINTR) {};
+}
+
+static void RespawnWorker(int id, int status)
+{
+	pid_t pid = workers[id].pid;
+	if (WIFSIGNALED(status))
+		fprintf(stderr, "Worker %d (pid %d) killed by signal %d\n", id, (int)pid, WTERMSIG(status));
+	else
+		fprintf(stderr, "Worker %d (pid %d) exited with status %d\n", id, (int)pid, WEXITSTATUS(status));
+	workers[id].pid = 0;
+	route_table_worker_exited(id);  /* before its replacement routes stations of its own */
+	metrics_worker_exited(id);  /* and before it counts in the same shard */
+
+	/* Do not spin on a worker that dies at startup (bad cert, port in use...);
+	 * the supervisor keeps serving while it waits */
+	if (time(NULL) - workers[id].startedAt < RESPAWN_BACKOFF_SEC) {
+		workers[id].respawnAt = NowMs() + RESPAWN_BACKOFF_SEC * 1000;
+		return;
+	}
+	StartWorker(id);
+}
+
+/* Respawn the workers whose backoff is over; returns how long until the
+ * next one is due, -1 if none is waiting */
+static int StartDueWorkers()
+{
+	long long now = NowMs();
+	long long next = -1;
+	for (int i = 0; i < numWorkers; i++) {
+		if (workers[i].pid > 0)
+			continue;
+		if (workers[i].respawnAt <= now)
+			StartWorker(i);
+		if (workers[i].pid == 0 && (next < 0 || workers[i].respawnAt - now < next))
+			next = workers[i].respawnAt > now ? workers[i].respawnAt - now : 0;
+	}
+	return (int)next;
+}
+
+/* Serve the control socket and the metrics endpoint, and respawn workers that
+ * exit, until SIGINT/SIGTERM.
+ * SIGUSR1 prints the TLS resumption and route counters the workers share;
+ * SIGUSR2 switches every process to debug logging and back. The
+ * signals stay blocked except inside ppoll(), so none slips in between a
+ * check of its flag and going to sleep. */
+void SuperviseWorkers()
+{
+	struct sigaction sa = {0};
+	sigset_t handled, waiting;
+	sigemptyset(&handled);
+	sigaddset(&handled, SIGINT);
+	sigaddset(&handled, SIGTERM);
+	sigaddset(&handled, SIGUSR1);
+	sigaddset(&handled, SIGUSR2);
+	sigaddset(&handled, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &handled, &waiting);
+
+	sa.sa_handler = OnShutdownSignal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sa.sa_handler = OnReportSignal;
+	sigaction(SIGUSR1, &sa, NULL);
+	sa.sa_handler = OnLevelSignal;
+	sigaction(SIGUSR2, &sa, NULL);
+	sa.sa_handler = OnChildSignal;
+	sa.sa_flags = SA_NOCLDSTOP;
+	sigaction(SIGCHLD, &sa, NULL);
+
+	/* What SIGUSR2 goes back to */
+	log_level_t quietLevel = log_get_level() == LOG_LEVEL_DEBUG ? LOG_LEVEL_INFO : log_get_level();
+
+	childExited = 1;  /* a worker may have died before the handler was in place */
+	while (!shutdownRequested) {
+		if (reportRequested) {
+			reportRequested = 0;
+			session_cache_report(stdout);
+			route_table_report(stdout);
+		}
+		if (levelToggleRequested) {
+			levelToggleRequested = 0;
+			log_set_level(log_get_level() == LOG_LEVEL_DEBUG ? quietLevel : LOG_LEVEL_DEBUG);
+			printf("Log level %s\n", log_level_name(log_get_level()));
+		}
+		control_run();
+		metrics_http_run();
+
+		while (childExited && !shutdownRequested) {
+			int status;
+			pid_t pid = waitpid(-1, &status, WNOHANG);
+			if (pid <= 0) {
+				childExited = 0;
+				break;
+			}
+			int id = FindWorker(pid);
+			if (id >= 0)
+				RespawnWorker(id, status);
+		}
+		if (shutdownRequested)
+			break;
+		int respawnTimeout = StartDueWorkers();
+
+		struct pollfd pfds[2];
+		nfds_t npfds = 0;
+		if (control_fd() >= 0)
+			pfds[npfds++] = (struct pollfd){ .fd = control_fd(), .events = POLLIN };
+		if (metrics_http_fd() >= 0)
+			pfds[npfds++] = (struct pollfd){ .fd = metrics_http_fd(), .events = POLLIN };
+		int timeout = control_timeout();
+		int scrapeTimeout = metrics_http_timeout();
+		if (scrapeTimeout >= 0 && (timeout < 0 || scrapeTimeout < timeout))
+			timeout = scrapeTimeout;
+		if (respawnTimeout >= 0 && (timeout < 0 || respawnTimeout < timeout))
+			timeout = respawnTimeout;
+		struct timespec ts = { .tv_sec = timeout / 1000, .tv_nsec = (long)(timeout % 1000) * 1000000 };
+		if (ppoll(pfds, npfds, timeout < 0 ? NULL : &ts, &waiting) < 0 && errno != EINTR) {
+			perror("ppoll");
+			break;
+		}
+	}
+
+	sigprocmask(SIG_SETMASK, &waiting, NULL);
+	StopWorkers();
+	control_close();
+	metrics_http_close();
+	session_cache_report(stdout);
+	route_table_report(stdout);
 }
@@ -3,29 +3,38 @@
 #include<stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
 #include <sys/prctl.h>
 
-// Define the macro for process creation
-#define PROCESS_CREATION(procName)                     \
+#define MAX_WORKERS 256
+
+// Define the macro for process creation: the parent returns the child's
+// pid, or -1 if the fork failed
+#define PROCESS_CREATION(procName, pid)                \
     do {                                               \
-        pid_t pid = fork();                            \
+        pid = fork();                                  \
         if (pid == 0) {                                \
             /* Child process */                       \
 			SetProcessName(procName);                 \
         } else if (pid > 0) {                          \
             /* Parent process */                        \
-            return;                  					\
+            return pid;              					\
         } else {                                       \
             /* Fork failed */                          \
             perror("Fork failed");                     \
-            exit(EXIT_FAILURE);\
+            return -1;                                 \
         }                                              \
     } while (0)
 
 void SetProcessName(const char* procName);
-void SpawnOtherProcess();
-void SpawnWebSocketServer();
+void SpawnOtherProcess(int workerCount);
+/* The worker's pid, or -1 if it could not be forked */
+pid_t SpawnWebSocketServer(int workerId);
+void SuperviseWorkers();
 
 #endif
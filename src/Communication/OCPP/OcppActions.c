@@ -0,0 +1,64 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "OcppActions.h"
+
+// FNV-1a from this offset basis puts every action name in its own slot when
+// the top byte of the hash is the index. Found by search over the list
+// above: adding an action may need a new seed, which the first lookup checks.
+#define OCPP_ACTION_SEED  0x18cb8u
+#define OCPP_ACTION_SLOTS 256
+
+static const struct {
+    const char *name;
+    size_t len;
+} action_names[OCPP_ACTION_COUNT] = {
+#define OCPP_ACTION_NAME(id, name) { name, sizeof(name) - 1 },
+    OCPP_ACTIONS(OCPP_ACTION_NAME)
+#undef OCPP_ACTION_NAME
+};
+
+static uint8_t action_slots[OCPP_ACTION_SLOTS];    // action + 1, 0 when empty
+static int action_slots_ready;
+
+static unsigned action_hash(const char *name, size_t len) {
+    uint32_t h = OCPP_ACTION_SEED;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h >> 24;
+}
+
+static void action_slots_init(void) {
+    for (int a = 0; a < OCPP_ACTION_COUNT; a++) {
+        unsigned slot = action_hash(action_names[a].name, action_names[a].len);
+        if (action_slots[slot]) {
+            fprintf(stderr, "OCPP actions %s and %s share a hash slot, pick a new OCPP_ACTION_SEED\n",
+                    action_names[a].name, action_names[action_slots[slot] - 1].name);
+            abort();
+        }
+        action_slots[slot] = (uint8_t)(a + 1);
+    }
+    action_slots_ready = 1;
+}
+
+ocpp_action_t ocpp_action_lookup(const char *name, size_t len) {
+    if (!action_slots_ready)
+        action_slots_init();
+    unsigned slot = action_slots[action_hash(name, len)];
+    if (!slot)
+        return OCPP_ACTION_UNKNOWN;
+    ocpp_action_t action = (ocpp_action_t)(slot - 1);
+    if (action_names[action].len != len || memcmp(action_names[action].name, name, len) != 0)
+        return OCPP_ACTION_UNKNOWN;
+    return action;
+}
+
+const char *ocpp_action_name(ocpp_action_t action) {
+    if (action < 0 || action >= OCPP_ACTION_COUNT)
+        return "Unknown";
+    return action_names[action].name;
+}
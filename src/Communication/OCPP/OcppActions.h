@@ -0,0 +1,98 @@
+#ifndef OCPP_ACTIONS_H
+#define OCPP_ACTIONS_H
+
+#include <stddef.h>
+
+// Every action of OCPP 1.6 (with the security extension) and 2.0.1, in both
+// directions. X(ENUM_SUFFIX, "WireName")
+#define OCPP_ACTIONS(X) \
+    X(AUTHORIZE,                            "Authorize") \
+    X(BOOT_NOTIFICATION,                    "BootNotification") \
+    X(CANCEL_RESERVATION,                   "CancelReservation") \
+    X(CERTIFICATE_SIGNED,                   "CertificateSigned") \
+    X(CHANGE_AVAILABILITY,                  "ChangeAvailability") \
+    X(CHANGE_CONFIGURATION,                 "ChangeConfiguration") \
+    X(CLEAR_CACHE,                          "ClearCache") \
+    X(CLEAR_CHARGING_PROFILE,               "ClearChargingProfile") \
+    X(CLEAR_DISPLAY_MESSAGE,                "ClearDisplayMessage") \
+    X(CLEARED_CHARGING_LIMIT,               "ClearedChargingLimit") \
+    X(CLEAR_VARIABLE_MONITORING,            "ClearVariableMonitoring") \
+    X(COST_UPDATED,                         "CostUpdated") \
+    X(CUSTOMER_INFORMATION,                 "CustomerInformation") \
+    X(DATA_TRANSFER,                        "DataTransfer") \
+    X(DELETE_CERTIFICATE,                   "DeleteCertificate") \
+    X(DIAGNOSTICS_STATUS_NOTIFICATION,      "DiagnosticsStatusNotification") \
+    X(EXTENDED_TRIGGER_MESSAGE,             "ExtendedTriggerMessage") \
+    X(FIRMWARE_STATUS_NOTIFICATION,         "FirmwareStatusNotification") \
+    X(GET_15118_EV_CERTIFICATE,             "Get15118EVCertificate") \
+    X(GET_BASE_REPORT,                      "GetBaseReport") \
+    X(GET_CERTIFICATE_STATUS,               "GetCertificateStatus") \
+    X(GET_CHARGING_PROFILES,                "GetChargingProfiles") \
+    X(GET_COMPOSITE_SCHEDULE,               "GetCompositeSchedule") \
+    X(GET_CONFIGURATION,                    "GetConfiguration") \
+    X(GET_DIAGNOSTICS,                      "GetDiagnostics") \
+    X(GET_DISPLAY_MESSAGES,                 "GetDisplayMessages") \
+    X(GET_INSTALLED_CERTIFICATE_IDS,        "GetInstalledCertificateIds") \
+    X(GET_LOCAL_LIST_VERSION,               "GetLocalListVersion") \
+    X(GET_LOG,                              "GetLog") \
+    X(GET_MONITORING_REPORT,                "GetMonitoringReport") \
+    X(GET_REPORT,                           "GetReport") \
+    X(GET_TRANSACTION_STATUS,               "GetTransactionStatus") \
+    X(GET_VARIABLES,                        "GetVariables") \
+    X(HEARTBEAT,                            "Heartbeat") \
+    X(INSTALL_CERTIFICATE,                  "InstallCertificate") \
+    X(LOG_STATUS_NOTIFICATION,              "LogStatusNotification") \
+    X(METER_VALUES,                         "MeterValues") \
+    X(NOTIFY_CHARGING_LIMIT,                "NotifyChargingLimit") \
+    X(NOTIFY_CUSTOMER_INFORMATION,          "NotifyCustomerInformation") \
+    X(NOTIFY_DISPLAY_MESSAGES,              "NotifyDisplayMessages") \
+    X(NOTIFY_EV_CHARGING_NEEDS,             "NotifyEVChargingNeeds") \
+    X(NOTIFY_EV_CHARGING_SCHEDULE,          "NotifyEVChargingSchedule") \
+    X(NOTIFY_EVENT,                         "NotifyEvent") \
+    X(NOTIFY_MONITORING_REPORT,             "NotifyMonitoringReport") \
+    X(NOTIFY_REPORT,                        "NotifyReport") \
+    X(PUBLISH_FIRMWARE,                     "PublishFirmware") \
+    X(PUBLISH_FIRMWARE_STATUS_NOTIFICATION, "PublishFirmwareStatusNotification") \
+    X(REMOTE_START_TRANSACTION,             "RemoteStartTransaction") \
+    X(REMOTE_STOP_TRANSACTION,              "RemoteStopTransaction") \
+    X(REPORT_CHARGING_PROFILES,             "ReportChargingProfiles") \
+    X(REQUEST_START_TRANSACTION,            "RequestStartTransaction") \
+    X(REQUEST_STOP_TRANSACTION,             "RequestStopTransaction") \
+    X(RESERVATION_STATUS_UPDATE,            "ReservationStatusUpdate") \
+    X(RESERVE_NOW,                          "ReserveNow") \
+    X(RESET,                                "Reset") \
+    X(SECURITY_EVENT_NOTIFICATION,          "SecurityEventNotification") \
+    X(SEND_LOCAL_LIST,                      "SendLocalList") \
+    X(SET_CHARGING_PROFILE,                 "SetChargingProfile") \
+    X(SET_DISPLAY_MESSAGE,                  "SetDisplayMessage") \
+    X(SET_MONITORING_BASE,                  "SetMonitoringBase") \
+    X(SET_MONITORING_LEVEL,                 "SetMonitoringLevel") \
+    X(SET_NETWORK_PROFILE,                  "SetNetworkProfile") \
+    X(SET_VARIABLE_MONITORING,              "SetVariableMonitoring") \
+    X(SET_VARIABLES,                        "SetVariables") \
+    X(SIGN_CERTIFICATE,                     "SignCertificate") \
+    X(SIGNED_FIRMWARE_STATUS_NOTIFICATION,  "SignedFirmwareStatusNotification") \
+    X(SIGNED_UPDATE_FIRMWARE,               "SignedUpdateFirmware") \
+    X(START_TRANSACTION,                    "StartTransaction") \
+    X(STATUS_NOTIFICATION,                  "StatusNotification") \
+    X(STOP_TRANSACTION,                     "StopTransaction") \
+    X(TRANSACTION_EVENT,                    "TransactionEvent") \
+    X(TRIGGER_MESSAGE,                      "TriggerMessage") \
+    X(UNLOCK_CONNECTOR,                     "UnlockConnector") \
+    X(UNPUBLISH_FIRMWARE,                   "UnpublishFirmware") \
+    X(UPDATE_FIRMWARE,                      "UpdateFirmware")
+
+typedef enum {
+    OCPP_ACTION_UNKNOWN = -1,
+#define OCPP_ACTION_ENUM(id, name) OCPP_ACTION_##id,
+    OCPP_ACTIONS(OCPP_ACTION_ENUM)
+#undef OCPP_ACTION_ENUM
+    OCPP_ACTION_COUNT
+} ocpp_action_t;
+
+// The action named by the len bytes at name, OCPP_ACTION_UNKNOWN if there is
+// none. One hash and at most one compare, however many actions there are.
+ocpp_action_t ocpp_action_lookup(const char *name, size_t len);
+const char *ocpp_action_name(ocpp_action_t action);
+
+#endif
@@ -0,0 +1,278 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "OcppJ.h"
+
+#define IOV_LIT(s) { (void *)(s), sizeof(s) - 1 }
+#define IOV_STR(s) { (void *)(s), strlen(s) }
+#define IOV_SPAN(p, n) { (void *)(p), (n) }
+
+static const char *skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    return p;
+}
+
+// Step over the ',' between two array elements
+static const char *next_element(const char *p, const char *end) {
+    p = skip_ws(p, end);
+    if (p >= end || *p != ',')
+        return NULL;
+    return skip_ws(p + 1, end);
+}
+
+// p is at the opening quote. Returns the position after the closing one, or
+// NULL if the string is unterminated or holds a raw control character.
+static const char *scan_string(const char *p, const char *end, ocpp_str_t *out) {
+    if (p >= end || *p != '"')
+        return NULL;
+    const char *start = ++p;
+    while (p < end && *p != '"') {
+        if ((unsigned char)*p < 0x20)
+            return NULL;
+        p += *p == '\\' ? 2 : 1;  // an escaped quote does not end the string
+    }
+    if (p >= end)
+        return NULL;
+    if (out) {
+        out->ptr = start;
+        out->len = (size_t)(p - start);
+    }
+    return p + 1;
+}
+
+// p is at a '{'. Returns the position after the matching '}', or NULL.
+static const char *scan_object(const char *p, const char *end, ocpp_str_t *out) {
+    if (p >= end || *p != '{')
+        return NULL;
+    const char *start = p;
+    size_t depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            if (!(p = scan_string(p, end, NULL)))
+                return NULL;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            out->ptr = start;
+            out->len = (size_t)(p + 1 - start);
+            return p + 1;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+int ocppj_parse(const char *text, size_t len, ocpp_message_t *msg) {
+    const char *p = text, *end = text + len;
+
+    memset(msg, 0, sizeof(*msg));
+    msg->action = OCPP_ACTION_UNKNOWN;
+
+    p = skip_ws(p, end);
+    if (p >= end || *p != '[')
+        return -1;
+    p = skip_ws(p + 1, end);
+    if (p >= end || *p < '0' + OCPP_CALL || *p > '0' + OCPP_CALLERROR)
+        return -1;
+    msg->type = *p - '0';
+
+    if (!(p = next_element(p + 1, end)) || !(p = scan_string(p, end, &msg->id)))
+        return -1;
+    if (msg->id.len == 0 || msg->id.len > OCPP_UNIQUE_ID_MAX) {
+        msg->id.len = 0;
+        return -1;
+    }
+    if (!(p = next_element(p, end)))
+        return -1;
+
+    switch (msg->type) {
+    case OCPP_CALL:
+        if (!(p = scan_string(p, end, &msg->action_name)) || !(p = next_element(p, end)))
+            return -1;
+        msg->action = ocpp_action_lookup(msg->action_name.ptr, msg->action_name.len);
+        break;
+    case OCPP_CALLERROR:
+        if (!(p = scan_string(p, end, &msg->error_code)) || !(p = next_element(p, end)) ||
+            !(p = scan_string(p, end, &msg->error_description)) || !(p = next_element(p, end)))
+            return -1;
+        break;
+    }
+    if (!(p = scan_object(p, end, &msg->payload)))
+        return -1;
+
+    p = skip_ws(p, end);
+    if (p >= end || *p != ']')
+        return -1;
+    return skip_ws(p + 1, end) == end ? 0 : -1;
+}
+
+void ocpp_router_init(ocpp_router_t *router) {
+    memset(router, 0, sizeof(*router));
+}
+
+void ocpp_router_register(ocpp_router_t *router, ocpp_action_t action, ocpp_call_fn fn) {
+    if (action >= 0 && action < OCPP_ACTION_COUNT)
+        router->calls[action] = fn;
+}
+
+ocpp_version_t ocpp_version_from_subprotocol(const char *subprotocol) {
+    return subprotocol && strcmp(subprotocol, "ocpp2.0.1") == 0 ? OCPP_V201 : OCPP_V16;
+}
+
+void ocpp_session_init(ocpp_session_t *s, const ocpp_router_t *router, ocpp_version_t version,
+                       ocpp_send_fn send, void *transport) {
+    memset(s, 0, sizeof(*s));
+    s->router = router;
+    s->version = version;
+    s->send = send;
+    s->transport = transport;
+}
+
+void ocpp_session_free(ocpp_session_t *s) {
+    for (int i = 0; i < OCPP_MAX_PENDING && s->npending > 0; i++) {
+        ocpp_pending_t *pc = &s->pending[i];
+        if (!pc->id_len)
+            continue;
+        pc->id_len = 0;
+        s->npending--;
+        if (pc->done)
+            pc->done(s, NULL, pc->opaque);
+    }
+}
+
+int ocpp_reply(ocpp_session_t *s, const ocpp_message_t *call, const char *payload, size_t len) {
+    struct iovec iov[] = {
+        IOV_LIT("[3,\""), IOV_SPAN(call->id.ptr, call->id.len), IOV_LIT("\","),
+        IOV_SPAN(payload, len), IOV_LIT("]")
+    };
+    return s->send(s->transport, iov, sizeof(iov) / sizeof(iov[0]));
+}
+
+char *ocpp_reply_frame(const ocpp_message_t *call, char *buf, size_t len, size_t *out_len) {
+    char *payload = buf + OCPP_REPLY_HEADROOM;
+    char *text = payload - (4 + call->id.len + 2);   // ocppj_parse bounds the id
+    memcpy(text, "[3,\"", 4);
+    memcpy(text + 4, call->id.ptr, call->id.len);
+    memcpy(payload - 2, "\",", 2);
+    payload[len] = ']';
+    *out_len = (size_t)(payload + len + 1 - text);
+    return text;
+}
+
+int ocpp_reply_error(ocpp_session_t *s, ocpp_str_t id, const char *code, const char *description) {
+    struct iovec iov[] = {
+        IOV_LIT("[4,\""), IOV_SPAN(id.ptr, id.len), IOV_LIT("\",\""), IOV_STR(code),
+        IOV_LIT("\",\""), IOV_STR(description), IOV_LIT("\",{}]")
+    };
+    return s->send(s->transport, iov, sizeof(iov) / sizeof(iov[0]));
+}
+
+int ocpp_call(ocpp_session_t *s, ocpp_action_t action, const char *payload, size_t len,
+              ocpp_reply_fn done, void *opaque) {
+    if (s->npending == OCPP_MAX_PENDING || action < 0 || action >= OCPP_ACTION_COUNT)
+        return -1;
+    ocpp_pending_t *pc = s->pending;
+    while (pc->id_len)
+        pc++;
+
+    int id_len = snprintf(pc->id, sizeof(pc->id), "%" PRIu32, ++s->next_id);
+    const char *name = ocpp_action_name(action);
+    struct iovec iov[] = {
+        IOV_LIT("[2,\""), IOV_SPAN(pc->id, (size_t)id_len), IOV_LIT("\",\""), IOV_STR(name),
+        IOV_LIT("\","), IOV_SPAN(payload, len), IOV_LIT("]")
+    };
+    if (s->send(s->transport, iov, sizeof(iov) / sizeof(iov[0])) < 0)
+        return -1;
+
+    pc->id_len = (uint8_t)id_len;
+    pc->action = action;
+    pc->done = done;
+    pc->opaque = opaque;
+    pc->deadline_ms = s->call_timeout_ms ? ocpp_clock_ms() + s->call_timeout_ms : 0;
+    s->npending++;
+    return 0;
+}
+
+uint64_t ocpp_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+uint64_t ocpp_session_expire(ocpp_session_t *s, uint64_t now_ms) {
+    uint64_t next = 0;
+    for (int i = 0; i < OCPP_MAX_PENDING && s->npending > 0; i++) {
+        ocpp_pending_t *pc = &s->pending[i];
+        if (!pc->id_len || !pc->deadline_ms)
+            continue;
+        if (pc->deadline_ms > now_ms) {
+            if (!next || pc->deadline_ms < next)
+                next = pc->deadline_ms;
+            continue;
+        }
+        pc->id_len = 0;
+        s->npending--;
+        if (pc->done)
+            pc->done(s, NULL, pc->opaque);
+    }
+    return next;
+}
+
+static void observe(const ocpp_session_t *s, const ocpp_message_t *msg) {
+    if (s->router->observe)
+        s->router->observe(msg);
+}
+
+static int dispatch_message(ocpp_session_t *s, const char *text, size_t len) {
+    ocpp_message_t msg;
+
+    if (ocppj_parse(text, len, &msg) < 0) {
+        observe(s, NULL);
+        // Only a CALL is ever answered, and only when its id could be read
+        if (msg.type != OCPP_CALL || msg.id.len == 0)
+            return 0;
+        return ocpp_reply_error(s, msg.id, s->version == OCPP_V201 ? "FormatViolation" : "FormationViolation",
+                                "Malformed OCPP-J message");
+    }
+
+    if (msg.type == OCPP_CALL) {
+        observe(s, &msg);
+        if (msg.action == OCPP_ACTION_UNKNOWN)
+            return ocpp_reply_error(s, msg.id, "NotImplemented", "Unknown action");
+        ocpp_call_fn fn = s->router->calls[msg.action];
+        if (!fn)
+            return ocpp_reply_error(s, msg.id, "NotSupported", "Action not supported");
+        return fn(s, &msg);
+    }
+
+    // A reply: at most OCPP_MAX_PENDING of our CALLs can be waiting for it
+    for (int i = 0; i < OCPP_MAX_PENDING; i++) {
+        ocpp_pending_t *pc = &s->pending[i];
+        if (pc->id_len != msg.id.len || memcmp(pc->id, msg.id.ptr, msg.id.len) != 0)
+            continue;
+        ocpp_reply_fn done = pc->done;
+        void *opaque = pc->opaque;
+        msg.action = pc->action;
+        pc->id_len = 0;
+        s->npending--;
+        observe(s, &msg);
+        if (done)
+            done(s, &msg, opaque);
+        return 0;
+    }
+    observe(s, &msg);
+    return 0;  // late or unsolicited, nobody is waiting for it
+}
+
+int ocpp_session_dispatch(ocpp_session_t *s, const char *text, size_t len) {
+    int rc = dispatch_message(s, text, len);
+    if (s->arena)
+        arena_reset(s->arena);
+    return rc;
+}
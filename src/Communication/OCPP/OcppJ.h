@@ -0,0 +1,134 @@
+#ifndef OCPP_J_H
+#define OCPP_J_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "OcppActions.h"
+#include "Arena.h"
+
+#define OCPP_CALL       2
+#define OCPP_CALLRESULT 3
+#define OCPP_CALLERROR  4
+
+#define OCPP_UNIQUE_ID_MAX 36   // a UUID, the longest id the spec allows
+#define OCPP_MAX_PENDING   4    // our own CALLs awaiting an answer per station
+
+typedef enum {
+    OCPP_V16,
+    OCPP_V201
+} ocpp_version_t;
+
+// A run of bytes inside the received message, not NUL terminated
+typedef struct {
+    const char *ptr;
+    size_t len;
+} ocpp_str_t;
+
+// One OCPP-J message: [2,id,action,payload], [3,id,payload] or
+// [4,id,code,description,details]. Strings are the raw bytes between the
+// quotes, escapes included, so they can be echoed back as they are.
+typedef struct {
+    int type;                   // OCPP_CALL, OCPP_CALLRESULT or OCPP_CALLERROR
+    ocpp_str_t id;
+    ocpp_action_t action;       // a CALL's action; for replies, that of our CALL
+    ocpp_str_t action_name;
+    ocpp_str_t payload;         // JSON object text; a CALLERROR's errorDetails
+    ocpp_str_t error_code;
+    ocpp_str_t error_description;
+} ocpp_message_t;
+
+// Split one message into its fields without copying or allocating. The
+// payload is only checked for balanced brackets here, its handler parses it.
+// Returns 0, or -1 if the message is malformed; msg->id is set (len > 0)
+// whenever it could be read, so the peer can still be answered.
+int ocppj_parse(const char *text, size_t len, ocpp_message_t *msg);
+
+typedef struct ocpp_session ocpp_session_t;
+
+// Answers a CALL through ocpp_reply / ocpp_reply_error. Returns -1 only if
+// the transport failed.
+typedef int (*ocpp_call_fn)(ocpp_session_t *s, const ocpp_message_t *call);
+// Gets the CALLRESULT or CALLERROR to one of our CALLs, or NULL if the
+// session ended or the call timed out before it came.
+typedef void (*ocpp_reply_fn)(ocpp_session_t *s, const ocpp_message_t *reply, void *opaque);
+// Sends the pieces of one message as a single text frame. They are only
+// borrowed for the call. Returns -1 on failure.
+typedef int (*ocpp_send_fn)(void *transport, const struct iovec *iov, int iovcnt);
+
+// Sees every received message before it is handled, a reply with the action
+// of the CALL it answers (OCPP_ACTION_UNKNOWN if none was waiting), and NULL
+// for one that could not be parsed
+typedef void (*ocpp_observe_fn)(const ocpp_message_t *msg);
+
+// CALL handlers indexed by action, shared by every session of a worker
+typedef struct {
+    ocpp_call_fn calls[OCPP_ACTION_COUNT];
+    ocpp_observe_fn observe;    // NULL for none
+} ocpp_router_t;
+
+typedef struct {
+    char id[OCPP_UNIQUE_ID_MAX];
+    uint8_t id_len;             // 0 when the slot is free
+    ocpp_action_t action;
+    ocpp_reply_fn done;
+    void *opaque;
+    uint64_t deadline_ms;       // on ocpp_clock_ms, 0 to wait for as long as the session lasts
+} ocpp_pending_t;
+
+struct ocpp_session {
+    const ocpp_router_t *router;
+    ocpp_version_t version;
+    ocpp_send_fn send;
+    void *transport;            // also the handlers' way back to the connection
+    arena_t *arena;             // handlers' scratch, reset after each message; may be NULL
+    uint32_t call_timeout_ms;   // how long a CALL of ours waits for its answer, 0 = forever
+    uint32_t next_id;
+    int npending;
+    ocpp_pending_t pending[OCPP_MAX_PENDING];
+};
+
+// Every action starts out answered with NotSupported
+void ocpp_router_init(ocpp_router_t *router);
+void ocpp_router_register(ocpp_router_t *router, ocpp_action_t action, ocpp_call_fn fn);
+
+// version from the negotiated subprotocol: "ocpp2.0.1", otherwise 1.6
+ocpp_version_t ocpp_version_from_subprotocol(const char *subprotocol);
+
+void ocpp_session_init(ocpp_session_t *s, const ocpp_router_t *router, ocpp_version_t version,
+                       ocpp_send_fn send, void *transport);
+// Fails the CALLs still waiting for an answer
+void ocpp_session_free(ocpp_session_t *s);
+
+// Handle one received text message: CALLs go to their handler (unknown or
+// malformed ones are answered with a CALLERROR), replies to the CALL with the
+// same id. The session's arena is reset afterwards. Returns -1 only if the
+// transport failed.
+int ocpp_session_dispatch(ocpp_session_t *s, const char *text, size_t len);
+
+// Answer a CALL. payload is a JSON object.
+int ocpp_reply(ocpp_session_t *s, const ocpp_message_t *call, const char *payload, size_t len);
+
+// Room the head of a CALLRESULT, [3,"<id>", takes in front of its payload
+#define OCPP_REPLY_HEADROOM (4 + OCPP_UNIQUE_ID_MAX + 2)
+// Complete a CALLRESULT whose payload was written in place: len bytes at
+// buf + OCPP_REPLY_HEADROOM, with one to spare after them. The head goes
+// right in front of the payload and the ']' behind it, so nothing is
+// copied. Returns where the message starts, *out_len its length; the
+// transport sends it from there.
+char *ocpp_reply_frame(const ocpp_message_t *call, char *buf, size_t len, size_t *out_len);
+int ocpp_reply_error(ocpp_session_t *s, ocpp_str_t id, const char *code, const char *description);
+
+// Send a CALL of our own; done runs once with the answer. Returns -1 if too
+// many are outstanding or the transport failed (done is not called then).
+int ocpp_call(ocpp_session_t *s, ocpp_action_t action, const char *payload, size_t len,
+              ocpp_reply_fn done, void *opaque);
+
+// Monotonic milliseconds, the clock CALL deadlines are kept on
+uint64_t ocpp_clock_ms(void);
+// Fail the CALLs whose answer is overdue at now_ms. Returns the earliest
+// deadline still pending, 0 if none. The transport calls this by then.
+uint64_t ocpp_session_expire(ocpp_session_t *s, uint64_t now_ms);
+
+#endif
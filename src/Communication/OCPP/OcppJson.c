@@ -0,0 +1,477 @@
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "OcppJson.h"
+
+#define MAX_DEPTH 32        // deeper than any OCPP schema nests
+#define MAX_NUMBER_LEN 64   // longer numbers are refused rather than copied
+
+// Word-at-a-time byte tests: BYTES(b) repeats b in every byte, HAS_LESS
+// flags (in bit 7 of some byte) a word holding a byte below n, n <= 128
+#define BYTES(b) ((uint64_t)(b) * 0x0101010101010101ull)
+#define HAS_LESS(w, n) (((w) - BYTES(n)) & ~(w))
+
+const char *ocpp_json_error_code(ocpp_json_error_t err, ocpp_version_t version) {
+    switch (err) {
+    case OCPP_JSON_TYPE:
+        return "TypeConstraintViolation";
+    case OCPP_JSON_PROPERTY:
+        return "PropertyConstraintViolation";
+    case OCPP_JSON_OCCURRENCE:
+        // 1.6 misspells it, and peers match the code exactly
+        return version == OCPP_V201 ? "OccurrenceConstraintViolation" : "OccurenceConstraintViolation";
+    default:
+        return version == OCPP_V201 ? "FormatViolation" : "FormationViolation";
+    }
+}
+
+void ocpp_json_init(ocpp_json_t *j, const char *text, size_t len, void *scratch, size_t scratch_size) {
+    memset(j, 0, sizeof(*j));
+    j->p = text;
+    j->end = text + len;
+    // Elements hold pointers and doubles, so carve from an aligned start
+    size_t pad = (8 - ((uintptr_t)scratch & 7)) & 7;
+    if (scratch_size < pad)
+        pad = scratch_size;
+    j->scratch = (char *)scratch + pad;
+    j->scratch_tail = (scratch_size - pad) & ~(size_t)7;
+}
+
+int ocpp_json_fail(ocpp_json_t *j, ocpp_json_error_t err, const char *what) {
+    if (j->error == OCPP_JSON_OK) {
+        j->error = err;
+        j->what = what;
+    }
+    return -1;
+}
+
+static void skip_ws(ocpp_json_t *j) {
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r'))
+        j->p++;
+}
+
+// The next significant byte, or 0 at the end of the input
+static char peek(ocpp_json_t *j) {
+    skip_ws(j);
+    return j->p < j->end ? *j->p : 0;
+}
+
+int ocpp_json_end(ocpp_json_t *j) {
+    return peek(j) == 0 && j->p == j->end ? 0 : ocpp_json_fail(j, OCPP_JSON_FORMAT, "trailing data");
+}
+
+// A value must start where the next member was expected
+static int type_error(ocpp_json_t *j, const char *what) {
+    char c = peek(j);
+    // Bytes no JSON value starts with make it a syntax error instead
+    if (c != '"' && c != '{' && c != '[' && c != '-' && (c < '0' || c > '9') && c != 't' && c != 'f' && c != 'n')
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, what);
+    return ocpp_json_fail(j, OCPP_JSON_TYPE, what);
+}
+
+// The ',' between members, or the closing bracket. 1, 0 at close, -1.
+static int next_member(ocpp_json_t *j, char close) {
+    char c = peek(j);
+    if (c == close) {
+        j->p++;
+        j->first = false;
+        j->depth--;
+        return 0;
+    }
+    if (!j->first) {
+        if (c != ',')
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "expected ','");
+        j->p++;
+        c = peek(j);
+    }
+    j->first = false;
+    return c ? 1 : ocpp_json_fail(j, OCPP_JSON_FORMAT, "unexpected end");
+}
+
+int ocpp_json_object_begin(ocpp_json_t *j, const char *what) {
+    if (peek(j) != '{')
+        return type_error(j, what);
+    if (++j->depth > MAX_DEPTH)
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "nested too deeply");
+    j->p++;
+    j->first = true;
+    return 0;
+}
+
+// p is at the opening quote; leaves p after the closing one. chars gets the
+// length after unescaping, in code points.
+static int scan_string(ocpp_json_t *j, ocpp_str_t *out, size_t *chars) {
+    const char *p = j->p + 1, *end = j->end;
+    size_t n = 0;
+    while (p < end) {
+        // Eight plain ASCII bytes at a time: no quote, backslash, control
+        // character or UTF-8 lead among them
+        if (end - p >= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            uint64_t quote = w ^ BYTES('"'), backslash = w ^ BYTES('\\');
+            if (!((HAS_LESS(quote, 1) | HAS_LESS(backslash, 1) | HAS_LESS(w, 0x20) | w) & BYTES(0x80))) {
+                p += 8;
+                n += 8;
+                continue;
+            }
+        }
+        unsigned char c = (unsigned char)*p;
+        if (c == '"')
+            break;
+        if (c < 0x20)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "control character in string");
+        if (c == '\\') {
+            if (++p >= end)
+                break;
+            if (*p == 'u') {
+                if (end - p < 5)
+                    break;
+                unsigned v = 0;
+                for (int i = 1; i <= 4; i++) {
+                    int h = p[i] >= '0' && p[i] <= '9' ? p[i] - '0'
+                          : (p[i] | 0x20) >= 'a' && (p[i] | 0x20) <= 'f' ? (p[i] | 0x20) - 'a' + 10 : -1;
+                    if (h < 0)
+                        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "bad unicode escape");
+                    v = v << 4 | (unsigned)h;
+                }
+                p += 5;
+                n += v < 0xD800 || v > 0xDBFF;  // a surrogate pair is one character
+                continue;
+            }
+            if (!*p || !strchr("\"\\/bfnrt", *p))
+                return ocpp_json_fail(j, OCPP_JSON_FORMAT, "bad escape");
+        }
+        n += (c & 0xC0) != 0x80;  // UTF-8 continuation bytes extend a character
+        p++;
+    }
+    if (p >= end)
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unterminated string");
+    if (out) {
+        out->ptr = j->p + 1;
+        out->len = (size_t)(p - out->ptr);
+    }
+    if (chars)
+        *chars = n;
+    j->p = p + 1;
+    return 0;
+}
+
+int ocpp_json_next_key(ocpp_json_t *j, ocpp_str_t *key) {
+    int rc = next_member(j, '}');
+    if (rc <= 0)
+        return rc;
+    if (*j->p != '"')
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "expected a property name");
+    if (scan_string(j, key, NULL) < 0)
+        return -1;
+    if (peek(j) != ':')
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "expected ':'");
+    j->p++;
+    skip_ws(j);
+    return 1;
+}
+
+int ocpp_json_missing(ocpp_json_t *j, uint32_t seen, uint32_t required, const char *const *names) {
+    uint32_t missing = required & ~seen;
+    int i = 0;
+    while (!(missing & 1u << i))
+        i++;
+    return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, names[i]);
+}
+
+int ocpp_json_array_begin(ocpp_json_t *j, ocpp_json_array_t *a, const char *what) {
+    if (peek(j) != '[')
+        return type_error(j, what);
+    if (++j->depth > MAX_DEPTH)
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "nested too deeply");
+    j->p++;
+    j->first = true;
+    a->tail = j->scratch_tail;
+    a->count = 0;
+    return 0;
+}
+
+int ocpp_json_array_next(ocpp_json_t *j) {
+    return next_member(j, ']');
+}
+
+#define SLOT(size) (((size) + 7) & ~(size_t)7)
+
+void *ocpp_json_array_push(ocpp_json_t *j, ocpp_json_array_t *a, size_t size) {
+    // Element k sits at a->tail - (k + 1) * SLOT(size). Room is kept for
+    // the whole array to be copied to the front below them.
+    size_t need = (a->count + 1) * (SLOT(size) + size);
+    if (need > a->tail - j->scratch_used) {
+        ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, "too many elements");
+        return NULL;
+    }
+    j->scratch_tail = a->tail - (a->count + 1) * SLOT(size);
+    a->count++;
+    return j->scratch + j->scratch_tail;
+}
+
+void *ocpp_json_array_end(ocpp_json_t *j, ocpp_json_array_t *a, size_t size) {
+    if (a->count == 0)
+        return NULL;
+    if (a->count * (SLOT(size) + size) > a->tail - j->scratch_used) {
+        ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, "too many elements");
+        return NULL;
+    }
+    char *items = j->scratch + j->scratch_used;
+    for (size_t k = 0; k < a->count; k++)
+        memcpy(items + k * size, j->scratch + a->tail - (k + 1) * SLOT(size), size);
+    j->scratch_used = SLOT(j->scratch_used + a->count * size);
+    j->scratch_tail = a->tail;
+    return items;
+}
+
+int ocpp_json_string(ocpp_json_t *j, ocpp_str_t *out, size_t max_len, const char *what) {
+    size_t chars;
+    if (peek(j) != '"')
+        return type_error(j, what);
+    if (scan_string(j, out, &chars) < 0)
+        return -1;
+    if (max_len && chars > max_len)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    return 0;
+}
+
+static int digits(const char *p, int n, int lo, int hi) {
+    int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] < '0' || p[i] > '9')
+            return 0;
+        v = v * 10 + p[i] - '0';
+    }
+    return v >= lo && v <= hi;
+}
+
+// RFC 3339 date-time: 2024-12-26T12:00:00[.fraction](Z|+01:00)
+int ocpp_json_datetime(ocpp_json_t *j, ocpp_str_t *out, const char *what) {
+    if (ocpp_json_string(j, out, 0, what) < 0)
+        return -1;
+    const char *s = out->ptr, *end = s + out->len;
+    if (out->len < 20 || !digits(s, 4, 0, 9999) || s[4] != '-' || !digits(s + 5, 2, 1, 12) || s[7] != '-' ||
+        !digits(s + 8, 2, 1, 31) || (s[10] | 0x20) != 't' || !digits(s + 11, 2, 0, 23) || s[13] != ':' ||
+        !digits(s + 14, 2, 0, 59) || s[16] != ':' || !digits(s + 17, 2, 0, 60))
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    s += 19;
+    if (*s == '.') {
+        const char *frac = ++s;
+        while (s < end && *s >= '0' && *s <= '9')
+            s++;
+        if (s == frac)
+            return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    }
+    if (s < end && (*s | 0x20) == 'z')
+        s++;
+    else if (end - s == 6 && (*s == '+' || *s == '-') && digits(s + 1, 2, 0, 23) && s[3] == ':' &&
+             digits(s + 4, 2, 0, 59))
+        s += 6;
+    return s == end ? 0 : ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+}
+
+// Step over a JSON number; integral is cleared if it has a fraction or exponent
+static int scan_number(ocpp_json_t *j, bool *integral, const char *what) {
+    const char *p = j->p, *end = j->end;
+    *integral = true;
+    if (p < end && *p == '-')
+        p++;
+    if (p >= end || *p < '0' || *p > '9')
+        return type_error(j, what);
+    if (*p == '0')
+        p++;
+    else
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    if (p < end && *p == '.') {
+        *integral = false;
+        if (++p >= end || *p < '0' || *p > '9')
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, what);
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    }
+    if (p < end && (*p | 0x20) == 'e') {
+        *integral = false;
+        if (++p < end && (*p == '+' || *p == '-'))
+            p++;
+        if (p >= end || *p < '0' || *p > '9')
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, what);
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    }
+    j->p = p;
+    return 0;
+}
+
+int ocpp_json_int(ocpp_json_t *j, int *out, const char *what) {
+    bool integral;
+    skip_ws(j);
+    const char *start = j->p;
+    if (scan_number(j, &integral, what) < 0)
+        return -1;
+    if (!integral)
+        return ocpp_json_fail(j, OCPP_JSON_TYPE, what);
+
+    const char *p = start;
+    bool neg = *p == '-';
+    long long v = 0;
+    for (p += neg; p < j->p; p++) {
+        v = v * 10 + (*p - '0');
+        if (v > (long long)INT_MAX + neg)
+            return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    }
+    *out = (int)(neg ? -v : v);
+    return 0;
+}
+
+int ocpp_json_number(ocpp_json_t *j, double *out, const char *what) {
+    bool integral;
+    skip_ws(j);
+    const char *start = j->p;
+    if (scan_number(j, &integral, what) < 0)
+        return -1;
+
+    // strtod needs a terminator the message does not have
+    char copy[MAX_NUMBER_LEN + 1];
+    size_t len = (size_t)(j->p - start);
+    if (len > MAX_NUMBER_LEN)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    memcpy(copy, start, len);
+    copy[len] = '\0';
+    *out = strtod(copy, NULL);
+    return isfinite(*out) ? 0 : ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+}
+
+static int literal(ocpp_json_t *j, const char *word, size_t n) {
+    if ((size_t)(j->end - j->p) < n || memcmp(j->p, word, n) != 0)
+        return -1;
+    j->p += n;
+    return 0;
+}
+
+int ocpp_json_bool(ocpp_json_t *j, bool *out, const char *what) {
+    char c = peek(j);
+    if (c == 't' && literal(j, "true", 4) == 0)
+        *out = true;
+    else if (c == 'f' && literal(j, "false", 5) == 0)
+        *out = false;
+    else
+        return type_error(j, what);
+    return 0;
+}
+
+int ocpp_json_skip(ocpp_json_t *j) {
+    ocpp_str_t key;
+    bool integral;
+    int rc;
+
+    switch (peek(j)) {
+    case '"':
+        return scan_string(j, NULL, NULL);
+    case '{':
+        if (ocpp_json_object_begin(j, "object") < 0)
+            return -1;
+        while ((rc = ocpp_json_next_key(j, &key)) > 0)
+            if (ocpp_json_skip(j) < 0)
+                return -1;
+        return rc;
+    case '[':
+        if (++j->depth > MAX_DEPTH)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "nested too deeply");
+        j->p++;
+        j->first = true;
+        while ((rc = ocpp_json_array_next(j)) > 0)
+            if (ocpp_json_skip(j) < 0)
+                return -1;
+        return rc;
+    case 't':
+        return literal(j, "true", 4) == 0 ? 0 : ocpp_json_fail(j, OCPP_JSON_FORMAT, "bad literal");
+    case 'f':
+        return literal(j, "false", 5) == 0 ? 0 : ocpp_json_fail(j, OCPP_JSON_FORMAT, "bad literal");
+    case 'n':
+        return literal(j, "null", 4) == 0 ? 0 : ocpp_json_fail(j, OCPP_JSON_FORMAT, "bad literal");
+    default:
+        return scan_number(j, &integral, "value");
+    }
+}
+
+int ocpp_json_raw_object(ocpp_json_t *j, ocpp_str_t *out, const char *what) {
+    if (peek(j) != '{')
+        return type_error(j, what);
+    const char *start = j->p;
+    if (ocpp_json_skip(j) < 0)
+        return -1;
+    out->ptr = start;
+    out->len = (size_t)(j->p - start);
+    return 0;
+}
+
+void ocpp_writer_init(ocpp_writer_t *w, char *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+}
+
+void ocpp_write_raw(ocpp_writer_t *w, const char *s, size_t n) {
+    if (w->len < w->cap)
+        memcpy(w->buf + w->len, s, n < w->cap - w->len ? n : w->cap - w->len);
+    w->len += n;
+}
+
+void ocpp_write_key(ocpp_writer_t *w, int *members, const char *key, size_t n) {
+    if ((*members)++)
+        ocpp_write_raw(w, ",", 1);
+    ocpp_write_raw(w, key, n);
+}
+
+void ocpp_write_str(ocpp_writer_t *w, ocpp_str_t str) {
+    ocpp_write_raw(w, "\"", 1);
+    ocpp_write_raw(w, str.ptr, str.len);
+    ocpp_write_raw(w, "\"", 1);
+}
+
+void ocpp_write_int(ocpp_writer_t *w, int v) {
+    char digits[12];
+    char *p = digits + sizeof(digits);
+    unsigned u = v < 0 ? 0u - (unsigned)v : (unsigned)v;
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        *--p = '-';
+    ocpp_write_raw(w, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+void ocpp_write_number(ocpp_writer_t *w, double v) {
+    char text[32];
+    if (v > -1e9 && v < 1e9 && v == (double)(int)v) {
+        ocpp_write_int(w, (int)v);
+        return;
+    }
+    if (!isfinite(v)) {
+        ocpp_write_raw(w, "0", 1);  // JSON has no NaN or infinity
+        return;
+    }
+    // The shortest of the two that reads back as the same double
+    int n = snprintf(text, sizeof(text), "%.15g", v);
+    if (strtod(text, NULL) != v)
+        n = snprintf(text, sizeof(text), "%.17g", v);
+    ocpp_write_raw(w, text, (size_t)n);
+}
+
+void ocpp_write_bool(ocpp_writer_t *w, bool v) {
+    if (v)
+        ocpp_write_raw(w, "true", 4);
+    else
+        ocpp_write_raw(w, "false", 5);
+}
+
+int ocpp_writer_status(const ocpp_writer_t *w) {
+    return w->len <= w->cap ? 0 : -1;
+}
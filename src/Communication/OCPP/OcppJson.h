@@ -0,0 +1,100 @@
+#ifndef OCPP_JSON_H
+#define OCPP_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OcppJ.h"
+
+// Runtime for the parsers and writers in OcppMessages.c, which
+// tools/ocpp_codegen.py generates from the schemas in Docs/schemas. A payload
+// is read straight into its struct in one pass: no tree is built, strings
+// stay slices of the message and arrays are carved out of a caller's buffer.
+
+// Why a payload was refused, in the terms of OCPP's CALLERROR codes
+typedef enum {
+    OCPP_JSON_OK,
+    OCPP_JSON_FORMAT,       // not JSON, or a property the schema does not define
+    OCPP_JSON_TYPE,         // a value of the wrong JSON type
+    OCPP_JSON_PROPERTY,     // a bad value: enum, maxLength, date-time, range
+    OCPP_JSON_OCCURRENCE    // a required property missing or repeated, minItems
+} ocpp_json_error_t;
+
+typedef struct {
+    const char *p, *end;
+    char *scratch;              // arrays are allocated from here
+    size_t scratch_used;        // finished arrays, from the front
+    size_t scratch_tail;        // elements of open arrays, down from the end
+    bool first;                 // no ',' expected before the next member
+    int depth;
+    ocpp_json_error_t error;
+    const char *what;           // the property that failed, for the description
+} ocpp_json_t;
+
+// The CALLERROR code for err; 1.6 and 2.0.1 spell some of them differently
+const char *ocpp_json_error_code(ocpp_json_error_t err, ocpp_version_t version);
+
+void ocpp_json_init(ocpp_json_t *j, const char *text, size_t len, void *scratch, size_t scratch_size);
+// Record the first failure. Always returns -1.
+int ocpp_json_fail(ocpp_json_t *j, ocpp_json_error_t err, const char *what);
+// Nothing but whitespace may follow the payload
+int ocpp_json_end(ocpp_json_t *j);
+
+// Objects: begin, then next_key until it returns 0 at the '}'. next_key
+// returns 1 with the raw key, positioned at its value; -1 on error.
+int ocpp_json_object_begin(ocpp_json_t *j, const char *what);
+int ocpp_json_next_key(ocpp_json_t *j, ocpp_str_t *key);
+// The first required property missing from seen, as an occurrence error
+int ocpp_json_missing(ocpp_json_t *j, uint32_t seen, uint32_t required, const char *const *names);
+
+// Arrays: begin, then array_next returns 1 before each element and 0 at the
+// ']'. Each element is parsed into the slot array_push hands out; array_end
+// moves them into one piece at the front of the scratch buffer and returns
+// it (NULL when empty, or on error with j->error set). Nested arrays close
+// before their parent, so open ones stack up at the end of the buffer.
+typedef struct {
+    size_t tail;                // scratch_tail when the array opened
+    size_t count;
+} ocpp_json_array_t;
+
+int ocpp_json_array_begin(ocpp_json_t *j, ocpp_json_array_t *a, const char *what);
+int ocpp_json_array_next(ocpp_json_t *j);
+void *ocpp_json_array_push(ocpp_json_t *j, ocpp_json_array_t *a, size_t size);
+void *ocpp_json_array_end(ocpp_json_t *j, ocpp_json_array_t *a, size_t size);
+
+// Scalars. Strings are the raw bytes between the quotes; max_len counts
+// characters after unescaping, 0 for no limit.
+int ocpp_json_string(ocpp_json_t *j, ocpp_str_t *out, size_t max_len, const char *what);
+int ocpp_json_datetime(ocpp_json_t *j, ocpp_str_t *out, const char *what);
+int ocpp_json_int(ocpp_json_t *j, int *out, const char *what);
+int ocpp_json_number(ocpp_json_t *j, double *out, const char *what);
+int ocpp_json_bool(ocpp_json_t *j, bool *out, const char *what);
+// Any value, checked but not kept
+int ocpp_json_skip(ocpp_json_t *j);
+// An object kept as its JSON text, for those open to vendor properties
+int ocpp_json_raw_object(ocpp_json_t *j, ocpp_str_t *out, const char *what);
+
+// Serializes into a fixed buffer. len keeps counting past cap, so a caller
+// whose buffer was too small learns the size it needs.
+typedef struct {
+    char *buf;
+    size_t cap, len;
+} ocpp_writer_t;
+
+void ocpp_writer_init(ocpp_writer_t *w, char *buf, size_t cap);
+void ocpp_write_raw(ocpp_writer_t *w, const char *s, size_t n);
+// "key": with the ',' that separates it from the previous member
+void ocpp_write_key(ocpp_writer_t *w, int *members, const char *key, size_t n);
+// str is written as it is, so it must already be JSON escaped
+void ocpp_write_str(ocpp_writer_t *w, ocpp_str_t str);
+void ocpp_write_int(ocpp_writer_t *w, int v);
+void ocpp_write_number(ocpp_writer_t *w, double v);
+void ocpp_write_bool(ocpp_writer_t *w, bool v);
+// 0, or -1 if the output did not fit
+int ocpp_writer_status(const ocpp_writer_t *w);
+
+// A string literal that needs no escaping, as an ocpp_str_t
+#define OCPP_STR(s) ((ocpp_str_t){ (s), sizeof(s) - 1 })
+
+#endif
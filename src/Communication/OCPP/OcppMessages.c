@@ -0,0 +1,3241 @@
+// Generated by tools/ocpp_codegen.py from Docs/schemas. Do not edit.
+#include <string.h>
+
+#include "OcppMessages.h"
+
+static const ocpp_str_t ocpp16_boot_notification_status_strs[] = {
+    { "Accepted", 8 },
+    { "Pending", 7 },
+    { "Rejected", 8 },
+};
+
+const char *ocpp16_boot_notification_status_name(ocpp16_boot_notification_status_t v) {
+    return ocpp16_boot_notification_status_strs[v].ptr;
+}
+
+static int match_ocpp16_boot_notification_status(ocpp_str_t s) {
+    switch (s.len) {
+    case 7:
+        if (memcmp(s.ptr, "Pending", 7) == 0)
+            return OCPP16_BOOT_NOTIFICATION_STATUS_PENDING;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "Accepted", 8) == 0)
+            return OCPP16_BOOT_NOTIFICATION_STATUS_ACCEPTED;
+        if (memcmp(s.ptr, "Rejected", 8) == 0)
+            return OCPP16_BOOT_NOTIFICATION_STATUS_REJECTED;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_boot_notification_status(ocpp_json_t *j, ocpp16_boot_notification_status_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_boot_notification_status(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_boot_notification_status_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_sampled_value_context_strs[] = {
+    { "Interruption.Begin", 18 },
+    { "Interruption.End", 16 },
+    { "Sample.Clock", 12 },
+    { "Sample.Periodic", 15 },
+    { "Transaction.Begin", 17 },
+    { "Transaction.End", 15 },
+    { "Trigger", 7 },
+    { "Other", 5 },
+};
+
+const char *ocpp16_sampled_value_context_name(ocpp16_sampled_value_context_t v) {
+    return ocpp16_sampled_value_context_strs[v].ptr;
+}
+
+static int match_ocpp16_sampled_value_context(ocpp_str_t s) {
+    switch (s.len) {
+    case 5:
+        if (memcmp(s.ptr, "Other", 5) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_OTHER;
+        break;
+    case 7:
+        if (memcmp(s.ptr, "Trigger", 7) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_TRIGGER;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "Sample.Clock", 12) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_SAMPLE_CLOCK;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "Sample.Periodic", 15) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_SAMPLE_PERIODIC;
+        if (memcmp(s.ptr, "Transaction.End", 15) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_TRANSACTION_END;
+        break;
+    case 16:
+        if (memcmp(s.ptr, "Interruption.End", 16) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_INTERRUPTION_END;
+        break;
+    case 17:
+        if (memcmp(s.ptr, "Transaction.Begin", 17) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_TRANSACTION_BEGIN;
+        break;
+    case 18:
+        if (memcmp(s.ptr, "Interruption.Begin", 18) == 0)
+            return OCPP16_SAMPLED_VALUE_CONTEXT_INTERRUPTION_BEGIN;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_sampled_value_context(ocpp_json_t *j, ocpp16_sampled_value_context_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_sampled_value_context(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_sampled_value_context_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_sampled_value_format_strs[] = {
+    { "Raw", 3 },
+    { "SignedData", 10 },
+};
+
+const char *ocpp16_sampled_value_format_name(ocpp16_sampled_value_format_t v) {
+    return ocpp16_sampled_value_format_strs[v].ptr;
+}
+
+static int match_ocpp16_sampled_value_format(ocpp_str_t s) {
+    switch (s.len) {
+    case 3:
+        if (memcmp(s.ptr, "Raw", 3) == 0)
+            return OCPP16_SAMPLED_VALUE_FORMAT_RAW;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "SignedData", 10) == 0)
+            return OCPP16_SAMPLED_VALUE_FORMAT_SIGNED_DATA;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_sampled_value_format(ocpp_json_t *j, ocpp16_sampled_value_format_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_sampled_value_format(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_sampled_value_format_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_sampled_value_measurand_strs[] = {
+    { "Energy.Active.Export.Register", 29 },
+    { "Energy.Active.Import.Register", 29 },
+    { "Energy.Reactive.Export.Register", 31 },
+    { "Energy.Reactive.Import.Register", 31 },
+    { "Energy.Active.Export.Interval", 29 },
+    { "Energy.Active.Import.Interval", 29 },
+    { "Energy.Reactive.Export.Interval", 31 },
+    { "Energy.Reactive.Import.Interval", 31 },
+    { "Power.Active.Export", 19 },
+    { "Power.Active.Import", 19 },
+    { "Power.Offered", 13 },
+    { "Power.Reactive.Export", 21 },
+    { "Power.Reactive.Import", 21 },
+    { "Power.Factor", 12 },
+    { "Current.Import", 14 },
+    { "Current.Export", 14 },
+    { "Current.Offered", 15 },
+    { "Voltage", 7 },
+    { "Frequency", 9 },
+    { "Temperature", 11 },
+    { "SoC", 3 },
+    { "RPM", 3 },
+};
+
+const char *ocpp16_sampled_value_measurand_name(ocpp16_sampled_value_measurand_t v) {
+    return ocpp16_sampled_value_measurand_strs[v].ptr;
+}
+
+static int match_ocpp16_sampled_value_measurand(ocpp_str_t s) {
+    switch (s.len) {
+    case 3:
+        if (memcmp(s.ptr, "SoC", 3) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_SOC;
+        if (memcmp(s.ptr, "RPM", 3) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_RPM;
+        break;
+    case 7:
+        if (memcmp(s.ptr, "Voltage", 7) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_VOLTAGE;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "Frequency", 9) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_FREQUENCY;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "Temperature", 11) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_TEMPERATURE;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "Power.Factor", 12) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_POWER_FACTOR;
+        break;
+    case 13:
+        if (memcmp(s.ptr, "Power.Offered", 13) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_POWER_OFFERED;
+        break;
+    case 14:
+        if (memcmp(s.ptr, "Current.Import", 14) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_CURRENT_IMPORT;
+        if (memcmp(s.ptr, "Current.Export", 14) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_CURRENT_EXPORT;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "Current.Offered", 15) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_CURRENT_OFFERED;
+        break;
+    case 19:
+        if (memcmp(s.ptr, "Power.Active.Export", 19) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_POWER_ACTIVE_EXPORT;
+        if (memcmp(s.ptr, "Power.Active.Import", 19) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_POWER_ACTIVE_IMPORT;
+        break;
+    case 21:
+        if (memcmp(s.ptr, "Power.Reactive.Export", 21) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_POWER_REACTIVE_EXPORT;
+        if (memcmp(s.ptr, "Power.Reactive.Import", 21) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_POWER_REACTIVE_IMPORT;
+        break;
+    case 29:
+        if (memcmp(s.ptr, "Energy.Active.Export.Register", 29) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_EXPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Active.Import.Register", 29) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Active.Export.Interval", 29) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_EXPORT_INTERVAL;
+        if (memcmp(s.ptr, "Energy.Active.Import.Interval", 29) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL;
+        break;
+    case 31:
+        if (memcmp(s.ptr, "Energy.Reactive.Export.Register", 31) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_EXPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Reactive.Import.Register", 31) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_IMPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Reactive.Export.Interval", 31) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_EXPORT_INTERVAL;
+        if (memcmp(s.ptr, "Energy.Reactive.Import.Interval", 31) == 0)
+            return OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_IMPORT_INTERVAL;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_sampled_value_measurand(ocpp_json_t *j, ocpp16_sampled_value_measurand_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_sampled_value_measurand(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_sampled_value_measurand_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_sampled_value_phase_strs[] = {
+    { "L1", 2 },
+    { "L2", 2 },
+    { "L3", 2 },
+    { "N", 1 },
+    { "L1-N", 4 },
+    { "L2-N", 4 },
+    { "L3-N", 4 },
+    { "L1-L2", 5 },
+    { "L2-L3", 5 },
+    { "L3-L1", 5 },
+};
+
+const char *ocpp16_sampled_value_phase_name(ocpp16_sampled_value_phase_t v) {
+    return ocpp16_sampled_value_phase_strs[v].ptr;
+}
+
+static int match_ocpp16_sampled_value_phase(ocpp_str_t s) {
+    switch (s.len) {
+    case 1:
+        if (memcmp(s.ptr, "N", 1) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_N;
+        break;
+    case 2:
+        if (memcmp(s.ptr, "L1", 2) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L1;
+        if (memcmp(s.ptr, "L2", 2) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L2;
+        if (memcmp(s.ptr, "L3", 2) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L3;
+        break;
+    case 4:
+        if (memcmp(s.ptr, "L1-N", 4) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L1_N;
+        if (memcmp(s.ptr, "L2-N", 4) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L2_N;
+        if (memcmp(s.ptr, "L3-N", 4) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L3_N;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "L1-L2", 5) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L1_L2;
+        if (memcmp(s.ptr, "L2-L3", 5) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L2_L3;
+        if (memcmp(s.ptr, "L3-L1", 5) == 0)
+            return OCPP16_SAMPLED_VALUE_PHASE_L3_L1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_sampled_value_phase(ocpp_json_t *j, ocpp16_sampled_value_phase_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_sampled_value_phase(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_sampled_value_phase_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_sampled_value_location_strs[] = {
+    { "Cable", 5 },
+    { "EV", 2 },
+    { "Inlet", 5 },
+    { "Outlet", 6 },
+    { "Body", 4 },
+};
+
+const char *ocpp16_sampled_value_location_name(ocpp16_sampled_value_location_t v) {
+    return ocpp16_sampled_value_location_strs[v].ptr;
+}
+
+static int match_ocpp16_sampled_value_location(ocpp_str_t s) {
+    switch (s.len) {
+    case 2:
+        if (memcmp(s.ptr, "EV", 2) == 0)
+            return OCPP16_SAMPLED_VALUE_LOCATION_EV;
+        break;
+    case 4:
+        if (memcmp(s.ptr, "Body", 4) == 0)
+            return OCPP16_SAMPLED_VALUE_LOCATION_BODY;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "Cable", 5) == 0)
+            return OCPP16_SAMPLED_VALUE_LOCATION_CABLE;
+        if (memcmp(s.ptr, "Inlet", 5) == 0)
+            return OCPP16_SAMPLED_VALUE_LOCATION_INLET;
+        break;
+    case 6:
+        if (memcmp(s.ptr, "Outlet", 6) == 0)
+            return OCPP16_SAMPLED_VALUE_LOCATION_OUTLET;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_sampled_value_location(ocpp_json_t *j, ocpp16_sampled_value_location_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_sampled_value_location(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_sampled_value_location_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_sampled_value_unit_strs[] = {
+    { "Wh", 2 },
+    { "kWh", 3 },
+    { "varh", 4 },
+    { "kvarh", 5 },
+    { "W", 1 },
+    { "kW", 2 },
+    { "VA", 2 },
+    { "kVA", 3 },
+    { "var", 3 },
+    { "kvar", 4 },
+    { "A", 1 },
+    { "V", 1 },
+    { "K", 1 },
+    { "Celcius", 7 },
+    { "Celsius", 7 },
+    { "Fahrenheit", 10 },
+    { "Percent", 7 },
+};
+
+const char *ocpp16_sampled_value_unit_name(ocpp16_sampled_value_unit_t v) {
+    return ocpp16_sampled_value_unit_strs[v].ptr;
+}
+
+static int match_ocpp16_sampled_value_unit(ocpp_str_t s) {
+    switch (s.len) {
+    case 1:
+        if (memcmp(s.ptr, "W", 1) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_W;
+        if (memcmp(s.ptr, "A", 1) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_A;
+        if (memcmp(s.ptr, "V", 1) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_V;
+        if (memcmp(s.ptr, "K", 1) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_K;
+        break;
+    case 2:
+        if (memcmp(s.ptr, "Wh", 2) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_WH;
+        if (memcmp(s.ptr, "kW", 2) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_KW;
+        if (memcmp(s.ptr, "VA", 2) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_VA;
+        break;
+    case 3:
+        if (memcmp(s.ptr, "kWh", 3) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_KWH;
+        if (memcmp(s.ptr, "kVA", 3) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_KVA;
+        if (memcmp(s.ptr, "var", 3) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_VAR;
+        break;
+    case 4:
+        if (memcmp(s.ptr, "varh", 4) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_VARH;
+        if (memcmp(s.ptr, "kvar", 4) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_KVAR;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "kvarh", 5) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_KVARH;
+        break;
+    case 7:
+        if (memcmp(s.ptr, "Celcius", 7) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_CELCIUS;
+        if (memcmp(s.ptr, "Celsius", 7) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_CELSIUS;
+        if (memcmp(s.ptr, "Percent", 7) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_PERCENT;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "Fahrenheit", 10) == 0)
+            return OCPP16_SAMPLED_VALUE_UNIT_FAHRENHEIT;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_sampled_value_unit(ocpp_json_t *j, ocpp16_sampled_value_unit_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_sampled_value_unit(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_sampled_value_unit_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_status_notification_error_code_strs[] = {
+    { "ConnectorLockFailure", 20 },
+    { "EVCommunicationError", 20 },
+    { "GroundFailure", 13 },
+    { "HighTemperature", 15 },
+    { "InternalError", 13 },
+    { "LocalListConflict", 17 },
+    { "NoError", 7 },
+    { "OtherError", 10 },
+    { "OverCurrentFailure", 18 },
+    { "PowerMeterFailure", 17 },
+    { "PowerSwitchFailure", 18 },
+    { "ReaderFailure", 13 },
+    { "ResetFailure", 12 },
+    { "UnderVoltage", 12 },
+    { "OverVoltage", 11 },
+    { "WeakSignal", 10 },
+};
+
+const char *ocpp16_status_notification_error_code_name(ocpp16_status_notification_error_code_t v) {
+    return ocpp16_status_notification_error_code_strs[v].ptr;
+}
+
+static int match_ocpp16_status_notification_error_code(ocpp_str_t s) {
+    switch (s.len) {
+    case 7:
+        if (memcmp(s.ptr, "NoError", 7) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_NO_ERROR;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "OtherError", 10) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_OTHER_ERROR;
+        if (memcmp(s.ptr, "WeakSignal", 10) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_WEAK_SIGNAL;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "OverVoltage", 11) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_OVER_VOLTAGE;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "ResetFailure", 12) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_RESET_FAILURE;
+        if (memcmp(s.ptr, "UnderVoltage", 12) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_UNDER_VOLTAGE;
+        break;
+    case 13:
+        if (memcmp(s.ptr, "GroundFailure", 13) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_GROUND_FAILURE;
+        if (memcmp(s.ptr, "InternalError", 13) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_INTERNAL_ERROR;
+        if (memcmp(s.ptr, "ReaderFailure", 13) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_READER_FAILURE;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "HighTemperature", 15) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_HIGH_TEMPERATURE;
+        break;
+    case 17:
+        if (memcmp(s.ptr, "LocalListConflict", 17) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_LOCAL_LIST_CONFLICT;
+        if (memcmp(s.ptr, "PowerMeterFailure", 17) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_POWER_METER_FAILURE;
+        break;
+    case 18:
+        if (memcmp(s.ptr, "OverCurrentFailure", 18) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_OVER_CURRENT_FAILURE;
+        if (memcmp(s.ptr, "PowerSwitchFailure", 18) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_POWER_SWITCH_FAILURE;
+        break;
+    case 20:
+        if (memcmp(s.ptr, "ConnectorLockFailure", 20) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_CONNECTOR_LOCK_FAILURE;
+        if (memcmp(s.ptr, "EVCommunicationError", 20) == 0)
+            return OCPP16_STATUS_NOTIFICATION_ERROR_CODE_EV_COMMUNICATION_ERROR;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_status_notification_error_code(ocpp_json_t *j, ocpp16_status_notification_error_code_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_status_notification_error_code(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_status_notification_error_code_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp16_status_notification_status_strs[] = {
+    { "Available", 9 },
+    { "Preparing", 9 },
+    { "Charging", 8 },
+    { "SuspendedEVSE", 13 },
+    { "SuspendedEV", 11 },
+    { "Finishing", 9 },
+    { "Reserved", 8 },
+    { "Unavailable", 11 },
+    { "Faulted", 7 },
+};
+
+const char *ocpp16_status_notification_status_name(ocpp16_status_notification_status_t v) {
+    return ocpp16_status_notification_status_strs[v].ptr;
+}
+
+static int match_ocpp16_status_notification_status(ocpp_str_t s) {
+    switch (s.len) {
+    case 7:
+        if (memcmp(s.ptr, "Faulted", 7) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_FAULTED;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "Charging", 8) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_CHARGING;
+        if (memcmp(s.ptr, "Reserved", 8) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_RESERVED;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "Available", 9) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_AVAILABLE;
+        if (memcmp(s.ptr, "Preparing", 9) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_PREPARING;
+        if (memcmp(s.ptr, "Finishing", 9) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_FINISHING;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "SuspendedEV", 11) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_SUSPENDED_EV;
+        if (memcmp(s.ptr, "Unavailable", 11) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_UNAVAILABLE;
+        break;
+    case 13:
+        if (memcmp(s.ptr, "SuspendedEVSE", 13) == 0)
+            return OCPP16_STATUS_NOTIFICATION_STATUS_SUSPENDED_EVSE;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_status_notification_status(ocpp_json_t *j, ocpp16_status_notification_status_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp16_status_notification_status(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp16_status_notification_status_t)v;
+    return 0;
+}
+
+static const char *const ocpp16_boot_notification_request_fields[] = {
+    "chargePointVendor", "chargePointModel", "chargePointSerialNumber", "chargeBoxSerialNumber", "firmwareVersion", "iccid", "imsi", "meterType", "meterSerialNumber"
+};
+
+static int ocpp16_boot_notification_request_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 4:
+        if (memcmp(s.ptr, "imsi", 4) == 0)
+            return 6;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "iccid", 5) == 0)
+            return 5;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "meterType", 9) == 0)
+            return 7;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "firmwareVersion", 15) == 0)
+            return 4;
+        break;
+    case 16:
+        if (memcmp(s.ptr, "chargePointModel", 16) == 0)
+            return 1;
+        break;
+    case 17:
+        if (memcmp(s.ptr, "chargePointVendor", 17) == 0)
+            return 0;
+        if (memcmp(s.ptr, "meterSerialNumber", 17) == 0)
+            return 8;
+        break;
+    case 21:
+        if (memcmp(s.ptr, "chargeBoxSerialNumber", 21) == 0)
+            return 3;
+        break;
+    case 23:
+        if (memcmp(s.ptr, "chargePointSerialNumber", 23) == 0)
+            return 2;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_boot_notification_request(ocpp_json_t *j, ocpp16_boot_notification_request_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp16_boot_notification_request_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp16_boot_notification_request_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_string(j, &v->charge_point_vendor, 20, "chargePointVendor") < 0)
+                return -1;
+            break;
+        case 1:
+            if (ocpp_json_string(j, &v->charge_point_model, 20, "chargePointModel") < 0)
+                return -1;
+            break;
+        case 2:
+            if (ocpp_json_string(j, &v->charge_point_serial_number, 25, "chargePointSerialNumber") < 0)
+                return -1;
+            v->has_charge_point_serial_number = true;
+            break;
+        case 3:
+            if (ocpp_json_string(j, &v->charge_box_serial_number, 25, "chargeBoxSerialNumber") < 0)
+                return -1;
+            v->has_charge_box_serial_number = true;
+            break;
+        case 4:
+            if (ocpp_json_string(j, &v->firmware_version, 50, "firmwareVersion") < 0)
+                return -1;
+            v->has_firmware_version = true;
+            break;
+        case 5:
+            if (ocpp_json_string(j, &v->iccid, 20, "iccid") < 0)
+                return -1;
+            v->has_iccid = true;
+            break;
+        case 6:
+            if (ocpp_json_string(j, &v->imsi, 20, "imsi") < 0)
+                return -1;
+            v->has_imsi = true;
+            break;
+        case 7:
+            if (ocpp_json_string(j, &v->meter_type, 25, "meterType") < 0)
+                return -1;
+            v->has_meter_type = true;
+            break;
+        case 8:
+            if (ocpp_json_string(j, &v->meter_serial_number, 25, "meterSerialNumber") < 0)
+                return -1;
+            v->has_meter_serial_number = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x3u) != 0x3u)
+        return ocpp_json_missing(j, seen, 0x3u, ocpp16_boot_notification_request_fields);
+    return 0;
+}
+
+static void write_ocpp16_boot_notification_request(ocpp_writer_t *w, const ocpp16_boot_notification_request_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    ocpp_write_key(w, &members, "\"chargePointVendor\":", 20);
+    ocpp_write_str(w, v->charge_point_vendor);
+    ocpp_write_key(w, &members, "\"chargePointModel\":", 19);
+    ocpp_write_str(w, v->charge_point_model);
+    if (v->has_charge_point_serial_number) {
+        ocpp_write_key(w, &members, "\"chargePointSerialNumber\":", 26);
+        ocpp_write_str(w, v->charge_point_serial_number);
+    }
+    if (v->has_charge_box_serial_number) {
+        ocpp_write_key(w, &members, "\"chargeBoxSerialNumber\":", 24);
+        ocpp_write_str(w, v->charge_box_serial_number);
+    }
+    if (v->has_firmware_version) {
+        ocpp_write_key(w, &members, "\"firmwareVersion\":", 18);
+        ocpp_write_str(w, v->firmware_version);
+    }
+    if (v->has_iccid) {
+        ocpp_write_key(w, &members, "\"iccid\":", 8);
+        ocpp_write_str(w, v->iccid);
+    }
+    if (v->has_imsi) {
+        ocpp_write_key(w, &members, "\"imsi\":", 7);
+        ocpp_write_str(w, v->imsi);
+    }
+    if (v->has_meter_type) {
+        ocpp_write_key(w, &members, "\"meterType\":", 12);
+        ocpp_write_str(w, v->meter_type);
+    }
+    if (v->has_meter_serial_number) {
+        ocpp_write_key(w, &members, "\"meterSerialNumber\":", 20);
+        ocpp_write_str(w, v->meter_serial_number);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp16_boot_notification_request_parse(ocpp_json_t *j, ocpp16_boot_notification_request_t *v) {
+    if (parse_ocpp16_boot_notification_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_boot_notification_request_write(ocpp_writer_t *w, const ocpp16_boot_notification_request_t *v) {
+    write_ocpp16_boot_notification_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp16_boot_notification_response_fields[] = {
+    "status", "currentTime", "interval"
+};
+
+static int ocpp16_boot_notification_response_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 6:
+        if (memcmp(s.ptr, "status", 6) == 0)
+            return 0;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "interval", 8) == 0)
+            return 2;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "currentTime", 11) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_boot_notification_response(ocpp_json_t *j, ocpp16_boot_notification_response_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp16_boot_notification_response_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp16_boot_notification_response_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (parse_ocpp16_boot_notification_status(j, &v->status, "status") < 0)
+                return -1;
+            break;
+        case 1:
+            if (ocpp_json_datetime(j, &v->current_time, "currentTime") < 0)
+                return -1;
+            break;
+        case 2:
+            if (ocpp_json_int(j, &v->interval, "interval") < 0)
+                return -1;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x7u) != 0x7u)
+        return ocpp_json_missing(j, seen, 0x7u, ocpp16_boot_notification_response_fields);
+    return 0;
+}
+
+static void write_ocpp16_boot_notification_response(ocpp_writer_t *w, const ocpp16_boot_notification_response_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    ocpp_write_key(w, &members, "\"status\":", 9);
+    ocpp_write_str(w, ocpp16_boot_notification_status_strs[v->status]);
+    ocpp_write_key(w, &members, "\"currentTime\":", 14);
+    ocpp_write_str(w, v->current_time);
+    ocpp_write_key(w, &members, "\"interval\":", 11);
+    ocpp_write_int(w, v->interval);
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp16_boot_notification_response_parse(ocpp_json_t *j, ocpp16_boot_notification_response_t *v) {
+    if (parse_ocpp16_boot_notification_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_boot_notification_response_write(ocpp_writer_t *w, const ocpp16_boot_notification_response_t *v) {
+    write_ocpp16_boot_notification_response(w, v);
+    return ocpp_writer_status(w);
+}
+
+static int parse_ocpp16_heartbeat_request(ocpp_json_t *j, ocpp16_heartbeat_request_t *v, const char *what) {
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+    }
+    return rc;
+}
+
+static void write_ocpp16_heartbeat_request(ocpp_writer_t *w, const ocpp16_heartbeat_request_t *v) {
+    (void)v;
+    ocpp_write_raw(w, "{}", 2);
+}
+
+int ocpp16_heartbeat_request_parse(ocpp_json_t *j, ocpp16_heartbeat_request_t *v) {
+    if (parse_ocpp16_heartbeat_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_heartbeat_request_write(ocpp_writer_t *w, const ocpp16_heartbeat_request_t *v) {
+    write_ocpp16_heartbeat_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp16_heartbeat_response_fields[] = {
+    "currentTime"
+};
+
+static int ocpp16_heartbeat_response_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 11:
+        if (memcmp(s.ptr, "currentTime", 11) == 0)
+            return 0;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_heartbeat_response(ocpp_json_t *j, ocpp16_heartbeat_response_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp16_heartbeat_response_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp16_heartbeat_response_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_datetime(j, &v->current_time, "currentTime") < 0)
+                return -1;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x1u) != 0x1u)
+        return ocpp_json_missing(j, seen, 0x1u, ocpp16_heartbeat_response_fields);
+    return 0;
+}
+
+static void write_ocpp16_heartbeat_response(ocpp_writer_t *w, const ocpp16_heartbeat_response_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    ocpp_write_key(w, &members, "\"currentTime\":", 14);
+    ocpp_write_str(w, v->current_time);
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp16_heartbeat_response_parse(ocpp_json_t *j, ocpp16_heartbeat_response_t *v) {
+    if (parse_ocpp16_heartbeat_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_heartbeat_response_write(ocpp_writer_t *w, const ocpp16_heartbeat_response_t *v) {
+    write_ocpp16_heartbeat_response(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp16_sampled_value_fields[] = {
+    "value", "context", "format", "measurand", "phase", "location", "unit"
+};
+
+static int ocpp16_sampled_value_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 4:
+        if (memcmp(s.ptr, "unit", 4) == 0)
+            return 6;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "value", 5) == 0)
+            return 0;
+        if (memcmp(s.ptr, "phase", 5) == 0)
+            return 4;
+        break;
+    case 6:
+        if (memcmp(s.ptr, "format", 6) == 0)
+            return 2;
+        break;
+    case 7:
+        if (memcmp(s.ptr, "context", 7) == 0)
+            return 1;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "location", 8) == 0)
+            return 5;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "measurand", 9) == 0)
+            return 3;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_sampled_value(ocpp_json_t *j, ocpp16_sampled_value_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp16_sampled_value_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp16_sampled_value_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_string(j, &v->value, 0, "value") < 0)
+                return -1;
+            break;
+        case 1:
+            if (parse_ocpp16_sampled_value_context(j, &v->context, "context") < 0)
+                return -1;
+            v->has_context = true;
+            break;
+        case 2:
+            if (parse_ocpp16_sampled_value_format(j, &v->format, "format") < 0)
+                return -1;
+            v->has_format = true;
+            break;
+        case 3:
+            if (parse_ocpp16_sampled_value_measurand(j, &v->measurand, "measurand") < 0)
+                return -1;
+            v->has_measurand = true;
+            break;
+        case 4:
+            if (parse_ocpp16_sampled_value_phase(j, &v->phase, "phase") < 0)
+                return -1;
+            v->has_phase = true;
+            break;
+        case 5:
+            if (parse_ocpp16_sampled_value_location(j, &v->location, "location") < 0)
+                return -1;
+            v->has_location = true;
+            break;
+        case 6:
+            if (parse_ocpp16_sampled_value_unit(j, &v->unit, "unit") < 0)
+                return -1;
+            v->has_unit = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x1u) != 0x1u)
+        return ocpp_json_missing(j, seen, 0x1u, ocpp16_sampled_value_fields);
+    return 0;
+}
+
+static void write_ocpp16_sampled_value(ocpp_writer_t *w, const ocpp16_sampled_value_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    ocpp_write_key(w, &members, "\"value\":", 8);
+    ocpp_write_str(w, v->value);
+    if (v->has_context) {
+        ocpp_write_key(w, &members, "\"context\":", 10);
+        ocpp_write_str(w, ocpp16_sampled_value_context_strs[v->context]);
+    }
+    if (v->has_format) {
+        ocpp_write_key(w, &members, "\"format\":", 9);
+        ocpp_write_str(w, ocpp16_sampled_value_format_strs[v->format]);
+    }
+    if (v->has_measurand) {
+        ocpp_write_key(w, &members, "\"measurand\":", 12);
+        ocpp_write_str(w, ocpp16_sampled_value_measurand_strs[v->measurand]);
+    }
+    if (v->has_phase) {
+        ocpp_write_key(w, &members, "\"phase\":", 8);
+        ocpp_write_str(w, ocpp16_sampled_value_phase_strs[v->phase]);
+    }
+    if (v->has_location) {
+        ocpp_write_key(w, &members, "\"location\":", 11);
+        ocpp_write_str(w, ocpp16_sampled_value_location_strs[v->location]);
+    }
+    if (v->has_unit) {
+        ocpp_write_key(w, &members, "\"unit\":", 7);
+        ocpp_write_str(w, ocpp16_sampled_value_unit_strs[v->unit]);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp16_meter_value_fields[] = {
+    "timestamp", "sampledValue"
+};
+
+static int ocpp16_meter_value_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 9:
+        if (memcmp(s.ptr, "timestamp", 9) == 0)
+            return 0;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "sampledValue", 12) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_meter_value(ocpp_json_t *j, ocpp16_meter_value_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp16_meter_value_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp16_meter_value_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_datetime(j, &v->timestamp, "timestamp") < 0)
+                return -1;
+            break;
+        case 1: {
+            ocpp_json_array_t a;
+            ocpp16_sampled_value_t *item;
+            if (ocpp_json_array_begin(j, &a, "sampledValue") < 0)
+                return -1;
+            while ((rc = ocpp_json_array_next(j)) > 0) {
+                if (!(item = ocpp_json_array_push(j, &a, sizeof(*item))))
+                    return -1;
+                if (parse_ocpp16_sampled_value(j, item, "sampledValue") < 0)
+                    return -1;
+            }
+            if (rc < 0)
+                return -1;
+            v->sampled_value = ocpp_json_array_end(j, &a, sizeof(*v->sampled_value));
+            if (j->error)
+                return -1;
+            v->sampled_value_count = a.count;
+            break;
+        }
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x3u) != 0x3u)
+        return ocpp_json_missing(j, seen, 0x3u, ocpp16_meter_value_fields);
+    return 0;
+}
+
+static void write_ocpp16_meter_value(ocpp_writer_t *w, const ocpp16_meter_value_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    ocpp_write_key(w, &members, "\"timestamp\":", 12);
+    ocpp_write_str(w, v->timestamp);
+    ocpp_write_key(w, &members, "\"sampledValue\":", 15);
+    ocpp_write_raw(w, "[", 1);
+    for (size_t i = 0; i < v->sampled_value_count; i++) {
+        if (i)
+            ocpp_write_raw(w, ",", 1);
+        write_ocpp16_sampled_value(w, &v->sampled_value[i]);
+    }
+    ocpp_write_raw(w, "]", 1);
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp16_meter_values_request_fields[] = {
+    "connectorId", "transactionId", "meterValue"
+};
+
+static int ocpp16_meter_values_request_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 10:
+        if (memcmp(s.ptr, "meterValue", 10) == 0)
+            return 2;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "connectorId", 11) == 0)
+            return 0;
+        break;
+    case 13:
+        if (memcmp(s.ptr, "transactionId", 13) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_meter_values_request(ocpp_json_t *j, ocpp16_meter_values_request_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp16_meter_values_request_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp16_meter_values_request_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_int(j, &v->connector_id, "connectorId") < 0)
+                return -1;
+            break;
+        case 1:
+            if (ocpp_json_int(j, &v->transaction_id, "transactionId") < 0)
+                return -1;
+            v->has_transaction_id = true;
+            break;
+        case 2: {
+            ocpp_json_array_t a;
+            ocpp16_meter_value_t *item;
+            if (ocpp_json_array_begin(j, &a, "meterValue") < 0)
+                return -1;
+            while ((rc = ocpp_json_array_next(j)) > 0) {
+                if (!(item = ocpp_json_array_push(j, &a, sizeof(*item))))
+                    return -1;
+                if (parse_ocpp16_meter_value(j, item, "meterValue") < 0)
+                    return -1;
+            }
+            if (rc < 0)
+                return -1;
+            v->meter_value = ocpp_json_array_end(j, &a, sizeof(*v->meter_value));
+            if (j->error)
+                return -1;
+            v->meter_value_count = a.count;
+            break;
+        }
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x5u) != 0x5u)
+        return ocpp_json_missing(j, seen, 0x5u, ocpp16_meter_values_request_fields);
+    return 0;
+}
+
+static void write_ocpp16_meter_values_request(ocpp_writer_t *w, const ocpp16_meter_values_request_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    ocpp_write_key(w, &members, "\"connectorId\":", 14);
+    ocpp_write_int(w, v->connector_id);
+    if (v->has_transaction_id) {
+        ocpp_write_key(w, &members, "\"transactionId\":", 16);
+        ocpp_write_int(w, v->transaction_id);
+    }
+    ocpp_write_key(w, &members, "\"meterValue\":", 13);
+    ocpp_write_raw(w, "[", 1);
+    for (size_t i = 0; i < v->meter_value_count; i++) {
+        if (i)
+            ocpp_write_raw(w, ",", 1);
+        write_ocpp16_meter_value(w, &v->meter_value[i]);
+    }
+    ocpp_write_raw(w, "]", 1);
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp16_meter_values_request_parse(ocpp_json_t *j, ocpp16_meter_values_request_t *v) {
+    if (parse_ocpp16_meter_values_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_meter_values_request_write(ocpp_writer_t *w, const ocpp16_meter_values_request_t *v) {
+    write_ocpp16_meter_values_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static int parse_ocpp16_meter_values_response(ocpp_json_t *j, ocpp16_meter_values_response_t *v, const char *what) {
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+    }
+    return rc;
+}
+
+static void write_ocpp16_meter_values_response(ocpp_writer_t *w, const ocpp16_meter_values_response_t *v) {
+    (void)v;
+    ocpp_write_raw(w, "{}", 2);
+}
+
+int ocpp16_meter_values_response_parse(ocpp_json_t *j, ocpp16_meter_values_response_t *v) {
+    if (parse_ocpp16_meter_values_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_meter_values_response_write(ocpp_writer_t *w, const ocpp16_meter_values_response_t *v) {
+    write_ocpp16_meter_values_response(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp16_status_notification_request_fields[] = {
+    "connectorId", "errorCode", "info", "status", "timestamp", "vendorId", "vendorErrorCode"
+};
+
+static int ocpp16_status_notification_request_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 4:
+        if (memcmp(s.ptr, "info", 4) == 0)
+            return 2;
+        break;
+    case 6:
+        if (memcmp(s.ptr, "status", 6) == 0)
+            return 3;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "vendorId", 8) == 0)
+            return 5;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "errorCode", 9) == 0)
+            return 1;
+        if (memcmp(s.ptr, "timestamp", 9) == 0)
+            return 4;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "connectorId", 11) == 0)
+            return 0;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "vendorErrorCode", 15) == 0)
+            return 6;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp16_status_notification_request(ocpp_json_t *j, ocpp16_status_notification_request_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp16_status_notification_request_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp16_status_notification_request_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_int(j, &v->connector_id, "connectorId") < 0)
+                return -1;
+            break;
+        case 1:
+            if (parse_ocpp16_status_notification_error_code(j, &v->error_code, "errorCode") < 0)
+                return -1;
+            break;
+        case 2:
+            if (ocpp_json_string(j, &v->info, 50, "info") < 0)
+                return -1;
+            v->has_info = true;
+            break;
+        case 3:
+            if (parse_ocpp16_status_notification_status(j, &v->status, "status") < 0)
+                return -1;
+            break;
+        case 4:
+            if (ocpp_json_datetime(j, &v->timestamp, "timestamp") < 0)
+                return -1;
+            v->has_timestamp = true;
+            break;
+        case 5:
+            if (ocpp_json_string(j, &v->vendor_id, 255, "vendorId") < 0)
+                return -1;
+            v->has_vendor_id = true;
+            break;
+        case 6:
+            if (ocpp_json_string(j, &v->vendor_error_code, 50, "vendorErrorCode") < 0)
+                return -1;
+            v->has_vendor_error_code = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0xbu) != 0xbu)
+        return ocpp_json_missing(j, seen, 0xbu, ocpp16_status_notification_request_fields);
+    return 0;
+}
+
+static void write_ocpp16_status_notification_request(ocpp_writer_t *w, const ocpp16_status_notification_request_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    ocpp_write_key(w, &members, "\"connectorId\":", 14);
+    ocpp_write_int(w, v->connector_id);
+    ocpp_write_key(w, &members, "\"errorCode\":", 12);
+    ocpp_write_str(w, ocpp16_status_notification_error_code_strs[v->error_code]);
+    if (v->has_info) {
+        ocpp_write_key(w, &members, "\"info\":", 7);
+        ocpp_write_str(w, v->info);
+    }
+    ocpp_write_key(w, &members, "\"status\":", 9);
+    ocpp_write_str(w, ocpp16_status_notification_status_strs[v->status]);
+    if (v->has_timestamp) {
+        ocpp_write_key(w, &members, "\"timestamp\":", 12);
+        ocpp_write_str(w, v->timestamp);
+    }
+    if (v->has_vendor_id) {
+        ocpp_write_key(w, &members, "\"vendorId\":", 11);
+        ocpp_write_str(w, v->vendor_id);
+    }
+    if (v->has_vendor_error_code) {
+        ocpp_write_key(w, &members, "\"vendorErrorCode\":", 18);
+        ocpp_write_str(w, v->vendor_error_code);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp16_status_notification_request_parse(ocpp_json_t *j, ocpp16_status_notification_request_t *v) {
+    if (parse_ocpp16_status_notification_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_status_notification_request_write(ocpp_writer_t *w, const ocpp16_status_notification_request_t *v) {
+    write_ocpp16_status_notification_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static int parse_ocpp16_status_notification_response(ocpp_json_t *j, ocpp16_status_notification_response_t *v, const char *what) {
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+    }
+    return rc;
+}
+
+static void write_ocpp16_status_notification_response(ocpp_writer_t *w, const ocpp16_status_notification_response_t *v) {
+    (void)v;
+    ocpp_write_raw(w, "{}", 2);
+}
+
+int ocpp16_status_notification_response_parse(ocpp_json_t *j, ocpp16_status_notification_response_t *v) {
+    if (parse_ocpp16_status_notification_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp16_status_notification_response_write(ocpp_writer_t *w, const ocpp16_status_notification_response_t *v) {
+    write_ocpp16_status_notification_response(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const ocpp_str_t ocpp201_boot_reason_strs[] = {
+    { "ApplicationReset", 16 },
+    { "FirmwareUpdate", 14 },
+    { "LocalReset", 10 },
+    { "PowerUp", 7 },
+    { "RemoteReset", 11 },
+    { "ScheduledReset", 14 },
+    { "Triggered", 9 },
+    { "Unknown", 7 },
+    { "Watchdog", 8 },
+};
+
+const char *ocpp201_boot_reason_name(ocpp201_boot_reason_t v) {
+    return ocpp201_boot_reason_strs[v].ptr;
+}
+
+static int match_ocpp201_boot_reason(ocpp_str_t s) {
+    switch (s.len) {
+    case 7:
+        if (memcmp(s.ptr, "PowerUp", 7) == 0)
+            return OCPP201_BOOT_REASON_POWER_UP;
+        if (memcmp(s.ptr, "Unknown", 7) == 0)
+            return OCPP201_BOOT_REASON_UNKNOWN;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "Watchdog", 8) == 0)
+            return OCPP201_BOOT_REASON_WATCHDOG;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "Triggered", 9) == 0)
+            return OCPP201_BOOT_REASON_TRIGGERED;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "LocalReset", 10) == 0)
+            return OCPP201_BOOT_REASON_LOCAL_RESET;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "RemoteReset", 11) == 0)
+            return OCPP201_BOOT_REASON_REMOTE_RESET;
+        break;
+    case 14:
+        if (memcmp(s.ptr, "FirmwareUpdate", 14) == 0)
+            return OCPP201_BOOT_REASON_FIRMWARE_UPDATE;
+        if (memcmp(s.ptr, "ScheduledReset", 14) == 0)
+            return OCPP201_BOOT_REASON_SCHEDULED_RESET;
+        break;
+    case 16:
+        if (memcmp(s.ptr, "ApplicationReset", 16) == 0)
+            return OCPP201_BOOT_REASON_APPLICATION_RESET;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_boot_reason(ocpp_json_t *j, ocpp201_boot_reason_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp201_boot_reason(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp201_boot_reason_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp201_registration_status_strs[] = {
+    { "Accepted", 8 },
+    { "Pending", 7 },
+    { "Rejected", 8 },
+};
+
+const char *ocpp201_registration_status_name(ocpp201_registration_status_t v) {
+    return ocpp201_registration_status_strs[v].ptr;
+}
+
+static int match_ocpp201_registration_status(ocpp_str_t s) {
+    switch (s.len) {
+    case 7:
+        if (memcmp(s.ptr, "Pending", 7) == 0)
+            return OCPP201_REGISTRATION_STATUS_PENDING;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "Accepted", 8) == 0)
+            return OCPP201_REGISTRATION_STATUS_ACCEPTED;
+        if (memcmp(s.ptr, "Rejected", 8) == 0)
+            return OCPP201_REGISTRATION_STATUS_REJECTED;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_registration_status(ocpp_json_t *j, ocpp201_registration_status_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp201_registration_status(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp201_registration_status_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp201_reading_context_strs[] = {
+    { "Interruption.Begin", 18 },
+    { "Interruption.End", 16 },
+    { "Other", 5 },
+    { "Sample.Clock", 12 },
+    { "Sample.Periodic", 15 },
+    { "Transaction.Begin", 17 },
+    { "Transaction.End", 15 },
+    { "Trigger", 7 },
+};
+
+const char *ocpp201_reading_context_name(ocpp201_reading_context_t v) {
+    return ocpp201_reading_context_strs[v].ptr;
+}
+
+static int match_ocpp201_reading_context(ocpp_str_t s) {
+    switch (s.len) {
+    case 5:
+        if (memcmp(s.ptr, "Other", 5) == 0)
+            return OCPP201_READING_CONTEXT_OTHER;
+        break;
+    case 7:
+        if (memcmp(s.ptr, "Trigger", 7) == 0)
+            return OCPP201_READING_CONTEXT_TRIGGER;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "Sample.Clock", 12) == 0)
+            return OCPP201_READING_CONTEXT_SAMPLE_CLOCK;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "Sample.Periodic", 15) == 0)
+            return OCPP201_READING_CONTEXT_SAMPLE_PERIODIC;
+        if (memcmp(s.ptr, "Transaction.End", 15) == 0)
+            return OCPP201_READING_CONTEXT_TRANSACTION_END;
+        break;
+    case 16:
+        if (memcmp(s.ptr, "Interruption.End", 16) == 0)
+            return OCPP201_READING_CONTEXT_INTERRUPTION_END;
+        break;
+    case 17:
+        if (memcmp(s.ptr, "Transaction.Begin", 17) == 0)
+            return OCPP201_READING_CONTEXT_TRANSACTION_BEGIN;
+        break;
+    case 18:
+        if (memcmp(s.ptr, "Interruption.Begin", 18) == 0)
+            return OCPP201_READING_CONTEXT_INTERRUPTION_BEGIN;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_reading_context(ocpp_json_t *j, ocpp201_reading_context_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp201_reading_context(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp201_reading_context_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp201_measurand_strs[] = {
+    { "Current.Export", 14 },
+    { "Current.Import", 14 },
+    { "Current.Offered", 15 },
+    { "Energy.Active.Export.Register", 29 },
+    { "Energy.Active.Import.Register", 29 },
+    { "Energy.Reactive.Export.Register", 31 },
+    { "Energy.Reactive.Import.Register", 31 },
+    { "Energy.Active.Export.Interval", 29 },
+    { "Energy.Active.Import.Interval", 29 },
+    { "Energy.Active.Net", 17 },
+    { "Energy.Reactive.Export.Interval", 31 },
+    { "Energy.Reactive.Import.Interval", 31 },
+    { "Energy.Reactive.Net", 19 },
+    { "Energy.Apparent.Net", 19 },
+    { "Energy.Apparent.Import", 22 },
+    { "Energy.Apparent.Export", 22 },
+    { "Frequency", 9 },
+    { "Power.Active.Export", 19 },
+    { "Power.Active.Import", 19 },
+    { "Power.Factor", 12 },
+    { "Power.Offered", 13 },
+    { "Power.Reactive.Export", 21 },
+    { "Power.Reactive.Import", 21 },
+    { "SoC", 3 },
+    { "Voltage", 7 },
+};
+
+const char *ocpp201_measurand_name(ocpp201_measurand_t v) {
+    return ocpp201_measurand_strs[v].ptr;
+}
+
+static int match_ocpp201_measurand(ocpp_str_t s) {
+    switch (s.len) {
+    case 3:
+        if (memcmp(s.ptr, "SoC", 3) == 0)
+            return OCPP201_MEASURAND_SOC;
+        break;
+    case 7:
+        if (memcmp(s.ptr, "Voltage", 7) == 0)
+            return OCPP201_MEASURAND_VOLTAGE;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "Frequency", 9) == 0)
+            return OCPP201_MEASURAND_FREQUENCY;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "Power.Factor", 12) == 0)
+            return OCPP201_MEASURAND_POWER_FACTOR;
+        break;
+    case 13:
+        if (memcmp(s.ptr, "Power.Offered", 13) == 0)
+            return OCPP201_MEASURAND_POWER_OFFERED;
+        break;
+    case 14:
+        if (memcmp(s.ptr, "Current.Export", 14) == 0)
+            return OCPP201_MEASURAND_CURRENT_EXPORT;
+        if (memcmp(s.ptr, "Current.Import", 14) == 0)
+            return OCPP201_MEASURAND_CURRENT_IMPORT;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "Current.Offered", 15) == 0)
+            return OCPP201_MEASURAND_CURRENT_OFFERED;
+        break;
+    case 17:
+        if (memcmp(s.ptr, "Energy.Active.Net", 17) == 0)
+            return OCPP201_MEASURAND_ENERGY_ACTIVE_NET;
+        break;
+    case 19:
+        if (memcmp(s.ptr, "Energy.Reactive.Net", 19) == 0)
+            return OCPP201_MEASURAND_ENERGY_REACTIVE_NET;
+        if (memcmp(s.ptr, "Energy.Apparent.Net", 19) == 0)
+            return OCPP201_MEASURAND_ENERGY_APPARENT_NET;
+        if (memcmp(s.ptr, "Power.Active.Export", 19) == 0)
+            return OCPP201_MEASURAND_POWER_ACTIVE_EXPORT;
+        if (memcmp(s.ptr, "Power.Active.Import", 19) == 0)
+            return OCPP201_MEASURAND_POWER_ACTIVE_IMPORT;
+        break;
+    case 21:
+        if (memcmp(s.ptr, "Power.Reactive.Export", 21) == 0)
+            return OCPP201_MEASURAND_POWER_REACTIVE_EXPORT;
+        if (memcmp(s.ptr, "Power.Reactive.Import", 21) == 0)
+            return OCPP201_MEASURAND_POWER_REACTIVE_IMPORT;
+        break;
+    case 22:
+        if (memcmp(s.ptr, "Energy.Apparent.Import", 22) == 0)
+            return OCPP201_MEASURAND_ENERGY_APPARENT_IMPORT;
+        if (memcmp(s.ptr, "Energy.Apparent.Export", 22) == 0)
+            return OCPP201_MEASURAND_ENERGY_APPARENT_EXPORT;
+        break;
+    case 29:
+        if (memcmp(s.ptr, "Energy.Active.Export.Register", 29) == 0)
+            return OCPP201_MEASURAND_ENERGY_ACTIVE_EXPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Active.Import.Register", 29) == 0)
+            return OCPP201_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Active.Export.Interval", 29) == 0)
+            return OCPP201_MEASURAND_ENERGY_ACTIVE_EXPORT_INTERVAL;
+        if (memcmp(s.ptr, "Energy.Active.Import.Interval", 29) == 0)
+            return OCPP201_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL;
+        break;
+    case 31:
+        if (memcmp(s.ptr, "Energy.Reactive.Export.Register", 31) == 0)
+            return OCPP201_MEASURAND_ENERGY_REACTIVE_EXPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Reactive.Import.Register", 31) == 0)
+            return OCPP201_MEASURAND_ENERGY_REACTIVE_IMPORT_REGISTER;
+        if (memcmp(s.ptr, "Energy.Reactive.Export.Interval", 31) == 0)
+            return OCPP201_MEASURAND_ENERGY_REACTIVE_EXPORT_INTERVAL;
+        if (memcmp(s.ptr, "Energy.Reactive.Import.Interval", 31) == 0)
+            return OCPP201_MEASURAND_ENERGY_REACTIVE_IMPORT_INTERVAL;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_measurand(ocpp_json_t *j, ocpp201_measurand_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp201_measurand(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp201_measurand_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp201_phase_strs[] = {
+    { "L1", 2 },
+    { "L2", 2 },
+    { "L3", 2 },
+    { "N", 1 },
+    { "L1-N", 4 },
+    { "L2-N", 4 },
+    { "L3-N", 4 },
+    { "L1-L2", 5 },
+    { "L2-L3", 5 },
+    { "L3-L1", 5 },
+};
+
+const char *ocpp201_phase_name(ocpp201_phase_t v) {
+    return ocpp201_phase_strs[v].ptr;
+}
+
+static int match_ocpp201_phase(ocpp_str_t s) {
+    switch (s.len) {
+    case 1:
+        if (memcmp(s.ptr, "N", 1) == 0)
+            return OCPP201_PHASE_N;
+        break;
+    case 2:
+        if (memcmp(s.ptr, "L1", 2) == 0)
+            return OCPP201_PHASE_L1;
+        if (memcmp(s.ptr, "L2", 2) == 0)
+            return OCPP201_PHASE_L2;
+        if (memcmp(s.ptr, "L3", 2) == 0)
+            return OCPP201_PHASE_L3;
+        break;
+    case 4:
+        if (memcmp(s.ptr, "L1-N", 4) == 0)
+            return OCPP201_PHASE_L1_N;
+        if (memcmp(s.ptr, "L2-N", 4) == 0)
+            return OCPP201_PHASE_L2_N;
+        if (memcmp(s.ptr, "L3-N", 4) == 0)
+            return OCPP201_PHASE_L3_N;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "L1-L2", 5) == 0)
+            return OCPP201_PHASE_L1_L2;
+        if (memcmp(s.ptr, "L2-L3", 5) == 0)
+            return OCPP201_PHASE_L2_L3;
+        if (memcmp(s.ptr, "L3-L1", 5) == 0)
+            return OCPP201_PHASE_L3_L1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_phase(ocpp_json_t *j, ocpp201_phase_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp201_phase(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp201_phase_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp201_location_strs[] = {
+    { "Body", 4 },
+    { "Cable", 5 },
+    { "EV", 2 },
+    { "Inlet", 5 },
+    { "Outlet", 6 },
+};
+
+const char *ocpp201_location_name(ocpp201_location_t v) {
+    return ocpp201_location_strs[v].ptr;
+}
+
+static int match_ocpp201_location(ocpp_str_t s) {
+    switch (s.len) {
+    case 2:
+        if (memcmp(s.ptr, "EV", 2) == 0)
+            return OCPP201_LOCATION_EV;
+        break;
+    case 4:
+        if (memcmp(s.ptr, "Body", 4) == 0)
+            return OCPP201_LOCATION_BODY;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "Cable", 5) == 0)
+            return OCPP201_LOCATION_CABLE;
+        if (memcmp(s.ptr, "Inlet", 5) == 0)
+            return OCPP201_LOCATION_INLET;
+        break;
+    case 6:
+        if (memcmp(s.ptr, "Outlet", 6) == 0)
+            return OCPP201_LOCATION_OUTLET;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_location(ocpp_json_t *j, ocpp201_location_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp201_location(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp201_location_t)v;
+    return 0;
+}
+
+static const ocpp_str_t ocpp201_connector_status_strs[] = {
+    { "Available", 9 },
+    { "Occupied", 8 },
+    { "Reserved", 8 },
+    { "Unavailable", 11 },
+    { "Faulted", 7 },
+};
+
+const char *ocpp201_connector_status_name(ocpp201_connector_status_t v) {
+    return ocpp201_connector_status_strs[v].ptr;
+}
+
+static int match_ocpp201_connector_status(ocpp_str_t s) {
+    switch (s.len) {
+    case 7:
+        if (memcmp(s.ptr, "Faulted", 7) == 0)
+            return OCPP201_CONNECTOR_STATUS_FAULTED;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "Occupied", 8) == 0)
+            return OCPP201_CONNECTOR_STATUS_OCCUPIED;
+        if (memcmp(s.ptr, "Reserved", 8) == 0)
+            return OCPP201_CONNECTOR_STATUS_RESERVED;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "Available", 9) == 0)
+            return OCPP201_CONNECTOR_STATUS_AVAILABLE;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "Unavailable", 11) == 0)
+            return OCPP201_CONNECTOR_STATUS_UNAVAILABLE;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_connector_status(ocpp_json_t *j, ocpp201_connector_status_t *out, const char *what) {
+    ocpp_str_t s;
+    if (ocpp_json_string(j, &s, 0, what) < 0)
+        return -1;
+    int v = match_ocpp201_connector_status(s);
+    if (v < 0)
+        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);
+    *out = (ocpp201_connector_status_t)v;
+    return 0;
+}
+
+static const char *const ocpp201_modem_fields[] = {
+    "customData", "iccid", "imsi"
+};
+
+static int ocpp201_modem_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 4:
+        if (memcmp(s.ptr, "imsi", 4) == 0)
+            return 2;
+        break;
+    case 5:
+        if (memcmp(s.ptr, "iccid", 5) == 0)
+            return 1;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_modem(ocpp_json_t *j, ocpp201_modem_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_modem_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_modem_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_string(j, &v->iccid, 20, "iccid") < 0)
+                return -1;
+            v->has_iccid = true;
+            break;
+        case 2:
+            if (ocpp_json_string(j, &v->imsi, 20, "imsi") < 0)
+                return -1;
+            v->has_imsi = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    return 0;
+}
+
+static void write_ocpp201_modem(ocpp_writer_t *w, const ocpp201_modem_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    if (v->has_iccid) {
+        ocpp_write_key(w, &members, "\"iccid\":", 8);
+        ocpp_write_str(w, v->iccid);
+    }
+    if (v->has_imsi) {
+        ocpp_write_key(w, &members, "\"imsi\":", 7);
+        ocpp_write_str(w, v->imsi);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp201_charging_station_fields[] = {
+    "customData", "serialNumber", "model", "modem", "vendorName", "firmwareVersion"
+};
+
+static int ocpp201_charging_station_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 5:
+        if (memcmp(s.ptr, "model", 5) == 0)
+            return 2;
+        if (memcmp(s.ptr, "modem", 5) == 0)
+            return 3;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        if (memcmp(s.ptr, "vendorName", 10) == 0)
+            return 4;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "serialNumber", 12) == 0)
+            return 1;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "firmwareVersion", 15) == 0)
+            return 5;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_charging_station(ocpp_json_t *j, ocpp201_charging_station_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_charging_station_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_charging_station_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_string(j, &v->serial_number, 25, "serialNumber") < 0)
+                return -1;
+            v->has_serial_number = true;
+            break;
+        case 2:
+            if (ocpp_json_string(j, &v->model, 20, "model") < 0)
+                return -1;
+            break;
+        case 3:
+            if (parse_ocpp201_modem(j, &v->modem, "modem") < 0)
+                return -1;
+            v->has_modem = true;
+            break;
+        case 4:
+            if (ocpp_json_string(j, &v->vendor_name, 50, "vendorName") < 0)
+                return -1;
+            break;
+        case 5:
+            if (ocpp_json_string(j, &v->firmware_version, 50, "firmwareVersion") < 0)
+                return -1;
+            v->has_firmware_version = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x14u) != 0x14u)
+        return ocpp_json_missing(j, seen, 0x14u, ocpp201_charging_station_fields);
+    return 0;
+}
+
+static void write_ocpp201_charging_station(ocpp_writer_t *w, const ocpp201_charging_station_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    if (v->has_serial_number) {
+        ocpp_write_key(w, &members, "\"serialNumber\":", 15);
+        ocpp_write_str(w, v->serial_number);
+    }
+    ocpp_write_key(w, &members, "\"model\":", 8);
+    ocpp_write_str(w, v->model);
+    if (v->has_modem) {
+        ocpp_write_key(w, &members, "\"modem\":", 8);
+        write_ocpp201_modem(w, &v->modem);
+    }
+    ocpp_write_key(w, &members, "\"vendorName\":", 13);
+    ocpp_write_str(w, v->vendor_name);
+    if (v->has_firmware_version) {
+        ocpp_write_key(w, &members, "\"firmwareVersion\":", 18);
+        ocpp_write_str(w, v->firmware_version);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp201_boot_notification_request_fields[] = {
+    "customData", "chargingStation", "reason"
+};
+
+static int ocpp201_boot_notification_request_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 6:
+        if (memcmp(s.ptr, "reason", 6) == 0)
+            return 2;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "chargingStation", 15) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_boot_notification_request(ocpp_json_t *j, ocpp201_boot_notification_request_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_boot_notification_request_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_boot_notification_request_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (parse_ocpp201_charging_station(j, &v->charging_station, "chargingStation") < 0)
+                return -1;
+            break;
+        case 2:
+            if (parse_ocpp201_boot_reason(j, &v->reason, "reason") < 0)
+                return -1;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x6u) != 0x6u)
+        return ocpp_json_missing(j, seen, 0x6u, ocpp201_boot_notification_request_fields);
+    return 0;
+}
+
+static void write_ocpp201_boot_notification_request(ocpp_writer_t *w, const ocpp201_boot_notification_request_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"chargingStation\":", 18);
+    write_ocpp201_charging_station(w, &v->charging_station);
+    ocpp_write_key(w, &members, "\"reason\":", 9);
+    ocpp_write_str(w, ocpp201_boot_reason_strs[v->reason]);
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_boot_notification_request_parse(ocpp_json_t *j, ocpp201_boot_notification_request_t *v) {
+    if (parse_ocpp201_boot_notification_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_boot_notification_request_write(ocpp_writer_t *w, const ocpp201_boot_notification_request_t *v) {
+    write_ocpp201_boot_notification_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp201_status_info_fields[] = {
+    "customData", "reasonCode", "additionalInfo"
+};
+
+static int ocpp201_status_info_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        if (memcmp(s.ptr, "reasonCode", 10) == 0)
+            return 1;
+        break;
+    case 14:
+        if (memcmp(s.ptr, "additionalInfo", 14) == 0)
+            return 2;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_status_info(ocpp_json_t *j, ocpp201_status_info_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_status_info_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_status_info_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_string(j, &v->reason_code, 20, "reasonCode") < 0)
+                return -1;
+            break;
+        case 2:
+            if (ocpp_json_string(j, &v->additional_info, 512, "additionalInfo") < 0)
+                return -1;
+            v->has_additional_info = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x2u) != 0x2u)
+        return ocpp_json_missing(j, seen, 0x2u, ocpp201_status_info_fields);
+    return 0;
+}
+
+static void write_ocpp201_status_info(ocpp_writer_t *w, const ocpp201_status_info_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"reasonCode\":", 13);
+    ocpp_write_str(w, v->reason_code);
+    if (v->has_additional_info) {
+        ocpp_write_key(w, &members, "\"additionalInfo\":", 17);
+        ocpp_write_str(w, v->additional_info);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp201_boot_notification_response_fields[] = {
+    "customData", "currentTime", "interval", "status", "statusInfo"
+};
+
+static int ocpp201_boot_notification_response_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 6:
+        if (memcmp(s.ptr, "status", 6) == 0)
+            return 3;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "interval", 8) == 0)
+            return 2;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        if (memcmp(s.ptr, "statusInfo", 10) == 0)
+            return 4;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "currentTime", 11) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_boot_notification_response(ocpp_json_t *j, ocpp201_boot_notification_response_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_boot_notification_response_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_boot_notification_response_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_datetime(j, &v->current_time, "currentTime") < 0)
+                return -1;
+            break;
+        case 2:
+            if (ocpp_json_int(j, &v->interval, "interval") < 0)
+                return -1;
+            break;
+        case 3:
+            if (parse_ocpp201_registration_status(j, &v->status, "status") < 0)
+                return -1;
+            break;
+        case 4:
+            if (parse_ocpp201_status_info(j, &v->status_info, "statusInfo") < 0)
+                return -1;
+            v->has_status_info = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0xeu) != 0xeu)
+        return ocpp_json_missing(j, seen, 0xeu, ocpp201_boot_notification_response_fields);
+    return 0;
+}
+
+static void write_ocpp201_boot_notification_response(ocpp_writer_t *w, const ocpp201_boot_notification_response_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"currentTime\":", 14);
+    ocpp_write_str(w, v->current_time);
+    ocpp_write_key(w, &members, "\"interval\":", 11);
+    ocpp_write_int(w, v->interval);
+    ocpp_write_key(w, &members, "\"status\":", 9);
+    ocpp_write_str(w, ocpp201_registration_status_strs[v->status]);
+    if (v->has_status_info) {
+        ocpp_write_key(w, &members, "\"statusInfo\":", 13);
+        write_ocpp201_status_info(w, &v->status_info);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_boot_notification_response_parse(ocpp_json_t *j, ocpp201_boot_notification_response_t *v) {
+    if (parse_ocpp201_boot_notification_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_boot_notification_response_write(ocpp_writer_t *w, const ocpp201_boot_notification_response_t *v) {
+    write_ocpp201_boot_notification_response(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp201_heartbeat_request_fields[] = {
+    "customData"
+};
+
+static int ocpp201_heartbeat_request_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_heartbeat_request(ocpp_json_t *j, ocpp201_heartbeat_request_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_heartbeat_request_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_heartbeat_request_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    return 0;
+}
+
+static void write_ocpp201_heartbeat_request(ocpp_writer_t *w, const ocpp201_heartbeat_request_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_heartbeat_request_parse(ocpp_json_t *j, ocpp201_heartbeat_request_t *v) {
+    if (parse_ocpp201_heartbeat_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_heartbeat_request_write(ocpp_writer_t *w, const ocpp201_heartbeat_request_t *v) {
+    write_ocpp201_heartbeat_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp201_heartbeat_response_fields[] = {
+    "customData", "currentTime"
+};
+
+static int ocpp201_heartbeat_response_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "currentTime", 11) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_heartbeat_response(ocpp_json_t *j, ocpp201_heartbeat_response_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_heartbeat_response_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_heartbeat_response_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_datetime(j, &v->current_time, "currentTime") < 0)
+                return -1;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x2u) != 0x2u)
+        return ocpp_json_missing(j, seen, 0x2u, ocpp201_heartbeat_response_fields);
+    return 0;
+}
+
+static void write_ocpp201_heartbeat_response(ocpp_writer_t *w, const ocpp201_heartbeat_response_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"currentTime\":", 14);
+    ocpp_write_str(w, v->current_time);
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_heartbeat_response_parse(ocpp_json_t *j, ocpp201_heartbeat_response_t *v) {
+    if (parse_ocpp201_heartbeat_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_heartbeat_response_write(ocpp_writer_t *w, const ocpp201_heartbeat_response_t *v) {
+    write_ocpp201_heartbeat_response(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp201_signed_meter_value_fields[] = {
+    "customData", "signedMeterData", "signingMethod", "encodingMethod", "publicKey"
+};
+
+static int ocpp201_signed_meter_value_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 9:
+        if (memcmp(s.ptr, "publicKey", 9) == 0)
+            return 4;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    case 13:
+        if (memcmp(s.ptr, "signingMethod", 13) == 0)
+            return 2;
+        break;
+    case 14:
+        if (memcmp(s.ptr, "encodingMethod", 14) == 0)
+            return 3;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "signedMeterData", 15) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_signed_meter_value(ocpp_json_t *j, ocpp201_signed_meter_value_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_signed_meter_value_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_signed_meter_value_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_string(j, &v->signed_meter_data, 2500, "signedMeterData") < 0)
+                return -1;
+            break;
+        case 2:
+            if (ocpp_json_string(j, &v->signing_method, 50, "signingMethod") < 0)
+                return -1;
+            break;
+        case 3:
+            if (ocpp_json_string(j, &v->encoding_method, 50, "encodingMethod") < 0)
+                return -1;
+            break;
+        case 4:
+            if (ocpp_json_string(j, &v->public_key, 2500, "publicKey") < 0)
+                return -1;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x1eu) != 0x1eu)
+        return ocpp_json_missing(j, seen, 0x1eu, ocpp201_signed_meter_value_fields);
+    return 0;
+}
+
+static void write_ocpp201_signed_meter_value(ocpp_writer_t *w, const ocpp201_signed_meter_value_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"signedMeterData\":", 18);
+    ocpp_write_str(w, v->signed_meter_data);
+    ocpp_write_key(w, &members, "\"signingMethod\":", 16);
+    ocpp_write_str(w, v->signing_method);
+    ocpp_write_key(w, &members, "\"encodingMethod\":", 17);
+    ocpp_write_str(w, v->encoding_method);
+    ocpp_write_key(w, &members, "\"publicKey\":", 12);
+    ocpp_write_str(w, v->public_key);
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp201_unit_of_measure_fields[] = {
+    "customData", "unit", "multiplier"
+};
+
+static int ocpp201_unit_of_measure_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 4:
+        if (memcmp(s.ptr, "unit", 4) == 0)
+            return 1;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        if (memcmp(s.ptr, "multiplier", 10) == 0)
+            return 2;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_unit_of_measure(ocpp_json_t *j, ocpp201_unit_of_measure_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_unit_of_measure_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_unit_of_measure_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_string(j, &v->unit, 20, "unit") < 0)
+                return -1;
+            v->has_unit = true;
+            break;
+        case 2:
+            if (ocpp_json_int(j, &v->multiplier, "multiplier") < 0)
+                return -1;
+            v->has_multiplier = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    return 0;
+}
+
+static void write_ocpp201_unit_of_measure(ocpp_writer_t *w, const ocpp201_unit_of_measure_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    if (v->has_unit) {
+        ocpp_write_key(w, &members, "\"unit\":", 7);
+        ocpp_write_str(w, v->unit);
+    }
+    if (v->has_multiplier) {
+        ocpp_write_key(w, &members, "\"multiplier\":", 13);
+        ocpp_write_int(w, v->multiplier);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp201_sampled_value_fields[] = {
+    "customData", "value", "context", "measurand", "phase", "location", "signedMeterValue", "unitOfMeasure"
+};
+
+static int ocpp201_sampled_value_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 5:
+        if (memcmp(s.ptr, "value", 5) == 0)
+            return 1;
+        if (memcmp(s.ptr, "phase", 5) == 0)
+            return 4;
+        break;
+    case 7:
+        if (memcmp(s.ptr, "context", 7) == 0)
+            return 2;
+        break;
+    case 8:
+        if (memcmp(s.ptr, "location", 8) == 0)
+            return 5;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "measurand", 9) == 0)
+            return 3;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    case 13:
+        if (memcmp(s.ptr, "unitOfMeasure", 13) == 0)
+            return 7;
+        break;
+    case 16:
+        if (memcmp(s.ptr, "signedMeterValue", 16) == 0)
+            return 6;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_sampled_value(ocpp_json_t *j, ocpp201_sampled_value_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_sampled_value_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_sampled_value_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_number(j, &v->value, "value") < 0)
+                return -1;
+            break;
+        case 2:
+            if (parse_ocpp201_reading_context(j, &v->context, "context") < 0)
+                return -1;
+            v->has_context = true;
+            break;
+        case 3:
+            if (parse_ocpp201_measurand(j, &v->measurand, "measurand") < 0)
+                return -1;
+            v->has_measurand = true;
+            break;
+        case 4:
+            if (parse_ocpp201_phase(j, &v->phase, "phase") < 0)
+                return -1;
+            v->has_phase = true;
+            break;
+        case 5:
+            if (parse_ocpp201_location(j, &v->location, "location") < 0)
+                return -1;
+            v->has_location = true;
+            break;
+        case 6:
+            if (parse_ocpp201_signed_meter_value(j, &v->signed_meter_value, "signedMeterValue") < 0)
+                return -1;
+            v->has_signed_meter_value = true;
+            break;
+        case 7:
+            if (parse_ocpp201_unit_of_measure(j, &v->unit_of_measure, "unitOfMeasure") < 0)
+                return -1;
+            v->has_unit_of_measure = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x2u) != 0x2u)
+        return ocpp_json_missing(j, seen, 0x2u, ocpp201_sampled_value_fields);
+    return 0;
+}
+
+static void write_ocpp201_sampled_value(ocpp_writer_t *w, const ocpp201_sampled_value_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"value\":", 8);
+    ocpp_write_number(w, v->value);
+    if (v->has_context) {
+        ocpp_write_key(w, &members, "\"context\":", 10);
+        ocpp_write_str(w, ocpp201_reading_context_strs[v->context]);
+    }
+    if (v->has_measurand) {
+        ocpp_write_key(w, &members, "\"measurand\":", 12);
+        ocpp_write_str(w, ocpp201_measurand_strs[v->measurand]);
+    }
+    if (v->has_phase) {
+        ocpp_write_key(w, &members, "\"phase\":", 8);
+        ocpp_write_str(w, ocpp201_phase_strs[v->phase]);
+    }
+    if (v->has_location) {
+        ocpp_write_key(w, &members, "\"location\":", 11);
+        ocpp_write_str(w, ocpp201_location_strs[v->location]);
+    }
+    if (v->has_signed_meter_value) {
+        ocpp_write_key(w, &members, "\"signedMeterValue\":", 19);
+        write_ocpp201_signed_meter_value(w, &v->signed_meter_value);
+    }
+    if (v->has_unit_of_measure) {
+        ocpp_write_key(w, &members, "\"unitOfMeasure\":", 16);
+        write_ocpp201_unit_of_measure(w, &v->unit_of_measure);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp201_meter_value_fields[] = {
+    "customData", "sampledValue", "timestamp"
+};
+
+static int ocpp201_meter_value_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 9:
+        if (memcmp(s.ptr, "timestamp", 9) == 0)
+            return 2;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    case 12:
+        if (memcmp(s.ptr, "sampledValue", 12) == 0)
+            return 1;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_meter_value(ocpp_json_t *j, ocpp201_meter_value_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_meter_value_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_meter_value_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1: {
+            ocpp_json_array_t a;
+            ocpp201_sampled_value_t *item;
+            if (ocpp_json_array_begin(j, &a, "sampledValue") < 0)
+                return -1;
+            while ((rc = ocpp_json_array_next(j)) > 0) {
+                if (!(item = ocpp_json_array_push(j, &a, sizeof(*item))))
+                    return -1;
+                if (parse_ocpp201_sampled_value(j, item, "sampledValue") < 0)
+                    return -1;
+            }
+            if (rc < 0)
+                return -1;
+            v->sampled_value = ocpp_json_array_end(j, &a, sizeof(*v->sampled_value));
+            if (j->error)
+                return -1;
+            if (a.count < 1)
+                return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, "sampledValue");
+            v->sampled_value_count = a.count;
+            break;
+        }
+        case 2:
+            if (ocpp_json_datetime(j, &v->timestamp, "timestamp") < 0)
+                return -1;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x6u) != 0x6u)
+        return ocpp_json_missing(j, seen, 0x6u, ocpp201_meter_value_fields);
+    return 0;
+}
+
+static void write_ocpp201_meter_value(ocpp_writer_t *w, const ocpp201_meter_value_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"sampledValue\":", 15);
+    ocpp_write_raw(w, "[", 1);
+    for (size_t i = 0; i < v->sampled_value_count; i++) {
+        if (i)
+            ocpp_write_raw(w, ",", 1);
+        write_ocpp201_sampled_value(w, &v->sampled_value[i]);
+    }
+    ocpp_write_raw(w, "]", 1);
+    ocpp_write_key(w, &members, "\"timestamp\":", 12);
+    ocpp_write_str(w, v->timestamp);
+    ocpp_write_raw(w, "}", 1);
+}
+
+static const char *const ocpp201_meter_values_request_fields[] = {
+    "customData", "evseId", "meterValue"
+};
+
+static int ocpp201_meter_values_request_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 6:
+        if (memcmp(s.ptr, "evseId", 6) == 0)
+            return 1;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        if (memcmp(s.ptr, "meterValue", 10) == 0)
+            return 2;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_meter_values_request(ocpp_json_t *j, ocpp201_meter_values_request_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_meter_values_request_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_meter_values_request_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_int(j, &v->evse_id, "evseId") < 0)
+                return -1;
+            break;
+        case 2: {
+            ocpp_json_array_t a;
+            ocpp201_meter_value_t *item;
+            if (ocpp_json_array_begin(j, &a, "meterValue") < 0)
+                return -1;
+            while ((rc = ocpp_json_array_next(j)) > 0) {
+                if (!(item = ocpp_json_array_push(j, &a, sizeof(*item))))
+                    return -1;
+                if (parse_ocpp201_meter_value(j, item, "meterValue") < 0)
+                    return -1;
+            }
+            if (rc < 0)
+                return -1;
+            v->meter_value = ocpp_json_array_end(j, &a, sizeof(*v->meter_value));
+            if (j->error)
+                return -1;
+            if (a.count < 1)
+                return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, "meterValue");
+            v->meter_value_count = a.count;
+            break;
+        }
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x6u) != 0x6u)
+        return ocpp_json_missing(j, seen, 0x6u, ocpp201_meter_values_request_fields);
+    return 0;
+}
+
+static void write_ocpp201_meter_values_request(ocpp_writer_t *w, const ocpp201_meter_values_request_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"evseId\":", 9);
+    ocpp_write_int(w, v->evse_id);
+    ocpp_write_key(w, &members, "\"meterValue\":", 13);
+    ocpp_write_raw(w, "[", 1);
+    for (size_t i = 0; i < v->meter_value_count; i++) {
+        if (i)
+            ocpp_write_raw(w, ",", 1);
+        write_ocpp201_meter_value(w, &v->meter_value[i]);
+    }
+    ocpp_write_raw(w, "]", 1);
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_meter_values_request_parse(ocpp_json_t *j, ocpp201_meter_values_request_t *v) {
+    if (parse_ocpp201_meter_values_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_meter_values_request_write(ocpp_writer_t *w, const ocpp201_meter_values_request_t *v) {
+    write_ocpp201_meter_values_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp201_meter_values_response_fields[] = {
+    "customData"
+};
+
+static int ocpp201_meter_values_response_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_meter_values_response(ocpp_json_t *j, ocpp201_meter_values_response_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_meter_values_response_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_meter_values_response_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    return 0;
+}
+
+static void write_ocpp201_meter_values_response(ocpp_writer_t *w, const ocpp201_meter_values_response_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_meter_values_response_parse(ocpp_json_t *j, ocpp201_meter_values_response_t *v) {
+    if (parse_ocpp201_meter_values_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_meter_values_response_write(ocpp_writer_t *w, const ocpp201_meter_values_response_t *v) {
+    write_ocpp201_meter_values_response(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp201_status_notification_request_fields[] = {
+    "customData", "timestamp", "connectorStatus", "evseId", "connectorId"
+};
+
+static int ocpp201_status_notification_request_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 6:
+        if (memcmp(s.ptr, "evseId", 6) == 0)
+            return 3;
+        break;
+    case 9:
+        if (memcmp(s.ptr, "timestamp", 9) == 0)
+            return 1;
+        break;
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    case 11:
+        if (memcmp(s.ptr, "connectorId", 11) == 0)
+            return 4;
+        break;
+    case 15:
+        if (memcmp(s.ptr, "connectorStatus", 15) == 0)
+            return 2;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_status_notification_request(ocpp_json_t *j, ocpp201_status_notification_request_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_status_notification_request_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_status_notification_request_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        case 1:
+            if (ocpp_json_datetime(j, &v->timestamp, "timestamp") < 0)
+                return -1;
+            break;
+        case 2:
+            if (parse_ocpp201_connector_status(j, &v->connector_status, "connectorStatus") < 0)
+                return -1;
+            break;
+        case 3:
+            if (ocpp_json_int(j, &v->evse_id, "evseId") < 0)
+                return -1;
+            break;
+        case 4:
+            if (ocpp_json_int(j, &v->connector_id, "connectorId") < 0)
+                return -1;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    if ((seen & 0x1eu) != 0x1eu)
+        return ocpp_json_missing(j, seen, 0x1eu, ocpp201_status_notification_request_fields);
+    return 0;
+}
+
+static void write_ocpp201_status_notification_request(ocpp_writer_t *w, const ocpp201_status_notification_request_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_key(w, &members, "\"timestamp\":", 12);
+    ocpp_write_str(w, v->timestamp);
+    ocpp_write_key(w, &members, "\"connectorStatus\":", 18);
+    ocpp_write_str(w, ocpp201_connector_status_strs[v->connector_status]);
+    ocpp_write_key(w, &members, "\"evseId\":", 9);
+    ocpp_write_int(w, v->evse_id);
+    ocpp_write_key(w, &members, "\"connectorId\":", 14);
+    ocpp_write_int(w, v->connector_id);
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_status_notification_request_parse(ocpp_json_t *j, ocpp201_status_notification_request_t *v) {
+    if (parse_ocpp201_status_notification_request(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_status_notification_request_write(ocpp_writer_t *w, const ocpp201_status_notification_request_t *v) {
+    write_ocpp201_status_notification_request(w, v);
+    return ocpp_writer_status(w);
+}
+
+static const char *const ocpp201_status_notification_response_fields[] = {
+    "customData"
+};
+
+static int ocpp201_status_notification_response_field(ocpp_str_t s) {
+    switch (s.len) {
+    case 10:
+        if (memcmp(s.ptr, "customData", 10) == 0)
+            return 0;
+        break;
+    }
+    return -1;
+}
+
+static int parse_ocpp201_status_notification_response(ocpp_json_t *j, ocpp201_status_notification_response_t *v, const char *what) {
+    uint32_t seen = 0;
+    ocpp_str_t key;
+    int rc;
+
+    memset(v, 0, sizeof(*v));
+    if (ocpp_json_object_begin(j, what) < 0)
+        return -1;
+    while ((rc = ocpp_json_next_key(j, &key)) > 0) {
+        int f = ocpp201_status_notification_response_field(key);
+        if (f < 0)
+            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");
+        if (seen & 1u << f)
+            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, ocpp201_status_notification_response_fields[f]);
+        seen |= 1u << f;
+        switch (f) {
+        case 0:
+            if (ocpp_json_raw_object(j, &v->custom_data, "customData") < 0)
+                return -1;
+            v->has_custom_data = true;
+            break;
+        }
+    }
+    if (rc < 0)
+        return -1;
+    return 0;
+}
+
+static void write_ocpp201_status_notification_response(ocpp_writer_t *w, const ocpp201_status_notification_response_t *v) {
+    int members = 0;
+
+    ocpp_write_raw(w, "{", 1);
+    if (v->has_custom_data) {
+        ocpp_write_key(w, &members, "\"customData\":", 13);
+        ocpp_write_raw(w, v->custom_data.ptr, v->custom_data.len);
+    }
+    ocpp_write_raw(w, "}", 1);
+}
+
+int ocpp201_status_notification_response_parse(ocpp_json_t *j, ocpp201_status_notification_response_t *v) {
+    if (parse_ocpp201_status_notification_response(j, v, "payload") < 0)
+        return -1;
+    return ocpp_json_end(j);
+}
+
+int ocpp201_status_notification_response_write(ocpp_writer_t *w, const ocpp201_status_notification_response_t *v) {
+    write_ocpp201_status_notification_response(w, v);
+    return ocpp_writer_status(w);
+}
@@ -0,0 +1,501 @@
+// Generated by tools/ocpp_codegen.py from Docs/schemas. Do not edit.
+#ifndef OCPP_MESSAGES_H
+#define OCPP_MESSAGES_H
+
+#include "OcppJson.h"
+
+// Strings are JSON text as it appears between the quotes, escapes and
+// all. Optional properties have a has_ flag, arrays a _count.
+
+// OCPP 1.6
+
+typedef enum {
+    OCPP16_BOOT_NOTIFICATION_STATUS_ACCEPTED,
+    OCPP16_BOOT_NOTIFICATION_STATUS_PENDING,
+    OCPP16_BOOT_NOTIFICATION_STATUS_REJECTED
+} ocpp16_boot_notification_status_t;
+
+typedef enum {
+    OCPP16_SAMPLED_VALUE_CONTEXT_INTERRUPTION_BEGIN,
+    OCPP16_SAMPLED_VALUE_CONTEXT_INTERRUPTION_END,
+    OCPP16_SAMPLED_VALUE_CONTEXT_SAMPLE_CLOCK,
+    OCPP16_SAMPLED_VALUE_CONTEXT_SAMPLE_PERIODIC,
+    OCPP16_SAMPLED_VALUE_CONTEXT_TRANSACTION_BEGIN,
+    OCPP16_SAMPLED_VALUE_CONTEXT_TRANSACTION_END,
+    OCPP16_SAMPLED_VALUE_CONTEXT_TRIGGER,
+    OCPP16_SAMPLED_VALUE_CONTEXT_OTHER
+} ocpp16_sampled_value_context_t;
+
+typedef enum {
+    OCPP16_SAMPLED_VALUE_FORMAT_RAW,
+    OCPP16_SAMPLED_VALUE_FORMAT_SIGNED_DATA
+} ocpp16_sampled_value_format_t;
+
+typedef enum {
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_EXPORT_REGISTER,
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_EXPORT_REGISTER,
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_IMPORT_REGISTER,
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_EXPORT_INTERVAL,
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_EXPORT_INTERVAL,
+    OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_REACTIVE_IMPORT_INTERVAL,
+    OCPP16_SAMPLED_VALUE_MEASURAND_POWER_ACTIVE_EXPORT,
+    OCPP16_SAMPLED_VALUE_MEASURAND_POWER_ACTIVE_IMPORT,
+    OCPP16_SAMPLED_VALUE_MEASURAND_POWER_OFFERED,
+    OCPP16_SAMPLED_VALUE_MEASURAND_POWER_REACTIVE_EXPORT,
+    OCPP16_SAMPLED_VALUE_MEASURAND_POWER_REACTIVE_IMPORT,
+    OCPP16_SAMPLED_VALUE_MEASURAND_POWER_FACTOR,
+    OCPP16_SAMPLED_VALUE_MEASURAND_CURRENT_IMPORT,
+    OCPP16_SAMPLED_VALUE_MEASURAND_CURRENT_EXPORT,
+    OCPP16_SAMPLED_VALUE_MEASURAND_CURRENT_OFFERED,
+    OCPP16_SAMPLED_VALUE_MEASURAND_VOLTAGE,
+    OCPP16_SAMPLED_VALUE_MEASURAND_FREQUENCY,
+    OCPP16_SAMPLED_VALUE_MEASURAND_TEMPERATURE,
+    OCPP16_SAMPLED_VALUE_MEASURAND_SOC,
+    OCPP16_SAMPLED_VALUE_MEASURAND_RPM
+} ocpp16_sampled_value_measurand_t;
+
+typedef enum {
+    OCPP16_SAMPLED_VALUE_PHASE_L1,
+    OCPP16_SAMPLED_VALUE_PHASE_L2,
+    OCPP16_SAMPLED_VALUE_PHASE_L3,
+    OCPP16_SAMPLED_VALUE_PHASE_N,
+    OCPP16_SAMPLED_VALUE_PHASE_L1_N,
+    OCPP16_SAMPLED_VALUE_PHASE_L2_N,
+    OCPP16_SAMPLED_VALUE_PHASE_L3_N,
+    OCPP16_SAMPLED_VALUE_PHASE_L1_L2,
+    OCPP16_SAMPLED_VALUE_PHASE_L2_L3,
+    OCPP16_SAMPLED_VALUE_PHASE_L3_L1
+} ocpp16_sampled_value_phase_t;
+
+typedef enum {
+    OCPP16_SAMPLED_VALUE_LOCATION_CABLE,
+    OCPP16_SAMPLED_VALUE_LOCATION_EV,
+    OCPP16_SAMPLED_VALUE_LOCATION_INLET,
+    OCPP16_SAMPLED_VALUE_LOCATION_OUTLET,
+    OCPP16_SAMPLED_VALUE_LOCATION_BODY
+} ocpp16_sampled_value_location_t;
+
+typedef enum {
+    OCPP16_SAMPLED_VALUE_UNIT_WH,
+    OCPP16_SAMPLED_VALUE_UNIT_KWH,
+    OCPP16_SAMPLED_VALUE_UNIT_VARH,
+    OCPP16_SAMPLED_VALUE_UNIT_KVARH,
+    OCPP16_SAMPLED_VALUE_UNIT_W,
+    OCPP16_SAMPLED_VALUE_UNIT_KW,
+    OCPP16_SAMPLED_VALUE_UNIT_VA,
+    OCPP16_SAMPLED_VALUE_UNIT_KVA,
+    OCPP16_SAMPLED_VALUE_UNIT_VAR,
+    OCPP16_SAMPLED_VALUE_UNIT_KVAR,
+    OCPP16_SAMPLED_VALUE_UNIT_A,
+    OCPP16_SAMPLED_VALUE_UNIT_V,
+    OCPP16_SAMPLED_VALUE_UNIT_K,
+    OCPP16_SAMPLED_VALUE_UNIT_CELCIUS,
+    OCPP16_SAMPLED_VALUE_UNIT_CELSIUS,
+    OCPP16_SAMPLED_VALUE_UNIT_FAHRENHEIT,
+    OCPP16_SAMPLED_VALUE_UNIT_PERCENT
+} ocpp16_sampled_value_unit_t;
+
+typedef enum {
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_CONNECTOR_LOCK_FAILURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_EV_COMMUNICATION_ERROR,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_GROUND_FAILURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_HIGH_TEMPERATURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_INTERNAL_ERROR,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_LOCAL_LIST_CONFLICT,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_NO_ERROR,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_OTHER_ERROR,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_OVER_CURRENT_FAILURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_POWER_METER_FAILURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_POWER_SWITCH_FAILURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_READER_FAILURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_RESET_FAILURE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_UNDER_VOLTAGE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_OVER_VOLTAGE,
+    OCPP16_STATUS_NOTIFICATION_ERROR_CODE_WEAK_SIGNAL
+} ocpp16_status_notification_error_code_t;
+
+typedef enum {
+    OCPP16_STATUS_NOTIFICATION_STATUS_AVAILABLE,
+    OCPP16_STATUS_NOTIFICATION_STATUS_PREPARING,
+    OCPP16_STATUS_NOTIFICATION_STATUS_CHARGING,
+    OCPP16_STATUS_NOTIFICATION_STATUS_SUSPENDED_EVSE,
+    OCPP16_STATUS_NOTIFICATION_STATUS_SUSPENDED_EV,
+    OCPP16_STATUS_NOTIFICATION_STATUS_FINISHING,
+    OCPP16_STATUS_NOTIFICATION_STATUS_RESERVED,
+    OCPP16_STATUS_NOTIFICATION_STATUS_UNAVAILABLE,
+    OCPP16_STATUS_NOTIFICATION_STATUS_FAULTED
+} ocpp16_status_notification_status_t;
+
+// BootNotificationRequest
+typedef struct {
+    ocpp_str_t charge_point_vendor;
+    ocpp_str_t charge_point_model;
+    bool has_charge_point_serial_number;
+    ocpp_str_t charge_point_serial_number;
+    bool has_charge_box_serial_number;
+    ocpp_str_t charge_box_serial_number;
+    bool has_firmware_version;
+    ocpp_str_t firmware_version;
+    bool has_iccid;
+    ocpp_str_t iccid;
+    bool has_imsi;
+    ocpp_str_t imsi;
+    bool has_meter_type;
+    ocpp_str_t meter_type;
+    bool has_meter_serial_number;
+    ocpp_str_t meter_serial_number;
+} ocpp16_boot_notification_request_t;
+
+// BootNotificationResponse
+typedef struct {
+    ocpp16_boot_notification_status_t status;
+    ocpp_str_t current_time;
+    int interval;
+} ocpp16_boot_notification_response_t;
+
+// HeartbeatRequest
+typedef struct {
+    char unused;                // the payload is an empty object
+} ocpp16_heartbeat_request_t;
+
+// HeartbeatResponse
+typedef struct {
+    ocpp_str_t current_time;
+} ocpp16_heartbeat_response_t;
+
+typedef struct {
+    ocpp_str_t value;
+    bool has_context;
+    ocpp16_sampled_value_context_t context;
+    bool has_format;
+    ocpp16_sampled_value_format_t format;
+    bool has_measurand;
+    ocpp16_sampled_value_measurand_t measurand;
+    bool has_phase;
+    ocpp16_sampled_value_phase_t phase;
+    bool has_location;
+    ocpp16_sampled_value_location_t location;
+    bool has_unit;
+    ocpp16_sampled_value_unit_t unit;
+} ocpp16_sampled_value_t;
+
+typedef struct {
+    ocpp_str_t timestamp;
+    ocpp16_sampled_value_t *sampled_value;
+    size_t sampled_value_count;
+} ocpp16_meter_value_t;
+
+// MeterValuesRequest
+typedef struct {
+    int connector_id;
+    bool has_transaction_id;
+    int transaction_id;
+    ocpp16_meter_value_t *meter_value;
+    size_t meter_value_count;
+} ocpp16_meter_values_request_t;
+
+// MeterValuesResponse
+typedef struct {
+    char unused;                // the payload is an empty object
+} ocpp16_meter_values_response_t;
+
+// StatusNotificationRequest
+typedef struct {
+    int connector_id;
+    ocpp16_status_notification_error_code_t error_code;
+    bool has_info;
+    ocpp_str_t info;
+    ocpp16_status_notification_status_t status;
+    bool has_timestamp;
+    ocpp_str_t timestamp;
+    bool has_vendor_id;
+    ocpp_str_t vendor_id;
+    bool has_vendor_error_code;
+    ocpp_str_t vendor_error_code;
+} ocpp16_status_notification_request_t;
+
+// StatusNotificationResponse
+typedef struct {
+    char unused;                // the payload is an empty object
+} ocpp16_status_notification_response_t;
+
+const char *ocpp16_boot_notification_status_name(ocpp16_boot_notification_status_t v);
+const char *ocpp16_sampled_value_context_name(ocpp16_sampled_value_context_t v);
+const char *ocpp16_sampled_value_format_name(ocpp16_sampled_value_format_t v);
+const char *ocpp16_sampled_value_measurand_name(ocpp16_sampled_value_measurand_t v);
+const char *ocpp16_sampled_value_phase_name(ocpp16_sampled_value_phase_t v);
+const char *ocpp16_sampled_value_location_name(ocpp16_sampled_value_location_t v);
+const char *ocpp16_sampled_value_unit_name(ocpp16_sampled_value_unit_t v);
+const char *ocpp16_status_notification_error_code_name(ocpp16_status_notification_error_code_t v);
+const char *ocpp16_status_notification_status_name(ocpp16_status_notification_status_t v);
+
+int ocpp16_boot_notification_request_parse(ocpp_json_t *j, ocpp16_boot_notification_request_t *v);
+int ocpp16_boot_notification_request_write(ocpp_writer_t *w, const ocpp16_boot_notification_request_t *v);
+int ocpp16_boot_notification_response_parse(ocpp_json_t *j, ocpp16_boot_notification_response_t *v);
+int ocpp16_boot_notification_response_write(ocpp_writer_t *w, const ocpp16_boot_notification_response_t *v);
+int ocpp16_heartbeat_request_parse(ocpp_json_t *j, ocpp16_heartbeat_request_t *v);
+int ocpp16_heartbeat_request_write(ocpp_writer_t *w, const ocpp16_heartbeat_request_t *v);
+int ocpp16_heartbeat_response_parse(ocpp_json_t *j, ocpp16_heartbeat_response_t *v);
+int ocpp16_heartbeat_response_write(ocpp_writer_t *w, const ocpp16_heartbeat_response_t *v);
+int ocpp16_meter_values_request_parse(ocpp_json_t *j, ocpp16_meter_values_request_t *v);
+int ocpp16_meter_values_request_write(ocpp_writer_t *w, const ocpp16_meter_values_request_t *v);
+int ocpp16_meter_values_response_parse(ocpp_json_t *j, ocpp16_meter_values_response_t *v);
+int ocpp16_meter_values_response_write(ocpp_writer_t *w, const ocpp16_meter_values_response_t *v);
+int ocpp16_status_notification_request_parse(ocpp_json_t *j, ocpp16_status_notification_request_t *v);
+int ocpp16_status_notification_request_write(ocpp_writer_t *w, const ocpp16_status_notification_request_t *v);
+int ocpp16_status_notification_response_parse(ocpp_json_t *j, ocpp16_status_notification_response_t *v);
+int ocpp16_status_notification_response_write(ocpp_writer_t *w, const ocpp16_status_notification_response_t *v);
+
+// OCPP 2.0.1
+
+typedef enum {
+    OCPP201_BOOT_REASON_APPLICATION_RESET,
+    OCPP201_BOOT_REASON_FIRMWARE_UPDATE,
+    OCPP201_BOOT_REASON_LOCAL_RESET,
+    OCPP201_BOOT_REASON_POWER_UP,
+    OCPP201_BOOT_REASON_REMOTE_RESET,
+    OCPP201_BOOT_REASON_SCHEDULED_RESET,
+    OCPP201_BOOT_REASON_TRIGGERED,
+    OCPP201_BOOT_REASON_UNKNOWN,
+    OCPP201_BOOT_REASON_WATCHDOG
+} ocpp201_boot_reason_t;
+
+typedef enum {
+    OCPP201_REGISTRATION_STATUS_ACCEPTED,
+    OCPP201_REGISTRATION_STATUS_PENDING,
+    OCPP201_REGISTRATION_STATUS_REJECTED
+} ocpp201_registration_status_t;
+
+typedef enum {
+    OCPP201_READING_CONTEXT_INTERRUPTION_BEGIN,
+    OCPP201_READING_CONTEXT_INTERRUPTION_END,
+    OCPP201_READING_CONTEXT_OTHER,
+    OCPP201_READING_CONTEXT_SAMPLE_CLOCK,
+    OCPP201_READING_CONTEXT_SAMPLE_PERIODIC,
+    OCPP201_READING_CONTEXT_TRANSACTION_BEGIN,
+    OCPP201_READING_CONTEXT_TRANSACTION_END,
+    OCPP201_READING_CONTEXT_TRIGGER
+} ocpp201_reading_context_t;
+
+typedef enum {
+    OCPP201_MEASURAND_CURRENT_EXPORT,
+    OCPP201_MEASURAND_CURRENT_IMPORT,
+    OCPP201_MEASURAND_CURRENT_OFFERED,
+    OCPP201_MEASURAND_ENERGY_ACTIVE_EXPORT_REGISTER,
+    OCPP201_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
+    OCPP201_MEASURAND_ENERGY_REACTIVE_EXPORT_REGISTER,
+    OCPP201_MEASURAND_ENERGY_REACTIVE_IMPORT_REGISTER,
+    OCPP201_MEASURAND_ENERGY_ACTIVE_EXPORT_INTERVAL,
+    OCPP201_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
+    OCPP201_MEASURAND_ENERGY_ACTIVE_NET,
+    OCPP201_MEASURAND_ENERGY_REACTIVE_EXPORT_INTERVAL,
+    OCPP201_MEASURAND_ENERGY_REACTIVE_IMPORT_INTERVAL,
+    OCPP201_MEASURAND_ENERGY_REACTIVE_NET,
+    OCPP201_MEASURAND_ENERGY_APPARENT_NET,
+    OCPP201_MEASURAND_ENERGY_APPARENT_IMPORT,
+    OCPP201_MEASURAND_ENERGY_APPARENT_EXPORT,
+    OCPP201_MEASURAND_FREQUENCY,
+    OCPP201_MEASURAND_POWER_ACTIVE_EXPORT,
+    OCPP201_MEASURAND_POWER_ACTIVE_IMPORT,
+    OCPP201_MEASURAND_POWER_FACTOR,
+    OCPP201_MEASURAND_POWER_OFFERED,
+    OCPP201_MEASURAND_POWER_REACTIVE_EXPORT,
+    OCPP201_MEASURAND_POWER_REACTIVE_IMPORT,
+    OCPP201_MEASURAND_SOC,
+    OCPP201_MEASURAND_VOLTAGE
+} ocpp201_measurand_t;
+
+typedef enum {
+    OCPP201_PHASE_L1,
+    OCPP201_PHASE_L2,
+    OCPP201_PHASE_L3,
+    OCPP201_PHASE_N,
+    OCPP201_PHASE_L1_N,
+    OCPP201_PHASE_L2_N,
+    OCPP201_PHASE_L3_N,
+    OCPP201_PHASE_L1_L2,
+    OCPP201_PHASE_L2_L3,
+    OCPP201_PHASE_L3_L1
+} ocpp201_phase_t;
+
+typedef enum {
+    OCPP201_LOCATION_BODY,
+    OCPP201_LOCATION_CABLE,
+    OCPP201_LOCATION_EV,
+    OCPP201_LOCATION_INLET,
+    OCPP201_LOCATION_OUTLET
+} ocpp201_location_t;
+
+typedef enum {
+    OCPP201_CONNECTOR_STATUS_AVAILABLE,
+    OCPP201_CONNECTOR_STATUS_OCCUPIED,
+    OCPP201_CONNECTOR_STATUS_RESERVED,
+    OCPP201_CONNECTOR_STATUS_UNAVAILABLE,
+    OCPP201_CONNECTOR_STATUS_FAULTED
+} ocpp201_connector_status_t;
+
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    bool has_iccid;
+    ocpp_str_t iccid;
+    bool has_imsi;
+    ocpp_str_t imsi;
+} ocpp201_modem_t;
+
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    bool has_serial_number;
+    ocpp_str_t serial_number;
+    ocpp_str_t model;
+    bool has_modem;
+    ocpp201_modem_t modem;
+    ocpp_str_t vendor_name;
+    bool has_firmware_version;
+    ocpp_str_t firmware_version;
+} ocpp201_charging_station_t;
+
+// BootNotificationRequest
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    ocpp201_charging_station_t charging_station;
+    ocpp201_boot_reason_t reason;
+} ocpp201_boot_notification_request_t;
+
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    ocpp_str_t reason_code;
+    bool has_additional_info;
+    ocpp_str_t additional_info;
+} ocpp201_status_info_t;
+
+// BootNotificationResponse
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    ocpp_str_t current_time;
+    int interval;
+    ocpp201_registration_status_t status;
+    bool has_status_info;
+    ocpp201_status_info_t status_info;
+} ocpp201_boot_notification_response_t;
+
+// HeartbeatRequest
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+} ocpp201_heartbeat_request_t;
+
+// HeartbeatResponse
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    ocpp_str_t current_time;
+} ocpp201_heartbeat_response_t;
+
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    ocpp_str_t signed_meter_data;
+    ocpp_str_t signing_method;
+    ocpp_str_t encoding_method;
+    ocpp_str_t public_key;
+} ocpp201_signed_meter_value_t;
+
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    bool has_unit;
+    ocpp_str_t unit;
+    bool has_multiplier;
+    int multiplier;
+} ocpp201_unit_of_measure_t;
+
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    double value;
+    bool has_context;
+    ocpp201_reading_context_t context;
+    bool has_measurand;
+    ocpp201_measurand_t measurand;
+    bool has_phase;
+    ocpp201_phase_t phase;
+    bool has_location;
+    ocpp201_location_t location;
+    bool has_signed_meter_value;
+    ocpp201_signed_meter_value_t signed_meter_value;
+    bool has_unit_of_measure;
+    ocpp201_unit_of_measure_t unit_of_measure;
+} ocpp201_sampled_value_t;
+
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    ocpp201_sampled_value_t *sampled_value;
+    size_t sampled_value_count;
+    ocpp_str_t timestamp;
+} ocpp201_meter_value_t;
+
+// MeterValuesRequest
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    int evse_id;
+    ocpp201_meter_value_t *meter_value;
+    size_t meter_value_count;
+} ocpp201_meter_values_request_t;
+
+// MeterValuesResponse
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+} ocpp201_meter_values_response_t;
+
+// StatusNotificationRequest
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+    ocpp_str_t timestamp;
+    ocpp201_connector_status_t connector_status;
+    int evse_id;
+    int connector_id;
+} ocpp201_status_notification_request_t;
+
+// StatusNotificationResponse
+typedef struct {
+    bool has_custom_data;
+    ocpp_str_t custom_data;
+} ocpp201_status_notification_response_t;
+
+const char *ocpp201_boot_reason_name(ocpp201_boot_reason_t v);
+const char *ocpp201_registration_status_name(ocpp201_registration_status_t v);
+const char *ocpp201_reading_context_name(ocpp201_reading_context_t v);
+const char *ocpp201_measurand_name(ocpp201_measurand_t v);
+const char *ocpp201_phase_name(ocpp201_phase_t v);
+const char *ocpp201_location_name(ocpp201_location_t v);
+const char *ocpp201_connector_status_name(ocpp201_connector_status_t v);
+
+int ocpp201_boot_notification_request_parse(ocpp_json_t *j, ocpp201_boot_notification_request_t *v);
+int ocpp201_boot_notification_request_write(ocpp_writer_t *w, const ocpp201_boot_notification_request_t *v);
+int ocpp201_boot_notification_response_parse(ocpp_json_t *j, ocpp201_boot_notification_response_t *v);
+int ocpp201_boot_notification_response_write(ocpp_writer_t *w, const ocpp201_boot_notification_response_t *v);
+int ocpp201_heartbeat_request_parse(ocpp_json_t *j, ocpp201_heartbeat_request_t *v);
+int ocpp201_heartbeat_request_write(ocpp_writer_t *w, const ocpp201_heartbeat_request_t *v);
+int ocpp201_heartbeat_response_parse(ocpp_json_t *j, ocpp201_heartbeat_response_t *v);
+int ocpp201_heartbeat_response_write(ocpp_writer_t *w, const ocpp201_heartbeat_response_t *v);
+int ocpp201_meter_values_request_parse(ocpp_json_t *j, ocpp201_meter_values_request_t *v);
+int ocpp201_meter_values_request_write(ocpp_writer_t *w, const ocpp201_meter_values_request_t *v);
+int ocpp201_meter_values_response_parse(ocpp_json_t *j, ocpp201_meter_values_response_t *v);
+int ocpp201_meter_values_response_write(ocpp_writer_t *w, const ocpp201_meter_values_response_t *v);
+int ocpp201_status_notification_request_parse(ocpp_json_t *j, ocpp201_status_notification_request_t *v);
+int ocpp201_status_notification_request_write(ocpp_writer_t *w, const ocpp201_status_notification_request_t *v);
+int ocpp201_status_notification_response_parse(ocpp_json_t *j, ocpp201_status_notification_response_t *v);
+int ocpp201_status_notification_response_write(ocpp_writer_t *w, const ocpp201_status_notification_response_t *v);
+
+#endif
@@ -0,0 +1,731 @@
+#define _GNU_SOURCE     // memmem
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Capture.h"
+#include "WebSocketFrame.h"
+#include "HttpParser.h"
+#include "Deflate.h"
+
+#define PCAP_MAGIC_US       0xa1b2c3d4
+#define PCAP_MAGIC_NS       0xa1b23c4d
+#define PCAPNG_MAGIC        0x0a0d0d0a
+#define PCAP_MAX_RECORD     (1024 * 1024)
+
+// Link layers tcpdump writes: Ethernet, "any" (cooked v1 and v2), loopback, raw IP
+#define LINK_NULL           0
+#define LINK_ETHERNET       1
+#define LINK_RAW            101
+#define LINK_LOOP           108
+#define LINK_LINUX_SLL      113
+#define LINK_IPV4           228
+#define LINK_IPV6           229
+#define LINK_LINUX_SLL2     276
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_ACK 0x10
+
+#define TLS_HANDSHAKE        22
+#define TLS_APPLICATION_DATA 23
+#define TLS_VERSION_13       0x0304
+
+enum { KIND_UNKNOWN, KIND_PLAIN, KIND_TLS, KIND_IGNORED };
+enum { STAGE_HEAD, STAGE_FRAMES, STAGE_DONE };
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} bytes_t;
+
+// One direction of a connection
+typedef struct {
+    uint32_t next_seq;
+    uint8_t synced;             // next_seq is known
+    uint8_t stage;
+    bytes_t tcp;                // reassembled, not yet taken by the TLS or HTTP layer
+    bytes_t app;                // decrypted, for the HTTP layer (TLS only)
+    tls_decrypt_t tls;
+    uint8_t tls_ready;
+} half_t;
+
+typedef struct {
+    uint8_t family;             // 4 or 6
+    uint8_t addr[2][16];        // side 0 sent the first packet seen
+    uint16_t port[2];
+} flow_key_t;
+
+typedef struct {
+    flow_key_t key;
+    int8_t client;              // side of the client, -1 until known
+    uint8_t kind;
+    uint8_t random[TLS_RANDOM_LEN];
+    uint8_t have_random;
+    half_t half[2];             // by side
+    bytes_t message;            // a fragmented message being put together
+    uint8_t msg_opcode;
+    uint8_t msg_compressed;
+    ws_deflate_t deflate;
+    bytes_t text;               // becomes out.text
+    capture_flow_t out;
+    uint8_t retired;            // its address pair was reused: no longer indexed
+} flow_t;
+
+typedef struct {
+    capture_t *c;
+    const tls_keylog_t *keys;
+    flow_t **flows;             // in the order they were opened
+    size_t nflows;
+    size_t cap;
+    int *index;                 // open addressing into flows, -1 when empty
+    size_t index_size;
+    uint64_t first_us;
+    uint8_t have_first;
+    uint8_t scratch[TLS_RECORD_MAX];
+} loader_t;
+
+/* Buffers */
+
+static int bytes_append(bytes_t *b, const void *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + len)
+            cap *= 2;
+        uint8_t *bigger = realloc(b->data, cap);
+        if (!bigger)
+            return -1;
+        b->data = bigger;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+static void bytes_consume(bytes_t *b, size_t n) {
+    b->len -= n;
+    memmove(b->data, b->data + n, b->len);
+}
+
+static void bytes_free(bytes_t *b) {
+    free(b->data);
+    *b = (bytes_t){ 0 };
+}
+
+/* Flows */
+
+static uint64_t key_hash(const flow_key_t *k) {
+    // The same either way round
+    uint64_t h[2];
+    for (int side = 0; side < 2; side++) {
+        uint64_t x = 1469598103934665603ull;
+        for (int i = 0; i < 16; i++)
+            x = (x ^ k->addr[side][i]) * 1099511628211ull;
+        h[side] = (x ^ k->port[side]) * 1099511628211ull;
+    }
+    return h[0] ^ h[1];
+}
+
+// Side of the flow the packet with key k came from, -1 if it is another flow
+static int key_side(const flow_key_t *flow, const flow_key_t *k) {
+    if (flow->family != k->family)
+        return -1;
+    for (int side = 0; side < 2; side++) {
+        if (flow->port[side] == k->port[0] && flow->port[!side] == k->port[1] &&
+            memcmp(flow->addr[side], k->addr[0], 16) == 0 && memcmp(flow->addr[!side], k->addr[1], 16) == 0)
+            return side;
+    }
+    return -1;
+}
+
+static int index_insert(loader_t *l, size_t flow) {
+    if ((l->nflows + 1) * 2 > l->index_size) {
+        size_t size = l->index_size ? l->index_size * 2 : 1024;
+        int *index = malloc(size * sizeof(*index));
+        if (!index)
+            return -1;
+        memset(index, 0xff, size * sizeof(*index));
+        free(l->index);
+        l->index = index;
+        l->index_size = size;
+        for (size_t i = 0; i < l->nflows; i++) {
+            if (l->flows[i]->retired)
+                continue;
+            size_t slot = key_hash(&l->flows[i]->key) & (size - 1);
+            while (index[slot] >= 0)
+                slot = (slot + 1) & (size - 1);
+            index[slot] = (int)i;
+        }
+    }
+    size_t slot = key_hash(&l->flows[flow]->key) & (l->index_size - 1);
+    while (l->index[slot] >= 0 && (size_t)l->index[slot] != flow)
+        slot = (slot + 1) & (l->index_size - 1);
+    l->index[slot] = (int)flow;
+    return 0;
+}
+
+// The flow the packet belongs to and its side
+static flow_t *flow_find(loader_t *l, const flow_key_t *k, int *side) {
+    if (!l->index_size)
+        return NULL;
+    size_t i = key_hash(k) & (l->index_size - 1);
+    for (; l->index[i] >= 0; i = (i + 1) & (l->index_size - 1)) {
+        flow_t *f = l->flows[l->index[i]];
+        if ((*side = key_side(&f->key, k)) >= 0)
+            return f;
+    }
+    return NULL;
+}
+
+// A new connection; old is the one that had the same address pair before
+static flow_t *flow_new(loader_t *l, const flow_key_t *k, flow_t *old) {
+    if (l->nflows == l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : 256;
+        flow_t **bigger = realloc(l->flows, cap * sizeof(*bigger));
+        if (!bigger)
+            return NULL;
+        l->flows = bigger;
+        l->cap = cap;
+    }
+    flow_t *f = calloc(1, sizeof(*f));
+    if (!f)
+        return NULL;
+    f->key = *k;
+    f->client = -1;
+    l->flows[l->nflows++] = f;
+    if (old) {
+        // Take over its index entry
+        size_t i = key_hash(k) & (l->index_size - 1);
+        while (l->flows[l->index[i]] != old)
+            i = (i + 1) & (l->index_size - 1);
+        l->index[i] = (int)(l->nflows - 1);
+        old->retired = 1;
+    } else if (index_insert(l, l->nflows - 1) < 0) {
+        l->nflows--;
+        free(f);
+        return NULL;
+    }
+    l->c->stats.connections++;
+    return f;
+}
+
+// Done with the connection's state; what it sent stays in out
+static void flow_release(flow_t *f) {
+    for (int side = 0; side < 2; side++) {
+        bytes_free(&f->half[side].tcp);
+        bytes_free(&f->half[side].app);
+        if (f->half[side].tls_ready)
+            tls_decrypt_free(&f->half[side].tls);
+        f->half[side].tls_ready = 0;
+        f->half[side].stage = STAGE_DONE;
+    }
+    bytes_free(&f->message);
+    ws_deflate_free(&f->deflate);
+}
+
+static void flow_ignore(flow_t *f) {
+    f->kind = KIND_IGNORED;
+    flow_release(f);
+}
+
+/* WebSocket */
+
+static void message_done(loader_t *l, flow_t *f, uint64_t time_us) {
+    const uint8_t *data = f->message.data;
+    size_t len = f->message.len;
+    if (f->msg_compressed &&
+        (!f->deflate.params.enabled ||
+         ws_inflate_message(&f->deflate, f->message.data, f->message.len, WS_DEFAULT_MAX_MESSAGE, &data, &len) < 0)) {
+        f->half[f->client].stage = STAGE_DONE;
+        return;
+    }
+
+    capture_flow_t *out = &f->out;
+    size_t off = f->text.len;
+    if (off + len > UINT32_MAX) {
+        f->half[f->client].stage = STAGE_DONE;
+        return;
+    }
+    if (out->count % 64 == 0) {
+        capture_message_t *bigger = realloc(out->messages, (out->count + 64) * sizeof(*bigger));
+        if (!bigger)
+            return;
+        out->messages = bigger;
+    }
+    if (bytes_append(&f->text, data, len) < 0)
+        return;
+    // Never before the message ahead of it, however the packets were stamped
+    time_us -= l->first_us;
+    if (out->count && time_us < out->messages[out->count - 1].time_us)
+        time_us = out->messages[out->count - 1].time_us;
+    out->messages[out->count++] = (capture_message_t){
+        .time_us = time_us,
+        .off = (uint32_t)off,
+        .len = (uint32_t)len,
+        .opcode = f->msg_opcode
+    };
+}
+
+static int http_head(flow_t *f, int side, bytes_t *in) {
+    if (!in->len)
+        return 0;
+    const uint8_t *end = memmem(in->data, in->len, "\r\n\r\n", 4);
+    if (!end)
+        return in->len > HTTP_MAX_REQUEST_SIZE ? -1 : 0;
+    size_t len = (size_t)(end - in->data) + 4;
+    const char *buf = (const char *)in->data;
+    int is_client = side == f->client;
+    http_parser_t p;
+    http_parser_init(&p, !is_client, HTTP_MAX_REQUEST_SIZE);
+    if (http_parse(&p, buf, len) != 1)
+        return -1;
+
+    if (is_client) {
+        if (!http_header_has_token(&p, buf, HTTP_HDR_UPGRADE, "websocket"))
+            return -1;
+    } else {
+        if (p.status != 101)
+            return -1;
+        const http_header_t *protocol = http_header(&p, HTTP_HDR_SEC_WEBSOCKET_PROTOCOL);
+        if (protocol && protocol->value.len < CAPTURE_SUBPROTOCOL_MAX)
+            memcpy(f->out.subprotocol, buf + protocol->value.off, protocol->value.len);
+        // Whatever the client offered, the answer says how it compresses
+        const http_header_t *extensions = http_header(&p, HTTP_HDR_SEC_WEBSOCKET_EXTENSIONS);
+        ws_deflate_params_t offer = {
+            .enabled = 1,
+            .server_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+            .client_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+            .client_max_window_bits_offered = 1
+        }, params;
+        if (extensions && ws_deflate_parse_response(buf + extensions->value.off, extensions->value.len,
+                                                    &offer, &params) == 0)
+            ws_deflate_init(&f->deflate, &params, 1);
+    }
+    bytes_consume(in, len);
+    return 1;
+}
+
+// The HTTP head, then (from the client) frames
+static void app_data(loader_t *l, flow_t *f, int side, bytes_t *in, uint64_t time_us) {
+    half_t *h = &f->half[side];
+    while (h->stage != STAGE_DONE && f->kind != KIND_IGNORED) {
+        if (h->stage == STAGE_HEAD) {
+            int rc = http_head(f, side, in);
+            if (rc == 0)
+                return;
+            if (rc < 0) {
+                flow_ignore(f);
+                return;
+            }
+            if (side == f->client) {
+                h->stage = STAGE_FRAMES;
+            } else {
+                h->stage = STAGE_DONE;
+                l->c->stats.websocket++;
+            }
+            continue;
+        }
+
+        ws_frame_header_t hdr;
+        int rc = ws_parse_frame_header(in->data, in->len, &hdr);
+        if (rc == 0)
+            return;
+        if (rc < 0 || hdr.payload_len > WS_DEFAULT_MAX_MESSAGE) {
+            h->stage = STAGE_DONE;
+            break;
+        }
+        if (in->len - hdr.header_len < hdr.payload_len)
+            return;
+        uint8_t *payload = in->data + hdr.header_len;
+        size_t len = (size_t)hdr.payload_len;
+        if (hdr.masked)
+            ws_mask(payload, len, hdr.mask, 0);
+
+        if (hdr.opcode == WS_OPCODE_CLOSE) {
+            h->stage = STAGE_DONE;
+        } else if (!WS_IS_CONTROL(hdr.opcode)) {
+            if (hdr.opcode != WS_OPCODE_CONTINUATION) {
+                f->message.len = 0;
+                f->msg_opcode = hdr.opcode;
+                f->msg_compressed = (hdr.rsv & 0x4) != 0;   // RSV1
+            }
+            if (f->msg_opcode && bytes_append(&f->message, payload, len) == 0 && hdr.fin) {
+                message_done(l, f, time_us);
+                f->msg_opcode = 0;
+            }
+        }
+        bytes_consume(in, hdr.header_len + len);
+    }
+    in->len = 0;    // nothing more is wanted from this side
+}
+
+/* TLS */
+
+static const uint8_t hello_retry_random[TLS_RANDOM_LEN] = {
+    0xCF, 0x21, 0xAD, 0x74, 0xE5, 0x9A, 0x61, 0x11, 0xBE, 0x1D, 0x8C, 0x02, 0x1E, 0x65, 0xB8, 0x91,
+    0xC2, 0xA2, 0x11, 0x16, 0x7A, 0xBB, 0x8C, 0x5E, 0x07, 0x9E, 0x09, 0xE2, 0xC8, 0xA8, 0x33, 0x9C
+};
+
+// A plaintext handshake record: the ClientHello gives the random the key
+// log is indexed by, the ServerHello the version and cipher suite
+static void hello(loader_t *l, flow_t *f, int side, const uint8_t *p, size_t len) {
+    if (len < 4 + 2 + TLS_RANDOM_LEN + 1)
+        return;
+    const uint8_t *random = p + 6;
+    if (side == f->client) {
+        if (p[0] == 1 && !f->have_random) {
+            memcpy(f->random, random, TLS_RANDOM_LEN);
+            f->have_random = 1;
+        }
+        return;
+    }
+    if (p[0] != 2 || memcmp(random, hello_retry_random, TLS_RANDOM_LEN) == 0)
+        return;
+
+    // legacy_session_id, cipher_suite, legacy_compression_method, extensions
+    size_t pos = 38;
+    pos += 1 + p[pos];
+    if (pos + 5 > len) {
+        flow_ignore(f);
+        return;
+    }
+    uint16_t suite = (uint16_t)(p[pos] << 8 | p[pos + 1]);
+    pos += 3;
+    size_t end = pos + 2 + (size_t)(p[pos] << 8 | p[pos + 1]);
+    int tls13 = 0;
+    for (pos += 2; pos + 4 <= end && end <= len;) {
+        uint16_t type = (uint16_t)(p[pos] << 8 | p[pos + 1]);
+        size_t ext_len = (size_t)(p[pos + 2] << 8 | p[pos + 3]);
+        if (type == 43 && ext_len == 2 && pos + 6 <= len)  // supported_versions
+            tls13 = (p[pos + 4] << 8 | p[pos + 5]) == TLS_VERSION_13;
+        pos += 4 + ext_len;
+    }
+    if (!tls13) {
+        l->c->stats.tls_unsupported++;
+        flow_ignore(f);
+        return;
+    }
+
+    const tls_keylog_entry_t *e = l->keys && f->have_random ? tls_keylog_find(l->keys, f->random) : NULL;
+    if (!e || !e->secret_len[TLS_SECRET_CLIENT_HANDSHAKE] || !e->secret_len[TLS_SECRET_CLIENT_TRAFFIC] ||
+        !e->secret_len[TLS_SECRET_SERVER_HANDSHAKE] || !e->secret_len[TLS_SECRET_SERVER_TRAFFIC]) {
+        l->c->stats.tls_without_keys++;
+        flow_ignore(f);
+        return;
+    }
+    half_t *client = &f->half[f->client], *server = &f->half[!f->client];
+    if (tls_decrypt_init(&client->tls, suite, e->secret[TLS_SECRET_CLIENT_HANDSHAKE],
+                         e->secret[TLS_SECRET_CLIENT_TRAFFIC], e->secret_len[TLS_SECRET_CLIENT_TRAFFIC]) < 0) {
+        l->c->stats.tls_unsupported++;
+        flow_ignore(f);
+        return;
+    }
+    client->tls_ready = 1;
+    if (tls_decrypt_init(&server->tls, suite, e->secret[TLS_SECRET_SERVER_HANDSHAKE],
+                         e->secret[TLS_SECRET_SERVER_TRAFFIC], e->secret_len[TLS_SECRET_SERVER_TRAFFIC]) < 0) {
+        l->c->stats.tls_unsupported++;
+        flow_ignore(f);
+        return;
+    }
+    server->tls_ready = 1;
+}
+
+static void tls_data(loader_t *l, flow_t *f, int side, uint64_t time_us) {
+    half_t *h = &f->half[side];
+    while (h->tcp.len >= TLS_RECORD_HEADER && f->kind != KIND_IGNORED) {
+        const uint8_t *r = h->tcp.data;
+        size_t len = TLS_RECORD_HEADER + (size_t)(r[3] << 8 | r[4]);
+        if (len > TLS_RECORD_HEADER + TLS_RECORD_MAX) {
+            flow_ignore(f);
+            return;
+        }
+        if (h->tcp.len < len)
+            break;
+
+        if (r[0] == TLS_HANDSHAKE && !h->tls_ready) {
+            hello(l, f, side, r + TLS_RECORD_HEADER, len - TLS_RECORD_HEADER);
+            if (f->kind == KIND_IGNORED)
+                return;
+        } else if (r[0] == TLS_APPLICATION_DATA) {
+            size_t n;
+            int type = h->tls_ready ? tls_decrypt_record(&h->tls, r, len, l->scratch, &n) : -1;
+            if (type < 0) {
+                if (h->tls_ready)
+                    l->c->stats.undecryptable++;
+                flow_ignore(f);
+                return;
+            }
+            if (type == TLS_APPLICATION_DATA && bytes_append(&h->app, l->scratch, n) < 0) {
+                flow_ignore(f);
+                return;
+            }
+        }
+        bytes_consume(&h->tcp, len);
+    }
+    if (f->kind != KIND_IGNORED)
+        app_data(l, f, side, &h->app, time_us);
+}
+
+/* Packets */
+
+// Where the IP header starts for the link type, NULL for anything else
+static const uint8_t *ip_header(int link, const uint8_t *p, size_t len, size_t *ip_len) {
+    size_t off;
+    uint16_t proto = 0;
+    switch (link) {
+    case LINK_ETHERNET:
+        if (len < 14) return NULL;
+        off = 14;
+        proto = (uint16_t)(p[12] << 8 | p[13]);
+        while (proto == 0x8100 && len >= off + 4) {     // VLAN tags
+            proto = (uint16_t)(p[off + 2] << 8 | p[off + 3]);
+            off += 4;
+        }
+        if (proto != 0x0800 && proto != 0x86DD) return NULL;
+        break;
+    case LINK_LINUX_SLL:
+        if (len < 16) return NULL;
+        off = 16;
+        break;
+    case LINK_LINUX_SLL2:
+        if (len < 20) return NULL;
+        off = 20;
+        break;
+    case LINK_NULL:
+    case LINK_LOOP:
+        off = 4;
+        break;
+    case LINK_RAW:
+    case LINK_IPV4:
+    case LINK_IPV6:
+        off = 0;
+        break;
+    default:
+        return NULL;
+    }
+    if (len <= off)
+        return NULL;
+    *ip_len = len - off;
+    return p + off;
+}
+
+static void packet(loader_t *l, int link, uint64_t time_us, const uint8_t *p, size_t len) {
+    capture_t *c = l->c;
+    c->stats.packets++;
+    if (!l->have_first) {
+        l->first_us = time_us;
+        l->have_first = 1;
+    }
+    // Captures from several queues can be a little out of order
+    if (time_us < l->first_us)
+        time_us = l->first_us;
+    if (time_us - l->first_us > c->duration_us)
+        c->duration_us = time_us - l->first_us;
+
+    size_t ip_len;
+    const uint8_t *ip = ip_header(link, p, len, &ip_len);
+    if (!ip)
+        return;
+
+    flow_key_t k = { 0 };
+    const uint8_t *tcp;
+    size_t tcp_len;
+    if ((ip[0] >> 4) == 4) {
+        size_t ihl = (size_t)(ip[0] & 0x0F) * 4;
+        size_t total = (size_t)(ip[2] << 8 | ip[3]);
+        if (ip_len < 20 || ip[9] != 6 || ihl < 20 || total < ihl || (ip[6] & 0x3F) || ip[7])
+            return;     // not TCP, or a fragment
+        if (total > ip_len) {
+            c->stats.truncated++;
+            return;
+        }
+        k.family = 4;
+        memcpy(k.addr[0], ip + 12, 4);
+        memcpy(k.addr[1], ip + 16, 4);
+        tcp = ip + ihl;
+        tcp_len = total - ihl;
+    } else if ((ip[0] >> 4) == 6) {
+        if (ip_len < 40 || ip[6] != 6)
+            return;     // extension headers are not followed
+        size_t total = 40 + (size_t)(ip[4] << 8 | ip[5]);
+        if (total > ip_len) {
+            c->stats.truncated++;
+            return;
+        }
+        k.family = 6;
+        memcpy(k.addr[0], ip + 8, 16);
+        memcpy(k.addr[1], ip + 24, 16);
+        tcp = ip + 40;
+        tcp_len = total - 40;
+    } else {
+        return;
+    }
+    if (tcp_len < 20 || (size_t)(tcp[12] >> 4) * 4 > tcp_len)
+        return;
+    c->stats.tcp_packets++;
+    k.port[0] = (uint16_t)(tcp[0] << 8 | tcp[1]);
+    k.port[1] = (uint16_t)(tcp[2] << 8 | tcp[3]);
+    uint32_t seq = (uint32_t)tcp[4] << 24 | (uint32_t)tcp[5] << 16 | (uint32_t)tcp[6] << 8 | tcp[7];
+    uint8_t flags = tcp[13];
+    size_t data_off = (size_t)(tcp[12] >> 4) * 4;
+    const uint8_t *data = tcp + data_off;
+    size_t data_len = tcp_len - data_off;
+
+    int side = 0;
+    flow_t *f = flow_find(l, &k, &side), *old = NULL;
+    if (f && (flags & (TCP_SYN | TCP_ACK)) == TCP_SYN && f->half[0].synced && f->half[1].synced) {
+        // The address pair is being reused for a new connection
+        flow_release(f);
+        old = f;
+        f = NULL;
+    }
+    if (!f) {
+        if (!(f = flow_new(l, &k, old)))
+            return;
+        side = 0;
+    }
+    half_t *h = &f->half[side];
+
+    if (flags & TCP_SYN) {
+        h->next_seq = seq + 1;
+        h->synced = 1;
+        if (f->client < 0)
+            f->client = (int8_t)(flags & TCP_ACK ? !side : side);
+        return;
+    }
+    if (!data_len || f->kind == KIND_IGNORED || h->stage == STAGE_DONE)
+        return;
+    if (!h->synced) {
+        h->next_seq = seq;
+        h->synced = 1;
+    }
+    int32_t ahead = (int32_t)(seq - h->next_seq);
+    if (ahead > 0) {
+        // Lost from the capture: the rest of this side cannot be read
+        c->stats.gaps += (uint64_t)ahead;
+        h->stage = STAGE_DONE;
+        bytes_free(&h->tcp);
+        return;
+    }
+    if ((size_t)-ahead >= data_len)
+        return;     // retransmitted
+    data += -ahead;
+    data_len -= (size_t)-ahead;
+    h->next_seq += (uint32_t)data_len;
+
+    if (f->kind == KIND_UNKNOWN) {
+        // Joined mid-connection: whoever speaks first in a known way is the client
+        if (f->client < 0)
+            f->client = (int8_t)(data[0] == TLS_HANDSHAKE || data[0] == 'G' ? side : !side);
+        if (side == f->client)
+            f->kind = data[0] == TLS_HANDSHAKE ? KIND_TLS : data[0] == 'G' ? KIND_PLAIN : KIND_IGNORED;
+        if (f->kind == KIND_IGNORED) {
+            flow_ignore(f);
+            return;
+        }
+    }
+    if (bytes_append(&h->tcp, data, data_len) < 0) {
+        flow_ignore(f);
+        return;
+    }
+    if (f->kind == KIND_TLS)
+        tls_data(l, f, side, time_us);
+    else if (f->kind == KIND_PLAIN)
+        app_data(l, f, side, &h->tcp, time_us);
+    // KIND_UNKNOWN: the server spoke first, kept until the client does
+}
+
+/* Files */
+
+static uint32_t read_u32(const uint8_t *p, int swap) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+int capture_load(capture_t *c, const char *path, const tls_keylog_t *keys) {
+    *c = (capture_t){ 0 };
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        c->error = "cannot open the file";
+        return -1;
+    }
+
+    uint8_t header[24];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        fclose(file);
+        c->error = "not a pcap file";
+        return -1;
+    }
+    uint32_t magic = read_u32(header, 0);
+    int swap = magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS);
+    magic = read_u32(header, swap);
+    if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+        fclose(file);
+        c->error = magic == PCAPNG_MAGIC ? "pcapng is not supported, convert it with editcap -F pcap"
+                                         : "not a pcap file";
+        return -1;
+    }
+    int nanoseconds = magic == PCAP_MAGIC_NS;
+    int link = (int)(read_u32(header + 20, swap) & 0xFFFF);
+
+    loader_t *l = calloc(1, sizeof(*l));
+    uint8_t *record = malloc(PCAP_MAX_RECORD);
+    if (!l || !record) {
+        free(l);
+        free(record);
+        fclose(file);
+        c->error = "out of memory";
+        return -1;
+    }
+    l->c = c;
+    l->keys = keys;
+
+    uint8_t rh[16];
+    while (fread(rh, 1, sizeof(rh), file) == sizeof(rh)) {
+        uint32_t sec = read_u32(rh, swap), frac = read_u32(rh + 4, swap);
+        uint32_t caplen = read_u32(rh + 8, swap), origlen = read_u32(rh + 12, swap);
+        if (caplen > PCAP_MAX_RECORD || fread(record, 1, caplen, file) != caplen)
+            break;      // cut off or corrupt: keep what came before
+        if (caplen < origlen)
+            c->stats.truncated++;
+        uint64_t time_us = (uint64_t)sec * 1000000 + (nanoseconds ? frac / 1000 : frac);
+        packet(l, link, time_us, record, caplen);
+    }
+    fclose(file);
+    free(record);
+
+    // Keep the clients that sent something
+    for (size_t i = 0; i < l->nflows; i++) {
+        flow_t *f = l->flows[i];
+        flow_release(f);
+        f->out.text = f->text.data;
+        f->out.text_len = f->text.len;
+        if (f->out.count) {
+            capture_flow_t *bigger = realloc(c->flows, (size_t)(c->nflows + 1) * sizeof(*bigger));
+            if (bigger) {
+                c->flows = bigger;
+                c->flows[c->nflows++] = f->out;
+                f->out = (capture_flow_t){ 0 };
+            }
+        }
+        free(f->out.messages);
+        free(f->out.text);
+        free(f);
+    }
+    free(l->flows);
+    free(l->index);
+    free(l);
+    return 0;
+}
+
+void capture_free(capture_t *c) {
+    for (int i = 0; i < c->nflows; i++) {
+        free(c->flows[i].messages);
+        free(c->flows[i].text);
+    }
+    free(c->flows);
+    *c = (capture_t){ 0 };
+}
@@ -0,0 +1,63 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "TLSDecrypt.h"
+
+// WebSocket messages captured on the wire, for replaying real traffic.
+// Reads classic pcap files (libpcap's format, microsecond or nanosecond;
+// pcapng must be converted first, e.g. editcap -F pcap), reassembles every
+// TCP connection and keeps what each client sent after its upgrade: the
+// text and binary messages, unmasked, defragmented and inflated, with the
+// time their last byte was captured. TLS connections are read when a key
+// log has their secrets. The servers' side is only looked at for the
+// ServerHello and the 101.
+
+#define CAPTURE_SUBPROTOCOL_MAX 16
+
+typedef struct {
+    uint64_t time_us;           // since the start of the capture
+    uint32_t off;               // payload, in the flow's text
+    uint32_t len;
+    uint8_t opcode;             // WS_OPCODE_TEXT or WS_OPCODE_BINARY
+} capture_message_t;
+
+// One client's messages
+typedef struct {
+    capture_message_t *messages;
+    size_t count;
+    uint8_t *text;              // payloads back to back
+    size_t text_len;
+    char subprotocol[CAPTURE_SUBPROTOCOL_MAX];  // the server's choice, "" if none
+} capture_flow_t;
+
+// What the capture held and why connections were left out
+typedef struct {
+    uint64_t packets;
+    uint64_t tcp_packets;
+    uint64_t connections;       // TCP connections seen
+    uint64_t websocket;         // upgraded to WebSocket, with or without messages kept
+    uint64_t tls_without_keys;  // no key log entry for them
+    uint64_t tls_unsupported;   // TLS 1.2 or an unknown cipher suite
+    uint64_t undecryptable;     // records no logged key opened
+    uint64_t gaps;              // bytes missing from the capture
+    uint64_t truncated;         // packets cut short by the snap length
+} capture_stats_t;
+
+typedef struct {
+    capture_flow_t *flows;      // in the order the connections were opened
+    int nflows;
+    uint64_t duration_us;
+    capture_stats_t stats;
+    const char *error;          // why capture_load failed
+} capture_t;
+
+// Read a capture. keys may be NULL when it is not encrypted. Returns -1 with
+// error set if the file cannot be read or is not a pcap file; connections
+// that cannot be followed are counted in stats and left out.
+int capture_load(capture_t *c, const char *path, const tls_keylog_t *keys);
+void capture_free(capture_t *c);
+
+#endif
@@ -0,0 +1,1050 @@
+#include "Swarm.h"
+
+// Charge point swarm: one process, one epoll loop, thousands of simulated
+// stations. Each keeps its own TLS session for resumption, sends a
+// BootNotification once upgraded and then Heartbeats and MeterValues on its
+// own schedule. Connect latency (TCP connect to the 101) and CALL round
+// trips are recorded in histograms and reported as percentiles.
+
+static swarm_config_t config = {
+    .host = "127.0.0.1",
+    .port = PORT,
+    .stations = SWARM_DEFAULT_STATIONS,
+    .ramp = SWARM_DEFAULT_RAMP,
+    .heartbeat = SWARM_DEFAULT_HEARTBEAT,
+    .meter_values = SWARM_DEFAULT_METER_VALUES,
+    .duration = SWARM_DEFAULT_DURATION,
+    .report = SWARM_DEFAULT_REPORT,
+    .reconnect_ms = SWARM_DEFAULT_RECONNECT_MS,
+    .storm_fraction = SWARM_DEFAULT_STORM_FRACTION,
+    .call_timeout = SWARM_DEFAULT_CALL_TIMEOUT,
+    .speed = SWARM_DEFAULT_SPEED
+};
+
+static station_t *stations;
+static SSL_CTX *ssl_ctx;
+static struct sockaddr_in server_addr;
+static int epfd;
+static timer_wheel_t timers;
+static wheel_timer_t report_timer, storm_timer, stop_timer;
+static ocpp_router_t router;       // no handlers: the server's CALLs get NotSupported
+static capture_t capture;           // what --replay plays, nflows == 0 otherwise
+static uint64_t started_ms;
+static int stopping;
+static int active;                  // stations not idle
+static int open_stations;
+
+static swarm_counters_t counters, last_report;
+static histogram_t connect_interval, rtt_interval;  // since the last report
+static histogram_t connect_total, rtt_total;
+
+static uint64_t clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Masks and jitter; a load generator needs them cheap, not unpredictable
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static uint64_t jitter(uint64_t ms) {
+    return ms ? ms / 2 + rng_next() % ms : 0;
+}
+
+static station_t *station_of_timer(wheel_timer_t *t) {
+    return (station_t *)((uintptr_t)t - offsetof(station_t, timer));
+}
+
+/* Output */
+
+// Room for len more bytes at the end of the backlog
+static uint8_t *backlog_reserve(station_t *st, size_t len) {
+    size_t cap = st->backlog ? buf_pool_size(st->backlog) : 0;
+    if (st->backlog_len + len > cap) {
+        uint8_t *bigger = buf_pool_get(st->backlog_len + len);
+        if (!bigger)
+            return NULL;
+        if (st->backlog_len)
+            memcpy(bigger, st->backlog, st->backlog_len);
+        buf_pool_put(st->backlog);
+        st->backlog = bigger;
+    }
+    return st->backlog + st->backlog_len;
+}
+
+// Hand the backlog to the socket (through TLS) until it would block
+static int station_flush(station_t *st) {
+    size_t off = 0;
+    if (st->tls.ssl) {
+        while (off < st->backlog_len) {
+            int n = tls_engine_write(&st->tls, st->backlog + off, st->backlog_len - off);
+            if (n < 0)
+                return -1;
+            if (n == 0) {
+                // The engine is full: make room unless the socket is too
+                int sent = tls_engine_send_fd(&st->tls, st->fd);
+                if (sent < 0)
+                    return -1;
+                if (sent == 0)
+                    break;
+                continue;
+            }
+            off += (size_t)n;
+        }
+        if (tls_engine_send_fd(&st->tls, st->fd) < 0)
+            return -1;
+    } else {
+        while (off < st->backlog_len) {
+            ssize_t n = send(st->fd, st->backlog + off, st->backlog_len - off, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return -1;
+            }
+            off += (size_t)n;
+        }
+    }
+
+    st->backlog_len -= off;
+    if (st->backlog_len)
+        memmove(st->backlog, st->backlog + off, st->backlog_len);
+    else {
+        buf_pool_put(st->backlog);
+        st->backlog = NULL;
+    }
+    return 0;
+}
+
+static int station_send(station_t *st, const void *data, size_t len) {
+    uint8_t *dst = backlog_reserve(st, len);
+    if (!dst)
+        return -1;
+    memcpy(dst, data, len);
+    st->backlog_len += len;
+    return station_flush(st);
+}
+
+// One masked frame, compressed when the server agreed to it
+static int station_send_frame(station_t *st, uint8_t opcode, const struct iovec *iov, int iovcnt) {
+    uint8_t *packed = NULL;
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++)
+        len += iov[i].iov_len;
+    if (st->deflate.params.enabled && opcode == WS_OPCODE_TEXT) {
+        int rc = ws_deflate_message(&st->deflate, iov, iovcnt, 0, &packed, &len);
+        if (rc < 0)
+            return -1;
+        if (rc > 0)
+            opcode |= WS_RSV1;
+    }
+
+    uint8_t *dst = backlog_reserve(st, WS_MAX_HEADER_SIZE + len);
+    if (!dst) {
+        buf_pool_put(packed);
+        return -1;
+    }
+    uint32_t mask_word = (uint32_t)rng_next();
+    uint8_t mask[4];
+    memcpy(mask, &mask_word, sizeof(mask));
+    size_t header_len = ws_build_frame_header(dst, opcode, 1, len, mask);
+    uint8_t *payload = dst + header_len;
+    if (packed) {
+        memcpy(payload, packed, len);
+        buf_pool_put(packed);
+    } else {
+        for (int i = 0; i < iovcnt; i++) {
+            memcpy(payload, iov[i].iov_base, iov[i].iov_len);
+            payload += iov[i].iov_len;
+        }
+        payload = dst + header_len;
+    }
+    ws_mask(payload, len, mask, 0);
+    st->backlog_len += header_len + len;
+    return station_flush(st);
+}
+
+// OCPP-J transport
+static int send_ocpp(void *transport, const struct iovec *iov, int iovcnt) {
+    return station_send_frame(transport, WS_OPCODE_TEXT, iov, iovcnt);
+}
+
+static int send_close(station_t *st, uint16_t code) {
+    uint32_t mask_word = (uint32_t)rng_next();
+    uint8_t mask[4], frame[WS_MAX_CONTROL_FRAME];
+    memcpy(mask, &mask_word, sizeof(mask));
+    return station_send(st, frame, ws_build_close(&st->rx, code, mask, frame));
+}
+
+/* Lifecycle */
+
+static void station_arm(station_t *st);
+
+// Tear the connection down; count is the counter to blame, NULL for an
+// orderly end. The station reconnects later unless the run is ending.
+static void station_reset(station_t *st, uint64_t *count, uint64_t reconnect_ms) {
+    if (count)
+        (*count)++;
+    if (st->state == STATION_OPEN) {
+        st->ending = 1;
+        ocpp_session_free(&st->ocpp);
+        st->ending = 0;
+        open_stations--;
+    }
+    if (st->state != STATION_IDLE) {
+        close(st->fd);
+        active--;
+    }
+    st->fd = -1;
+    tls_engine_free(&st->tls);
+    ws_decoder_free(&st->rx);
+    ws_deflate_free(&st->deflate);
+    buf_pool_put(st->backlog);
+    st->backlog = NULL;
+    st->backlog_len = 0;
+    st->state = STATION_IDLE;
+
+    if (stopping)
+        timer_cancel(&timers, &st->timer);
+    else
+        timer_arm(&timers, &st->timer, reconnect_ms);
+}
+
+static void station_fail(station_t *st, uint64_t *count) {
+    station_reset(st, count, jitter(config.reconnect_ms));
+}
+
+// Keep the newest session of each station. TLS 1.3 tickets arrive after
+// the handshake, so they are taken as they come in. The session handed over
+// is the connection's own, which OpenSSL marks unresumable when the
+// connection ends without close_notify, as dropped ones do: keep a copy.
+static int save_session(SSL *ssl, SSL_SESSION *sess) {
+    station_t *st = SSL_get_app_data(ssl);
+    SSL_SESSION *copy = st ? SSL_SESSION_dup(sess) : NULL;
+    if (copy) {
+        SSL_SESSION_free(st->session);
+        st->session = copy;
+    }
+    return 0;
+}
+
+static void station_connect(station_t *st) {
+    counters.attempts++;
+    st->connect_started_us = clock_us();
+    st->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (st->fd < 0) {
+        perror("Unable to create socket");
+        st->state = STATION_IDLE;
+        station_fail(st, &counters.connect_failed);
+        return;
+    }
+    int one = 1;
+    setsockopt(st->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    st->state = STATION_CONNECTING;
+    active++;
+    if (connect(st->fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 && errno != EINPROGRESS) {
+        station_fail(st, &counters.connect_failed);
+        return;
+    }
+    // Edge triggered: every event drives the station as far as it goes
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = st };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, st->fd, &ev) < 0) {
+        station_fail(st, &counters.connect_failed);
+        return;
+    }
+    ws_decoder_init(&st->rx, 0, WS_DEFAULT_MAX_MESSAGE);
+    timer_arm(&timers, &st->timer, SWARM_CONNECT_TIMEOUT_MS);
+}
+
+static int send_upgrade(station_t *st) {
+    if (ws_generate_key(st->key) < 0)
+        return -1;
+    char request[1024], extension[WS_DEFLATE_PARAMS_SIZE] = "";
+    const char *subprotocol = config.ocpp201 ? "ocpp2.0.1" : "ocpp1.6";
+    if (capture.nflows && capture.flows[(st->index - 1) % capture.nflows].subprotocol[0])
+        subprotocol = capture.flows[(st->index - 1) % capture.nflows].subprotocol;
+    if (config.deflate) {
+        ws_deflate_params_t offer = {
+            .enabled = 1,
+            .server_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+            .client_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+            .client_max_window_bits_offered = 1
+        };
+        ws_deflate_format(&offer, 0, extension, sizeof(extension));
+    }
+    int n = snprintf(request, sizeof(request),
+                     "GET /%s%05u HTTP/1.1\r\n"
+                     "Host: %s:%d\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\n"
+                     "Sec-WebSocket-Version: 13\r\n"
+                     "Sec-WebSocket-Protocol: %s\r\n"
+                     "%s%s%s"
+                     "\r\n",
+                     SWARM_STATION_PREFIX, st->index, config.host, config.port, st->key,
+                     subprotocol,
+                     extension[0] ? "Sec-WebSocket-Extensions: " : "", extension, extension[0] ? "\r\n" : "");
+    http_parser_init(&st->http, 1, HTTP_MAX_REQUEST_SIZE);
+    st->state = STATION_UPGRADE;
+    return station_send(st, request, (size_t)n);
+}
+
+/* OCPP */
+
+static void format_timestamp(char out[32]) {
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(out, 32, "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+// The send time rides along as the CALL's opaque pointer
+static void on_reply(ocpp_session_t *s, const ocpp_message_t *reply, void *opaque) {
+    station_t *st = s->transport;
+    if (!reply) {
+        if (!st->ending)
+            counters.call_timeouts++;
+        return;
+    }
+    counters.answered++;
+    if (reply->type == OCPP_CALLERROR) {
+        counters.call_errors++;
+        return;
+    }
+    uint64_t rtt = clock_us() - (uint64_t)(uintptr_t)opaque;
+    histogram_record(&rtt_interval, rtt);
+}
+
+static int station_call(station_t *st, ocpp_action_t action, const char *payload, size_t len) {
+    if (st->ocpp.npending >= OCPP_MAX_PENDING) {
+        counters.throttled++;
+        return 0;
+    }
+    counters.calls++;
+    return ocpp_call(&st->ocpp, action, payload, len, on_reply, (void *)(uintptr_t)clock_us());
+}
+
+static int send_boot_notification(station_t *st) {
+    char buf[256];
+    ocpp_writer_t w;
+    ocpp_writer_init(&w, buf, sizeof(buf));
+    if (st->ocpp.version == OCPP_V201) {
+        ocpp201_boot_notification_request_t boot = {
+            .charging_station = { .model = OCPP_STR("Swarm"), .vendor_name = OCPP_STR("Simulator") },
+            .reason = OCPP201_BOOT_REASON_POWER_UP
+        };
+        ocpp201_boot_notification_request_write(&w, &boot);
+    } else {
+        ocpp16_boot_notification_request_t boot = {
+            .charge_point_vendor = OCPP_STR("Simulator"),
+            .charge_point_model = OCPP_STR("Swarm")
+        };
+        ocpp16_boot_notification_request_write(&w, &boot);
+    }
+    if (ocpp_writer_status(&w) < 0)
+        return -1;
+    return station_call(st, OCPP_ACTION_BOOT_NOTIFICATION, buf, w.len);
+}
+
+static int send_meter_values(station_t *st) {
+    char buf[512], timestamp[32], value[16];
+    format_timestamp(timestamp);
+    st->energy_wh += 10 + (uint32_t)(rng_next() % 90);
+    ocpp_writer_t w;
+    ocpp_writer_init(&w, buf, sizeof(buf));
+    if (st->ocpp.version == OCPP_V201) {
+        ocpp201_sampled_value_t sample = {
+            .value = st->energy_wh,
+            .has_context = true, .context = OCPP201_READING_CONTEXT_SAMPLE_PERIODIC,
+            .has_measurand = true, .measurand = OCPP201_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER
+        };
+        ocpp201_meter_value_t mv = {
+            .sampled_value = &sample, .sampled_value_count = 1,
+            .timestamp = { timestamp, strlen(timestamp) }
+        };
+        ocpp201_meter_values_request_t req = { .evse_id = 1, .meter_value = &mv, .meter_value_count = 1 };
+        ocpp201_meter_values_request_write(&w, &req);
+    } else {
+        int n = snprintf(value, sizeof(value), "%u", st->energy_wh);
+        ocpp16_sampled_value_t sample = {
+            .value = { value, (size_t)n },
+            .has_context = true, .context = OCPP16_SAMPLED_VALUE_CONTEXT_SAMPLE_PERIODIC,
+            .has_measurand = true, .measurand = OCPP16_SAMPLED_VALUE_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
+            .has_unit = true, .unit = OCPP16_SAMPLED_VALUE_UNIT_WH
+        };
+        ocpp16_meter_value_t mv = {
+            .timestamp = { timestamp, strlen(timestamp) },
+            .sampled_value = &sample, .sampled_value_count = 1
+        };
+        ocpp16_meter_values_request_t req = { .connector_id = 1, .meter_value = &mv, .meter_value_count = 1 };
+        ocpp16_meter_values_request_write(&w, &req);
+    }
+    if (ocpp_writer_status(&w) < 0)
+        return -1;
+    return station_call(st, OCPP_ACTION_METER_VALUES, buf, w.len);
+}
+
+// A captured message as it was, except that a CALL goes out under a fresh
+// id so its answer is timed like any other
+static int replay_send(station_t *st, const capture_flow_t *flow, const capture_message_t *m) {
+    const char *text = (const char *)flow->text + m->off;
+    ocpp_message_t msg;
+    if (m->opcode == WS_OPCODE_TEXT && ocppj_parse(text, m->len, &msg) == 0 &&
+        msg.type == OCPP_CALL && msg.action != OCPP_ACTION_UNKNOWN)
+        return station_call(st, msg.action, msg.payload.ptr, msg.payload.len);
+
+    counters.replayed_raw++;
+    struct iovec iov = { (void *)text, m->len };
+    return station_send_frame(st, m->opcode, &iov, 1);
+}
+
+// Send the captured messages that are due, holding them while every CALL
+// slot is taken. At speed 0 the next one goes as soon as a slot is free.
+static int station_replay(station_t *st) {
+    const capture_flow_t *flow = &capture.flows[(st->index - 1) % capture.nflows];
+    uint64_t now = timer_clock_ms();
+    for (;;) {
+        if (st->replay_next == flow->count) {
+            // Once more from the top, after the capture's average gap
+            // between messages (a second if it has one). At speed 0 right
+            // away while an answer is outstanding to pace it, else on the
+            // next tick.
+            uint64_t span_us = flow->messages[flow->count - 1].time_us - flow->messages[0].time_us;
+            double gap_ms = flow->count > 1 ? span_us / 1000.0 / (double)(flow->count - 1) : 1000.0;
+            uint64_t pause = config.speed > 0 ? (uint64_t)(gap_ms / config.speed) : 0;
+            st->replay_next = 0;
+            st->replay_started_ms = now + (pause ? pause : 1);
+            if (config.speed <= 0 && !st->ocpp.npending) {
+                st->next_replay_ms = st->replay_started_ms;
+                return 0;
+            }
+        }
+        const capture_message_t *m = &flow->messages[st->replay_next];
+        if (config.speed > 0) {
+            uint64_t due = st->replay_started_ms +
+                           (uint64_t)((m->time_us - flow->messages[0].time_us) / 1000.0 / config.speed);
+            if (due > now) {
+                st->next_replay_ms = due;
+                return 0;
+            }
+        }
+        // Late rather than lost: wait for an answer to free a slot
+        if (st->ocpp.npending >= OCPP_MAX_PENDING) {
+            st->next_replay_ms = 0;
+            return 0;
+        }
+        st->replay_next++;
+        if (replay_send(st, flow, m) < 0)
+            return -1;
+    }
+}
+
+// The timer goes off at the first of the next Heartbeat, the next
+// MeterValues, the next captured message and the earliest CALL deadline
+static void station_arm(station_t *st) {
+    uint64_t now = timer_clock_ms();
+    uint64_t next = 0;
+    if (config.heartbeat)
+        next = st->next_heartbeat_ms;
+    if (config.meter_values && (!next || st->next_meter_ms < next))
+        next = st->next_meter_ms;
+    if (st->next_replay_ms && (!next || st->next_replay_ms < next))
+        next = st->next_replay_ms;
+    uint64_t expiry = ocpp_session_expire(&st->ocpp, now);
+    if (expiry && (!next || expiry < next))
+        next = expiry;
+    if (next)
+        timer_arm(&timers, &st->timer, next > now ? next - now : 0);
+    else
+        timer_cancel(&timers, &st->timer);
+}
+
+// The 101 is in: check it, then start the OCPP session on the same buffer
+static int station_upgraded(station_t *st, const char *buf) {
+    http_parser_t *p = &st->http;
+    char expected[WS_ACCEPT_LEN + 1];
+    ws_accept_key(st->key, expected);
+    const http_header_t *accept = http_header(p, HTTP_HDR_SEC_WEBSOCKET_ACCEPT);
+    if (p->status != 101 || !accept || accept->value.len != WS_ACCEPT_LEN ||
+        memcmp(buf + accept->value.off, expected, WS_ACCEPT_LEN) != 0)
+        return -1;
+
+    ws_deflate_params_t deflate = { 0 };
+    const http_header_t *extensions = http_header(p, HTTP_HDR_SEC_WEBSOCKET_EXTENSIONS);
+    if (extensions) {
+        ws_deflate_params_t offer = {
+            .enabled = 1,
+            .server_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+            .client_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+            .client_max_window_bits_offered = 1
+        };
+        if (!config.deflate ||
+            ws_deflate_parse_response(buf + extensions->value.off, extensions->value.len, &offer, &deflate) < 0)
+            return -1;
+    }
+    const http_header_t *protocol = http_header(p, HTTP_HDR_SEC_WEBSOCKET_PROTOCOL);
+    char subprotocol[16] = "";
+    if (protocol && protocol->value.len < sizeof(subprotocol))
+        memcpy(subprotocol, buf + protocol->value.off, protocol->value.len);
+    size_t consumed = p->length;
+
+    ws_decoder_consume(&st->rx, consumed);
+    ws_deflate_init(&st->deflate, &deflate, 0);
+    st->rx.deflate = deflate.enabled;
+    ocpp_session_init(&st->ocpp, &router, ocpp_version_from_subprotocol(subprotocol), send_ocpp, st);
+    st->ocpp.call_timeout_ms = config.call_timeout * 1000;
+    st->state = STATION_OPEN;
+    open_stations++;
+    counters.connected++;
+    histogram_record(&connect_interval, clock_us() - st->connect_started_us);
+
+    // Spread the schedules so the stations do not move in lockstep
+    uint64_t now = timer_clock_ms();
+    st->next_heartbeat_ms = now + jitter(config.heartbeat * 1000ull);
+    st->next_meter_ms = now + jitter(config.meter_values * 1000ull);
+    if (capture.nflows) {
+        // The capture has its own BootNotification
+        st->replay_next = 0;
+        st->replay_started_ms = now;
+        st->next_replay_ms = 0;
+        if (station_replay(st) < 0)
+            return -1;
+    } else if (send_boot_notification(st) < 0) {
+        return -1;
+    }
+    station_arm(st);
+    return 0;
+}
+
+// Handle what the decoder holds. Returns -1 once the station was reset.
+static int station_process(station_t *st) {
+    if (st->state == STATION_UPGRADE) {
+        size_t avail;
+        const uint8_t *data = ws_decoder_peek(&st->rx, &avail);
+        if (!data)
+            return 0;
+        int rc = http_parse(&st->http, (const char *)data, avail);
+        if (rc == 0)
+            return 0;
+        if (rc < 0 || station_upgraded(st, (const char *)data) < 0) {
+            station_fail(st, &counters.handshake_failed);
+            return -1;
+        }
+    }
+
+    ws_message_t msg;
+    int rc;
+    while ((rc = ws_decoder_next(&st->rx, &msg)) > 0) {
+        if (WS_IS_CONTROL(msg.opcode)) {
+            uint32_t mask_word = (uint32_t)rng_next();
+            uint8_t mask[4], reply[WS_MAX_CONTROL_FRAME];
+            size_t reply_len;
+            memcpy(mask, &mask_word, sizeof(mask));
+            int closed = ws_control_frame(&st->rx, &msg, mask, reply, &reply_len);
+            if (reply_len && station_send(st, reply, reply_len) < 0) {
+                station_fail(st, &counters.dropped);
+                return -1;
+            }
+            if (closed) {
+                // Our close answered at the end of a run, or the server's echoed
+                station_fail(st, stopping ? NULL : &counters.dropped);
+                return -1;
+            }
+            continue;
+        }
+        if (st->rx.close_sent)
+            continue;
+
+        const uint8_t *text = msg.payload;
+        size_t len = msg.len;
+        if (msg.compressed &&
+            ws_inflate_message(&st->deflate, msg.payload, msg.len, st->rx.max_message, &text, &len) < 0) {
+            send_close(st, st->deflate.close_code);
+            station_fail(st, &counters.dropped);
+            return -1;
+        }
+        if (msg.compressed && msg.opcode == WS_OPCODE_TEXT && !ws_utf8_valid(text, len)) {
+            send_close(st, WS_CLOSE_INVALID_DATA);
+            station_fail(st, &counters.dropped);
+            return -1;
+        }
+        if (ocpp_session_dispatch(&st->ocpp, (const char *)text, len) < 0) {
+            station_fail(st, &counters.dropped);
+            return -1;
+        }
+    }
+    if (rc < 0) {
+        send_close(st, st->rx.close_code);
+        station_fail(st, &counters.dropped);
+        return -1;
+    }
+    // Answers free CALL slots for a replay held back or going as fast as it can
+    if (capture.nflows && st->next_replay_ms <= timer_clock_ms() && !st->rx.close_sent) {
+        if (station_replay(st) < 0) {
+            station_fail(st, &counters.dropped);
+            return -1;
+        }
+        station_arm(st);
+    }
+    return 0;
+}
+
+// Which counter a failure in the current state goes to
+static uint64_t *failure_counter(const station_t *st) {
+    switch (st->state) {
+    case STATION_CONNECTING: return &counters.connect_failed;
+    case STATION_TLS:
+    case STATION_UPGRADE: return &counters.handshake_failed;
+    default: return stopping ? NULL : &counters.dropped;
+    }
+}
+
+static void station_event(station_t *st, uint32_t events) {
+    if (st->state == STATION_IDLE)
+        return;     // reset earlier in this batch
+
+    if (st->state == STATION_CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(st->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+            station_fail(st, &counters.connect_failed);
+            return;
+        }
+        if (!(events & EPOLLOUT))
+            return;
+        if (ssl_ctx) {
+            if (tls_engine_init(&st->tls, ssl_ctx, 0, -1) < 0) {
+                station_fail(st, &counters.handshake_failed);
+                return;
+            }
+            SSL_set_app_data(st->tls.ssl, st);
+            if (st->session)
+                SSL_set_session(st->tls.ssl, st->session);
+            st->state = STATION_TLS;
+        } else if (send_upgrade(st) < 0) {
+            station_fail(st, &counters.handshake_failed);
+            return;
+        }
+    }
+
+    if (st->state == STATION_TLS) {
+        int rc = tls_engine_handshake_fd(&st->tls, st->fd);
+        if (rc < 0) {
+            station_fail(st, &counters.handshake_failed);
+            return;
+        }
+        if (rc == 0)
+            return;
+        if (SSL_session_reused(st->tls.ssl))
+            counters.resumed++;
+        if (send_upgrade(st) < 0) {
+            station_fail(st, &counters.handshake_failed);
+            return;
+        }
+    }
+
+    // Plaintext the socket did not take, or ciphertext the engine still holds
+    if ((st->backlog_len || (st->tls.ssl && tls_engine_pending(&st->tls))) && station_flush(st) < 0) {
+        station_fail(st, failure_counter(st));
+        return;
+    }
+
+    // Read until the socket is dry, as edge triggering requires
+    for (;;) {
+        size_t avail;
+        uint8_t *dst = ws_decoder_write_ptr(&st->rx, &avail);
+        if (!dst) {
+            station_fail(st, failure_counter(st));
+            return;
+        }
+        int n;
+        if (st->tls.ssl) {
+            n = tls_engine_read_fd(&st->tls, st->fd, dst, avail);
+        } else {
+            ssize_t got = read(st->fd, dst, avail);
+            n = got > 0 ? (int)got : got == 0 ? -1 : (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+        }
+        if (n < 0) {
+            station_fail(st, failure_counter(st));
+            return;
+        }
+        if (n == 0)
+            break;
+        ws_decoder_commit(&st->rx, (size_t)n);
+        if (station_process(st) < 0)
+            return;
+    }
+}
+
+static void station_timer(timer_wheel_t *w, wheel_timer_t *t) {
+    (void)w;
+    station_t *st = station_of_timer(t);
+    switch (st->state) {
+    case STATION_IDLE:
+        if (!stopping)
+            station_connect(st);
+        return;
+    case STATION_CONNECTING:
+        station_fail(st, &counters.connect_failed);
+        return;
+    case STATION_TLS:
+    case STATION_UPGRADE:
+        station_fail(st, &counters.handshake_failed);
+        return;
+    case STATION_OPEN:
+        break;
+    }
+
+    // Closing at the end of the run and the server did not answer
+    if (st->rx.close_sent) {
+        station_reset(st, NULL, 0);
+        return;
+    }
+    uint64_t now = timer_clock_ms();
+    int rc = 0;
+    if (config.heartbeat && st->next_heartbeat_ms <= now) {
+        st->next_heartbeat_ms = now + config.heartbeat * 1000ull;
+        rc = station_call(st, OCPP_ACTION_HEARTBEAT, "{}", 2);
+    }
+    if (rc == 0 && config.meter_values && st->next_meter_ms <= now) {
+        st->next_meter_ms = now + config.meter_values * 1000ull;
+        rc = send_meter_values(st);
+    }
+    if (rc == 0 && st->next_replay_ms && st->next_replay_ms <= now)
+        rc = station_replay(st);
+    if (rc < 0) {
+        station_fail(st, &counters.dropped);
+        return;
+    }
+    station_arm(st);
+}
+
+/* Reports */
+
+static double ms(uint64_t us) {
+    return us / 1000.0;
+}
+
+static void print_latency(const char *name, const histogram_t *h) {
+    printf("  %-9s p50 %8.2f  p99 %8.2f  p99.9 %8.2f  max %8.2f ms  (%llu)\n", name,
+           ms(histogram_percentile(h, 0.50)), ms(histogram_percentile(h, 0.99)),
+           ms(histogram_percentile(h, 0.999)), ms(h->total ? h->max : 0), (unsigned long long)h->total);
+}
+
+static void report(timer_wheel_t *w, wheel_timer_t *t) {
+    (void)t;
+    double elapsed = (timer_clock_ms() - started_ms) / 1000.0;
+    swarm_counters_t *c = &counters, *l = &last_report;
+    uint64_t errors = (c->connect_failed - l->connect_failed) + (c->handshake_failed - l->handshake_failed) +
+                      (c->dropped - l->dropped) + (c->call_errors - l->call_errors) +
+                      (c->call_timeouts - l->call_timeouts);
+    printf("%6.1fs  open %6d  connects +%llu  calls +%llu  errors +%llu\n", elapsed, open_stations,
+           (unsigned long long)(c->connected - l->connected), (unsigned long long)(c->calls - l->calls),
+           (unsigned long long)errors);
+    print_latency("connect", &connect_interval);
+    print_latency("rtt", &rtt_interval);
+    fflush(stdout);
+
+    histogram_add(&connect_total, &connect_interval);
+    histogram_add(&rtt_total, &rtt_interval);
+    histogram_init(&connect_interval);
+    histogram_init(&rtt_interval);
+    last_report = counters;
+    if (config.report && !stopping)
+        timer_arm(w, &report_timer, config.report * 1000);
+}
+
+static double rate(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+static void write_hgrm(const char *suffix, const histogram_t *h) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s-%s.hgrm", config.hgrm, suffix);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    histogram_write_hgrm(h, f, 1000.0);
+    fclose(f);
+}
+
+static void summary(void) {
+    histogram_add(&connect_total, &connect_interval);
+    histogram_add(&rtt_total, &rtt_interval);
+    const swarm_counters_t *c = &counters;
+    printf("\n%d stations, %.1f s\n", config.stations, (timer_clock_ms() - started_ms) / 1000.0);
+    printf("  connects  %llu of %llu attempts (%llu TLS resumed), %llu failed, %llu handshakes failed (%.2f%% errors)\n",
+           (unsigned long long)c->connected, (unsigned long long)c->attempts, (unsigned long long)c->resumed,
+           (unsigned long long)c->connect_failed, (unsigned long long)c->handshake_failed,
+           rate(c->connect_failed + c->handshake_failed, c->attempts));
+    printf("  drops     %llu unexpected, %llu in storms\n",
+           (unsigned long long)c->dropped, (unsigned long long)c->storm_drops);
+    printf("  calls     %llu sent, %llu answered, %llu CALLERROR, %llu timed out, %llu throttled (%.2f%% errors)\n",
+           (unsigned long long)c->calls, (unsigned long long)c->answered, (unsigned long long)c->call_errors,
+           (unsigned long long)c->call_timeouts, (unsigned long long)c->throttled,
+           rate(c->call_errors + c->call_timeouts, c->calls));
+    if (capture.nflows)
+        printf("  replayed  %llu messages other than CALLs as captured\n", (unsigned long long)c->replayed_raw);
+    print_latency("connect", &connect_total);
+    print_latency("rtt", &rtt_total);
+    if (config.hgrm) {
+        write_hgrm("connect", &connect_total);
+        write_hgrm("rtt", &rtt_total);
+    }
+}
+
+/* Run */
+
+// Drop a share of the open stations at once; they all reconnect right away
+static void storm(timer_wheel_t *w, wheel_timer_t *t) {
+    (void)t;
+    uint64_t threshold = (uint64_t)(config.storm_fraction * (double)UINT32_MAX);
+    int dropped = 0;
+    for (int i = 0; i < config.stations; i++) {
+        station_t *st = &stations[i];
+        if (st->state == STATION_OPEN && !st->rx.close_sent && (rng_next() & UINT32_MAX) < threshold) {
+            station_reset(st, &counters.storm_drops, 0);
+            dropped++;
+        }
+    }
+    printf("Storm: dropped %d stations\n", dropped);
+    timer_arm(w, &storm_timer, config.storm_every * 1000);
+}
+
+// Close every station properly; the loop ends when the last one is gone
+static void stop(timer_wheel_t *w, wheel_timer_t *t) {
+    (void)t;
+    stopping = 1;
+    timer_cancel(w, &storm_timer);
+    timer_cancel(w, &report_timer);
+    for (int i = 0; i < config.stations; i++) {
+        station_t *st = &stations[i];
+        if (st->state != STATION_OPEN) {
+            station_reset(st, NULL, 0);
+            continue;
+        }
+        if (!st->rx.close_sent && send_close(st, WS_CLOSE_NORMAL) < 0) {
+            station_reset(st, NULL, 0);
+            continue;
+        }
+        timer_arm(w, &st->timer, SWARM_CLOSE_GRACE_MS);
+    }
+}
+
+static void run(void) {
+    struct epoll_event events[SWARM_MAX_EVENTS];
+    while (!stopping || active > 0) {
+        int timeout = timer_wheel_timeout(&timers, timer_clock_ms());
+        int n = epoll_wait(epfd, events, SWARM_MAX_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            return;
+        }
+        timer_wheel_advance(&timers, timer_clock_ms());
+        for (int i = 0; i < n; i++)
+            station_event(events[i].data.ptr, events[i].events);
+    }
+}
+
+// Read the capture to replay; stations no longer run their own schedule
+static int load_replay(void) {
+    tls_keylog_t keys = { 0 };
+    if (config.keylog && tls_keylog_load(&keys, config.keylog) < 0) {
+        fprintf(stderr, "%s: no TLS 1.3 secrets\n", config.keylog);
+        return -1;
+    }
+    int rc = capture_load(&capture, config.replay, config.keylog ? &keys : NULL);
+    tls_keylog_free(&keys);
+    if (rc < 0) {
+        fprintf(stderr, "%s: %s\n", config.replay, capture.error);
+        return -1;
+    }
+
+    const capture_stats_t *cs = &capture.stats;
+    size_t messages = 0;
+    for (int i = 0; i < capture.nflows; i++)
+        messages += capture.flows[i].count;
+    printf("%s: %llu packets over %.1f s, %llu TCP connections, %llu WebSocket\n", config.replay,
+           (unsigned long long)cs->packets, capture.duration_us / 1e6, (unsigned long long)cs->connections,
+           (unsigned long long)cs->websocket);
+    if (cs->tls_without_keys || cs->tls_unsupported || cs->undecryptable)
+        printf("  TLS: %llu without keys, %llu not 1.3, %llu failed to decrypt\n",
+               (unsigned long long)cs->tls_without_keys, (unsigned long long)cs->tls_unsupported,
+               (unsigned long long)cs->undecryptable);
+    if (cs->gaps || cs->truncated)
+        printf("  %llu bytes missing, %llu packets truncated\n", (unsigned long long)cs->gaps,
+               (unsigned long long)cs->truncated);
+    if (!capture.nflows) {
+        fprintf(stderr, "%s: no WebSocket messages from any client%s\n", config.replay,
+                cs->tls_without_keys && !config.keylog ? " (the TLS ones need --keylog)" : "");
+        return -1;
+    }
+    printf("  replaying %d connections, %zu messages\n", capture.nflows, messages);
+    config.heartbeat = 0;
+    config.meter_values = 0;
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  -n, --stations N        simulated charge points (default: %d)\n", SWARM_DEFAULT_STATIONS);
+    fprintf(stderr, "  -H, --host ADDR         server IPv4 address (default: 127.0.0.1)\n");
+    fprintf(stderr, "  -p, --port N            server port (default: %d)\n", PORT);
+    fprintf(stderr, "      --plain             connect with ws:// instead of wss://\n");
+    fprintf(stderr, "  -r, --ramp N            connects started per second, 0 for all at once (default: %d)\n", SWARM_DEFAULT_RAMP);
+    fprintf(stderr, "  -d, --duration S        length of the run (default: %d)\n", SWARM_DEFAULT_DURATION);
+    fprintf(stderr, "      --heartbeat S       Heartbeat interval, 0 for none (default: %d)\n", SWARM_DEFAULT_HEARTBEAT);
+    fprintf(stderr, "      --meter-values S    MeterValues interval, 0 for none (default: %d)\n", SWARM_DEFAULT_METER_VALUES);
+    fprintf(stderr, "      --reconnect-ms MS   delay before reconnecting after a failure (default: %d)\n", SWARM_DEFAULT_RECONNECT_MS);
+    fprintf(stderr, "      --storm-every S     drop and reconnect a share of the stations every S seconds\n");
+    fprintf(stderr, "      --storm-fraction F  share each storm drops (default: %.1f)\n", SWARM_DEFAULT_STORM_FRACTION);
+    fprintf(stderr, "      --call-timeout S    give up on an answer after S seconds (default: %d)\n", SWARM_DEFAULT_CALL_TIMEOUT);
+    fprintf(stderr, "      --report S          progress line interval, 0 for the summary only (default: %d)\n", SWARM_DEFAULT_REPORT);
+    fprintf(stderr, "      --deflate           offer permessage-deflate\n");
+    fprintf(stderr, "      --ocpp201           speak OCPP 2.0.1 instead of 1.6\n");
+    fprintf(stderr, "      --hgrm PREFIX       write latency distributions to PREFIX-connect.hgrm and PREFIX-rtt.hgrm\n");
+    fprintf(stderr, "      --replay FILE       send what the clients in a pcap capture sent instead of Heartbeats and MeterValues\n");
+    fprintf(stderr, "      --keylog FILE       TLS 1.3 secrets of the captured connections (SSLKEYLOGFILE format)\n");
+    fprintf(stderr, "      --speed X           replay X times as fast as captured, 0 for as fast as answers come back (default: 1)\n");
+}
+
+int main(int argc, char **argv) {
+    static const struct option long_opts[] = {
+        {"stations", required_argument, NULL, 'n'},
+        {"host", required_argument, NULL, 'H'},
+        {"port", required_argument, NULL, 'p'},
+        {"plain", no_argument, NULL, 'P'},
+        {"ramp", required_argument, NULL, 'r'},
+        {"duration", required_argument, NULL, 'd'},
+        {"heartbeat", required_argument, NULL, 'B'},
+        {"meter-values", required_argument, NULL, 'M'},
+        {"reconnect-ms", required_argument, NULL, 'R'},
+        {"storm-every", required_argument, NULL, 'S'},
+        {"storm-fraction", required_argument, NULL, 'F'},
+        {"call-timeout", required_argument, NULL, 'C'},
+        {"report", required_argument, NULL, 'I'},
+        {"deflate", no_argument, NULL, 'Z'},
+        {"ocpp201", no_argument, NULL, 'V'},
+        {"hgrm", required_argument, NULL, 'G'},
+        {"replay", required_argument, NULL, 'X'},
+        {"keylog", required_argument, NULL, 'K'},
+        {"speed", required_argument, NULL, 'E'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:H:p:r:d:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'n': config.stations = atoi(optarg); break;
+        case 'H': config.host = optarg; break;
+        case 'p': config.port = atoi(optarg); break;
+        case 'P': config.plain = 1; break;
+        case 'r': config.ramp = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'd': config.duration = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'B': config.heartbeat = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'M': config.meter_values = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'R': config.reconnect_ms = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'S': config.storm_every = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'F': config.storm_fraction = atof(optarg); break;
+        case 'C': config.call_timeout = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'I': config.report = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 'Z': config.deflate = 1; break;
+        case 'V': config.ocpp201 = 1; break;
+        case 'G': config.hgrm = optarg; break;
+        case 'X': config.replay = optarg; break;
+        case 'K': config.keylog = optarg; break;
+        case 'E': config.speed = atof(optarg); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (config.stations < 1 || config.stations > 99999 || config.duration == 0 ||
+        config.storm_fraction < 0 || config.storm_fraction > 1 || config.speed < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (config.replay && load_replay() < 0)
+        return EXIT_FAILURE;
+    server_addr = (struct sockaddr_in){ .sin_family = AF_INET, .sin_port = htons(config.port) };
+    if (inet_pton(AF_INET, config.host, &server_addr.sin_addr) <= 0) {
+        fprintf(stderr, "Invalid address %s\n", config.host);
+        return EXIT_FAILURE;
+    }
+
+    // Every station is a socket
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0) {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
+        if (nofile.rlim_cur < (rlim_t)config.stations + 16)
+            fprintf(stderr, "Only %llu file descriptors: not every station can connect\n",
+                    (unsigned long long)nofile.rlim_cur);
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (!config.plain) {
+        ssl_ctx = SSL_CTX_new(TLS_client_method());
+        if (!ssl_ctx) {
+            perror("Unable to create SSL context");
+            return EXIT_FAILURE;
+        }
+        SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_NONE, NULL);
+        SSL_CTX_set_mode(ssl_ctx, SSL_MODE_RELEASE_BUFFERS);
+        SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ssl_ctx, save_session);
+    }
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    stations = calloc((size_t)config.stations, sizeof(*stations));
+    if (epfd < 0 || !stations) {
+        perror("Unable to set up");
+        return EXIT_FAILURE;
+    }
+    ocpp_router_init(&router);
+    histogram_init(&connect_interval);
+    histogram_init(&rtt_interval);
+    histogram_init(&connect_total);
+    histogram_init(&rtt_total);
+    rng_state ^= (uint64_t)getpid() << 32 ^ clock_us();
+
+    started_ms = timer_clock_ms();
+    timer_wheel_init(&timers, started_ms);
+    for (int i = 0; i < config.stations; i++) {
+        station_t *st = &stations[i];
+        st->index = (uint32_t)i + 1;
+        st->fd = -1;
+        timer_init(&st->timer, station_timer);
+        timer_arm(&timers, &st->timer, config.ramp ? (uint64_t)i * 1000 / config.ramp : 0);
+    }
+    timer_init(&report_timer, report);
+    timer_init(&storm_timer, storm);
+    timer_init(&stop_timer, stop);
+    if (config.report)
+        timer_arm(&timers, &report_timer, config.report * 1000);
+    if (config.storm_every)
+        timer_arm(&timers, &storm_timer, config.storm_every * 1000);
+    timer_arm(&timers, &stop_timer, config.duration * 1000ull);
+
+    printf("%d stations to %s:%d (%s), %u per second, for %u s\n", config.stations, config.host,
+           config.port, config.plain ? "ws" : "wss", config.ramp, config.duration);
+    run();
+    summary();
+
+    for (int i = 0; i < config.stations; i++)
+        SSL_SESSION_free(stations[i].session);
+    free(stations);
+    capture_free(&capture);
+    close(epfd);
+    SSL_CTX_free(ssl_ctx);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#ifndef SWARM_H
+#define SWARM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "WebSocketFrame.h"
+#include "BufferPool.h"
+#include "HttpParser.h"
+#include "HandshakeCrypto.h"
+#include "TLSEngine.h"
+#include "Deflate.h"
+#include "Histogram.h"
+#include "Capture.h"
+#include "TimerWheel.h"
+#include "OcppJ.h"
+#include "OcppMessages.h"
+
+#define PORT 12345
+#define SWARM_STATION_PREFIX          "SIM"   // station ids are the prefix and a number
+#define SWARM_DEFAULT_STATIONS        1000
+#define SWARM_DEFAULT_RAMP            200     // connects started per second
+#define SWARM_DEFAULT_HEARTBEAT       60      // seconds between Heartbeats
+#define SWARM_DEFAULT_METER_VALUES    10      // seconds between MeterValues
+#define SWARM_DEFAULT_DURATION        60
+#define SWARM_DEFAULT_REPORT          5
+#define SWARM_DEFAULT_RECONNECT_MS    1000    // after a failure, with jitter
+#define SWARM_DEFAULT_STORM_FRACTION  0.2
+#define SWARM_DEFAULT_CALL_TIMEOUT    30
+#define SWARM_DEFAULT_SPEED           1.0     // replays at the captured pace
+#define SWARM_CONNECT_TIMEOUT_MS      10000   // TCP, TLS and upgrade together
+#define SWARM_CLOSE_GRACE_MS          3000    // for close handshakes at the end of a run
+#define SWARM_MAX_EVENTS              256
+
+typedef struct {
+    const char *host;           // IPv4 address of the server
+    int port;
+    int plain;                  // ws:// instead of wss://
+    int stations;
+    unsigned ramp;              // connects started per second, 0 = all at once
+    unsigned heartbeat;         // seconds, 0 = never
+    unsigned meter_values;      // seconds, 0 = never
+    unsigned duration;          // seconds the run lasts
+    unsigned report;            // seconds between progress lines, 0 = only the summary
+    unsigned reconnect_ms;
+    unsigned storm_every;       // seconds between reconnect storms, 0 = none
+    double storm_fraction;      // share of the open stations each storm drops
+    unsigned call_timeout;      // seconds
+    int deflate;                // offer permessage-deflate
+    int ocpp201;                // offer OCPP 2.0.1 instead of 1.6
+    const char *hgrm;           // write full distributions to <hgrm>-connect.hgrm and -rtt.hgrm
+    const char *replay;         // pcap file: stations send what its clients sent instead
+    const char *keylog;         // secrets of its TLS connections
+    double speed;               // replay pace, 2 = twice as fast, 0 = as fast as answers come back
+} swarm_config_t;
+
+typedef enum {
+    STATION_IDLE,               // waiting for its (re)connect time
+    STATION_CONNECTING,
+    STATION_TLS,
+    STATION_UPGRADE,            // request sent, waiting for the 101
+    STATION_OPEN
+} station_state_t;
+
+// One simulated charge point. Its timer is the next thing it has to do:
+// connect, give up on connecting, or send whichever CALL is due. Replaying,
+// station n plays captured connection n modulo their number, over and over.
+typedef struct {
+    wheel_timer_t timer;
+    int fd;
+    uint32_t index;
+    uint8_t state;              // station_state_t
+    uint8_t ending;             // its session is being torn down, unanswered CALLs are not timeouts
+    tls_engine_t tls;
+    SSL_SESSION *session;       // the newest one the server gave it, for resuming
+    uint64_t connect_started_us;
+    uint64_t next_heartbeat_ms;
+    uint64_t next_meter_ms;
+    uint32_t energy_wh;         // the meter reading it reports
+    uint32_t replay_next;       // next captured message
+    uint64_t replay_started_ms; // when the capture's first message went out this round
+    uint64_t next_replay_ms;    // when the next one is due, 0 if it waits for an answer
+    char key[WS_KEY_LEN + 1];
+    uint8_t *backlog;           // framed output the socket has not taken yet
+    size_t backlog_len;
+    ws_decoder_t rx;
+    ws_deflate_t deflate;
+    union {
+        http_parser_t http;     // the 101, until the upgrade completes
+        ocpp_session_t ocpp;    // afterwards
+    };
+} station_t;
+
+// Totals since the start; each report shows the difference to the last one
+typedef struct {
+    uint64_t attempts;
+    uint64_t connected;
+    uint64_t resumed;           // TLS session resumed
+    uint64_t connect_failed;    // TCP refused or timed out
+    uint64_t handshake_failed;  // TLS or HTTP upgrade rejected or timed out
+    uint64_t dropped;           // lost while open: closed by the server or the network
+    uint64_t storm_drops;
+    uint64_t calls;
+    uint64_t answered;
+    uint64_t call_errors;       // CALLERROR
+    uint64_t call_timeouts;
+    uint64_t throttled;         // not sent: too many CALLs outstanding
+    uint64_t replayed_raw;      // captured messages other than CALLs, sent as they were
+} swarm_counters_t;
+
+#endif
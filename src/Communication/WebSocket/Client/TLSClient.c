@@ -1,109 +1,337 @@
 
-#include "TLSClient.h"
-
-static const int mod_table[] = {0, 2, 1};
-
-// Helper function to Base64 encode data
-char *base64_encode(const unsigned char *input, int length) {
-    static const char encoding_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    char *encoded_data = malloc(((length + 2) / 3) * 4 + 1);
-    if (!encoded_data) return NULL;
-
-    int i, j;
-    for (i = 0, j = 0; i < length;) {
-        uint32_t octet_a = i < length ? (unsigned char)input[i++] : 0;
-        uint32_t octet_b = i < length ? (unsigned char)input[i++] : 0;
-        uint32_t octet_c = i < length ? (unsigned char)input[i++] : 0;
 
-        uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
+#include "TLSClient.h"
 
-        encoded_data[j++] = encoding_table[(triple >> 18) & 0x3F];
-        encoded_data[j++] = encoding_table[(triple >> 12) & 0x3F];
-        encoded_data[j++] = encoding_table[(triple >> 6) & 0x3F];
-        encoded_data[j++] = encoding_table[triple & 0x3F];
+// Encrypt all of data and send the records, blocking until they are out
+static int client_write(client_t *client, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len > 0) {
+        int n = tls_engine_write(&client->tls, p, len);
+        if (n < 0) return -1;
+        if (n == 0) {
+            // The engine is full: drain it to the socket and retry the same bytes
+            if (tls_engine_send_fd(&client->tls, client->fd) <= 0) return -1;
+            continue;
+        }
+        p += n;
+        len -= (size_t)n;
     }
-
-    for (int k = 0; k < mod_table[length % 3]; k++)
-        encoded_data[--j] = '=';
-
-    encoded_data[j] = '\0';
-    return encoded_data;
+    return tls_engine_send_fd(&client->tls, client->fd) < 0 ? -1 : 0;
 }
 
-// Generate a Sec-WebSocket-Key
-void generate_websocket_key(char *key, size_t len) {
-    srand((unsigned int)time(NULL));
-    for (size_t i = 0; i < len - 1; ++i) {
-        key[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"[rand() % 62];
-    }
-    key[len - 1] = '\0';
+// Blocking read of whatever plaintext is available; -1 on EOF or error
+static int client_read(client_t *client, void *buf, size_t len) {
+    int n = tls_engine_read_fd(&client->tls, client->fd, buf, len);
+    return n > 0 ? n : -1;
 }
 
+// Offered to the server: compression both ways with context takeover, and
+// the server may pick our window
+static const ws_deflate_params_t deflate_offer = {
+    .enabled = 1,
+    .server_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+    .client_max_window_bits = WS_DEFLATE_MAX_WINDOW,
+    .client_max_window_bits_offered = 1
+};
+
 // Send WebSocket Handshake Request
-void send_handshake_request(SSL *ssl) {
-    char sec_websocket_key[25];
-    generate_websocket_key(sec_websocket_key, sizeof(sec_websocket_key));
+int send_handshake_request(client_t *client, char key[WS_KEY_LEN + 1]) {
+    if (ws_generate_key(key) < 0) return -1;
 
-    char request[BUFFER_SIZE];
+    char request[BUFFER_SIZE], extension[WS_DEFLATE_PARAMS_SIZE];
+    ws_deflate_format(&deflate_offer, 0, extension, sizeof(extension));
     snprintf(request, sizeof(request),
-             "GET / HTTP/1.1\r\n"
+             "GET /%s HTTP/1.1\r\n"
              "Host: localhost:%d\r\n"
              "Upgrade: websocket\r\n"
              "Connection: Upgrade\r\n"
              "Sec-WebSocket-Key: %s\r\n"
              "Sec-WebSocket-Version: 13\r\n"
+             "Sec-WebSocket-Protocol: ocpp2.0.1, ocpp1.6\r\n"
+             "Sec-WebSocket-Extensions: %s\r\n"
              "\r\n",
-             PORT, sec_websocket_key);
+             STATION_ID, PORT, key, extension);
 
-    SSL_write(ssl, request, strlen(request));
+    return client_write(client, request, strlen(request));
 }
 
-// Process WebSocket Handshake Response
-int process_handshake_response(SSL *ssl) {
+// Process WebSocket Handshake Response: 101 with the accept value our key
+// implies, and no extension we did not offer. version gets the OCPP version
+// the server picked; client->deflate is set up as it settled. Frames the
+// server sent right behind the head are handed to rx.
+int process_handshake_response(client_t *client, const char *key, ws_decoder_t *rx, ocpp_version_t *version) {
     char buffer[BUFFER_SIZE];
-    SSL_read(ssl, buffer, sizeof(buffer));
-    if (strstr(buffer, "Sec-WebSocket-Accept")) {
-        printf("Handshake successful:\n%s\n", buffer);
+    size_t len = 0;
+    http_parser_t p;
+    http_parser_init(&p, 1, sizeof(buffer) - 1);
+
+    int rc = 0;
+    while (rc == 0) {
+        int n = client_read(client, buffer + len, sizeof(buffer) - 1 - len);
+        if (n <= 0) break;
+        len += (size_t)n;
+        rc = http_parse(&p, buffer, len);
+    }
+    buffer[len] = '\0';
+
+    char expected[WS_ACCEPT_LEN + 1];
+    ws_accept_key(key, expected);
+    const http_header_t *accept = rc == 1 ? http_header(&p, HTTP_HDR_SEC_WEBSOCKET_ACCEPT) : NULL;
+    if (p.status == 101 && accept && accept->value.len == WS_ACCEPT_LEN &&
+        memcmp(buffer + accept->value.off, expected, WS_ACCEPT_LEN) == 0) {
+        ws_deflate_params_t deflate = { 0 };
+        const http_header_t *extensions = http_header(&p, HTTP_HDR_SEC_WEBSOCKET_EXTENSIONS);
+        if (extensions && ws_deflate_parse_response(buffer + extensions->value.off, extensions->value.len,
+                                                    &deflate_offer, &deflate) < 0) {
+            LOG_ERROR("Handshake failed, unexpected extension:\n%s", LOG_SPAN(buffer, p.length));
+            return 0;
+        }
+        ws_deflate_init(&client->deflate, &deflate, 0);
+        rx->deflate = deflate.enabled;
+
+        for (size_t off = p.length; off < len; ) {
+            size_t avail;
+            uint8_t *dst = ws_decoder_write_ptr(rx, &avail);
+            if (!dst) return 0;
+            size_t n = len - off < avail ? len - off : avail;
+            memcpy(dst, buffer + off, n);
+            ws_decoder_commit(rx, n);
+            off += n;
+        }
+
+        const http_header_t *protocol = http_header(&p, HTTP_HDR_SEC_WEBSOCKET_PROTOCOL);
+        char subprotocol[16] = "";
+        if (protocol && protocol->value.len < sizeof(subprotocol))
+            memcpy(subprotocol, buffer + protocol->value.off, protocol->value.len);
+        *version = ocpp_version_from_subprotocol(subprotocol);
+        LOG_INFO("Handshake successful (%s)", subprotocol[0] ? subprotocol : "no subprotocol");
+        LOG_DEBUG("Handshake response:\n%s", LOG_SPAN(buffer, p.length));
         return 1;
     }
-    printf("Handshake failed:\n%s\n", buffer);
+    LOG_ERROR("Handshake failed:\n%s", buffer);
     return 0;
 }
 
-// WebSocket Frame Helpers
-void send_frame(SSL *ssl, const char *message) {
-    size_t len = strlen(message);
-    unsigned char frame[BUFFER_SIZE] = {0};
-    frame[0] = 0x81;  // FIN=1, opcode=1 (text frame)
-    frame[1] = len;   // Assuming payload length < 126
-    memcpy(frame + 2, message, len);
-    SSL_write(ssl, frame, len + 2);
+// A compressed message: the deflater leaves room in front of the payload,
+// the header is written right before it
+static int send_deflated(client_t *client, uint8_t *buf, size_t len, const uint8_t mask[4]) {
+    uint8_t header[WS_MAX_HEADER_SIZE];
+    size_t header_len = ws_build_frame_header(header, WS_OPCODE_TEXT | WS_RSV1, 1, len, mask);
+    uint8_t *frame = buf + WS_MAX_HEADER_SIZE - header_len;
+    memcpy(frame, header, header_len);
+    ws_mask(buf + WS_MAX_HEADER_SIZE, len, mask, 0);
+
+    int rc = client_write(client, frame, header_len + len);
+    buf_pool_put(buf);
+    return rc;
 }
 
-void receive_frame(SSL *ssl, char *buffer) {
-    unsigned char frame[BUFFER_SIZE] = {0};
-    SSL_read(ssl, frame, BUFFER_SIZE);
-    size_t len = frame[1] & 0x7F;  // Get payload length
-    memcpy(buffer, frame + 2, len);
-    buffer[len] = '\0';
+// WebSocket Frame Helpers: the pieces are gathered straight into one masked
+// text frame in a pooled buffer
+static int send_frame_iov(client_t *client, const struct iovec *iov, int iovcnt) {
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++)
+        len += iov[i].iov_len;
+    uint8_t mask[4];
+    if (RAND_bytes(mask, sizeof(mask)) != 1) return -1;
+
+    if (client->deflate.params.enabled) {
+        uint8_t *packed;
+        size_t packed_len;
+        int rc = ws_deflate_message(&client->deflate, iov, iovcnt, WS_MAX_HEADER_SIZE, &packed, &packed_len);
+        if (rc < 0) return -1;
+        if (rc > 0) return send_deflated(client, packed, packed_len, mask);
+    }
+
+    unsigned char *frame = buf_pool_get(WS_MAX_HEADER_SIZE + len);
+    if (!frame) return -1;
+    size_t header_len = ws_build_frame_header(frame, WS_OPCODE_TEXT, 1, len, mask);
+    size_t off = header_len;
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(frame + off, iov[i].iov_base, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+    ws_mask(frame + header_len, len, mask, 0);  // clients must mask every frame
+
+    int rc = client_write(client, frame, off);
+    buf_pool_put(frame);
+    return rc;
+}
+
+int send_frame(client_t *client, const char *message) {
+    struct iovec iov = { (void *)message, strlen(message) };
+    return send_frame_iov(client, &iov, 1);
+}
+
+// OCPP-J transport: one text frame per message
+static int send_ocpp(void *transport, const struct iovec *iov, int iovcnt) {
+    return send_frame_iov(transport, iov, iovcnt);
+}
+
+static void on_boot_reply(ocpp_session_t *s, const ocpp_message_t *reply, void *opaque) {
+    (void)opaque;
+    if (!reply) {
+        LOG_WARN("BootNotification got no answer");
+        return;
+    }
+    if (reply->type == OCPP_CALLERROR) {
+        LOG_WARN("BootNotification failed: %s (%s)", LOG_SPAN(reply->error_code.ptr, reply->error_code.len),
+                 LOG_SPAN(reply->error_description.ptr, reply->error_description.len));
+        return;
+    }
+
+    ocpp_json_t j;
+    ocpp_json_init(&j, reply->payload.ptr, reply->payload.len, NULL, 0);
+    const char *status;
+    int interval;
+    if (s->version == OCPP_V201) {
+        ocpp201_boot_notification_response_t resp;
+        if (ocpp201_boot_notification_response_parse(&j, &resp) < 0)
+            goto invalid;
+        status = ocpp201_registration_status_name(resp.status);
+        interval = resp.interval;
+    } else {
+        ocpp16_boot_notification_response_t resp;
+        if (ocpp16_boot_notification_response_parse(&j, &resp) < 0)
+            goto invalid;
+        status = ocpp16_boot_notification_status_name(resp.status);
+        interval = resp.interval;
+    }
+    LOG_INFO("BootNotification answered: %s, heartbeat every %d s", status, interval);
+    return;
+
+invalid:
+    LOG_WARN("BootNotification answer is invalid: %s (%s)", ocpp_json_error_code(j.error, s->version), j.what);
+}
+
+// The BootNotification payload for the negotiated version. Returns its length or -1.
+static int build_boot_notification(ocpp_version_t version, char *buf, size_t size) {
+    ocpp_writer_t w;
+    ocpp_writer_init(&w, buf, size);
+    if (version == OCPP_V201) {
+        ocpp201_boot_notification_request_t boot = {
+            .charging_station = {
+                .model = OCPP_STR("ModelX"),
+                .vendor_name = OCPP_STR("VendorY"),
+                .has_firmware_version = true,
+                .firmware_version = OCPP_STR("1.0.0")
+            },
+            .reason = OCPP201_BOOT_REASON_POWER_UP
+        };
+        ocpp201_boot_notification_request_write(&w, &boot);
+    } else {
+        ocpp16_boot_notification_request_t boot = {
+            .charge_point_vendor = OCPP_STR("VendorY"),
+            .charge_point_model = OCPP_STR("ModelX"),
+            .has_firmware_version = true,
+            .firmware_version = OCPP_STR("1.0.0")
+        };
+        ocpp16_boot_notification_request_write(&w, &boot);
+    }
+    return ocpp_writer_status(&w) < 0 ? -1 : (int)w.len;
+}
+
+// Send a Close frame carrying a status code, starting the close handshake
+int send_close(client_t *client, ws_decoder_t *rx, uint16_t code) {
+    uint8_t mask[4], frame[WS_MAX_CONTROL_FRAME];
+    if (RAND_bytes(mask, sizeof(mask)) != 1) return -1;
+    return client_write(client, frame, ws_build_close(rx, code, mask, frame));
+}
+
+// Block until a complete data message arrives, answering pings and closes
+// on the way. Returns its length and points text at it, valid until the next
+// call; -1 once the connection is closed.
+int receive_frame(client_t *client, ws_decoder_t *rx, const char **text) {
+    ws_message_t msg;
+
+    for (;;) {
+        int rc = ws_decoder_next(rx, &msg);
+        if (rc < 0) {
+            send_close(client, rx, rx->close_code);
+            return -1;
+        }
+        if (rc > 0) {
+            if (WS_IS_CONTROL(msg.opcode)) {
+                uint8_t mask[4], reply[WS_MAX_CONTROL_FRAME];
+                size_t reply_len;
+                if (RAND_bytes(mask, sizeof(mask)) != 1) return -1;
+                int closed = ws_control_frame(rx, &msg, mask, reply, &reply_len);
+                if (reply_len && client_write(client, reply, reply_len) < 0) return -1;
+                if (closed) return -1;
+                continue;
+            }
+            // Until the server answers our close, its messages are dropped
+            if (rx->close_sent) continue;
+
+            const uint8_t *payload = msg.payload;
+            size_t len = msg.len;
+            if (msg.compressed &&
+                ws_inflate_message(&client->deflate, msg.payload, msg.len, rx->max_message, &payload, &len) < 0) {
+                send_close(client, rx, client->deflate.close_code);
+                return -1;
+            }
+            if (msg.compressed && msg.opcode == WS_OPCODE_TEXT && !ws_utf8_valid(payload, len)) {
+                send_close(client, rx, WS_CLOSE_INVALID_DATA);
+                return -1;
+            }
+            *text = (const char *)payload;
+            return (int)len;
+        }
+
+        size_t avail;
+        uint8_t *dst = ws_decoder_write_ptr(rx, &avail);
+        if (!dst) return -1;
+        int n = client_read(client, dst, avail);
+        if (n <= 0) return -1;
+        ws_decoder_commit(rx, (size_t)n);
+    }
 }
 
 // Main Client Logic
+// Keep the newest session so the next connection can resume it. TLS 1.3
+// tickets arrive after the handshake, so they are saved as they come in.
+static int save_session(SSL *ssl, SSL_SESSION *sess) {
+    (void)ssl;
+    int fd = open(SESSION_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0600);  // holds a resumption secret
+    FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!f) {
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    PEM_write_SSL_SESSION(f, sess);
+    fclose(f);
+    return 0;
+}
+
+static void load_session(SSL *ssl) {
+    FILE *f = fopen(SESSION_FILE, "r");
+    if (!f) return;
+    SSL_SESSION *sess = PEM_read_SSL_SESSION(f, NULL, NULL, NULL);
+    fclose(f);
+    if (!sess) return;
+    if (SSL_SESSION_is_resumable(sess))
+        SSL_set_session(ssl, sess);
+    SSL_SESSION_free(sess);
+}
+
 void websocket_client() {
     SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
     if (!ctx) {
         perror("Unable to create SSL context");
         exit(EXIT_FAILURE);
     }
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, save_session);
 
-    SSL *ssl = SSL_new(ctx);
-    if (!ssl) {
+    client_t client = { 0 };
+    if (tls_engine_init(&client.tls, ctx, 0, -1) < 0) {
         perror("Unable to create SSL object");
         exit(EXIT_FAILURE);
     }
+    load_session(client.tls.ssl);
 
-    int client_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_fd < 0) {
+    client.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (client.fd < 0) {
         perror("Unable to create socket");
         exit(EXIT_FAILURE);
     }
@@ -118,49 +346,69 @@ void websocket_client() {
         exit(EXIT_FAILURE);
     }
 
-    if (connect(client_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+    if (connect(client.fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
         perror("Unable to connect");
         exit(EXIT_FAILURE);
     }
 
-    SSL_set_fd(ssl, client_fd);
-
-    if (SSL_connect(ssl) <= 0) {
+    if (tls_engine_handshake_fd(&client.tls, client.fd) <= 0) {
         ERR_print_errors_fp(stderr);
     } else {
-        printf("Connected to server via TLS\n");
+        LOG_INFO("Connected to server via TLS (%s)",
+                 SSL_session_reused(client.tls.ssl) ? "resumed session" : "full handshake");
 
-        send_handshake_request(ssl);
-        if (process_handshake_response(ssl)) {
-            cJSON *request_json = cJSON_CreateObject();
-            cJSON_AddStringToObject(request_json, "chargePointModel", "ModelX");
-            cJSON_AddStringToObject(request_json, "chargePointVendor", "VendorY");
-            cJSON_AddStringToObject(request_json, "firmwareVersion", "1.0.0");
-            const char *request = cJSON_PrintUnformatted(request_json);
+        char key[WS_KEY_LEN + 1];
+        ocpp_version_t version;
+        ws_decoder_t rx;
+        ws_decoder_init(&rx, 0, WS_DEFAULT_MAX_MESSAGE);
+        if (send_handshake_request(&client, key) == 0 && process_handshake_response(&client, key, &rx, &version)) {
+            // A station answers no CALLs yet, it only makes them
+            ocpp_router_t router;
+            ocpp_router_init(&router);
+            ocpp_session_t ocpp;
+            ocpp_session_init(&ocpp, &router, version, send_ocpp, &client);
 
-            printf("%s",request);
-
-            send_frame(ssl, request);
-            cJSON_Delete(request_json);
-
-            char buffer[BUFFER_SIZE];
-            receive_frame(ssl, buffer);
-            printf("Received: %s\n", buffer);
+            char request[256];
+            const char *text;
+            int len = build_boot_notification(version, request, sizeof(request));
+            if (len >= 0 && ocpp_call(&ocpp, OCPP_ACTION_BOOT_NOTIFICATION, request, (size_t)len,
+                                      on_boot_reply, NULL) == 0) {
+                int n;
+                while (ocpp.npending > 0 && (n = receive_frame(&client, &rx, &text)) >= 0) {
+                    LOG_DEBUG("Received: %s", LOG_SPAN(text, n));
+                    ocpp_session_dispatch(&ocpp, text, (size_t)n);
+                }
+            }
+            // Close handshake: the server answers our close, then drops the connection
+            if (!rx.close_sent && send_close(&client, &rx, WS_CLOSE_NORMAL) == 0)
+                while (receive_frame(&client, &rx, &text) >= 0)
+                    ;
+            ocpp_session_free(&ocpp);
         }
+        ws_decoder_free(&rx);
+        ws_deflate_free(&client.deflate);
     }
 
-    SSL_shutdown(ssl);
-    SSL_free(ssl);
-    close(client_fd);
+    tls_engine_shutdown(&client.tls);
+    tls_engine_send_fd(&client.tls, client.fd);
+    tls_engine_free(&client.tls);
+    close(client.fd);
     SSL_CTX_free(ctx);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // -v: every message received, and the server's handshake response
+    if (argc > 1 && strcmp(argv[1], "-v") == 0)
+        log_set_level(LOG_LEVEL_DEBUG);
+    if (log_start() < 0)
+        perror("Unable to start the log thread, logging synchronously");
+
     SSL_library_init();
     OpenSSL_add_all_algorithms();
     SSL_load_error_strings();
 
     websocket_client();
 
+    log_stop();
     return EXIT_SUCCESS;
 }
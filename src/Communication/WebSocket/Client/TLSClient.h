@@ -4,22 +4,42 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
-#include <openssl/sha.h>
-#include <cjson/cJSON.h>
+#include <openssl/rand.h>
+#include <openssl/pem.h>
+
+#include "WebSocketFrame.h"
+#include "BufferPool.h"
+#include "HttpParser.h"
+#include "HandshakeCrypto.h"
+#include "TLSEngine.h"
+#include "Deflate.h"
+#include "OcppJ.h"
+#include "OcppMessages.h"
+#include "Log.h"
 
 #define PORT 12345
 #define BUFFER_SIZE 1024
-#define WEBSOCKET_MAGIC_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define SESSION_FILE "client_session.pem"  // TLS session reused across runs
+#define STATION_ID "CP001"  // the server takes the last path segment as the charge point identity
+
+// A blocking connection; TLS runs through the engine's memory BIOs
+typedef struct {
+    int fd;
+    tls_engine_t tls;
+    ws_deflate_t deflate;   // permessage-deflate, if the server took our offer
+} client_t;
 
 // WebSocket helper functions
-void send_handshake_request(SSL *ssl);
-int process_handshake_response(SSL *ssl);
-void send_frame(SSL *ssl, const char *message);
-void receive_frame(SSL *ssl, char *buffer);
-char *base64_encode(const unsigned char *input, int length);
+int send_handshake_request(client_t *client, char key[WS_KEY_LEN + 1]);
+int process_handshake_response(client_t *client, const char *key, ws_decoder_t *rx, ocpp_version_t *version);
+int send_frame(client_t *client, const char *message);
+int send_close(client_t *client, ws_decoder_t *rx, uint16_t code);
+int receive_frame(client_t *client, ws_decoder_t *rx, const char **text);
 
 #endif
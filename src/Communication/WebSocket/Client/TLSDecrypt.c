@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/hmac.h>
+
+#include "TLSDecrypt.h"
+
+/* Key log */
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode the hex word at *s into out, moving *s past it. Returns the bytes
+// written or -1 if the word is not hex or longer than max.
+static int hex_word(const char **s, uint8_t *out, size_t max) {
+    const char *p = *s;
+    while (*p == ' ' || *p == '\t') p++;
+    size_t n = 0;
+    for (;;) {
+        int hi = hex_value(p[0]);
+        if (hi < 0)
+            break;
+        int lo = hex_value(p[1]);
+        if (lo < 0 || n == max)
+            return -1;
+        out[n++] = (uint8_t)(hi << 4 | lo);
+        p += 2;
+    }
+    *s = p;
+    return (int)n;
+}
+
+static const char *const secret_labels[TLS_SECRET_COUNT] = {
+    [TLS_SECRET_CLIENT_HANDSHAKE] = "CLIENT_HANDSHAKE_TRAFFIC_SECRET",
+    [TLS_SECRET_SERVER_HANDSHAKE] = "SERVER_HANDSHAKE_TRAFFIC_SECRET",
+    [TLS_SECRET_CLIENT_TRAFFIC] = "CLIENT_TRAFFIC_SECRET_0",
+    [TLS_SECRET_SERVER_TRAFFIC] = "SERVER_TRAFFIC_SECRET_0",
+};
+
+static tls_keylog_entry_t *keylog_entry(tls_keylog_t *k, const uint8_t random[TLS_RANDOM_LEN]) {
+    tls_keylog_entry_t *e = (tls_keylog_entry_t *)tls_keylog_find(k, random);
+    if (e)
+        return e;
+    if (k->count == k->cap) {
+        size_t cap = k->cap ? k->cap * 2 : 64;
+        tls_keylog_entry_t *bigger = realloc(k->entries, cap * sizeof(*bigger));
+        if (!bigger)
+            return NULL;
+        k->entries = bigger;
+        k->cap = cap;
+    }
+    e = &k->entries[k->count++];
+    memset(e, 0, sizeof(*e));
+    memcpy(e->random, random, TLS_RANDOM_LEN);
+    return e;
+}
+
+int tls_keylog_load(tls_keylog_t *k, const char *path) {
+    *k = (tls_keylog_t){ 0 };
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        int which = -1;
+        size_t label_len = 0;
+        for (int i = 0; i < TLS_SECRET_COUNT; i++) {
+            label_len = strlen(secret_labels[i]);
+            if (strncmp(line, secret_labels[i], label_len) == 0 && line[label_len] == ' ') {
+                which = i;
+                break;
+            }
+        }
+        if (which < 0)
+            continue;
+
+        const char *p = line + label_len;
+        uint8_t random[TLS_RANDOM_LEN], secret[TLS_SECRET_MAX];
+        if (hex_word(&p, random, sizeof(random)) != TLS_RANDOM_LEN)
+            continue;
+        int len = hex_word(&p, secret, sizeof(secret));
+        if (len <= 0)
+            continue;
+        tls_keylog_entry_t *e = keylog_entry(k, random);
+        if (!e) {
+            fclose(f);
+            tls_keylog_free(k);
+            return -1;
+        }
+        memcpy(e->secret[which], secret, (size_t)len);
+        e->secret_len[which] = (uint8_t)len;
+    }
+    fclose(f);
+    return k->count ? 0 : -1;
+}
+
+void tls_keylog_free(tls_keylog_t *k) {
+    free(k->entries);
+    *k = (tls_keylog_t){ 0 };
+}
+
+const tls_keylog_entry_t *tls_keylog_find(const tls_keylog_t *k, const uint8_t random[TLS_RANDOM_LEN]) {
+    // Newest first: a reconnecting client is looked up soon after it logged
+    for (size_t i = k->count; i-- > 0;) {
+        if (memcmp(k->entries[i].random, random, TLS_RANDOM_LEN) == 0)
+            return &k->entries[i];
+    }
+    return NULL;
+}
+
+/* Record protection (RFC 8446 section 5.2 and 7) */
+
+// HKDF-Expand-Label(secret, label, "", len)
+static int expand_label(const EVP_MD *md, const uint8_t *secret, size_t secret_len, const char *label,
+                        uint8_t *out, size_t len) {
+    uint8_t info[64];
+    size_t label_len = strlen(label), n = 0;
+    info[n++] = (uint8_t)(len >> 8);
+    info[n++] = (uint8_t)len;
+    info[n++] = (uint8_t)(6 + label_len);
+    memcpy(info + n, "tls13 ", 6);
+    n += 6;
+    memcpy(info + n, label, label_len);
+    n += label_len;
+    info[n++] = 0;  // empty context
+
+    // HKDF-Expand: T(i) = HMAC(secret, T(i-1) | info | i)
+    uint8_t t[EVP_MAX_MD_SIZE], block[EVP_MAX_MD_SIZE + sizeof(info) + 1];
+    size_t t_len = 0, done = 0;
+    for (uint8_t i = 1; done < len; i++) {
+        memcpy(block, t, t_len);
+        memcpy(block + t_len, info, n);
+        block[t_len + n] = i;
+        unsigned int md_len;
+        if (!HMAC(md, secret, (int)secret_len, block, t_len + n + 1, t, &md_len))
+            return -1;
+        t_len = md_len;
+        size_t take = len - done < t_len ? len - done : t_len;
+        memcpy(out + done, t, take);
+        done += take;
+    }
+    return 0;
+}
+
+// Key and IV for the secret in use, sequence numbers starting over
+static int use_secret(tls_decrypt_t *d, const uint8_t *secret) {
+    memcpy(d->secret, secret, d->secret_len);
+    d->seq = 0;
+    return expand_label(d->md, d->secret, d->secret_len, "key", d->key, (size_t)EVP_CIPHER_key_length(d->cipher)) < 0 ||
+           expand_label(d->md, d->secret, d->secret_len, "iv", d->iv, sizeof(d->iv)) < 0 ? -1 : 0;
+}
+
+int tls_decrypt_init(tls_decrypt_t *d, uint16_t suite, const uint8_t *handshake_secret,
+                     const uint8_t *traffic_secret, size_t secret_len) {
+    memset(d, 0, sizeof(*d));
+    switch (suite) {
+    case 0x1301: d->cipher = EVP_aes_128_gcm(); d->md = EVP_sha256(); break;
+    case 0x1302: d->cipher = EVP_aes_256_gcm(); d->md = EVP_sha384(); break;
+    case 0x1303: d->cipher = EVP_chacha20_poly1305(); d->md = EVP_sha256(); break;
+    default: return -1;
+    }
+    if (secret_len != (size_t)EVP_MD_size(d->md))
+        return -1;
+    d->secret_len = (uint8_t)secret_len;
+    d->ctx = EVP_CIPHER_CTX_new();
+    if (!d->ctx)
+        return -1;
+    memcpy(d->next, traffic_secret, secret_len);
+    d->handshake = 1;
+    return use_secret(d, handshake_secret);
+}
+
+void tls_decrypt_free(tls_decrypt_t *d) {
+    EVP_CIPHER_CTX_free(d->ctx);
+    OPENSSL_cleanse(d, sizeof(*d));
+}
+
+// Open the record with the current key. Returns the plaintext length with
+// padding, or -1 if the tag does not match.
+static int open_record(tls_decrypt_t *d, const uint8_t *record, size_t len, uint8_t *out) {
+    if (len < TLS_RECORD_HEADER + TLS_TAG_LEN)
+        return -1;
+    uint8_t nonce[12];
+    memcpy(nonce, d->iv, sizeof(nonce));
+    for (int i = 0; i < 8; i++)
+        nonce[11 - i] ^= (uint8_t)(d->seq >> (8 * i));
+
+    size_t ct_len = len - TLS_RECORD_HEADER - TLS_TAG_LEN;
+    int n = 0, final = 0;
+    if (EVP_DecryptInit_ex(d->ctx, d->cipher, NULL, d->key, nonce) != 1 ||
+        EVP_DecryptUpdate(d->ctx, NULL, &n, record, TLS_RECORD_HEADER) != 1 ||
+        EVP_DecryptUpdate(d->ctx, out, &n, record + TLS_RECORD_HEADER, (int)ct_len) != 1 ||
+        EVP_CIPHER_CTX_ctrl(d->ctx, EVP_CTRL_AEAD_SET_TAG, TLS_TAG_LEN,
+                            (void *)(record + TLS_RECORD_HEADER + ct_len)) != 1 ||
+        EVP_DecryptFinal_ex(d->ctx, out + n, &final) != 1)
+        return -1;
+    d->seq++;
+    return n + final;
+}
+
+int tls_decrypt_record(tls_decrypt_t *d, const uint8_t *record, size_t len, uint8_t *out, size_t *out_len) {
+    int n = open_record(d, record, len, out);
+    if (n < 0) {
+        // Past the Finished message, or past a KeyUpdate
+        uint8_t saved[TLS_SECRET_MAX], next[TLS_SECRET_MAX];
+        uint64_t saved_seq = d->seq;
+        memcpy(saved, d->secret, d->secret_len);
+        if (d->handshake)
+            memcpy(next, d->next, d->secret_len);
+        else if (expand_label(d->md, d->secret, d->secret_len, "traffic upd", next, d->secret_len) < 0)
+            return -1;
+        if (use_secret(d, next) < 0 || (n = open_record(d, record, len, out)) < 0) {
+            use_secret(d, saved);
+            d->seq = saved_seq;
+            return -1;
+        }
+        d->handshake = 0;
+    }
+
+    // TLSInnerPlaintext: content, type, zero padding
+    while (n > 0 && out[n - 1] == 0)
+        n--;
+    if (n == 0)
+        return -1;
+    *out_len = (size_t)n - 1;
+    return out[n - 1];
+}
@@ -0,0 +1,78 @@
+#ifndef TLS_DECRYPT_H
+#define TLS_DECRYPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/evp.h>
+
+// Reading TLS 1.3 records of a captured connection with the secrets its
+// client logged (SSLKEYLOGFILE format, as written by browsers, curl,
+// Python's ssl.keylog_filename or SSL_CTX_set_keylog_callback). TLS 1.2
+// connections are not covered: their master secret needs the 1.2 PRF and
+// every cipher suite family, and the stations this replays run 1.3.
+
+#define TLS_RANDOM_LEN      32
+#define TLS_SECRET_MAX      48      // SHA-384
+#define TLS_RECORD_HEADER   5
+#define TLS_RECORD_MAX      (16384 + 256)   // ciphertext of a full record
+#define TLS_TAG_LEN         16
+
+// The traffic secrets one connection logged
+enum {
+    TLS_SECRET_CLIENT_HANDSHAKE,
+    TLS_SECRET_SERVER_HANDSHAKE,
+    TLS_SECRET_CLIENT_TRAFFIC,
+    TLS_SECRET_SERVER_TRAFFIC,
+    TLS_SECRET_COUNT
+};
+
+typedef struct {
+    uint8_t random[TLS_RANDOM_LEN];     // the ClientHello random it is filed under
+    uint8_t secret[TLS_SECRET_COUNT][TLS_SECRET_MAX];
+    uint8_t secret_len[TLS_SECRET_COUNT];   // 0 when the line was missing
+} tls_keylog_entry_t;
+
+typedef struct {
+    tls_keylog_entry_t *entries;
+    size_t count;
+    size_t cap;
+} tls_keylog_t;
+
+// Read a key log file. Lines for other purposes (TLS 1.2 CLIENT_RANDOM,
+// early data, exporters) are skipped. Returns -1 if the file cannot be
+// read or holds no TLS 1.3 secrets.
+int tls_keylog_load(tls_keylog_t *k, const char *path);
+void tls_keylog_free(tls_keylog_t *k);
+// The entry for a client random, NULL if the log has none
+const tls_keylog_entry_t *tls_keylog_find(const tls_keylog_t *k, const uint8_t random[TLS_RANDOM_LEN]);
+
+// One direction of a connection. Records are protected with the handshake
+// secret until the Finished message, then with the traffic secret, which
+// KeyUpdate may advance later. Where one stops and the next begins is
+// found by which key authenticates the record, so the handshake messages
+// never need to be reassembled and parsed.
+typedef struct {
+    const EVP_CIPHER *cipher;
+    const EVP_MD *md;
+    EVP_CIPHER_CTX *ctx;
+    uint8_t key[32];
+    uint8_t iv[12];
+    uint64_t seq;
+    uint8_t secret[TLS_SECRET_MAX];     // the one in use
+    uint8_t next[TLS_SECRET_MAX];       // traffic secret, while still on the handshake one
+    uint8_t secret_len;
+    uint8_t handshake;                  // still on the handshake secret
+} tls_decrypt_t;
+
+// Set up for a cipher suite from the ServerHello. Returns -1 for a suite
+// this does not know or secrets of the wrong length.
+int tls_decrypt_init(tls_decrypt_t *d, uint16_t suite, const uint8_t *handshake_secret,
+                     const uint8_t *traffic_secret, size_t secret_len);
+void tls_decrypt_free(tls_decrypt_t *d);
+
+// Open one protected record (header included, len bytes). Returns its inner
+// content type with the plaintext in out (at least len bytes) and its length
+// in *out_len, or -1 if none of the keys it could be under authenticates it.
+int tls_decrypt_record(tls_decrypt_t *d, const uint8_t *record, size_t len, uint8_t *out, size_t *out_len);
+
+#endif
@@ -0,0 +1,60 @@
+#include <stdalign.h>
+#include <stdlib.h>
+
+#include "Arena.h"
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+struct arena_chunk {
+    arena_chunk_t *next;
+    size_t size;
+    alignas(max_align_t) unsigned char data[];
+};
+
+static arena_chunk_t *arena_chunk_new(size_t size, arena_chunk_t *next) {
+    arena_chunk_t *c = malloc(sizeof(*c) + size);
+    if (!c) return NULL;
+    c->next = next;
+    c->size = size;
+    return c;
+}
+
+void arena_init(arena_t *a, size_t chunk_size) {
+    a->chunks = NULL;
+    a->used = 0;
+    a->chunk_size = chunk_size;
+}
+
+void arena_free(arena_t *a) {
+    while (a->chunks) {
+        arena_chunk_t *next = a->chunks->next;
+        free(a->chunks);
+        a->chunks = next;
+    }
+    a->used = 0;
+}
+
+void *arena_alloc(arena_t *a, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena_chunk_t *c = a->chunks;
+    if (!c || c->size - a->used < size) {
+        // A request larger than a chunk gets a chunk of its own
+        c = arena_chunk_new(size > a->chunk_size ? size : a->chunk_size, a->chunks);
+        if (!c) return NULL;
+        a->chunks = c;
+        a->used = 0;
+    }
+    void *p = c->data + a->used;
+    a->used += size;
+    return p;
+}
+
+void arena_reset(arena_t *a) {
+    // Keep only the first chunk, and only if it has the regular size
+    while (a->chunks && (a->chunks->next || a->chunks->size != a->chunk_size)) {
+        arena_chunk_t *next = a->chunks->next;
+        free(a->chunks);
+        a->chunks = next;
+    }
+    a->used = 0;
+}
@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for memory that lives as long as one message. Allocating is
+// a pointer increment and arena_reset hands everything back at once. The
+// first chunk survives resets, so steady traffic never reaches malloc; chunks
+// added for an unusually large message are freed by the next reset.
+typedef struct arena_chunk arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t *chunks;      // newest first, the first chunk is last
+    size_t used;                // bytes taken from the newest chunk
+    size_t chunk_size;
+} arena_t;
+
+void arena_init(arena_t *a, size_t chunk_size);
+void arena_free(arena_t *a);
+// size bytes aligned for any type, or NULL when out of memory
+void *arena_alloc(arena_t *a, size_t size);
+void arena_reset(arena_t *a);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "BufferPool.h"
+
+#define BUF_POOL_MIN_SHIFT 8    // 256 bytes
+#define BUF_POOL_CLASSES   7    // 256 .. 16K
+#define BUF_POOL_OVERSIZE  BUF_POOL_CLASSES
+
+// Sits in front of every buffer. While the buffer is on a free list, next
+// links it; otherwise size tells buf_pool_put where it goes back to.
+typedef struct buf_header {
+    union {
+        struct buf_header *next;
+        size_t size;
+    };
+    unsigned cls;
+    alignas(max_align_t) unsigned char data[];
+} buf_header_t;
+
+static buf_header_t *free_list[BUF_POOL_CLASSES];
+static size_t free_count[BUF_POOL_CLASSES];
+
+static unsigned buf_pool_class(size_t size) {
+    unsigned cls = 0;
+    while (cls < BUF_POOL_CLASSES && ((size_t)1 << (BUF_POOL_MIN_SHIFT + cls)) < size)
+        cls++;
+    return cls;
+}
+
+void *buf_pool_get(size_t size) {
+    unsigned cls = buf_pool_class(size);
+    buf_header_t *b;
+    if (cls < BUF_POOL_CLASSES && (b = free_list[cls])) {
+        free_list[cls] = b->next;
+        free_count[cls]--;
+    } else {
+        if (cls < BUF_POOL_CLASSES)
+            size = (size_t)1 << (BUF_POOL_MIN_SHIFT + cls);
+        if (!(b = malloc(sizeof(*b) + size)))
+            return NULL;
+        b->cls = cls;
+    }
+    b->size = cls < BUF_POOL_CLASSES ? (size_t)1 << (BUF_POOL_MIN_SHIFT + cls) : size;
+    return b->data;
+}
+
+static buf_header_t *buf_header(const void *buf) {
+    return (buf_header_t *)((uintptr_t)buf - offsetof(buf_header_t, data));
+}
+
+size_t buf_pool_size(const void *buf) {
+    return buf_header(buf)->size;
+}
+
+void buf_pool_put(void *buf) {
+    if (!buf) return;
+    buf_header_t *b = buf_header(buf);
+    unsigned cls = b->cls;
+    if (cls == BUF_POOL_OVERSIZE ||
+        (free_count[cls] + 1) << (BUF_POOL_MIN_SHIFT + cls) > BUF_POOL_KEEP_BYTES) {
+        free(b);
+        return;
+    }
+    b->next = free_list[cls];
+    free_list[cls] = b;
+    free_count[cls]++;
+}
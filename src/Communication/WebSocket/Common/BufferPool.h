@@ -0,0 +1,22 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+
+// Recycled buffers for output frames and receive buffers, which outlive the
+// message that produced them. Sizes are rounded up to a class (256 bytes to
+// 16K); a freed buffer goes on its class's list for the next taker instead
+// of back to malloc. Larger requests are plain mallocs. The pool is per
+// process and not locked: each worker is single threaded.
+// Free bytes a class may hold on to; the rest goes back to malloc, so a
+// burst does not pin memory once it is over
+#define BUF_POOL_KEEP_BYTES (1024 * 1024)
+
+// At least size bytes, or NULL when out of memory
+void *buf_pool_get(size_t size);
+// Usable size of a buffer from buf_pool_get
+size_t buf_pool_size(const void *buf);
+// Return a buffer; NULL is ignored. Usable as an outq_release_fn.
+void buf_pool_put(void *buf);
+
+#endif
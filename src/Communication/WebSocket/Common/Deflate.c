@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+#include "Deflate.h"
+#include "BufferPool.h"
+#include "WebSocketFrame.h"
+
+#define ZALLOC_HEADER  16           // keeps zlib's memory aligned
+#define INFLATE_KEEP   (64 * 1024)  // a bigger output buffer is dropped before the next message
+
+struct ws_zstream {
+    z_stream z;
+    uint8_t inflating;
+};
+
+// Streams without context takeover, by window size. Per process like the buffer pool.
+static ws_zstream_t *shared_streams[2][WS_DEFLATE_MAX_WINDOW + 1];
+static uint8_t *inflate_out;
+static size_t inflate_cap;
+static size_t zlib_bytes;
+
+static const uint8_t flush_tail[4] = { 0x00, 0x00, 0xff, 0xff };
+
+static voidpf zalloc_counted(voidpf opaque, uInt items, uInt size) {
+    (void)opaque;
+    size_t n = (size_t)items * size;
+    uint8_t *p = malloc(ZALLOC_HEADER + n);
+    if (!p)
+        return NULL;
+    memcpy(p, &n, sizeof(n));
+    zlib_bytes += n;
+    return p + ZALLOC_HEADER;
+}
+
+static void zfree_counted(voidpf opaque, voidpf address) {
+    (void)opaque;
+    uint8_t *p = (uint8_t *)address - ZALLOC_HEADER;
+    size_t n;
+    memcpy(&n, p, sizeof(n));
+    zlib_bytes -= n;
+    free(p);
+}
+
+size_t ws_deflate_memory(void) {
+    return zlib_bytes;
+}
+
+// Raw deflate streams; the hash table is scaled down with the window, since
+// a small window is asked for to save memory
+static ws_zstream_t *zstream_new(int inflating, int bits) {
+    ws_zstream_t *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    s->z.zalloc = zalloc_counted;
+    s->z.zfree = zfree_counted;
+    s->inflating = (uint8_t)inflating;
+    int mem_level = bits - 7 < 1 ? 1 : bits - 7 > 8 ? 8 : bits - 7;
+    int rc = inflating ? inflateInit2(&s->z, -bits)
+                       : deflateInit2(&s->z, WS_DEFLATE_LEVEL, Z_DEFLATED, -bits, mem_level, Z_DEFAULT_STRATEGY);
+    if (rc != Z_OK) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+static void zstream_free(ws_zstream_t *s) {
+    if (!s)
+        return;
+    if (s->inflating)
+        inflateEnd(&s->z);
+    else
+        deflateEnd(&s->z);
+    free(s);
+}
+
+/* Negotiation */
+
+static int window_bits_value(const char *value, size_t len) {
+    if (len == 1 && value[0] >= '8' && value[0] <= '9')
+        return value[0] - '0';
+    if (len == 2 && value[0] == '1' && value[1] >= '0' && value[1] <= '5')
+        return 10 + value[1] - '0';
+    return -1;
+}
+
+// Split "name; param[=value]; ..." calling visit for each parameter, the
+// value NULL when absent and unquoted when quoted. The name must be ours.
+// Returns -1 if the name differs, the syntax is bad or visit fails.
+static int each_param(const char *s, size_t len,
+                      int (*visit)(const char *name, size_t name_len, const char *value, size_t value_len, void *arg),
+                      void *arg) {
+    const char *end = s + len;
+    int first = 1;
+    while (s <= end) {
+        const char *semi = memchr(s, ';', (size_t)(end - s));
+        const char *stop = semi ? semi : end;
+        const char *a = s, *b = stop;
+        while (a < b && (*a == ' ' || *a == '\t')) a++;
+        while (b > a && (b[-1] == ' ' || b[-1] == '\t')) b--;
+
+        if (first) {
+            if ((size_t)(b - a) != sizeof(WS_DEFLATE_EXTENSION) - 1 ||
+                strncasecmp(a, WS_DEFLATE_EXTENSION, (size_t)(b - a)) != 0)
+                return -1;
+            first = 0;
+        } else {
+            const char *eq = memchr(a, '=', (size_t)(b - a));
+            const char *name_end = eq ? eq : b;
+            while (name_end > a && (name_end[-1] == ' ' || name_end[-1] == '\t')) name_end--;
+            const char *value = NULL;
+            size_t value_len = 0;
+            if (eq) {
+                const char *v = eq + 1;
+                while (v < b && (*v == ' ' || *v == '\t')) v++;
+                if (b - v >= 2 && *v == '"' && b[-1] == '"') {
+                    v++;
+                    value_len = (size_t)(b - v - 1);
+                } else {
+                    value_len = (size_t)(b - v);
+                }
+                value = v;
+            }
+            if (name_end == a || visit(a, (size_t)(name_end - a), value, value_len, arg) < 0)
+                return -1;
+        }
+        if (!semi)
+            break;
+        s = semi + 1;
+    }
+    return 0;
+}
+
+#define PARAM_SERVER_NO_TAKEOVER 0x1
+#define PARAM_CLIENT_NO_TAKEOVER 0x2
+#define PARAM_SERVER_BITS        0x4
+#define PARAM_CLIENT_BITS        0x8
+
+typedef struct {
+    unsigned seen;
+    int server_bits;            // 0 when absent or given without a value
+    int client_bits;
+} deflate_params_t;
+
+static int param_is(const char *name, size_t len, const char *want) {
+    return strlen(want) == len && strncasecmp(name, want, len) == 0;
+}
+
+// Each parameter at most once; window sizes 8 to 15
+static int collect_param(const char *name, size_t name_len, const char *value, size_t value_len, void *arg) {
+    deflate_params_t *out = arg;
+    unsigned bit;
+    int *bits = NULL;
+    if (param_is(name, name_len, "server_no_context_takeover"))
+        bit = PARAM_SERVER_NO_TAKEOVER;
+    else if (param_is(name, name_len, "client_no_context_takeover"))
+        bit = PARAM_CLIENT_NO_TAKEOVER;
+    else if (param_is(name, name_len, "server_max_window_bits"))
+        bit = PARAM_SERVER_BITS, bits = &out->server_bits;
+    else if (param_is(name, name_len, "client_max_window_bits"))
+        bit = PARAM_CLIENT_BITS, bits = &out->client_bits;
+    else
+        return -1;
+    if (out->seen & bit)
+        return -1;
+    out->seen |= bit;
+
+    if (!bits)
+        return value ? -1 : 0;
+    if (!value)
+        return 0;
+    return (*bits = window_bits_value(value, value_len)) < 0 ? -1 : 0;
+}
+
+static int min_bits(int a, int b) {
+    return a < b ? a : b;
+}
+
+int ws_deflate_accept(const char *offer, size_t len, const ws_deflate_config_t *cfg,
+                      ws_deflate_params_t *p) {
+    deflate_params_t o = { 0 };
+    if (each_param(offer, len, collect_param, &o) < 0)
+        return 0;
+    // server_max_window_bits needs its value, and ours must fit in it
+    if ((o.seen & PARAM_SERVER_BITS) && (!o.server_bits || o.server_bits < WS_DEFLATE_MIN_WINDOW))
+        return 0;
+
+    int bits = cfg->max_window_bits;
+    if (bits < WS_DEFLATE_MIN_WINDOW || bits > WS_DEFLATE_MAX_WINDOW)
+        bits = WS_DEFLATE_MAX_WINDOW;
+    *p = (ws_deflate_params_t){
+        .enabled = 1,
+        .server_no_context_takeover = (o.seen & PARAM_SERVER_NO_TAKEOVER) || cfg->no_context_takeover,
+        .client_no_context_takeover = (o.seen & PARAM_CLIENT_NO_TAKEOVER) || cfg->no_context_takeover,
+        .server_max_window_bits = (uint8_t)(o.server_bits ? min_bits(bits, o.server_bits) : bits),
+        // Only a client that said so can be held to a smaller window
+        .client_max_window_bits = (uint8_t)(!(o.seen & PARAM_CLIENT_BITS) ? WS_DEFLATE_MAX_WINDOW
+                                            : o.client_bits ? min_bits(bits, o.client_bits) : bits),
+        .client_max_window_bits_offered = (o.seen & PARAM_CLIENT_BITS) != 0,
+    };
+    return 1;
+}
+
+int ws_deflate_parse_response(const char *value, size_t len, const ws_deflate_params_t *offer,
+                              ws_deflate_params_t *p) {
+    deflate_params_t r = { 0 };
+    if (each_param(value, len, collect_param, &r) < 0)
+        return -1;
+    if ((r.seen & PARAM_SERVER_BITS) && !r.server_bits)
+        return -1;
+    if (r.seen & PARAM_CLIENT_BITS) {
+        if (!offer->client_max_window_bits_offered || !r.client_bits)
+            return -1;
+        // zlib cannot compress within a window of 8
+        if (r.client_bits < WS_DEFLATE_MIN_WINDOW)
+            return -1;
+    }
+    if (offer->server_no_context_takeover && !(r.seen & PARAM_SERVER_NO_TAKEOVER))
+        return -1;
+    if (r.server_bits > offer->server_max_window_bits)
+        return -1;
+
+    *p = (ws_deflate_params_t){
+        .enabled = 1,
+        .server_no_context_takeover = (r.seen & PARAM_SERVER_NO_TAKEOVER) != 0,
+        .client_no_context_takeover = (r.seen & PARAM_CLIENT_NO_TAKEOVER) || offer->client_no_context_takeover,
+        .server_max_window_bits = (uint8_t)(r.server_bits ? r.server_bits : offer->server_max_window_bits),
+        .client_max_window_bits = (uint8_t)(r.client_bits ? min_bits(r.client_bits, offer->client_max_window_bits)
+                                                          : offer->client_max_window_bits),
+        .client_max_window_bits_offered = offer->client_max_window_bits_offered,
+    };
+    return 0;
+}
+
+size_t ws_deflate_format(const ws_deflate_params_t *p, int is_server, char *out, size_t size) {
+    int n = snprintf(out, size, "%s%s%s", WS_DEFLATE_EXTENSION,
+                     p->server_no_context_takeover ? "; server_no_context_takeover" : "",
+                     p->client_no_context_takeover ? "; client_no_context_takeover" : "");
+    if (n >= 0 && (size_t)n < size && p->server_max_window_bits < WS_DEFLATE_MAX_WINDOW)
+        n += snprintf(out + n, size - (size_t)n, "; server_max_window_bits=%d", p->server_max_window_bits);
+    // A client offers the parameter bare to let the server choose; a server
+    // may only answer it when offered
+    if (n >= 0 && (size_t)n < size && p->client_max_window_bits_offered) {
+        if (!is_server && p->client_max_window_bits == WS_DEFLATE_MAX_WINDOW)
+            n += snprintf(out + n, size - (size_t)n, "; client_max_window_bits");
+        else if (p->client_max_window_bits < WS_DEFLATE_MAX_WINDOW)
+            n += snprintf(out + n, size - (size_t)n, "; client_max_window_bits=%d", p->client_max_window_bits);
+    }
+    return n < 0 ? 0 : (size_t)n < size ? (size_t)n : size - 1;
+}
+
+/* Messages */
+
+void ws_deflate_init(ws_deflate_t *d, const ws_deflate_params_t *p, int is_server) {
+    *d = (ws_deflate_t){ .params = *p, .is_server = is_server ? 1 : 0 };
+}
+
+void ws_deflate_free(ws_deflate_t *d) {
+    zstream_free(d->tx);
+    zstream_free(d->rx);
+    d->tx = d->rx = NULL;
+}
+
+// The stream for one direction: the connection's own with context takeover,
+// otherwise the process's one for the window size
+static ws_zstream_t *direction_stream(ws_deflate_t *d, int inflating, int *takeover) {
+    const ws_deflate_params_t *p = &d->params;
+    int ours = inflating != d->is_server;   // the server's direction
+    int bits = ours ? p->server_max_window_bits : p->client_max_window_bits;
+    if (bits < WS_DEFLATE_MIN_WINDOW || bits > WS_DEFLATE_MAX_WINDOW)
+        bits = bits < WS_DEFLATE_MIN_WINDOW ? WS_DEFLATE_MIN_WINDOW : WS_DEFLATE_MAX_WINDOW;
+    *takeover = !(ours ? p->server_no_context_takeover : p->client_no_context_takeover);
+
+    ws_zstream_t **slot = *takeover ? (inflating ? &d->rx : &d->tx) : &shared_streams[inflating][bits];
+    if (!*slot)
+        *slot = zstream_new(inflating, bits);
+    return *slot;
+}
+
+// Move compressed output to a bigger pooled buffer
+static uint8_t *grow_output(uint8_t *buf, size_t *cap, z_stream *z) {
+    size_t used = (size_t)(z->next_out - buf);
+    uint8_t *bigger = buf_pool_get(*cap * 2);
+    if (!bigger)
+        return NULL;
+    memcpy(bigger, buf, used);
+    buf_pool_put(buf);
+    *cap = buf_pool_size(bigger);
+    z->next_out = bigger + used;
+    z->avail_out = (uInt)(*cap - used);
+    return bigger;
+}
+
+int ws_deflate_message(ws_deflate_t *d, const struct iovec *iov, int iovcnt, size_t headroom,
+                       uint8_t **out, size_t *out_len) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++)
+        total += iov[i].iov_len;
+    // Skipping a message keeps both windows in step: neither side sees it
+    if (total < WS_DEFLATE_MIN_SIZE)
+        return 0;
+
+    int takeover;
+    ws_zstream_t *s = direction_stream(d, 0, &takeover);
+    if (!s)
+        return -1;
+    z_stream *z = &s->z;
+    size_t cap = headroom + deflateBound(z, total) + 8;
+    uint8_t *buf = buf_pool_get(cap);
+    if (!buf)
+        return -1;
+    cap = buf_pool_size(buf);
+    z->next_out = buf + headroom;
+    z->avail_out = (uInt)(cap - headroom);
+
+    for (int i = 0; i <= iovcnt; i++) {
+        int last = i == iovcnt;
+        z->next_in = last ? NULL : iov[i].iov_base;
+        z->avail_in = last ? 0 : (uInt)iov[i].iov_len;
+        do {
+            if (!z->avail_out && !(buf = grow_output(buf, &cap, z)))
+                goto fail;
+            if (deflate(z, last ? Z_SYNC_FLUSH : Z_NO_FLUSH) == Z_STREAM_ERROR)
+                goto fail;
+        } while (!z->avail_out);
+    }
+
+    size_t len = (size_t)(z->next_out - buf) - headroom;
+    if (len < sizeof(flush_tail) || memcmp(buf + headroom + len - sizeof(flush_tail), flush_tail, sizeof(flush_tail)) != 0)
+        goto fail;
+    len -= sizeof(flush_tail);
+
+    if (!takeover) {
+        deflateReset(z);
+        // Nothing ties the next message to this one, so it may go out as it was
+        if (len >= total) {
+            buf_pool_put(buf);
+            return 0;
+        }
+    }
+    *out = buf;
+    *out_len = len;
+    return 1;
+
+fail:
+    // A context takeover stream is out of step with the peer from here on
+    if (!takeover)
+        deflateReset(z);
+    buf_pool_put(buf);
+    return -1;
+}
+
+static int inflate_fail(ws_deflate_t *d, z_stream *z, int takeover, uint16_t code) {
+    if (!takeover)
+        inflateReset(z);
+    d->close_code = code;
+    return -1;
+}
+
+int ws_inflate_message(ws_deflate_t *d, const uint8_t *in, size_t len, size_t max,
+                       const uint8_t **out, size_t *out_len) {
+    int takeover;
+    ws_zstream_t *s = direction_stream(d, 1, &takeover);
+    if (!s) {
+        d->close_code = WS_CLOSE_TOO_BIG;
+        return -1;
+    }
+    z_stream *z = &s->z;
+
+    // Whatever the last message left behind has been consumed by now
+    if (inflate_cap > INFLATE_KEEP) {
+        free(inflate_out);
+        inflate_out = NULL;
+        inflate_cap = 0;
+    }
+    size_t used = 0;
+    for (int part = 0; part < 2; part++) {
+        z->next_in = (uint8_t *)(part ? flush_tail : in);
+        z->avail_in = (uInt)(part ? sizeof(flush_tail) : len);
+        for (;;) {
+            if (used == inflate_cap) {
+                if (used > max)
+                    return inflate_fail(d, z, takeover, WS_CLOSE_TOO_BIG);
+                size_t cap = inflate_cap ? inflate_cap * 2 : 4096;
+                if (cap > max + 1)
+                    cap = max + 1;
+                uint8_t *bigger = realloc(inflate_out, cap);
+                if (!bigger)
+                    return inflate_fail(d, z, takeover, WS_CLOSE_TOO_BIG);
+                inflate_out = bigger;
+                inflate_cap = cap;
+            }
+            z->next_out = inflate_out + used;
+            z->avail_out = (uInt)(inflate_cap - used);
+            int rc = inflate(z, Z_SYNC_FLUSH);
+            used = inflate_cap - z->avail_out;
+            if (used > max)
+                return inflate_fail(d, z, takeover, WS_CLOSE_TOO_BIG);
+            if (rc == Z_STREAM_END) {
+                // A final block: the next message starts a new stream
+                inflateReset(z);
+                part = 1;
+                break;
+            }
+            if (rc == Z_BUF_ERROR && z->avail_in && z->avail_out)
+                return inflate_fail(d, z, takeover, WS_CLOSE_INVALID_DATA);
+            if (rc != Z_OK && rc != Z_BUF_ERROR)
+                return inflate_fail(d, z, takeover, WS_CLOSE_INVALID_DATA);
+            // Done once the input is in and output room was left over
+            if (!z->avail_in && z->avail_out)
+                break;
+        }
+    }
+    if (!takeover)
+        inflateReset(z);
+    *out = inflate_out;
+    *out_len = used;
+    return 0;
+}
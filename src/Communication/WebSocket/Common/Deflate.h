@@ -0,0 +1,82 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// permessage-deflate (RFC 7692). Each direction is a raw deflate stream,
+// flushed at the end of every message with its 00 00 ff ff tail left off
+// the wire. With context takeover a stream keeps its window from one message
+// to the next, which is where the compression of small, repetitive OCPP
+// messages comes from, at the price of zlib state held per connection.
+// Without it the stream starts over each message, so one stream per window
+// size is shared by all connections in the process and a connection holds
+// nothing. Streams are created on first use either way.
+
+#define WS_DEFLATE_EXTENSION  "permessage-deflate"
+#define WS_DEFLATE_MIN_WINDOW 9     // zlib cannot compress with a window of 8
+#define WS_DEFLATE_MAX_WINDOW 15
+#define WS_DEFLATE_LEVEL      6
+#define WS_DEFLATE_MIN_SIZE   32    // smaller messages go out as they are
+#define WS_DEFLATE_PARAMS_SIZE 128  // longest extension value ws_deflate_format writes
+
+// What a server is willing to negotiate
+typedef struct {
+    int enabled;
+    int max_window_bits;        // bounds both directions' windows
+    int no_context_takeover;    // demanded in both directions
+} ws_deflate_config_t;
+
+// What the handshake settled on
+typedef struct {
+    uint8_t enabled;
+    uint8_t server_no_context_takeover;
+    uint8_t client_no_context_takeover;
+    uint8_t server_max_window_bits;
+    uint8_t client_max_window_bits;
+    uint8_t client_max_window_bits_offered;  // client side: the offer allowed the server to set it
+} ws_deflate_params_t;
+
+typedef struct ws_zstream ws_zstream_t;
+
+// One endpoint of a connection
+typedef struct {
+    ws_deflate_params_t params;
+    uint8_t is_server;
+    uint16_t close_code;        // reason for the last failure
+    ws_zstream_t *tx;           // context takeover streams, NULL until used
+    ws_zstream_t *rx;
+} ws_deflate_t;
+
+// Server: accept one offer from Sec-WebSocket-Extensions. Returns 1 and
+// fills p when the offer is permessage-deflate with parameters we can honour
+// under cfg, 0 otherwise.
+int ws_deflate_accept(const char *offer, size_t len, const ws_deflate_config_t *cfg,
+                      ws_deflate_params_t *p);
+// Client: check the server's answer to our offer and fill p. Returns 0 or -1
+// if the answer is not one the offer allowed.
+int ws_deflate_parse_response(const char *value, size_t len, const ws_deflate_params_t *offer,
+                              ws_deflate_params_t *p);
+// The extension value describing p, as a server's response or a client's
+// offer. Returns its length.
+size_t ws_deflate_format(const ws_deflate_params_t *p, int is_server, char *out, size_t size);
+
+void ws_deflate_init(ws_deflate_t *d, const ws_deflate_params_t *p, int is_server);
+void ws_deflate_free(ws_deflate_t *d);
+
+// Compress a message. Returns 1 with the payload at *out + headroom in a
+// buffer from buf_pool_get, 0 when the message should be sent as it is and -1
+// when out of memory.
+int ws_deflate_message(ws_deflate_t *d, const struct iovec *iov, int iovcnt, size_t headroom,
+                       uint8_t **out, size_t *out_len);
+// Decompress a message received with RSV1 into a buffer owned by the
+// process, valid until the next call. Returns 0, or -1 with close_code set
+// when the data is corrupt or inflates past max bytes.
+int ws_inflate_message(ws_deflate_t *d, const uint8_t *in, size_t len, size_t max,
+                       const uint8_t **out, size_t *out_len);
+
+// Bytes zlib holds in this process, for sizing the window options
+size_t ws_deflate_memory(void);
+
+#endif
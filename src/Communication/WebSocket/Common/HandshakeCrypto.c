@@ -0,0 +1,288 @@
+#include <string.h>
+#include <openssl/rand.h>
+
+#include "HandshakeCrypto.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WS_SHA1_X86 1
+#endif
+
+static const char base64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Sextet for each character, 0xff if it is not in the alphabet
+static const uint8_t base64_decode_table[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,   62, 0xff, 0xff, 0xff,   63,
+      52,   53,   54,   55,   56,   57,   58,   59,   60,   61, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff,    0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,   13,   14,
+      15,   16,   17,   18,   19,   20,   21,   22,   23,   24,   25, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff,   26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,
+      41,   42,   43,   44,   45,   46,   47,   48,   49,   50,   51, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+size_t ws_base64_encode(const uint8_t *in, size_t len, char *out) {
+    char *o = out;
+    for (; len >= 3; in += 3, len -= 3, o += 4) {
+        uint32_t triple = (uint32_t)in[0] << 16 | (uint32_t)in[1] << 8 | in[2];
+        o[0] = base64_table[triple >> 18];
+        o[1] = base64_table[(triple >> 12) & 0x3F];
+        o[2] = base64_table[(triple >> 6) & 0x3F];
+        o[3] = base64_table[triple & 0x3F];
+    }
+
+    // One or two bytes left over become two or three characters and padding
+    if (len) {
+        uint32_t triple = (uint32_t)in[0] << 16 | (len == 2 ? (uint32_t)in[1] << 8 : 0);
+        o[0] = base64_table[triple >> 18];
+        o[1] = base64_table[(triple >> 12) & 0x3F];
+        o[2] = len == 2 ? base64_table[(triple >> 6) & 0x3F] : '=';
+        o[3] = '=';
+        o += 4;
+    }
+    *o = '\0';
+    return (size_t)(o - out);
+}
+
+int ws_base64_decode(const char *in, size_t len, uint8_t *out) {
+    const unsigned char *s = (const unsigned char *)in;
+    if (len % 4) return -1;
+
+    int n = 0;
+    for (size_t i = 0; i < len; i += 4, s += 4) {
+        // Padding may only end the last quantum
+        int pad = 0;
+        if (i + 4 == len)
+            pad = s[3] == '=' ? (s[2] == '=' ? 2 : 1) : 0;
+
+        uint8_t a = base64_decode_table[s[0]];
+        uint8_t b = base64_decode_table[s[1]];
+        uint8_t c = pad > 1 ? 0 : base64_decode_table[s[2]];
+        uint8_t d = pad > 0 ? 0 : base64_decode_table[s[3]];
+        if ((a | b | c | d) & 0x80) return -1;
+
+        uint32_t triple = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | d;
+        out[n++] = (uint8_t)(triple >> 16);
+        if (pad < 2) out[n++] = (uint8_t)(triple >> 8);
+        if (pad < 1) out[n++] = (uint8_t)triple;
+    }
+    return n;
+}
+
+// The hashed input is always the 24-byte key followed by the 36-byte GUID,
+// so the message has exactly two SHA-1 blocks. The GUID trails the key, which
+// rules out a classic midstate, but everything after the key is constant: the
+// rest of the first block, and the whole padding block whose message schedule
+// can be expanded once.
+
+#define SHA1_DIGEST_LEN 20
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+typedef void (*ws_sha1_fn)(const char key[WS_KEY_LEN], uint8_t digest[SHA1_DIGEST_LEN]);
+
+static const uint32_t sha1_iv[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+static const uint32_t sha1_k[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+// First block after the key: the GUID, then the 0x80 that starts the padding
+static const char sha1_block_tail[64 - WS_KEY_LEN] = WEBSOCKET_MAGIC_GUID "\x80\0\0";
+// Second block: zeros and the message length, 60 bytes = 480 bits
+static const uint8_t sha1_pad_block[64] = { [62] = 0x01, [63] = 0xE0 };
+
+static inline uint32_t load_be32(const void *p) {
+    const uint8_t *b = p;
+    return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Schedule words 6..15 of the first block and the round inputs (W + K) of the
+// padding block, filled on first use
+static uint32_t sha1_tail_words[16 - WS_KEY_LEN / 4];
+static uint32_t sha1_pad_wk[80];
+static int sha1_prepared;
+
+static void sha1_expand(uint32_t w[80]) {
+    for (int t = 16; t < 80; t++)
+        w[t] = ROL(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+    for (int t = 0; t < 80; t++)
+        w[t] += sha1_k[t / 20];
+}
+
+static void sha1_prepare(void) {
+    for (size_t i = 0; i < sizeof(sha1_tail_words) / sizeof(sha1_tail_words[0]); i++)
+        sha1_tail_words[i] = load_be32(sha1_block_tail + 4 * i);
+    for (int i = 0; i < 16; i++)
+        sha1_pad_wk[i] = load_be32(sha1_pad_block + 4 * i);
+    sha1_expand(sha1_pad_wk);
+    sha1_prepared = 1;
+}
+
+#define SHA1_ROUND(f) do {                              \
+        uint32_t tmp = ROL(a, 5) + (f) + e + wk[t];     \
+        e = d; d = c; c = ROL(b, 30); b = a; a = tmp;   \
+    } while (0)
+
+static void sha1_rounds(uint32_t h[5], const uint32_t wk[80]) {
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    int t = 0;
+    for (; t < 20; t++) SHA1_ROUND(d ^ (b & (c ^ d)));
+    for (; t < 40; t++) SHA1_ROUND(b ^ c ^ d);
+    for (; t < 60; t++) SHA1_ROUND((b & c) | (d & (b | c)));
+    for (; t < 80; t++) SHA1_ROUND(b ^ c ^ d);
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+static void ws_sha1_scalar(const char key[WS_KEY_LEN], uint8_t digest[SHA1_DIGEST_LEN]) {
+    if (!sha1_prepared)
+        sha1_prepare();
+
+    uint32_t h[5], w[80];
+    for (int i = 0; i < WS_KEY_LEN / 4; i++)
+        w[i] = load_be32(key + 4 * i);
+    memcpy(w + WS_KEY_LEN / 4, sha1_tail_words, sizeof(sha1_tail_words));
+    sha1_expand(w);
+
+    memcpy(h, sha1_iv, sizeof(h));
+    sha1_rounds(h, w);
+    sha1_rounds(h, sha1_pad_wk);
+
+    for (int i = 0; i < 5; i++)
+        store_be32(digest + 4 * i, h[i]);
+}
+
+#ifdef WS_SHA1_X86
+// The round function selector of sha1rnds4 has to be an immediate
+__attribute__((target("sha,sse4.1")))
+static inline __m128i sha1_rnds4(__m128i abcd, __m128i e, int f) {
+    switch (f) {
+    case 0:  return _mm_sha1rnds4_epu32(abcd, e, 0);
+    case 1:  return _mm_sha1rnds4_epu32(abcd, e, 1);
+    case 2:  return _mm_sha1rnds4_epu32(abcd, e, 2);
+    default: return _mm_sha1rnds4_epu32(abcd, e, 3);
+    }
+}
+
+// One block with the SHA extensions. msg[i & 3] holds the words of round
+// group i; each group also prepares the words of group i + 4 from there.
+__attribute__((target("sha,sse4.1")))
+static void sha1_shani_block(__m128i *abcd_io, __m128i *e_io, const uint8_t block[64]) {
+    const __m128i bswap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd = *abcd_io, abcd_save = *abcd_io, e_save = *e_io;
+    __m128i msg[4], e[2];
+
+    for (int i = 0; i < 4; i++)
+        msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block + 16 * i)), bswap);
+
+    e[0] = _mm_add_epi32(*e_io, msg[0]);
+#pragma GCC unroll 20
+    for (int i = 0; i < 20; i++) {
+        if (i > 0)
+            e[i & 1] = _mm_sha1nexte_epu32(e[i & 1], msg[i & 3]);
+        e[(i + 1) & 1] = abcd;
+        if (i >= 3 && i <= 18)
+            msg[(i + 1) & 3] = _mm_sha1msg2_epu32(msg[(i + 1) & 3], msg[i & 3]);
+        abcd = sha1_rnds4(abcd, e[i & 1], i / 5);
+        if (i >= 1 && i <= 16)
+            msg[(i + 3) & 3] = _mm_sha1msg1_epu32(msg[(i + 3) & 3], msg[i & 3]);
+        if (i >= 2 && i <= 17)
+            msg[(i + 2) & 3] = _mm_xor_si128(msg[(i + 2) & 3], msg[i & 3]);
+    }
+
+    *e_io = _mm_sha1nexte_epu32(e[0], e_save);
+    *abcd_io = _mm_add_epi32(abcd, abcd_save);
+}
+
+__attribute__((target("sha,sse4.1")))
+static void ws_sha1_shani(const char key[WS_KEY_LEN], uint8_t digest[SHA1_DIGEST_LEN]) {
+    const __m128i bswap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    uint8_t block[64];
+    memcpy(block, key, WS_KEY_LEN);
+    memcpy(block + WS_KEY_LEN, sha1_block_tail, sizeof(sha1_block_tail));
+
+    // a in the top lane, e alone in the top lane of its own register
+    __m128i abcd = _mm_set_epi32((int)sha1_iv[0], (int)sha1_iv[1], (int)sha1_iv[2], (int)sha1_iv[3]);
+    __m128i e = _mm_set_epi32((int)sha1_iv[4], 0, 0, 0);
+    sha1_shani_block(&abcd, &e, block);
+    sha1_shani_block(&abcd, &e, sha1_pad_block);
+
+    _mm_storeu_si128((__m128i *)digest, _mm_shuffle_epi8(abcd, bswap));
+    store_be32(digest + 16, (uint32_t)_mm_extract_epi32(e, 3));
+}
+#endif
+
+static const struct {
+    const char *name;
+    ws_sha1_fn fn;
+} ws_sha1_impls[WS_SHA1_IMPL_COUNT] = {
+    [WS_SHA1_SCALAR] = { "scalar", ws_sha1_scalar },
+#ifdef WS_SHA1_X86
+    [WS_SHA1_SHANI]  = { "sha-ni", ws_sha1_shani },
+#else
+    [WS_SHA1_SHANI]  = { "sha-ni", NULL },
+#endif
+};
+
+int ws_sha1_impl_supported(int impl) {
+    if (impl < 0 || impl >= WS_SHA1_IMPL_COUNT || !ws_sha1_impls[impl].fn)
+        return 0;
+#ifdef WS_SHA1_X86
+    __builtin_cpu_init();
+    if (impl == WS_SHA1_SHANI)
+        return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+#endif
+    return 1;
+}
+
+const char *ws_sha1_impl_name(int impl) {
+    if (impl < 0 || impl >= WS_SHA1_IMPL_COUNT)
+        return "unknown";
+    return ws_sha1_impls[impl].name;
+}
+
+void ws_accept_key_with(int impl, const char key[WS_KEY_LEN], char accept[WS_ACCEPT_LEN + 1]) {
+    uint8_t digest[SHA1_DIGEST_LEN];
+    ws_sha1_impls[impl].fn(key, digest);
+    ws_base64_encode(digest, sizeof(digest), accept);
+}
+
+// Resolved on first use, like the masking kernels
+static ws_sha1_fn ws_sha1_best;
+
+static ws_sha1_fn ws_sha1_resolve(void) {
+    for (int impl = WS_SHA1_IMPL_COUNT - 1; impl > WS_SHA1_SCALAR; impl--) {
+        if (ws_sha1_impl_supported(impl))
+            return ws_sha1_impls[impl].fn;
+    }
+    return ws_sha1_scalar;
+}
+
+void ws_accept_key(const char key[WS_KEY_LEN], char accept[WS_ACCEPT_LEN + 1]) {
+    uint8_t digest[SHA1_DIGEST_LEN];
+    ws_sha1_fn fn = ws_sha1_best;
+    if (!fn)
+        ws_sha1_best = fn = ws_sha1_resolve();
+    fn(key, digest);
+    ws_base64_encode(digest, sizeof(digest), accept);
+}
+
+int ws_generate_key(char key[WS_KEY_LEN + 1]) {
+    uint8_t nonce[16];
+    if (RAND_bytes(nonce, sizeof(nonce)) != 1)
+        return -1;
+    ws_base64_encode(nonce, sizeof(nonce), key);
+    return 0;
+}
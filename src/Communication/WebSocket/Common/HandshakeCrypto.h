@@ -0,0 +1,38 @@
+#ifndef HANDSHAKE_CRYPTO_H
+#define HANDSHAKE_CRYPTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WEBSOCKET_MAGIC_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_LEN    24    // base64 of the 16-byte client nonce
+#define WS_ACCEPT_LEN 28    // base64 of a SHA-1 digest
+
+// Characters base64 needs for n bytes, padding included, without the NUL
+#define WS_BASE64_LEN(n) ((((n) + 2) / 3) * 4)
+
+// SHA-1 kernels for the accept hash, from slowest to fastest
+enum {
+    WS_SHA1_SCALAR,
+    WS_SHA1_SHANI,
+    WS_SHA1_IMPL_COUNT
+};
+
+// Padded base64 into out, which must hold WS_BASE64_LEN(len) + 1 bytes.
+// Returns the length written, not counting the NUL.
+size_t ws_base64_encode(const uint8_t *in, size_t len, char *out);
+// Decode padded base64 into out, which must hold len / 4 * 3 bytes.
+// Returns the decoded length, or -1 if in is not valid base64.
+int ws_base64_decode(const char *in, size_t len, uint8_t *out);
+
+// Sec-WebSocket-Accept for a client key: base64(SHA-1(key + GUID)), NUL terminated
+void ws_accept_key(const char key[WS_KEY_LEN], char accept[WS_ACCEPT_LEN + 1]);
+// A fresh Sec-WebSocket-Key, NUL terminated. Returns -1 if the RNG failed.
+int ws_generate_key(char key[WS_KEY_LEN + 1]);
+
+// Explicit kernel selection, for benchmarks and cross-checking
+int ws_sha1_impl_supported(int impl);
+const char *ws_sha1_impl_name(int impl);
+void ws_accept_key_with(int impl, const char key[WS_KEY_LEN], char accept[WS_ACCEPT_LEN + 1]);
+
+#endif
@@ -0,0 +1,98 @@
+#include <math.h>
+#include <string.h>
+
+#include "Histogram.h"
+
+#define SUB_COUNT (1u << HISTOGRAM_SUB_BITS)
+#define MAX_VALUE ((1ull << HISTOGRAM_MAX_BITS) - 1)
+
+static unsigned bucket_index(uint64_t v) {
+    if (v > MAX_VALUE)
+        v = MAX_VALUE;
+    if (v < SUB_COUNT)
+        return (unsigned)v;
+    unsigned msb = 63 - (unsigned)__builtin_clzll(v);
+    unsigned shift = msb - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + (unsigned)((v >> shift) - SUB_COUNT);
+}
+
+// Highest value counted at index i
+static uint64_t bucket_value(unsigned i) {
+    if (i < SUB_COUNT)
+        return i;
+    unsigned shift = (i >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t low = (uint64_t)(SUB_COUNT + (i & (SUB_COUNT - 1))) << shift;
+    return low + (1ull << shift) - 1;
+}
+
+void histogram_init(histogram_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void histogram_record(histogram_t *h, uint64_t value) {
+    h->counts[bucket_index(value)]++;
+    h->total++;
+    h->sum += (double)value;
+    h->sum_squares += (double)value * (double)value;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+void histogram_add(histogram_t *h, const histogram_t *other) {
+    for (unsigned i = 0; i < HISTOGRAM_COUNTS; i++)
+        h->counts[i] += other->counts[i];
+    h->total += other->total;
+    h->sum += other->sum;
+    h->sum_squares += other->sum_squares;
+    if (other->min < h->min) h->min = other->min;
+    if (other->max > h->max) h->max = other->max;
+}
+
+uint64_t histogram_percentile(const histogram_t *h, double fraction) {
+    if (!h->total)
+        return 0;
+    uint64_t rank = (uint64_t)(fraction * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > h->total) rank = h->total;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HISTOGRAM_COUNTS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = bucket_value(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+double histogram_mean(const histogram_t *h) {
+    return h->total ? h->sum / (double)h->total : 0.0;
+}
+
+double histogram_stddev(const histogram_t *h) {
+    if (!h->total)
+        return 0.0;
+    double mean = histogram_mean(h);
+    double variance = h->sum_squares / (double)h->total - mean * mean;
+    return variance > 0 ? sqrt(variance) : 0.0;
+}
+
+void histogram_write_hgrm(const histogram_t *h, FILE *f, double scale) {
+    fprintf(f, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HISTOGRAM_COUNTS && seen < h->total; i++) {
+        if (!h->counts[i])
+            continue;
+        seen += h->counts[i];
+        double p = (double)seen / (double)h->total;
+        uint64_t v = bucket_value(i) < h->max ? bucket_value(i) : h->max;
+        if (seen < h->total)
+            fprintf(f, "%12.3f %2.12f %10llu %14.2f\n", v / scale, p, (unsigned long long)seen, 1.0 / (1.0 - p));
+        else
+            fprintf(f, "%12.3f %2.12f %10llu\n", v / scale, p, (unsigned long long)seen);
+    }
+    fprintf(f, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", histogram_mean(h) / scale, histogram_stddev(h) / scale);
+    fprintf(f, "#[Max     = %12.3f, Total count    = %12llu]\n", h->max / scale, (unsigned long long)h->total);
+    fprintf(f, "#[Buckets = %12d, SubBuckets     = %12u]\n", HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1, SUB_COUNT);
+}
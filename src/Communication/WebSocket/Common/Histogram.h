@@ -0,0 +1,35 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// HDR-style latency histogram: values below 2^HISTOGRAM_SUB_BITS are counted
+// exactly, larger ones in 2^HISTOGRAM_SUB_BITS linear steps per power of two,
+// so every recorded value is off by less than 1% over the whole range and
+// recording is a shift and an increment.
+#define HISTOGRAM_SUB_BITS 7
+#define HISTOGRAM_MAX_BITS 36   // microseconds: about 19 hours, larger values are clamped
+#define HISTOGRAM_COUNTS   ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+typedef struct {
+    uint64_t total;
+    uint64_t min, max;
+    double sum, sum_squares;
+    uint64_t counts[HISTOGRAM_COUNTS];
+} histogram_t;
+
+void histogram_init(histogram_t *h);
+void histogram_record(histogram_t *h, uint64_t value);
+void histogram_add(histogram_t *h, const histogram_t *other);
+// Smallest recorded value at or above the given fraction (0 to 1) of them;
+// 0 when empty
+uint64_t histogram_percentile(const histogram_t *h, double fraction);
+double histogram_mean(const histogram_t *h);
+double histogram_stddev(const histogram_t *h);
+// The percentile distribution in HdrHistogram's .hgrm text format, values
+// divided by scale (1000 turns microseconds into milliseconds)
+void histogram_write_hgrm(const histogram_t *h, FILE *f, double scale);
+
+#endif
@@ -0,0 +1,205 @@
+#include <string.h>
+#include <strings.h>
+
+#include "HttpParser.h"
+
+enum {
+    HTTP_STATE_START_LINE,
+    HTTP_STATE_HEADERS,
+    HTTP_STATE_DONE,
+    HTTP_STATE_ERROR
+};
+
+// RFC 7230 tchar
+static int http_is_tchar(unsigned char c) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        return 1;
+    return c != 0 && strchr("!#$%&'*+-.^_`|~", c) != NULL;
+}
+
+static int http_is_ows(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Every interesting header has a distinct length, so one compare settles it
+static uint8_t http_header_id(const char *name, size_t len) {
+    static const struct {
+        const char *name;
+        uint8_t id;
+    } by_len[] = {
+        [4]  = { "host", HTTP_HDR_HOST },
+        [7]  = { "upgrade", HTTP_HDR_UPGRADE },
+        [10] = { "connection", HTTP_HDR_CONNECTION },
+        [17] = { "sec-websocket-key", HTTP_HDR_SEC_WEBSOCKET_KEY },
+        [20] = { "sec-websocket-accept", HTTP_HDR_SEC_WEBSOCKET_ACCEPT },
+        [21] = { "sec-websocket-version", HTTP_HDR_SEC_WEBSOCKET_VERSION },
+        [22] = { "sec-websocket-protocol", HTTP_HDR_SEC_WEBSOCKET_PROTOCOL },
+        [24] = { "sec-websocket-extensions", HTTP_HDR_SEC_WEBSOCKET_EXTENSIONS },
+    };
+
+    if (len >= sizeof(by_len) / sizeof(by_len[0]) || !by_len[len].name)
+        return HTTP_HDR_OTHER;
+    return strncasecmp(name, by_len[len].name, len) == 0 ? by_len[len].id : HTTP_HDR_OTHER;
+}
+
+static int http_fail(http_parser_t *p, int status) {
+    p->state = HTTP_STATE_ERROR;
+    p->error_status = status;
+    return -1;
+}
+
+static http_slice_t http_slice(const char *buf, const char *start, size_t len) {
+    http_slice_t s = { (uint16_t)(start - buf), (uint16_t)len };
+    return s;
+}
+
+// "HTTP/1.x", returns the minor version or -1
+static int http_parse_version(const char *s, size_t len) {
+    if (len != 8 || memcmp(s, "HTTP/1.", 7) != 0 || s[7] < '0' || s[7] > '9')
+        return -1;
+    return s[7] - '0';
+}
+
+// METHOD SP request-target SP HTTP-version
+static int http_parse_request_line(http_parser_t *p, const char *buf, const char *line, size_t len) {
+    const char *end = line + len;
+    const char *sp1 = memchr(line, ' ', len);
+    if (!sp1 || sp1 == line) return http_fail(p, 400);
+    for (const char *c = line; c < sp1; c++)
+        if (!http_is_tchar((unsigned char)*c)) return http_fail(p, 400);
+
+    const char *target = sp1 + 1;
+    const char *sp2 = memchr(target, ' ', (size_t)(end - target));
+    if (!sp2 || sp2 == target) return http_fail(p, 400);
+
+    p->minor_version = http_parse_version(sp2 + 1, (size_t)(end - sp2 - 1));
+    if (p->minor_version < 0) return http_fail(p, 505);
+
+    p->method = http_slice(buf, line, (size_t)(sp1 - line));
+    p->target = http_slice(buf, target, (size_t)(sp2 - target));
+    return 0;
+}
+
+// HTTP-version SP status-code SP reason-phrase
+static int http_parse_status_line(http_parser_t *p, const char *line, size_t len) {
+    if (len < 12 || line[8] != ' ') return http_fail(p, 400);
+    p->minor_version = http_parse_version(line, 8);
+    if (p->minor_version < 0) return http_fail(p, 400);
+
+    int status = 0;
+    for (int i = 9; i < 12; i++) {
+        if (line[i] < '0' || line[i] > '9') return http_fail(p, 400);
+        status = status * 10 + (line[i] - '0');
+    }
+    if (len > 12 && line[12] != ' ') return http_fail(p, 400);
+    p->status = status;
+    return 0;
+}
+
+// field-name ":" OWS field-value OWS
+static int http_parse_header_line(http_parser_t *p, const char *buf, const char *line, size_t len) {
+    // Obsolete line folding is not accepted (RFC 7230 3.2.4)
+    if (http_is_ows(line[0])) return http_fail(p, 400);
+    if (p->num_headers == HTTP_MAX_HEADERS) return http_fail(p, 431);
+
+    const char *colon = memchr(line, ':', len);
+    if (!colon || colon == line) return http_fail(p, 400);
+    for (const char *c = line; c < colon; c++)
+        if (!http_is_tchar((unsigned char)*c)) return http_fail(p, 400);
+
+    const char *value = colon + 1;
+    const char *end = line + len;
+    while (value < end && http_is_ows(*value)) value++;
+    while (end > value && http_is_ows(end[-1])) end--;
+
+    http_header_t *h = &p->headers[p->num_headers];
+    h->name = http_slice(buf, line, (size_t)(colon - line));
+    h->value = http_slice(buf, value, (size_t)(end - value));
+    h->id = http_header_id(line, h->name.len);
+    if (h->id != HTTP_HDR_OTHER && p->known[h->id] < 0)
+        p->known[h->id] = (int8_t)p->num_headers;
+    p->num_headers++;
+    return 0;
+}
+
+void http_parser_init(http_parser_t *p, int is_response, size_t max_size) {
+    memset(p, 0, sizeof(*p));
+    p->is_response = is_response ? 1 : 0;
+    p->max_size = max_size && max_size <= HTTP_MAX_REQUEST_SIZE ? max_size : HTTP_MAX_REQUEST_SIZE;
+    memset(p->known, -1, sizeof(p->known));
+}
+
+int http_parse(http_parser_t *p, const char *buf, size_t len) {
+    if (p->state == HTTP_STATE_DONE) return 1;
+    if (p->state == HTTP_STATE_ERROR) return -1;
+
+    for (;;) {
+        size_t limit = len < p->max_size ? len : p->max_size;
+        const char *nl = p->scan < limit ? memchr(buf + p->scan, '\n', limit - p->scan) : NULL;
+        if (!nl) {
+            p->scan = limit;
+            return len >= p->max_size ? http_fail(p, 431) : 0;
+        }
+
+        const char *line = buf + p->pos;
+        size_t line_len = (size_t)(nl - line);
+        if (line_len > 0 && line[line_len - 1] == '\r')
+            line_len--;
+        p->pos = p->scan = (size_t)(nl - buf) + 1;
+
+        if (p->state == HTTP_STATE_START_LINE) {
+            // Tolerate blank lines ahead of the start line (RFC 7230 3.5)
+            if (line_len == 0) continue;
+            int rc = p->is_response ? http_parse_status_line(p, line, line_len)
+                                    : http_parse_request_line(p, buf, line, line_len);
+            if (rc < 0) return -1;
+            p->state = HTTP_STATE_HEADERS;
+        } else if (line_len == 0) {
+            p->state = HTTP_STATE_DONE;
+            p->length = p->pos;
+            return 1;
+        } else if (http_parse_header_line(p, buf, line, line_len) < 0) {
+            return -1;
+        }
+    }
+}
+
+const http_header_t *http_header(const http_parser_t *p, int id) {
+    if (id <= HTTP_HDR_OTHER || id >= HTTP_HDR_COUNT || p->known[id] < 0)
+        return NULL;
+    return &p->headers[p->known[id]];
+}
+
+int http_header_each_token(const http_parser_t *p, const char *buf, int id,
+                           int (*visit)(const char *token, size_t len, void *arg), void *arg) {
+    if (!http_header(p, id)) return 0;
+
+    for (int i = p->known[id]; i < p->num_headers; i++) {
+        const http_header_t *h = &p->headers[i];
+        if (h->id != id) continue;
+
+        const char *s = buf + h->value.off;
+        const char *end = s + h->value.len;
+        while (s < end) {
+            const char *comma = memchr(s, ',', (size_t)(end - s));
+            const char *tok_end = comma ? comma : end;
+            const char *t = s;
+            while (t < tok_end && http_is_ows(*t)) t++;
+            const char *e = tok_end;
+            while (e > t && http_is_ows(e[-1])) e--;
+            if (e > t && visit(t, (size_t)(e - t), arg))
+                return 1;
+            s = comma ? comma + 1 : end;
+        }
+    }
+    return 0;
+}
+
+static int http_token_equals(const char *token, size_t len, void *arg) {
+    const char *want = arg;
+    return strlen(want) == len && strncasecmp(token, want, len) == 0;
+}
+
+int http_header_has_token(const http_parser_t *p, const char *buf, int id, const char *token) {
+    return http_header_each_token(p, buf, id, http_token_equals, (void *)token);
+}
@@ -0,0 +1,72 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_MAX_HEADERS      32
+#define HTTP_MAX_REQUEST_SIZE 8192
+
+// Headers the WebSocket upgrade cares about, recognised while parsing
+enum {
+    HTTP_HDR_OTHER,
+    HTTP_HDR_HOST,
+    HTTP_HDR_UPGRADE,
+    HTTP_HDR_CONNECTION,
+    HTTP_HDR_SEC_WEBSOCKET_KEY,
+    HTTP_HDR_SEC_WEBSOCKET_VERSION,
+    HTTP_HDR_SEC_WEBSOCKET_PROTOCOL,
+    HTTP_HDR_SEC_WEBSOCKET_EXTENSIONS,
+    HTTP_HDR_SEC_WEBSOCKET_ACCEPT,
+    HTTP_HDR_COUNT
+};
+
+// A slice of the message being parsed, as offsets from its first byte so the
+// underlying buffer may move between calls
+typedef struct {
+    uint16_t off;
+    uint16_t len;
+} http_slice_t;
+
+typedef struct {
+    http_slice_t name;
+    http_slice_t value;
+    uint8_t id;
+} http_header_t;
+
+// Resumable HTTP/1.1 request/response head parser. It keeps no copies and
+// never allocates; feed it the same growing buffer until it returns 1.
+typedef struct {
+    uint8_t state;
+    uint8_t is_response;
+    size_t pos;                 // start of the line being parsed
+    size_t scan;                // where the search for its end resumes
+    size_t max_size;
+    http_slice_t method;        // requests
+    http_slice_t target;
+    int status;                 // responses
+    int minor_version;
+    http_header_t headers[HTTP_MAX_HEADERS];
+    int num_headers;
+    int8_t known[HTTP_HDR_COUNT];  // index of the first header with each id, -1 if absent
+    size_t length;              // size of the head, once complete
+    int error_status;           // HTTP status to answer a malformed request with
+} http_parser_t;
+
+void http_parser_init(http_parser_t *p, int is_response, size_t max_size);
+
+// Parse as far as buf[0..len) allows. Returns 1 once the blank line ending
+// the head has been seen, 0 if more bytes are needed and -1 on malformed input.
+int http_parse(http_parser_t *p, const char *buf, size_t len);
+
+// First header with the given id, or NULL
+const http_header_t *http_header(const http_parser_t *p, int id);
+// Case-insensitive search for token in every comma-separated list value of
+// the headers with the given id
+int http_header_has_token(const http_parser_t *p, const char *buf, int id, const char *token);
+// Visit the comma-separated tokens of every header with the given id. Stops
+// and returns 1 as soon as visit returns non-zero.
+int http_header_each_token(const http_parser_t *p, const char *buf, int id,
+                           int (*visit)(const char *token, size_t len, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,640 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Log.h"
+
+#define LOG_CACHE_LINE 64
+#define LOG_RECORD_ALIGN 8
+#define LOG_MAX_ARGS 8   // what the macros pass at most
+#define LOG_LINE_MAX (4 * LOG_STRING_MAX)
+#define LOG_TRUNCATED 0x80000000u  // in a string's length: there was more
+
+// Single producer, the thread that logs, and single consumer, the formatter.
+// Same scheme as IpcRing, without the sleeping side: the formatter looks
+// every LOG_FLUSH_MS, or sooner once a ring is half full.
+typedef struct log_ring {
+    alignas(LOG_CACHE_LINE) uint64_t tail;  // bytes ever published
+    uint64_t dropped;                       // records that did not fit
+    alignas(LOG_CACHE_LINE) uint64_t head;  // bytes ever consumed
+    uint64_t dropped_seen;                  // as far as the formatter has said
+    alignas(LOG_CACHE_LINE) uint64_t cached_head;  // the producer's last look at head
+    struct log_ring *next;
+    alignas(LOG_CACHE_LINE) char data[LOG_RING_SIZE];
+} log_ring_t;
+
+typedef struct {
+    uint32_t len;               // header and arguments, rounded up to LOG_RECORD_ALIGN
+    uint32_t pad;               // fills the end of the ring; nothing else is set
+    const log_site_t *site;
+    uint64_t ticks;
+    // then each argument: its tag, then the value, or a string's length and bytes
+} log_header_t;
+
+typedef struct {
+    char buf[LOG_LINE_MAX];
+    size_t len;
+} log_line_t;
+
+static uint8_t private_level = LOG_LEVEL_INFO;
+volatile uint8_t *log_level_now = &private_level;
+
+static log_ring_t *rings;           // every thread that has logged since log_start
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread log_ring_t *thread_ring;
+static int started;
+static int stopping;
+static int wake_fd = -1;
+static pthread_t formatter;
+
+static const char *const level_names[] = { "debug", "info", "warn", "error", "off" };
+static const char *const level_tags[] = { "DEBUG", "INFO ", "WARN ", "ERROR" };
+
+// The cheapest clock there is; the formatter turns it into wall time
+static inline uint64_t log_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---- Recording ----
+
+static uint32_t capped(size_t len) {
+    return len > LOG_STRING_MAX ? LOG_STRING_MAX | LOG_TRUNCATED : (uint32_t)len;
+}
+
+// What the arguments take after the header; the strings' lengths go in lens
+static size_t measure_args(const log_arg_t *args, size_t count, uint32_t *lens) {
+    size_t size = 1;  // LOG_ARG_END
+    for (size_t i = 0; i < count; i++) {
+        if (args[i].tag == LOG_ARG_STRING)
+            lens[i] = args[i].ptr ? capped(strnlen(args[i].ptr, LOG_STRING_MAX + 1)) : 6;
+        else if (args[i].tag == LOG_ARG_SPAN)
+            lens[i] = capped(args[i].len);
+        else {
+            size += 1 + sizeof(uint64_t);
+            continue;
+        }
+        size += 1 + sizeof(uint32_t) + (lens[i] & ~LOG_TRUNCATED);
+    }
+    return size;
+}
+
+// Short strings are copied inline, in two overlapping moves
+static inline void copy_bytes(char *dst, const char *src, size_t len) {
+    if (len >= 8 && len <= 16) {
+        uint64_t a, b;
+        memcpy(&a, src, 8);
+        memcpy(&b, src + len - 8, 8);
+        memcpy(dst, &a, 8);
+        memcpy(dst + len - 8, &b, 8);
+    } else {
+        memcpy(dst, src, len);
+    }
+}
+
+// The arguments after the header at p, as measure_args found them
+static void encode_args(char *p, const log_arg_t *args, size_t count, const uint32_t *lens) {
+    for (size_t i = 0; i < count; i++) {
+        *p++ = (char)args[i].tag;
+        if (args[i].tag == LOG_ARG_STRING || args[i].tag == LOG_ARG_SPAN) {
+            size_t len = lens[i] & ~LOG_TRUNCATED;
+            memcpy(p, &lens[i], sizeof(lens[i]));
+            copy_bytes(p + sizeof(lens[i]), args[i].ptr ? args[i].ptr : "(null)", len);
+            p += sizeof(lens[i]) + len;
+        } else {
+            memcpy(p, &args[i].bits, sizeof(args[i].bits));
+            p += sizeof(args[i].bits);
+        }
+    }
+    *p = LOG_ARG_END;
+}
+
+static log_ring_t *ring_new(void) {
+    log_ring_t *r = aligned_alloc(LOG_CACHE_LINE, sizeof(*r));
+    if (!r)
+        return NULL;
+    memset(r, 0, offsetof(log_ring_t, data));
+    // The formatter walks the list without the lock: a ring is only ever added at the front
+    pthread_mutex_lock(&rings_lock);
+    r->next = rings;
+    __atomic_store_n(&rings, r, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&rings_lock);
+    return r;
+}
+
+// Room for size contiguous bytes, or NULL if the formatter is that far
+// behind; *tail is where the ring's tail goes once they are written
+static log_header_t *ring_reserve(log_ring_t *r, size_t size, uint64_t *tail) {
+    uint64_t t = r->tail;
+    size_t off = t & (LOG_RING_SIZE - 1);
+    size_t pad = off + size > LOG_RING_SIZE ? LOG_RING_SIZE - off : 0;
+    if (t + pad + size - r->cached_head > LOG_RING_SIZE) {
+        r->cached_head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (t + pad + size - r->cached_head > LOG_RING_SIZE)
+            return NULL;
+    }
+    if (pad) {
+        log_header_t *fill = (log_header_t *)(r->data + off);
+        fill->len = (uint32_t)pad;
+        fill->pad = 1;
+        t += pad;
+        off = 0;
+    }
+    *tail = t + size;
+    return (log_header_t *)(r->data + off);
+}
+
+static void format_record(log_line_t *line, const log_header_t *h, uint64_t wall_ns);
+static void write_all(int fd, const char *buf, size_t len);
+
+// Before log_start, and for warnings and errors: format it here and now
+static void record_now(const log_site_t *site, size_t size, const log_arg_t *args, size_t count,
+                       const uint32_t *lens) {
+    log_header_t *h = malloc(size);
+    log_line_t *line = malloc(sizeof(*line));
+    if (h && line) {
+        h->len = (uint32_t)size;
+        h->pad = 0;
+        h->site = site;
+        encode_args((char *)(h + 1), args, count, lens);
+        line->len = 0;
+        format_record(line, h, clock_ns(CLOCK_REALTIME));
+        write_all(site->level >= LOG_LEVEL_WARN ? STDERR_FILENO : STDOUT_FILENO, line->buf, line->len);
+    }
+    free(h);
+    free(line);
+}
+
+void log_record(const log_site_t *site, const log_arg_t *args, size_t count) {
+    uint64_t ticks = log_ticks();
+    uint32_t lens[LOG_MAX_ARGS];
+    if (count > LOG_MAX_ARGS)
+        count = LOG_MAX_ARGS;
+    size_t size = (sizeof(log_header_t) + measure_args(args, count, lens) + LOG_RECORD_ALIGN - 1)
+                  & ~(size_t)(LOG_RECORD_ALIGN - 1);
+
+    // Warnings and errors are what a crash must not take with it
+    if (site->level >= LOG_LEVEL_WARN || !__atomic_load_n(&started, __ATOMIC_ACQUIRE)) {
+        record_now(site, size, args, count, lens);
+        return;
+    }
+    log_ring_t *r = thread_ring;
+    if (!r && !(r = thread_ring = ring_new()))
+        return;
+    uint64_t tail;
+    log_header_t *h = ring_reserve(r, size, &tail);
+    if (!h) {
+        __atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    h->len = (uint32_t)size;
+    h->pad = 0;
+    h->site = site;
+    h->ticks = ticks;
+    encode_args((char *)(h + 1), args, count, lens);
+
+    uint64_t before = r->tail;
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    // Past half full: no point waiting for the formatter's next look
+    uint64_t half = r->cached_head + LOG_RING_SIZE / 2;
+    if (before < half && tail >= half) {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            // It looks within LOG_FLUSH_MS anyway
+        }
+    }
+}
+
+// ---- Formatting ----
+
+static void line_append(log_line_t *line, const char *s, size_t len) {
+    if (len > sizeof(line->buf) - line->len)
+        len = sizeof(line->buf) - line->len;
+    memcpy(line->buf + line->len, s, len);
+    line->len += len;
+}
+
+static void line_printf(log_line_t *line, const char *fmt, ...) {
+    size_t room = sizeof(line->buf) - line->len;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line->buf + line->len, room, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        line->len += (size_t)n < room ? (size_t)n : room - 1;
+}
+
+typedef struct {
+    int tag;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        void *p;
+        struct {
+            const char *ptr;
+            uint32_t len;
+        } s;
+    };
+} log_value_t;
+
+static const char *next_arg(const char *p, log_value_t *v) {
+    v->tag = *p;
+    if (v->tag == LOG_ARG_END)
+        return p;
+    p++;
+    switch (v->tag) {
+    case LOG_ARG_INT:
+    case LOG_ARG_UINT:
+        memcpy(&v->i, p, sizeof(v->i));
+        return p + sizeof(v->i);
+    case LOG_ARG_DOUBLE:
+        memcpy(&v->d, p, sizeof(v->d));
+        return p + sizeof(v->d);
+    case LOG_ARG_POINTER:
+        memcpy(&v->p, p, sizeof(v->p));
+        return p + sizeof(v->p);
+    default:
+        memcpy(&v->s.len, p, sizeof(v->s.len));
+        v->s.ptr = p + sizeof(v->s.len);
+        return v->s.ptr + (v->s.len & ~LOG_TRUNCATED);
+    }
+}
+
+static long long as_int(const log_value_t *v) {
+    return v->tag == LOG_ARG_DOUBLE ? (long long)v->d : v->tag == LOG_ARG_END ? 0 : v->i;
+}
+
+// One conversion. spec is printf's, length modifiers left out, with room
+// for one of ours.
+static void format_value(log_line_t *line, char *spec, size_t n, char conv, const log_value_t *v) {
+    if (v->tag == LOG_ARG_END) {
+        line_append(line, "(missing)", 9);
+        return;
+    }
+    if (v->tag == LOG_ARG_STRING || v->tag == LOG_ARG_SPAN) {
+        size_t len = v->s.len & ~LOG_TRUNCATED;
+        if (n == 1) {
+            line_append(line, v->s.ptr, len);
+        } else {
+            // Width or precision: printf wants it NUL-terminated
+            char copy[LOG_STRING_MAX + 1];
+            memcpy(copy, v->s.ptr, len);
+            copy[len] = '\0';
+            memcpy(spec + n, "s", 2);
+            line_printf(line, spec, copy);
+        }
+        if (v->s.len & LOG_TRUNCATED)
+            line_append(line, "...", 3);
+        return;
+    }
+    switch (conv) {
+    case 'd': case 'i':
+        memcpy(spec + n, "lld", 4);
+        line_printf(line, spec, as_int(v));
+        break;
+    case 'u': case 'o': case 'x': case 'X':
+        spec[n] = 'l';
+        spec[n + 1] = 'l';
+        spec[n + 2] = conv;
+        spec[n + 3] = '\0';
+        line_printf(line, spec, (unsigned long long)as_int(v));
+        break;
+    case 'c':
+        memcpy(spec + n, "c", 2);
+        line_printf(line, spec, (int)as_int(v));
+        break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        spec[n] = conv;
+        spec[n + 1] = '\0';
+        line_printf(line, spec, v->tag == LOG_ARG_DOUBLE ? v->d
+                                : v->tag == LOG_ARG_UINT ? (double)v->u : (double)v->i);
+        break;
+    case 'p':
+        line_printf(line, "%p", v->tag == LOG_ARG_POINTER ? v->p : (void *)(uintptr_t)v->u);
+        break;
+    default:
+        // %s of a number, or a conversion we do not know: the value as it is
+        if (v->tag == LOG_ARG_DOUBLE)
+            line_printf(line, "%g", v->d);
+        else if (v->tag == LOG_ARG_POINTER)
+            line_printf(line, "%p", v->p);
+        else if (v->tag == LOG_ARG_UINT)
+            line_printf(line, "%llu", v->u);
+        else
+            line_printf(line, "%lld", v->i);
+    }
+}
+
+// A width or precision: digits, or * for the next argument
+static const char *spec_number(const char *f, char *spec, size_t *n, const char **args) {
+    if (*f == '*') {
+        log_value_t v;
+        *args = next_arg(*args, &v);
+        *n += (size_t)snprintf(spec + *n, 12, "%d", (int)as_int(&v));
+        return f + 1;
+    }
+    while (*f >= '0' && *f <= '9') {
+        if (*n < 20)
+            spec[(*n)++] = *f;
+        f++;
+    }
+    return f;
+}
+
+static void format_message(log_line_t *line, const char *fmt, const char *args) {
+    const char *f = fmt;
+    for (;;) {
+        const char *pct = strchr(f, '%');
+        if (!pct) {
+            line_append(line, f, strlen(f));
+            return;
+        }
+        line_append(line, f, (size_t)(pct - f));
+        f = pct + 1;
+        if (*f == '%') {
+            line_append(line, "%", 1);
+            f++;
+            continue;
+        }
+
+        char spec[64] = "%";
+        size_t n = 1;
+        while (*f && strchr("-+ #0", *f)) {
+            if (n < 8)
+                spec[n++] = *f;
+            f++;
+        }
+        f = spec_number(f, spec, &n, &args);
+        if (*f == '.') {
+            spec[n++] = *f++;
+            f = spec_number(f, spec, &n, &args);
+        }
+        while (*f && strchr("hlLqjzt", *f))
+            f++;
+        if (!*f)
+            return;
+        char conv = *f++;
+
+        log_value_t v;
+        args = next_arg(args, &v);
+        spec[n] = '\0';
+        format_value(line, spec, n, conv, &v);
+    }
+}
+
+static void format_prefix(log_line_t *line, unsigned level, uint64_t wall_ns) {
+    static __thread time_t last_sec = -1;
+    static __thread char stamp[32];
+    time_t sec = (time_t)(wall_ns / 1000000000ull);
+    if (sec != last_sec) {
+        struct tm tm;
+        localtime_r(&sec, &tm);
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+        last_sec = sec;
+    }
+    line_printf(line, "%s.%03u %s [%d] ", stamp, (unsigned)(wall_ns / 1000000 % 1000),
+                level_tags[level < LOG_LEVEL_OFF ? level : LOG_LEVEL_ERROR], (int)getpid());
+}
+
+static void format_record(log_line_t *line, const log_header_t *h, uint64_t wall_ns) {
+    format_prefix(line, h->site->level, wall_ns);
+    format_message(line, h->site->fmt, (const char *)(h + 1));
+    if (line->len == sizeof(line->buf))
+        line->len--;
+    line->buf[line->len++] = '\n';
+}
+
+static void write_all(int fd, const char *buf, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+// ---- The formatter thread ----
+
+typedef struct {
+    int fd;
+    size_t len;
+    char buf[LOG_BATCH_SIZE];
+} log_batch_t;
+
+// Ticks to wall time: a pair of readings from when the thread started, and
+// the rate measured since
+typedef struct {
+    uint64_t ticks0, mono0, wall0;
+    double ns_per_tick;
+} log_clock_t;
+
+static void clock_sample(log_clock_t *c) {
+    uint64_t ticks = log_ticks(), mono = clock_ns(CLOCK_MONOTONIC);
+    if (ticks > c->ticks0 && mono > c->mono0)
+        c->ns_per_tick = (double)(mono - c->mono0) / (double)(ticks - c->ticks0);
+}
+
+static uint64_t clock_wall(const log_clock_t *c, uint64_t ticks) {
+    return c->wall0 + (uint64_t)(int64_t)(((double)ticks - (double)c->ticks0) * c->ns_per_tick);
+}
+
+static void batch_flush(log_batch_t *b) {
+    write_all(b->fd, b->buf, b->len);
+    b->len = 0;
+}
+
+static void batch_add(log_batch_t *b, const log_line_t *line) {
+    if (b->len + line->len > sizeof(b->buf))
+        batch_flush(b);
+    memcpy(b->buf + b->len, line->buf, line->len);
+    b->len += line->len;
+}
+
+typedef struct {
+    log_batch_t out, err;
+    log_line_t line;
+    log_clock_t clock;
+} log_formatter_t;
+
+// Everything the rings hold
+static void drain(log_formatter_t *fm) {
+    for (log_ring_t *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t head = r->head;
+        uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+        while (head < tail) {
+            const log_header_t *h = (const log_header_t *)(r->data + (head & (LOG_RING_SIZE - 1)));
+            if (!h->pad) {
+                fm->line.len = 0;
+                format_record(&fm->line, h, clock_wall(&fm->clock, h->ticks));
+                batch_add(h->site->level >= LOG_LEVEL_WARN ? &fm->err : &fm->out, &fm->line);
+            }
+            head += h->len;
+            __atomic_store_n(&r->head, head, __ATOMIC_RELEASE);
+        }
+        uint64_t dropped = __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+        if (dropped != r->dropped_seen) {
+            fm->line.len = 0;
+            format_prefix(&fm->line, LOG_LEVEL_WARN, clock_ns(CLOCK_REALTIME));
+            line_printf(&fm->line, "%llu log records dropped, the formatter fell behind\n",
+                        (unsigned long long)(dropped - r->dropped_seen));
+            batch_add(&fm->err, &fm->line);
+            r->dropped_seen = dropped;
+        }
+    }
+    batch_flush(&fm->out);
+    batch_flush(&fm->err);
+}
+
+static void *formatter_main(void *arg) {
+    log_formatter_t *fm = arg;
+    struct pollfd pfd = { .fd = wake_fd, .events = POLLIN };
+    int stop = 0;
+    while (!stop) {
+        // A batch is whatever came in meanwhile
+        if (poll(&pfd, 1, LOG_FLUSH_MS) > 0) {
+            uint64_t count;
+            if (read(wake_fd, &count, sizeof(count)) < 0) {
+                // Already reset by an earlier read
+            }
+        }
+        // Read first: what was logged before log_stop is in this last pass
+        stop = __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+        clock_sample(&fm->clock);
+        drain(fm);
+    }
+    return NULL;
+}
+
+static log_formatter_t *formatter_state;
+
+// In a forked child the thread is gone; log on the spot until it starts its own
+static void after_fork(void) {
+    started = 0;
+    stopping = 0;
+    rings = NULL;
+    thread_ring = NULL;
+    formatter_state = NULL;
+    if (wake_fd >= 0)
+        close(wake_fd);
+    wake_fd = -1;
+}
+
+int log_start(void) {
+    static int registered;
+    if (started)
+        return 0;
+    if (!registered) {
+        pthread_atfork(NULL, NULL, after_fork);
+        atexit(log_stop);
+        registered = 1;
+    }
+    log_formatter_t *fm = calloc(1, sizeof(*fm));
+    if (!fm)
+        return -1;
+    fm->out.fd = STDOUT_FILENO;
+    fm->err.fd = STDERR_FILENO;
+    fm->clock.ticks0 = log_ticks();
+    fm->clock.mono0 = clock_ns(CLOCK_MONOTONIC);
+    fm->clock.wall0 = clock_ns(CLOCK_REALTIME);
+    fm->clock.ns_per_tick = 1.0;  // measured before each pass, against an ever longer span
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        free(fm);
+        return -1;
+    }
+    // The thread takes no signals: they stay with the thread that logs
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    stopping = 0;
+    int rc = pthread_create(&formatter, NULL, formatter_main, fm);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        close(wake_fd);
+        wake_fd = -1;
+        free(fm);
+        errno = rc;
+        return -1;
+    }
+    formatter_state = fm;
+    __atomic_store_n(&started, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void log_stop(void) {
+    if (!started)
+        return;
+    __atomic_store_n(&started, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        // It is bound to look within LOG_FLUSH_MS
+    }
+    pthread_join(formatter, NULL);
+    close(wake_fd);
+    wake_fd = -1;
+    free(formatter_state);
+    formatter_state = NULL;
+    // The rings stay: a thread may still hold its own
+}
+
+// ---- Levels ----
+
+int log_share_level(void) {
+    uint8_t *mem = mmap(NULL, sizeof(uint8_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return -1;
+    *mem = *log_level_now;
+    log_level_now = mem;
+    return 0;
+}
+
+void log_set_level(log_level_t level) {
+    *log_level_now = (uint8_t)level;
+}
+
+log_level_t log_get_level(void) {
+    return (log_level_t)*log_level_now;
+}
+
+int log_parse_level(const char *name) {
+    for (int i = 0; i <= LOG_LEVEL_OFF; i++) {
+        if (strcmp(name, level_names[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const char *log_level_name(log_level_t level) {
+    return level <= LOG_LEVEL_OFF ? level_names[level] : "?";
+}
@@ -0,0 +1,152 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Structured logging off the hot path. A call site costs a level check, and
+// when enabled a compact binary record in the calling thread's ring: a
+// timestamp, the call site as the format id, and the arguments as they are.
+// A thread of the process's own formats the records and writes them out to
+// stdout in batches. A full ring drops records rather than wait; the
+// formatter says how many. Warnings and errors go to stderr on the spot,
+// so that a crash cannot lose them.
+//
+//   LOG_INFO("Station %s connected after %d ms", station_id, elapsed);
+//   LOG_DEBUG("Received: %s", LOG_SPAN(text, len));
+//
+// Up to eight arguments: integers, doubles, NUL-terminated strings (copied,
+// up to LOG_STRING_MAX bytes), LOG_SPAN for bytes that are not, and pointers.
+// Before log_start, and if its thread could not be started, records are
+// formatted and written on the spot.
+
+#define LOG_RING_SIZE   (1u << 20)  // bytes per thread
+#define LOG_STRING_MAX  8192        // longer strings are cut short, marked with "..."
+#define LOG_FLUSH_MS    20          // how long a record may wait to be written
+#define LOG_BATCH_SIZE  65536       // formatted bytes written at once
+
+typedef enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+} log_level_t;
+
+// A call site, in read-only memory; records point at it
+typedef struct {
+    const char *fmt;
+    uint8_t level;
+} log_site_t;
+
+// Bytes that need not end in NUL, formatted by %s
+typedef struct {
+    const char *ptr;
+    size_t len;
+} log_span_t;
+
+#define LOG_SPAN(p, n) ((log_span_t){ (const char *)(p), (size_t)(n) })
+
+enum {
+    LOG_ARG_END,
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,
+    LOG_ARG_SPAN,
+    LOG_ARG_POINTER
+};
+
+// An argument as the call site hands it over: its type tag and itself.
+// Integers are widened to 64 bits so the formatter reads one size; a
+// string's length is taken by log_record.
+typedef struct {
+    int tag;
+    size_t len;                 // a span's bytes
+    union {
+        uint64_t bits;          // integers, doubles and pointers as they are
+        const char *ptr;
+    };
+} log_arg_t;
+
+// A function per type, as _Generic checks the branches it does not take too
+static inline log_arg_t log_arg_int(long long v) {
+    return (log_arg_t){ .tag = LOG_ARG_INT, .bits = (uint64_t)v };
+}
+static inline log_arg_t log_arg_uint(unsigned long long v) {
+    return (log_arg_t){ .tag = LOG_ARG_UINT, .bits = v };
+}
+static inline log_arg_t log_arg_double(double v) {
+    log_arg_t a = { .tag = LOG_ARG_DOUBLE };
+    __builtin_memcpy(&a.bits, &v, sizeof(v));
+    return a;
+}
+static inline log_arg_t log_arg_string(const char *v) {
+    return (log_arg_t){ .tag = LOG_ARG_STRING, .ptr = v };
+}
+static inline log_arg_t log_arg_span(log_span_t v) {
+    return (log_arg_t){ .tag = LOG_ARG_SPAN, .len = v.len, .ptr = v.ptr };
+}
+static inline log_arg_t log_arg_pointer(const void *v) {
+    return (log_arg_t){ .tag = LOG_ARG_POINTER, .bits = (uintptr_t)v };
+}
+#define LOG_ARG(x) _Generic((x), \
+    _Bool: log_arg_int, char: log_arg_int, signed char: log_arg_int, short: log_arg_int, \
+    int: log_arg_int, long: log_arg_int, long long: log_arg_int, \
+    unsigned char: log_arg_uint, unsigned short: log_arg_uint, unsigned: log_arg_uint, \
+    unsigned long: log_arg_uint, unsigned long long: log_arg_uint, \
+    float: log_arg_double, double: log_arg_double, \
+    char *: log_arg_string, const char *: log_arg_string, \
+    log_span_t: log_arg_span, \
+    default: log_arg_pointer)(x)
+
+#define LOG_ARGS_0()
+#define LOG_ARGS_1(a) LOG_ARG(a)
+#define LOG_ARGS_2(a, b) LOG_ARGS_1(a), LOG_ARG(b)
+#define LOG_ARGS_3(a, b, c) LOG_ARGS_2(a, b), LOG_ARG(c)
+#define LOG_ARGS_4(a, b, c, d) LOG_ARGS_3(a, b, c), LOG_ARG(d)
+#define LOG_ARGS_5(a, b, c, d, e) LOG_ARGS_4(a, b, c, d), LOG_ARG(e)
+#define LOG_ARGS_6(a, b, c, d, e, f) LOG_ARGS_5(a, b, c, d, e), LOG_ARG(f)
+#define LOG_ARGS_7(a, b, c, d, e, f, g) LOG_ARGS_6(a, b, c, d, e, f), LOG_ARG(g)
+#define LOG_ARGS_8(a, b, c, d, e, f, g, h) LOG_ARGS_7(a, b, c, d, e, f, g), LOG_ARG(h)
+#define LOG_ARGS_PICK(_0, _1, _2, _3, _4, _5, _6, _7, _8, name, ...) name
+#define LOG_ARGS(...) LOG_ARGS_PICK(_0, ##__VA_ARGS__, LOG_ARGS_8, LOG_ARGS_7, LOG_ARGS_6, LOG_ARGS_5, \
+                                    LOG_ARGS_4, LOG_ARGS_3, LOG_ARGS_2, LOG_ARGS_1, LOG_ARGS_0)(__VA_ARGS__)
+
+// Where the level is read from: this process's own, or the page
+// log_share_level mapped
+extern volatile uint8_t *log_level_now;
+
+#define LOG_AT(lvl, fmt, ...) do { \
+        if ((lvl) >= *log_level_now) { \
+            static const log_site_t log_site_ = { fmt, lvl }; \
+            const log_arg_t log_args_[] = { LOG_ARGS(__VA_ARGS__) }; \
+            log_record(&log_site_, log_args_, sizeof(log_args_) / sizeof(log_args_[0])); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+// Use the macros
+void log_record(const log_site_t *site, const log_arg_t *args, size_t count);
+
+// Main process, before forking: keep the level in shared memory so that a
+// change in any process applies to all of them. Returns -1 if it could not
+// be mapped.
+int log_share_level(void);
+void log_set_level(log_level_t level);
+log_level_t log_get_level(void);
+// "debug", "info", "warn", "error" or "off"; -1 for anything else
+int log_parse_level(const char *name);
+const char *log_level_name(log_level_t level);
+
+// Start this process's formatter thread; after a fork, the child's own.
+// Returns -1 with errno set if it could not be started.
+int log_start(void);
+// Write out what is queued and stop the thread. Also runs at exit.
+void log_stop(void);
+
+#endif
@@ -0,0 +1,165 @@
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "TLSEngine.h"
+
+int tls_engine_init(tls_engine_t *tls, SSL_CTX *ctx, int server, int fd) {
+    tls->ssl = SSL_new(ctx);
+    tls->net = NULL;
+    if (!tls->ssl)
+        return -1;
+
+    if (fd >= 0) {
+        SSL_set_fd(tls->ssl, fd);
+    } else {
+        BIO *inner;
+        if (!BIO_new_bio_pair(&inner, TLS_ENGINE_BUFFER_SIZE, &tls->net, TLS_ENGINE_BUFFER_SIZE)) {
+            SSL_free(tls->ssl);
+            tls->ssl = NULL;
+            return -1;
+        }
+        SSL_set_bio(tls->ssl, inner, inner);  // the SSL owns the inner end
+    }
+    if (server)
+        SSL_set_accept_state(tls->ssl);
+    else
+        SSL_set_connect_state(tls->ssl);
+    return 0;
+}
+
+void tls_engine_free(tls_engine_t *tls) {
+    SSL_free(tls->ssl);
+    BIO_free(tls->net);
+    tls->ssl = NULL;
+    tls->net = NULL;
+}
+
+// Map an SSL result onto progress / needs I/O / failed
+static int tls_engine_result(tls_engine_t *tls, int rc) {
+    if (rc > 0)
+        return rc;
+    int err = SSL_get_error(tls->ssl, rc);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+        return 0;
+    return -1;
+}
+
+int tls_engine_handshake(tls_engine_t *tls) {
+    return tls_engine_result(tls, SSL_do_handshake(tls->ssl));
+}
+
+int tls_engine_read(tls_engine_t *tls, void *buf, size_t len) {
+    return tls_engine_result(tls, SSL_read(tls->ssl, buf, len > INT_MAX ? INT_MAX : (int)len));
+}
+
+int tls_engine_write(tls_engine_t *tls, const void *buf, size_t len) {
+    return tls_engine_result(tls, SSL_write(tls->ssl, buf, len > INT_MAX ? INT_MAX : (int)len));
+}
+
+void tls_engine_shutdown(tls_engine_t *tls) {
+    SSL_shutdown(tls->ssl);
+}
+
+uint8_t *tls_engine_input(tls_engine_t *tls, size_t *avail) {
+    char *p = NULL;
+    int n = tls->net ? BIO_nwrite0(tls->net, &p) : 0;
+    *avail = n > 0 ? (size_t)n : 0;
+    return n > 0 ? (uint8_t *)p : NULL;
+}
+
+void tls_engine_commit(tls_engine_t *tls, size_t n) {
+    char *p;
+    BIO_nwrite(tls->net, &p, (int)n);
+}
+
+const uint8_t *tls_engine_output(tls_engine_t *tls, size_t *len) {
+    char *p = NULL;
+    int n = tls->net ? BIO_nread0(tls->net, &p) : 0;
+    *len = n > 0 ? (size_t)n : 0;
+    return n > 0 ? (const uint8_t *)p : NULL;
+}
+
+void tls_engine_consume(tls_engine_t *tls, size_t n) {
+    char *p;
+    BIO_nread(tls->net, &p, (int)n);
+}
+
+size_t tls_engine_pending(tls_engine_t *tls) {
+    return tls->net ? BIO_ctrl_pending(tls->net) : 0;
+}
+
+int tls_engine_recv_fd(tls_engine_t *tls, int fd) {
+    size_t avail;
+    uint8_t *dst = tls_engine_input(tls, &avail);
+    if (!dst)
+        return 0;  // bound to the socket, or OpenSSL has not drained the last read
+
+    for (;;) {
+        ssize_t n = read(fd, dst, avail);
+        if (n > 0) {
+            tls_engine_commit(tls, (size_t)n);
+            return (int)n;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return -1;
+    }
+}
+
+int tls_engine_send_fd(tls_engine_t *tls, int fd) {
+    int total = 0;
+    for (;;) {
+        size_t len;
+        const uint8_t *src = tls_engine_output(tls, &len);
+        if (!src)
+            return total;
+
+        ssize_t n = send(fd, src, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return total;
+            return -1;
+        }
+        tls_engine_consume(tls, (size_t)n);
+        total += (int)n;
+    }
+}
+
+// Let OpenSSL's output out and the peer's input in; 0 when neither moved
+static int tls_engine_pump_fd(tls_engine_t *tls, int fd) {
+    int sent = tls_engine_send_fd(tls, fd);
+    if (sent < 0)
+        return -1;
+    int got = tls_engine_recv_fd(tls, fd);
+    if (got < 0)
+        return -1;
+    return sent > 0 || got > 0;
+}
+
+int tls_engine_handshake_fd(tls_engine_t *tls, int fd) {
+    for (;;) {
+        int rc = tls_engine_handshake(tls);
+        if (rc != 0) {
+            // The final flight may still be sitting in the pair
+            if (rc > 0 && tls_engine_send_fd(tls, fd) < 0)
+                return -1;
+            return rc;
+        }
+        int moved = tls_engine_pump_fd(tls, fd);
+        if (moved <= 0)
+            return moved;
+    }
+}
+
+int tls_engine_read_fd(tls_engine_t *tls, int fd, void *buf, size_t len) {
+    for (;;) {
+        int n = tls_engine_read(tls, buf, len);
+        if (n != 0)
+            return n;
+        int moved = tls_engine_pump_fd(tls, fd);
+        if (moved <= 0)
+            return moved;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef TLS_ENGINE_H
+#define TLS_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/ssl.h>
+
+// Ciphertext buffered in each direction: a full-size record with its header
+// and cipher expansion, or dozens of the small records OCPP traffic produces
+#define TLS_ENGINE_BUFFER_SIZE (17 * 1024)
+
+// OpenSSL behind a BIO pair. The transport moves ciphertext in and out of the
+// engine in bulk, so records from many writes leave in one send and the TLS
+// layer runs the same over a socket or an in-memory pipe. Bound to a socket
+// fd instead, OpenSSL does its own I/O; kernel TLS offload needs that.
+typedef struct {
+    SSL *ssl;           // NULL when the connection is not encrypted
+    BIO *net;           // our end of the pair, NULL when bound to a socket
+} tls_engine_t;
+
+// server selects the accepting side. fd >= 0 binds the socket directly,
+// -1 sets up the BIO pair. Returns -1 if OpenSSL could not allocate.
+int tls_engine_init(tls_engine_t *tls, SSL_CTX *ctx, int server, int fd);
+void tls_engine_free(tls_engine_t *tls);
+
+// Application side. > 0 is progress, 0 means the engine needs more
+// ciphertext moved (or a bound socket would block), -1 a failure or the
+// peer's close_notify. A write returning 0 must be retried with the same bytes.
+int tls_engine_handshake(tls_engine_t *tls);     // 1 once complete
+int tls_engine_read(tls_engine_t *tls, void *buf, size_t len);
+int tls_engine_write(tls_engine_t *tls, const void *buf, size_t len);
+// Queue close_notify for the transport
+void tls_engine_shutdown(tls_engine_t *tls);
+
+// Transport side: contiguous room for incoming ciphertext, and the next run
+// of outgoing ciphertext. Both return NULL with *len == 0 when there is none.
+uint8_t *tls_engine_input(tls_engine_t *tls, size_t *avail);
+void tls_engine_commit(tls_engine_t *tls, size_t n);
+const uint8_t *tls_engine_output(tls_engine_t *tls, size_t *len);
+void tls_engine_consume(tls_engine_t *tls, size_t n);
+// All ciphertext not yet handed to the transport
+size_t tls_engine_pending(tls_engine_t *tls);
+
+// Move ciphertext over a socket. recv reads once and returns the bytes taken
+// in, send writes until drained or blocked and returns the bytes sent; both
+// return 0 when the socket has nothing to give or take and -1 on EOF or error.
+int tls_engine_recv_fd(tls_engine_t *tls, int fd);
+int tls_engine_send_fd(tls_engine_t *tls, int fd);
+
+// Drive the handshake / read plaintext, moving ciphertext over fd as needed.
+// Same returns as the application side calls; 0 now means fd would block.
+int tls_engine_handshake_fd(tls_engine_t *tls, int fd);
+int tls_engine_read_fd(tls_engine_t *tls, int fd, void *buf, size_t len);
+
+#endif
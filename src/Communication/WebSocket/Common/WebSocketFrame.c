@@ -0,0 +1,341 @@
+#include <string.h>
+
+#include "WebSocketFrame.h"
+#include "BufferPool.h"
+
+// Worst case a fragmented message at the limit sits behind its first header
+// while the next fragment's header and an interleaved control frame arrive.
+#define WS_RX_SLACK (2 * WS_MAX_HEADER_SIZE + WS_MAX_CONTROL_PAYLOAD)
+
+int ws_parse_frame_header(const uint8_t *data, size_t len, ws_frame_header_t *hdr) {
+    if (len < 2) return 0;
+
+    hdr->fin = data[0] >> 7;
+    hdr->rsv = (data[0] >> 4) & 0x07;
+    hdr->opcode = data[0] & 0x0F;
+    hdr->masked = data[1] >> 7;
+
+    uint64_t payload_len = data[1] & 0x7F;
+    size_t header_len = 2;
+
+    if (payload_len == 126) {
+        if (len < 4) return 0;
+        payload_len = ((uint64_t)data[2] << 8) | data[3];
+        header_len = 4;
+    } else if (payload_len == 127) {
+        if (len < 10) return 0;
+        payload_len = 0;
+        for (int i = 0; i < 8; i++)
+            payload_len = (payload_len << 8) | data[2 + i];
+        if (payload_len >> 63) return -1;  // most significant bit must be 0
+        header_len = 10;
+    }
+
+    if (hdr->masked) {
+        if (len < header_len + 4) return 0;
+        memcpy(hdr->mask, data + header_len, 4);
+        header_len += 4;
+    }
+
+    hdr->payload_len = payload_len;
+    hdr->header_len = header_len;
+    return 1;
+}
+
+size_t ws_build_frame_header(uint8_t *out, uint8_t opcode, int fin, uint64_t payload_len, const uint8_t *mask) {
+    size_t n = 2;
+
+    out[0] = (fin ? 0x80 : 0x00) | (opcode & (WS_RSV1 | 0x0F));
+    out[1] = mask ? 0x80 : 0x00;
+
+    if (payload_len < 126) {
+        out[1] |= (uint8_t)payload_len;
+    } else if (payload_len <= 0xFFFF) {
+        out[1] |= 126;
+        out[2] = (uint8_t)(payload_len >> 8);
+        out[3] = (uint8_t)payload_len;
+        n = 4;
+    } else {
+        out[1] |= 127;
+        for (int i = 0; i < 8; i++)
+            out[2 + i] = (uint8_t)(payload_len >> (56 - 8 * i));
+        n = 10;
+    }
+
+    if (mask) {
+        memcpy(out + n, mask, 4);
+        n += 4;
+    }
+    return n;
+}
+
+void ws_decoder_init(ws_decoder_t *d, int is_server, size_t max_message) {
+    memset(d, 0, sizeof(*d));
+    d->is_server = is_server ? 1 : 0;
+    d->max_message = max_message ? max_message : WS_DEFAULT_MAX_MESSAGE;
+}
+
+void ws_decoder_free(ws_decoder_t *d) {
+    buf_pool_put(d->data);
+    d->data = NULL;
+    d->cap = d->head = d->parse = d->tail = 0;
+    d->msg_start = d->msg_end = 0;
+    d->msg_opcode = 0;
+}
+
+void ws_decoder_release(ws_decoder_t *d) {
+    if (d->data && !d->msg_opcode && d->parse == d->tail) {
+        buf_pool_put(d->data);
+        d->data = NULL;
+        d->cap = d->head = d->parse = d->tail = 0;
+    }
+}
+
+// Move live bytes to the front of the buffer. Bytes between the reassembled
+// payload and the next frame (continuation headers, handled control frames)
+// are squeezed out on the way.
+static void ws_decoder_compact(ws_decoder_t *d) {
+    if (d->msg_opcode) {
+        size_t kept = d->msg_end - d->head;
+        size_t rest = d->tail - d->parse;
+        memmove(d->data, d->data + d->head, kept);
+        memmove(d->data + kept, d->data + d->parse, rest);
+        d->msg_start -= d->head;
+        d->msg_end = kept;
+        d->parse = kept;
+        d->tail = kept + rest;
+    } else {
+        memmove(d->data, d->data + d->head, d->tail - d->head);
+        d->parse -= d->head;
+        d->tail -= d->head;
+    }
+    d->head = 0;
+}
+
+uint8_t *ws_decoder_write_ptr(ws_decoder_t *d, size_t *avail) {
+    size_t limit = d->max_message + WS_RX_SLACK;
+
+    if (!d->data) {
+        size_t cap = WS_RX_INITIAL_SIZE < limit ? WS_RX_INITIAL_SIZE : limit;
+        d->data = buf_pool_get(cap);
+        if (!d->data) return NULL;
+        d->cap = cap;
+    }
+
+    if (d->tail == d->cap) {
+        if (d->head > 0 || (d->msg_opcode && d->msg_end < d->parse))
+            ws_decoder_compact(d);
+        if (d->tail == d->cap) {
+            if (d->cap >= limit) return NULL;
+            size_t cap = d->cap * 2 < limit ? d->cap * 2 : limit;
+            uint8_t *data = buf_pool_get(cap);
+            if (!data) return NULL;
+            memcpy(data, d->data, d->tail);
+            buf_pool_put(d->data);
+            d->data = data;
+            d->cap = cap;
+        }
+    }
+
+    *avail = d->cap - d->tail;
+    return d->data + d->tail;
+}
+
+void ws_decoder_commit(ws_decoder_t *d, size_t len) {
+    d->tail += len;
+}
+
+const uint8_t *ws_decoder_peek(const ws_decoder_t *d, size_t *len) {
+    *len = d->tail - d->parse;
+    return d->data ? d->data + d->parse : NULL;
+}
+
+void ws_decoder_consume(ws_decoder_t *d, size_t len) {
+    d->parse += len;
+    d->head = d->parse;
+    if (d->parse == d->tail)
+        d->head = d->parse = d->tail = 0;
+}
+
+int ws_utf8_check(uint32_t *state, const uint8_t *p, size_t len) {
+    // A sequence in progress owes need continuation bytes, the next one in
+    // [lo, hi]: the narrower ranges after E0, ED, F0 and F4 rule out
+    // overlong forms, surrogates and code points past U+10FFFF
+    uint32_t need = *state & 0xFF, lo = (*state >> 8) & 0xFF, hi = *state >> 16;
+    size_t i = 0;
+    while (i < len) {
+        if (!need) {
+            // OCPP is mostly ASCII: skip it a word at a time
+            uint64_t w;
+            while (i + 8 <= len && (memcpy(&w, p + i, 8), (w & 0x8080808080808080ull) == 0))
+                i += 8;
+            if (i == len)
+                break;
+        }
+        uint8_t c = p[i++];
+        if (need) {
+            if (c < lo || c > hi) return -1;
+            need--;
+            lo = 0x80;
+            hi = 0xBF;
+        } else if (c >= 0x80) {
+            if (c < 0xC2 || c > 0xF4) return -1;
+            need = c < 0xE0 ? 1 : c < 0xF0 ? 2 : 3;
+            lo = c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80;
+            hi = c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF;
+        }
+    }
+    *state = need | lo << 8 | hi << 16;
+    return 0;
+}
+
+int ws_utf8_valid(const uint8_t *p, size_t len) {
+    uint32_t state = 0;
+    return ws_utf8_check(&state, p, len) == 0 && (state & 0xFF) == 0;
+}
+
+static int ws_decoder_fail(ws_decoder_t *d, uint16_t code) {
+    d->close_code = code;
+    return -1;
+}
+
+int ws_decoder_next(ws_decoder_t *d, ws_message_t *msg) {
+    for (;;) {
+        // Everything before parse has been handed out, reclaim it
+        if (!d->msg_opcode) {
+            d->head = d->parse;
+            if (d->parse == d->tail)
+                d->head = d->parse = d->tail = 0;
+        }
+        if (!d->data) return 0;
+
+        ws_frame_header_t hdr;
+        size_t avail = d->tail - d->parse;
+        int rc = ws_parse_frame_header(d->data + d->parse, avail, &hdr);
+        if (rc == 0) return 0;
+        if (rc < 0) return ws_decoder_fail(d, WS_CLOSE_PROTOCOL_ERROR);
+
+        // permessage-deflate gives RSV1 a meaning on the first frame of a
+        // data message; every other RSV bit must be clear
+        uint8_t rsv_allowed = d->deflate && !WS_IS_CONTROL(hdr.opcode) &&
+                              hdr.opcode != WS_OPCODE_CONTINUATION ? WS_RSV1 >> 4 : 0;
+        if (hdr.rsv & ~rsv_allowed)
+            return ws_decoder_fail(d, WS_CLOSE_PROTOCOL_ERROR);
+        if (hdr.masked != d->is_server)
+            return ws_decoder_fail(d, WS_CLOSE_PROTOCOL_ERROR);
+
+        if (WS_IS_CONTROL(hdr.opcode)) {
+            if (hdr.opcode > WS_OPCODE_PONG || !hdr.fin || hdr.payload_len > WS_MAX_CONTROL_PAYLOAD)
+                return ws_decoder_fail(d, WS_CLOSE_PROTOCOL_ERROR);
+        } else if (hdr.opcode == WS_OPCODE_CONTINUATION) {
+            if (!d->msg_opcode)
+                return ws_decoder_fail(d, WS_CLOSE_PROTOCOL_ERROR);
+        } else if (hdr.opcode > WS_OPCODE_BINARY || d->msg_opcode) {
+            return ws_decoder_fail(d, WS_CLOSE_PROTOCOL_ERROR);
+        }
+
+        if (!WS_IS_CONTROL(hdr.opcode)) {
+            uint64_t so_far = d->msg_opcode ? d->msg_end - d->msg_start : 0;
+            if (hdr.payload_len > d->max_message - so_far)
+                return ws_decoder_fail(d, WS_CLOSE_TOO_BIG);
+        }
+
+        if (avail - hdr.header_len < hdr.payload_len)
+            return 0;
+
+        size_t len = (size_t)hdr.payload_len;
+        uint8_t *payload = d->data + d->parse + hdr.header_len;
+        if (hdr.masked)
+            ws_mask(payload, len, hdr.mask, 0);
+        d->parse += hdr.header_len + len;
+
+        // Text is checked as each fragment arrives, a sequence may straddle two
+        uint8_t opcode = hdr.opcode == WS_OPCODE_CONTINUATION ? d->msg_opcode : hdr.opcode;
+        int compressed = hdr.opcode == WS_OPCODE_CONTINUATION ? d->msg_compressed : hdr.rsv != 0;
+        if (opcode == WS_OPCODE_TEXT && !compressed) {
+            if (hdr.opcode != WS_OPCODE_CONTINUATION)
+                d->utf8_state = 0;
+            if (ws_utf8_check(&d->utf8_state, payload, len) < 0 || (hdr.fin && (d->utf8_state & 0xFF)))
+                return ws_decoder_fail(d, WS_CLOSE_INVALID_DATA);
+        }
+
+        if (WS_IS_CONTROL(hdr.opcode) || (hdr.opcode != WS_OPCODE_CONTINUATION && hdr.fin)) {
+            msg->opcode = hdr.opcode;
+            msg->compressed = hdr.rsv != 0;
+            msg->payload = payload;
+            msg->len = len;
+            return 1;
+        }
+
+        if (hdr.opcode != WS_OPCODE_CONTINUATION) {
+            // First fragment: its payload is where reassembly starts
+            d->msg_opcode = hdr.opcode;
+            d->msg_compressed = hdr.rsv != 0;
+            d->msg_start = (size_t)(payload - d->data);
+            d->msg_end = d->msg_start + len;
+            continue;
+        }
+
+        // Continuation: slide the payload down over the header in front of it
+        memmove(d->data + d->msg_end, payload, len);
+        d->msg_end += len;
+        if (hdr.fin) {
+            msg->opcode = d->msg_opcode;
+            msg->compressed = d->msg_compressed;
+            msg->payload = d->data + d->msg_start;
+            msg->len = d->msg_end - d->msg_start;
+            d->msg_opcode = 0;
+            return 1;
+        }
+    }
+}
+
+// Codes a peer may send (RFC 6455 7.4): the registered ones except those
+// reserved for local use, and the private ranges
+static int ws_close_code_valid(uint16_t code) {
+    if (code >= 3000 && code <= 4999)
+        return 1;
+    return code >= 1000 && code <= 1014 && code != 1004 && code != WS_CLOSE_NO_STATUS && code != 1006;
+}
+
+// A control frame carrying payload, masked if asked to
+static size_t ws_build_control(uint8_t opcode, const uint8_t *payload, size_t len, const uint8_t *mask,
+                               uint8_t *out) {
+    size_t n = ws_build_frame_header(out, opcode, 1, len, mask);
+    memcpy(out + n, payload, len);
+    if (mask)
+        ws_mask(out + n, len, mask, 0);
+    return n + len;
+}
+
+size_t ws_build_close(ws_decoder_t *d, uint16_t code, const uint8_t *mask, uint8_t *out) {
+    uint8_t payload[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+    d->close_sent = 1;
+    return ws_build_control(WS_OPCODE_CLOSE, payload, code == WS_CLOSE_NO_STATUS ? 0 : 2, mask, out);
+}
+
+int ws_control_frame(ws_decoder_t *d, const ws_message_t *msg, const uint8_t *mask,
+                     uint8_t *out, size_t *out_len) {
+    *out_len = 0;
+    if (msg->opcode == WS_OPCODE_PING) {
+        // Once we have closed, only the peer's close matters
+        if (!d->close_sent)
+            *out_len = ws_build_control(WS_OPCODE_PONG, msg->payload, msg->len, mask, out);
+        return 0;
+    }
+    if (msg->opcode != WS_OPCODE_CLOSE)
+        return 0;
+
+    d->close_received = 1;
+    if (d->close_sent)
+        return 1;
+    uint16_t code = WS_CLOSE_NO_STATUS;
+    if (msg->len >= 2)
+        code = (uint16_t)((msg->payload[0] << 8) | msg->payload[1]);
+    if (msg->len == 1 || (msg->len >= 2 && !ws_close_code_valid(code)))
+        code = WS_CLOSE_PROTOCOL_ERROR;
+    else if (msg->len > 2 && !ws_utf8_valid(msg->payload + 2, msg->len - 2))
+        code = WS_CLOSE_INVALID_DATA;
+    *out_len = ws_build_close(d, code, mask, out);
+    return 1;
+}
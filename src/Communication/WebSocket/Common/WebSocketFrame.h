@@ -0,0 +1,129 @@
+#ifndef WEBSOCKET_FRAME_H
+#define WEBSOCKET_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WebSocketMask.h"
+
+// RFC 6455 opcodes
+#define WS_OPCODE_CONTINUATION 0x0
+#define WS_OPCODE_TEXT         0x1
+#define WS_OPCODE_BINARY       0x2
+#define WS_OPCODE_CLOSE        0x8
+#define WS_OPCODE_PING         0x9
+#define WS_OPCODE_PONG         0xA
+
+#define WS_IS_CONTROL(opcode) (((opcode) & 0x8) != 0)
+
+// Or'ed into the opcode given to ws_build_frame_header: a compressed message
+#define WS_RSV1 0x40
+
+// RFC 6455 close status codes
+#define WS_CLOSE_NORMAL         1000
+#define WS_CLOSE_GOING_AWAY     1001
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+#define WS_CLOSE_UNSUPPORTED   1003
+#define WS_CLOSE_NO_STATUS      1005    // never on the wire: a close frame without a code
+#define WS_CLOSE_INVALID_DATA   1007
+#define WS_CLOSE_TOO_BIG        1009
+
+#define WS_MAX_HEADER_SIZE     14   // 2 + 8 byte length + 4 byte mask
+#define WS_MAX_CONTROL_PAYLOAD 125
+#define WS_MAX_CONTROL_FRAME   (WS_MAX_HEADER_SIZE + WS_MAX_CONTROL_PAYLOAD)
+#define WS_RX_INITIAL_SIZE     4096
+#define WS_DEFAULT_MAX_MESSAGE (1024 * 1024)
+
+typedef struct {
+    uint8_t fin;
+    uint8_t rsv;          // RSV1-3 in the low three bits
+    uint8_t opcode;
+    uint8_t masked;
+    uint8_t mask[4];
+    uint64_t payload_len;
+    size_t header_len;
+} ws_frame_header_t;
+
+// A complete message (or control frame). The payload points into the
+// decoder's buffer and stays valid until the next ws_decoder_* call.
+typedef struct {
+    uint8_t opcode;
+    uint8_t compressed;   // RSV1 was set: the payload is permessage-deflate data
+    uint8_t *payload;
+    size_t len;
+} ws_message_t;
+
+// Incremental decoder over a per-connection receive buffer. Bytes are read
+// straight into the buffer, frames are unmasked where they lie and fragments
+// are reassembled in place, so a message is never copied out.
+// The cursors every read moves come first, for servers that keep them in a
+// connection's first cache line.
+typedef struct {
+    uint8_t *data;
+    size_t parse;         // next frame header
+    size_t tail;          // end of received data
+    size_t head;          // oldest byte still in use
+    size_t cap;
+    size_t max_message;
+    size_t msg_start;     // reassembled payload of a fragmented message
+    size_t msg_end;
+    uint8_t msg_opcode;   // opcode of the fragmented message, 0 if none
+    uint8_t is_server;    // servers require masked frames, clients forbid them
+    uint16_t close_code;  // reason for the last decode error
+    uint8_t close_sent;   // our close frame is out, the peer's ends the handshake
+    uint8_t close_received;
+    uint8_t deflate;      // permessage-deflate negotiated: RSV1 is allowed
+    uint8_t msg_compressed;
+    uint32_t utf8_state;  // ws_utf8_check state of the text message being reassembled
+} ws_decoder_t;
+
+// Parse a frame header. Returns 1 when complete, 0 if more bytes are needed
+// and -1 if the header is malformed.
+int ws_parse_frame_header(const uint8_t *data, size_t len, ws_frame_header_t *hdr);
+// Write a frame header into out (at least WS_MAX_HEADER_SIZE bytes) and return its length.
+// opcode may carry WS_RSV1.
+size_t ws_build_frame_header(uint8_t *out, uint8_t opcode, int fin, uint64_t payload_len, const uint8_t *mask);
+
+void ws_decoder_init(ws_decoder_t *d, int is_server, size_t max_message);
+void ws_decoder_free(ws_decoder_t *d);
+// Drop the buffer while it holds nothing, so idle connections cost no memory
+void ws_decoder_release(ws_decoder_t *d);
+
+// Free space to receive into, growing or compacting the buffer if needed.
+// Returns NULL if the buffer is at its limit.
+uint8_t *ws_decoder_write_ptr(ws_decoder_t *d, size_t *avail);
+void ws_decoder_commit(ws_decoder_t *d, size_t len);
+
+// Raw access to unparsed bytes, used before the upgrade completes
+const uint8_t *ws_decoder_peek(const ws_decoder_t *d, size_t *len);
+void ws_decoder_consume(ws_decoder_t *d, size_t len);
+
+// Returns 1 and fills msg when a message is ready, 0 if more data is needed
+// and -1 on a protocol violation (close_code tells which). Uncompressed text
+// is checked to be UTF-8 fragment by fragment (1007 if not); compressed text
+// can only be checked once inflated, with ws_utf8_valid.
+int ws_decoder_next(ws_decoder_t *d, ws_message_t *msg);
+
+// Incremental UTF-8 validation. state starts at 0 and carries a sequence
+// split across calls; returns -1 on invalid input (overlong forms,
+// surrogates, code points past U+10FFFF). The text is complete and valid
+// once state is back to 0.
+int ws_utf8_check(uint32_t *state, const uint8_t *p, size_t len);
+int ws_utf8_valid(const uint8_t *p, size_t len);
+
+// Control frames are answered by the codec and never reach the application.
+// Replies are built in out (WS_MAX_CONTROL_FRAME bytes, on the caller's
+// stack) and masked with mask when it is not NULL, which clients need.
+
+// A close frame with code (WS_CLOSE_NO_STATUS: none), starting our side of
+// the close handshake. Returns its length.
+size_t ws_build_close(ws_decoder_t *d, uint16_t code, const uint8_t *mask, uint8_t *out);
+// Handle a control frame from ws_decoder_next: a ping gets a pong with its
+// payload, a close we did not start is echoed with its code (1002 if that is
+// not a valid one, 1007 if its reason is not UTF-8), a pong needs nothing. *out_len is 0 when there is nothing
+// to send. Returns 1 once both sides have sent their close and the
+// connection should be closed after out, 0 otherwise.
+int ws_control_frame(ws_decoder_t *d, const ws_message_t *msg, const uint8_t *mask,
+                     uint8_t *out, size_t *out_len);
+
+#endif
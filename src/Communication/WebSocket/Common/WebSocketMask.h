@@ -0,0 +1,26 @@
+#ifndef WEBSOCKET_MASK_H
+#define WEBSOCKET_MASK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Masking kernels, from slowest to fastest
+enum {
+    WS_MASK_SCALAR,
+    WS_MASK_SSE2,
+    WS_MASK_AVX2,
+    WS_MASK_AVX512,
+    WS_MASK_IMPL_COUNT
+};
+
+// XOR data with the 4-byte mask key, using the fastest kernel this CPU
+// supports. offset is the position of data[0] within the masked payload, so
+// a payload can be processed in pieces.
+void ws_mask(uint8_t *data, size_t len, const uint8_t mask[4], size_t offset);
+
+// Explicit kernel selection, for benchmarks and cross-checking
+int ws_mask_impl_supported(int impl);
+const char *ws_mask_impl_name(int impl);
+void ws_mask_with(int impl, uint8_t *data, size_t len, const uint8_t mask[4], size_t offset);
+
+#endif
@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "Commands.h"
+#include "WorkerIpc.h"
+#include "Metrics.h"
+
+// Space kept free in the events ring before a command is taken on, so that
+// its IPC_MSG_CALL_SENT always fits
+#define COMMAND_HEADROOM 4096
+
+// A station's answer, or its absence, back to the main process. Dropped if
+// the ring is full; the main process stops waiting for it at its deadline.
+static void on_command_reply(ocpp_session_t *s, const ocpp_message_t *reply, void *opaque) {
+    connection_t *conn = s->transport;
+    worker_ipc_t *ipc = worker_ipc_self();
+    size_t len = 0;
+    if (reply && reply->type == OCPP_CALLRESULT)
+        len = reply->payload.len;
+    else if (reply)
+        len = reply->error_code.len + reply->error_description.len + reply->payload.len + 4;
+
+    ipc_call_result_t *res = ipc_ring_reserve(&ipc->events, IPC_MSG_CALL_RESULT, (uint32_t)(sizeof(*res) + len));
+    if (!res)
+        return;
+    res->tag = (uint32_t)(uintptr_t)opaque;
+    res->station_len = (uint8_t)strlen(conn->cold->upgrade.station_id);
+    memcpy(res->station, conn->cold->upgrade.station_id, res->station_len);
+    if (!reply) {
+        res->status = IPC_CALL_NO_ANSWER;
+    } else if (reply->type == OCPP_CALLRESULT) {
+        res->status = IPC_CALL_ANSWERED;
+        memcpy(res->text, reply->payload.ptr, len);
+    } else {
+        // code "description" details, the way they were on the wire
+        char *p = res->text;
+        res->status = IPC_CALL_REJECTED;
+        memcpy(p, reply->error_code.ptr, reply->error_code.len);
+        p += reply->error_code.len;
+        *p++ = ' ';
+        *p++ = '"';
+        memcpy(p, reply->error_description.ptr, reply->error_description.len);
+        p += reply->error_description.len;
+        *p++ = '"';
+        *p++ = ' ';
+        memcpy(p, reply->payload.ptr, reply->payload.len);
+    }
+    ipc_ring_commit(&ipc->events, (uint32_t)(sizeof(*res) + len));
+}
+
+static int station_matches(const connection_t *conn, const ipc_call_t *call) {
+    const char *id = conn->cold->upgrade.station_id;
+    return call->station_len == 0 ||
+           (strlen(id) == call->station_len && memcmp(id, call->station, call->station_len) == 0);
+}
+
+static void command_send(event_loop_t *loop, connection_t *conn, const ipc_call_t *call, size_t len,
+                         ipc_call_sent_t *sent) {
+    if (conn->state != CONN_OPEN || !conn->cold->upgraded || !station_matches(conn, call))
+        return;
+    if (ocpp_call(&conn->cold->ocpp, (ocpp_action_t)call->action, call->payload, len - sizeof(*call),
+                  on_command_reply, (void *)(uintptr_t)call->tag) < 0) {
+        sent->busy++;
+        return;
+    }
+    sent->sent++;
+    metric_ocpp_call_sent(call->action);
+    conn_timer_update(loop, conn);
+    conn_drive(loop, conn);  // out now rather than with the station's next read
+}
+
+// Send the CALL to every open station it names and say how many that was
+static void command_call(event_loop_t *loop, worker_ipc_t *ipc, const ipc_call_t *call, size_t len) {
+    ipc_call_sent_t sent = { .tag = call->tag };
+    metric_inc(METRIC_COMMANDS);
+
+    connection_t *conn;
+    if (call->handle != CONN_HANDLE_NONE) {
+        // Routed: gone by now if the handle no longer resolves
+        conn = conn_pool_get(&loop->conns, call->handle);
+        if (conn)
+            command_send(loop, conn, call, len, &sent);
+    } else {
+        for (uint32_t slot = 0; (conn = conn_pool_next(&loop->conns, &slot)); slot++)
+            command_send(loop, conn, call, len, &sent);
+    }
+
+    ipc_call_sent_t *out = ipc_ring_reserve(&ipc->events, IPC_MSG_CALL_SENT, sizeof(*out));
+    if (out) {
+        *out = sent;
+        ipc_ring_commit(&ipc->events, sizeof(*out));
+    }
+}
+
+void commands_run(event_loop_t *loop) {
+    worker_ipc_t *ipc = loop->ipc;
+    const ipc_record_t *rec;
+    while ((rec = ipc_ring_peek(&ipc->commands))) {
+        if (rec->type == IPC_MSG_CALL) {
+            // Left queued until the main process has read what we told it
+            if (ipc_ring_room(&ipc->events) < COMMAND_HEADROOM)
+                return;
+            if (rec->len >= sizeof(ipc_call_t))
+                command_call(loop, ipc, ipc_record_data(rec), rec->len);
+        }
+        ipc_ring_release(&ipc->commands, rec);
+    }
+}
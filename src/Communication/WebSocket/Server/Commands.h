@@ -0,0 +1,11 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "EventLoop.h"
+
+// Worker side of the main process's commands: CALLs to one station or to
+// all of them, sent as soon as the loop wakes and answered through the
+// worker's events ring as the stations reply
+void commands_run(event_loop_t *loop);
+
+#endif
@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "EventLoop.h"
+
+struct conn_slab {
+    connection_t hot[CONN_SLAB_SLOTS];
+    conn_cold_t cold[CONN_SLAB_SLOTS];
+};
+
+void conn_pool_init(conn_pool_t *pool) {
+    memset(pool, 0, sizeof(*pool));
+}
+
+void conn_pool_destroy(conn_pool_t *pool) {
+    for (uint32_t i = 0; i < pool->nslabs; i++)
+        free(pool->slabs[i]);
+    free(pool->slabs);
+    free(pool->free_slots);
+    conn_pool_init(pool);
+}
+
+static connection_t *conn_pool_slot(const conn_pool_t *pool, uint32_t slot) {
+    return &pool->slabs[slot / CONN_SLAB_SLOTS]->hot[slot % CONN_SLAB_SLOTS];
+}
+
+static int conn_pool_grow(conn_pool_t *pool) {
+    uint32_t n = pool->nslabs + 1;
+    conn_slab_t **slabs = realloc(pool->slabs, n * sizeof(*slabs));
+    if (!slabs) return -1;
+    pool->slabs = slabs;
+    uint32_t *free_slots = realloc(pool->free_slots, (size_t)n * CONN_SLAB_SLOTS * sizeof(*free_slots));
+    if (!free_slots) return -1;
+    pool->free_slots = free_slots;
+
+    conn_slab_t *slab = aligned_alloc(CONN_CACHE_LINE, sizeof(*slab));
+    if (!slab) return -1;
+    memset(slab, 0, sizeof(*slab));
+    // Lowest index on top of the stack, so slabs fill in order
+    uint32_t base = pool->nslabs * CONN_SLAB_SLOTS;
+    for (uint32_t i = CONN_SLAB_SLOTS; i-- > 0;) {
+        slab->hot[i].slot = base + i;
+        slab->hot[i].cold = &slab->cold[i];
+        pool->free_slots[pool->nfree++] = base + i;
+    }
+    pool->slabs[pool->nslabs++] = slab;
+    return 0;
+}
+
+connection_t *conn_pool_alloc(conn_pool_t *pool) {
+    if (!pool->nfree && conn_pool_grow(pool) < 0)
+        return NULL;
+    connection_t *conn = conn_pool_slot(pool, pool->free_slots[--pool->nfree]);
+    uint32_t slot = conn->slot, generation = conn->generation + 1;
+    conn_cold_t *cold = conn->cold;
+    memset(conn, 0, sizeof(*conn));
+    memset(cold, 0, sizeof(*cold));
+    conn->slot = slot;
+    conn->generation = generation;
+    conn->cold = cold;
+    pool->live++;
+    return conn;
+}
+
+void conn_pool_free(conn_pool_t *pool, connection_t *conn) {
+    conn->generation++;
+    pool->free_slots[pool->nfree++] = conn->slot;
+    pool->live--;
+}
+
+connection_t *conn_pool_next(const conn_pool_t *pool, uint32_t *slot) {
+    for (uint32_t i = *slot; i < pool->nslabs * CONN_SLAB_SLOTS; i++) {
+        connection_t *conn = conn_pool_slot(pool, i);
+        if (conn->generation & 1) {
+            *slot = i;
+            return conn;
+        }
+    }
+    return NULL;
+}
+
+conn_handle_t conn_handle(const connection_t *conn) {
+    return (uint64_t)conn->generation << 32 | conn->slot;
+}
+
+connection_t *conn_pool_get(const conn_pool_t *pool, conn_handle_t handle) {
+    uint32_t slot = (uint32_t)handle, generation = (uint32_t)(handle >> 32);
+    if (!(generation & 1) || slot / CONN_SLAB_SLOTS >= pool->nslabs)
+        return NULL;
+    connection_t *conn = conn_pool_slot(pool, slot);
+    return conn->generation == generation ? conn : NULL;
+}
+
+size_t conn_pool_slot_size(void) {
+    return sizeof(connection_t) + sizeof(conn_cold_t);
+}
@@ -0,0 +1,49 @@
+#ifndef CONN_POOL_H
+#define CONN_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONN_SLAB_SLOTS 256     // connections added to the pool at a time
+
+typedef struct connection connection_t;
+typedef struct conn_slab conn_slab_t;
+
+// Names a connection without keeping it alive: the slot index in the low 32
+// bits, the slot's generation in the high 32. The generation is odd while the
+// slot is in use and moves on when it is freed, so a handle kept past the
+// connection's end no longer resolves, even once the slot is reused.
+typedef uint64_t conn_handle_t;
+#define CONN_HANDLE_NONE 0      // never resolves
+
+// Fixed-size connections in slabs, hot parts and cold parts in separate
+// arrays. Slabs are never returned, so a worker that once held N connections
+// reuses their slots instead of fragmenting the heap with churn.
+typedef struct {
+    conn_slab_t **slabs;
+    uint32_t nslabs;
+    uint32_t *free_slots;       // stack of unused slot indices
+    uint32_t nfree;
+    size_t live;
+} conn_pool_t;
+
+void conn_pool_init(conn_pool_t *pool);
+// Frees the slabs; connections still in use must have been torn down
+void conn_pool_destroy(conn_pool_t *pool);
+
+// A zeroed connection with its cold part attached, or NULL when out of memory
+connection_t *conn_pool_alloc(conn_pool_t *pool);
+void conn_pool_free(conn_pool_t *pool, connection_t *conn);
+
+// The first connection in use at slot *slot or after it, which *slot is
+// moved to; NULL past the last. Walks every live connection.
+connection_t *conn_pool_next(const conn_pool_t *pool, uint32_t *slot);
+
+conn_handle_t conn_handle(const connection_t *conn);
+// The connection handle names, or NULL if it has been freed since
+connection_t *conn_pool_get(const conn_pool_t *pool, conn_handle_t handle);
+
+// Memory the pool holds for each slot, hot and cold part together
+size_t conn_pool_slot_size(void);
+
+#endif
@@ -0,0 +1,462 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "Control.h"
+#include "WorkerIpc.h"
+#include "TimerWheel.h"
+#include "OcppActions.h"
+#include "RouteTable.h"
+
+#define CONTROL_MAX_EVENTS 64
+// epoll data: the listener, then the workers' eventfds by id + 1, then clients
+#define CONTROL_LISTEN 0
+
+// The command a client has in flight
+typedef struct {
+    uint32_t tag;               // 0 when there is none
+    int workers_left;           // IPC_MSG_CALL_SENT still to come
+    uint64_t expected;          // results the workers said they would send
+    uint64_t received;
+    uint64_t busy;
+    uint64_t deadline_ms;       // 0 to wait for as long as it takes
+} command_t;
+
+typedef struct control_client {
+    int fd;
+    int eof;                    // the client sends no more
+    int done;                   // closed once its answers are written
+    int dead;                   // closed at the end of the pass
+    char *out;                  // answers the socket has not taken yet
+    size_t out_len, out_cap;
+    command_t cmd;
+    struct control_client *next;
+    size_t in_len;
+    char in[CONTROL_LINE_MAX];
+} control_client_t;
+
+static int epfd = -1;
+static int listen_fd = -1;
+static control_client_t *clients;
+static uint32_t next_tag;
+static uint32_t wait_ms;        // how long a command may take, 0 forever
+
+static void client_flush(control_client_t *c) {
+    size_t off = 0;
+    while (off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + off, c->out_len - off, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            off += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;  // EPOLLOUT picks it up
+        c->dead = 1;
+        return;
+    }
+    memmove(c->out, c->out + off, c->out_len - off);
+    c->out_len -= off;
+}
+
+static void client_printf(control_client_t *c, const char *fmt, ...) {
+    if (c->dead)
+        return;
+    if (!c->out) {
+        c->out = malloc(4096);
+        if (!c->out) {
+            c->dead = 1;
+            return;
+        }
+        c->out_cap = 4096;
+    }
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(c->out + c->out_len, c->out_cap - c->out_len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            c->dead = 1;
+            return;
+        }
+        if ((size_t)n < c->out_cap - c->out_len) {
+            c->out_len += (size_t)n;
+            return;
+        }
+        size_t cap = c->out_cap * 2;
+        while (cap < c->out_len + (size_t)n + 1)
+            cap *= 2;
+        char *bigger = cap <= CONTROL_OUT_MAX ? realloc(c->out, cap) : NULL;
+        if (!bigger) {
+            c->dead = 1;
+            return;
+        }
+        c->out = bigger;
+        c->out_cap = cap;
+    }
+}
+
+static void client_free(control_client_t *c) {
+    close(c->fd);  // also leaves the epoll set
+    free(c->out);
+    free(c);
+}
+
+static control_client_t *client_by_tag(uint32_t tag) {
+    for (control_client_t *c = clients; c; c = c->next) {
+        if (c->cmd.tag == tag)
+            return c;
+    }
+    return NULL;
+}
+
+static void start_command(control_client_t *c, char *line, size_t len);
+static void end_command(control_client_t *c);
+
+static int command_done(const command_t *cmd) {
+    return !cmd->workers_left && cmd->received >= cmd->expected;
+}
+
+// Run the commands the client has sent as far as one at a time allows
+static void client_next(control_client_t *c) {
+    while (!c->cmd.tag && !c->dead) {
+        char *nl = memchr(c->in, '\n', c->in_len);
+        if (!nl) {
+            if (c->in_len == sizeof(c->in)) {
+                client_printf(c, "ERROR line too long\n");
+                c->eof = 1;
+                c->in_len = 0;
+            }
+            if (c->eof)
+                c->done = 1;
+            return;
+        }
+        size_t len = (size_t)(nl - c->in);
+        if (len && c->in[len - 1] == '\r')
+            len--;
+        start_command(c, c->in, len);
+        size_t used = (size_t)(nl - c->in) + 1;
+        memmove(c->in, c->in + used, c->in_len - used);
+        c->in_len -= used;
+        // Nothing to wait for: no station to send it to, or no worker took it
+        if (c->cmd.tag && command_done(&c->cmd))
+            end_command(c);
+    }
+}
+
+static void end_command(control_client_t *c) {
+    command_t *cmd = &c->cmd;
+    if (cmd->workers_left)
+        client_printf(c, "ERROR %d workers did not answer\n", cmd->workers_left);
+    if (cmd->received < cmd->expected)
+        client_printf(c, "END sent %llu busy %llu missing %llu\n", (unsigned long long)cmd->expected,
+                      (unsigned long long)cmd->busy, (unsigned long long)(cmd->expected - cmd->received));
+    else
+        client_printf(c, "END sent %llu busy %llu\n", (unsigned long long)cmd->expected,
+                      (unsigned long long)cmd->busy);
+    cmd->tag = 0;
+}
+
+// The command is over: every worker has answered and so has every station,
+// or it is out of time. On to the client's next one.
+static void finish_command(control_client_t *c) {
+    end_command(c);
+    client_next(c);
+}
+
+static void maybe_finish(control_client_t *c) {
+    if (command_done(&c->cmd))
+        finish_command(c);
+}
+
+static const char *skip_spaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+static const char *word_end(const char *p, const char *end) {
+    while (p < end && *p != ' ' && *p != '\t')
+        p++;
+    return p;
+}
+
+static void start_command(control_client_t *c, char *line, size_t len) {
+    const char *end = line + len;
+    const char *station = skip_spaces(line, end);
+    if (station == end)
+        return;  // blank line
+    const char *station_end = word_end(station, end);
+    const char *action = skip_spaces(station_end, end);
+    const char *action_end = word_end(action, end);
+    const char *payload = skip_spaces(action_end, end);
+    const char *payload_end = end;
+    while (payload_end > payload && (payload_end[-1] == ' ' || payload_end[-1] == '\t'))
+        payload_end--;
+
+    size_t station_len = (size_t)(station_end - station);
+    if (station_len == 1 && *station == '*')
+        station_len = 0;
+    else if (station_len > STATION_ID_MAX) {
+        client_printf(c, "ERROR station id longer than %d\n", STATION_ID_MAX);
+        return;
+    }
+    ocpp_action_t a = ocpp_action_lookup(action, (size_t)(action_end - action));
+    if (a == OCPP_ACTION_UNKNOWN) {
+        client_printf(c, "ERROR unknown action %.*s\n", (int)(action_end - action), action);
+        return;
+    }
+    size_t payload_len = (size_t)(payload_end - payload);
+    if (payload_len < 2 || payload[0] != '{' || payload_end[-1] != '}') {
+        client_printf(c, "ERROR the payload must be a JSON object\n");
+        return;
+    }
+
+    if (++next_tag == 0)
+        next_tag = 1;
+    command_t *cmd = &c->cmd;
+    *cmd = (command_t){ .tag = next_tag };
+
+    // A station the route table knows goes to its worker alone, one it does
+    // not know is not connected. Every worker looks for it only when the
+    // table is off or has overflowed, and always for a broadcast.
+    route_t route = { .handle = CONN_HANDLE_NONE };
+    int first = 0, last = worker_ipc_count();
+    if (station_len && route_table_lookup(station, station_len, &route) == 0 && route.worker < last) {
+        first = route.worker;
+        last = route.worker + 1;
+    } else if (station_len && !route_table_incomplete())
+        last = 0;
+
+    int refused = 0;
+    for (int i = first; i < last; i++) {
+        worker_ipc_t *w = worker_ipc_main(i);
+        ipc_call_t *call = ipc_ring_reserve(&w->commands, IPC_MSG_CALL, (uint32_t)(sizeof(*call) + payload_len));
+        if (!call) {
+            refused++;
+            continue;
+        }
+        call->tag = cmd->tag;
+        call->action = (int16_t)a;
+        call->station_len = (uint8_t)station_len;
+        call->handle = route.handle;
+        memcpy(call->station, station, station_len);
+        memcpy(call->payload, payload, payload_len);
+        ipc_ring_commit(&w->commands, (uint32_t)(sizeof(*call) + payload_len));
+        cmd->workers_left++;
+    }
+    if (refused)
+        client_printf(c, "ERROR %d of %d workers have too many commands queued\n", refused, worker_ipc_count());
+    if (wait_ms)
+        cmd->deadline_ms = timer_clock_ms() + wait_ms;
+}
+
+static void client_read(control_client_t *c) {
+    while (!c->eof && c->in_len < sizeof(c->in)) {
+        ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        c->eof = 1;  // answers still go out on a half-closed socket
+    }
+    client_next(c);
+}
+
+static void accept_clients(void) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("control accept");
+            return;
+        }
+        control_client_t *c = calloc(1, sizeof(*c));
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = c };
+        if (!c || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->next = clients;
+        clients = c;
+    }
+}
+
+static void worker_events(worker_ipc_t *w) {
+    const ipc_record_t *rec;
+    while ((rec = ipc_ring_peek(&w->events))) {
+        if (rec->type == IPC_MSG_CALL_SENT && rec->len >= sizeof(ipc_call_sent_t)) {
+            const ipc_call_sent_t *sent = ipc_record_data(rec);
+            control_client_t *c = client_by_tag(sent->tag);
+            if (c) {
+                c->cmd.workers_left--;
+                c->cmd.expected += sent->sent;
+                c->cmd.busy += sent->busy;
+                maybe_finish(c);
+            }
+        } else if (rec->type == IPC_MSG_CALL_RESULT && rec->len >= sizeof(ipc_call_result_t)) {
+            const ipc_call_result_t *res = ipc_record_data(rec);
+            control_client_t *c = client_by_tag(res->tag);
+            if (c) {
+                // One line per answer, whatever whitespace the station put in
+                size_t len = rec->len - sizeof(*res);
+                static const char *const status[] = {
+                    [IPC_CALL_ANSWERED] = "CALLRESULT", [IPC_CALL_REJECTED] = "CALLERROR",
+                    [IPC_CALL_NO_ANSWER] = "NOANSWER"
+                };
+                size_t start = c->out_len;
+                client_printf(c, "%.*s %s%s%.*s\n", (int)res->station_len, res->station,
+                              res->status <= IPC_CALL_NO_ANSWER ? status[res->status] : "?",
+                              len ? " " : "", (int)len, res->text);
+                for (size_t i = start; !c->dead && i + 1 < c->out_len; i++) {
+                    if (c->out[i] == '\n' || c->out[i] == '\r')
+                        c->out[i] = ' ';
+                }
+                // A station that fails while the CALL goes out is reported
+                // before its worker's count
+                c->cmd.received++;
+                maybe_finish(c);
+            }
+        }
+        ipc_ring_release(&w->events, rec);
+    }
+}
+
+int control_init(const char *path, unsigned call_timeout) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (!worker_ipc_count()) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // A socket left behind by an earlier run, never any other kind of file
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        return -1;
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0)
+        goto fail;
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        goto fail;
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = CONTROL_LISTEN };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0)
+        goto fail;
+    for (int i = 0; i < worker_ipc_count(); i++) {
+        ev = (struct epoll_event){ .events = EPOLLIN, .data.u64 = (uint64_t)i + 1 };
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, worker_ipc_main(i)->events.efd, &ev) < 0)
+            goto fail;
+    }
+    wait_ms = call_timeout ? call_timeout * 1000 + CONTROL_GRACE_MS : 0;
+    return 0;
+
+fail:;
+    int err = errno;
+    control_close();
+    errno = err;
+    return -1;
+}
+
+int control_fd(void) {
+    return epfd;
+}
+
+int control_timeout(void) {
+    if (epfd < 0)
+        return -1;
+    for (int i = 0; i < worker_ipc_count(); i++) {
+        if (ipc_ring_sleep(&worker_ipc_main(i)->events) < 0)
+            return 0;
+    }
+    uint64_t now = timer_clock_ms(), next = 0;
+    for (control_client_t *c = clients; c; c = c->next) {
+        if (c->cmd.tag && c->cmd.deadline_ms && (!next || c->cmd.deadline_ms < next))
+            next = c->cmd.deadline_ms;
+    }
+    if (!next)
+        return -1;
+    return next > now ? (int)(next - now) : 0;
+}
+
+void control_run(void) {
+    if (epfd < 0)
+        return;
+    struct epoll_event events[CONTROL_MAX_EVENTS];
+    int n = epoll_wait(epfd, events, CONTROL_MAX_EVENTS, 0);
+    for (int i = 0; i < n; i++) {
+        uint64_t id = events[i].data.u64;
+        if (id == CONTROL_LISTEN) {
+            accept_clients();
+        } else if (id <= (uint64_t)worker_ipc_count()) {
+            ipc_ring_clear_wakeup(&worker_ipc_main((int)id - 1)->events);
+        } else {
+            control_client_t *c = events[i].data.ptr;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                client_read(c);
+        }
+    }
+
+    for (int i = 0; i < worker_ipc_count(); i++) {
+        worker_ipc_t *w = worker_ipc_main(i);
+        ipc_ring_awake(&w->events);
+        worker_events(w);
+    }
+
+    // Out of time: a worker died, or the events ring overflowed
+    uint64_t now = timer_clock_ms();
+    for (control_client_t *c = clients; c; c = c->next) {
+        if (c->cmd.tag && c->cmd.deadline_ms && c->cmd.deadline_ms <= now)
+            finish_command(c);
+    }
+
+    for (control_client_t **p = &clients; *p;) {
+        control_client_t *c = *p;
+        if (c->out_len && !c->dead)
+            client_flush(c);
+        if (c->dead || (c->done && !c->out_len)) {
+            *p = c->next;
+            client_free(c);
+            continue;
+        }
+        p = &c->next;
+    }
+}
+
+void control_close(void) {
+    while (clients) {
+        control_client_t *c = clients;
+        clients = c->next;
+        client_free(c);
+    }
+    if (epfd >= 0)
+        close(epfd);
+    if (listen_fd >= 0)
+        close(listen_fd);
+    epfd = listen_fd = -1;
+}
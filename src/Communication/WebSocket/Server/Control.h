@@ -0,0 +1,38 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#define CONTROL_LINE_MAX 65536
+#define CONTROL_OUT_MAX (16 * 1024 * 1024)  // answers queued for a client that does not read them
+#define CONTROL_GRACE_MS 2000               // waited beyond the workers' CALL timeout
+
+// The main process's control socket: a local client (an operator, the
+// backend) sends the stations CALLs through the workers, one command per line
+//
+//   <station id> <Action> <JSON payload>
+//   * <Action> <JSON payload>              every connected station
+//
+// and gets a line per station the CALL went to, as the answers come in,
+// then one to end the command:
+//
+//   <station id> CALLRESULT <payload>
+//   <station id> CALLERROR <code> "<description>" <details>
+//   <station id> NOANSWER                  timed out or disconnected first
+//   END sent <n> busy <n> [missing <n>]    busy: too many CALLs of ours outstanding
+//   ERROR <why>                            the command was refused
+//
+// Commands from one client run one after the other.
+
+// Listen on path (a Unix socket, replaced if one is there already). Needs
+// the workers' channels. call_timeout is theirs, in seconds, 0 for none.
+// Returns -1 with errno set on failure.
+int control_init(const char *path, unsigned call_timeout);
+// One fd to poll for everything the control socket waits on, -1 if off
+int control_fd(void);
+// Milliseconds the main process may sleep: 0 if workers have sent something,
+// -1 for as long as it likes
+int control_timeout(void);
+// Serve clients and pass on what the workers sent, without blocking
+void control_run(void);
+void control_close(void);
+
+#endif
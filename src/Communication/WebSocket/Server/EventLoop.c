@@ -0,0 +1,555 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "TLSServer.h"
+#include "IoUring.h"
+#include "WorkerIpc.h"
+#include "Commands.h"
+#include "RouteTable.h"
+
+// The main process's eventfd in the epoll set. Never a connection handle:
+// slot 1 with generation 0, which is even.
+#define LOOP_HANDLE_IPC 1
+
+void conn_free(event_loop_t *loop, connection_t *conn) {
+    conn_cold_t *cold = conn->cold;
+    timer_cancel(&loop->timers, &cold->timer);
+    metric_inc(METRIC_CLOSED);
+    metric_gauge_add(METRIC_CONNECTIONS, -1);
+    if (cold->upgraded) {
+        metric_gauge_add(METRIC_STATIONS, -1);
+        route_table_clear(cold->upgrade.station_id, strlen(cold->upgrade.station_id), conn_handle(conn));
+        ocpp_session_free(&cold->ocpp);
+        ws_deflate_free(&cold->deflate);
+        LOG_INFO("Station %s disconnected after %ld s, %u messages", cold->upgrade.station_id,
+                 (long)(time(NULL) - cold->connected_at), cold->messages);
+    }
+    tls_engine_free(&conn->tls);
+    close(conn->fd);  // also removes the fd from the epoll set
+    ws_decoder_free(&conn->rx);
+    outq_clear(&conn->out);
+    conn_pool_free(&loop->conns, conn);
+}
+
+static void conn_close(event_loop_t *loop, connection_t *conn) {
+    timer_cancel(&loop->timers, &conn->cold->timer);
+    // Best effort close_notify, we never wait for the peer's reply
+    if (conn->tls.ssl && conn->state != CONN_TLS_ACCEPT) {
+        tls_engine_shutdown(&conn->tls);
+        if (!conn->uring)
+            tls_engine_send_fd(&conn->tls, conn->fd);
+    }
+    if (conn->uring)
+        uring_conn_close(loop, conn);  // freed once the kernel is done with it
+    else
+        conn_free(loop, conn);
+}
+
+int conn_send(connection_t *conn, const void *data, size_t len) {
+    metric_add(METRIC_BYTES_SENT, len);
+    return outq_push_copy(&conn->out, data, len);
+}
+
+int conn_writable(const connection_t *conn) {
+    return !conn->out.over_high;
+}
+
+// Write out as much pending output as the socket accepts. Returns -1 on fatal error.
+static int conn_flush(connection_t *conn) {
+    if (conn->uring)
+        return uring_conn_flush(conn);
+    if (conn->tls.ssl && !conn->ktls_tx)
+        return outq_flush_tls(&conn->out, &conn->tls, conn->fd);
+    return outq_flush_fd(&conn->out, conn->fd);
+}
+
+// Hand the engine ciphertext io_uring has already received
+static int conn_feed_tls(connection_t *conn) {
+    size_t room;
+    uint8_t *in = tls_engine_input(&conn->tls, &room);
+    if (!in)
+        return 0;
+    int n = uring_conn_recv(conn, in, room);
+    if (n > 0)
+        tls_engine_commit(&conn->tls, (size_t)n);
+    return n;
+}
+
+// Returns 1 once the TLS handshake is complete, 0 while it waits for the peer
+static int conn_handshake(connection_t *conn) {
+    if (!conn->uring)
+        return tls_engine_handshake_fd(&conn->tls, conn->fd);
+    for (;;) {
+        int rc = tls_engine_handshake(&conn->tls);
+        if (rc != 0 || (rc = conn_feed_tls(conn)) <= 0)
+            return rc;
+    }
+}
+
+// Receive into the decoder's buffer. Returns bytes read, 0 when the socket is
+// drained and -1 on EOF or error.
+static int conn_recv(connection_t *conn, uint8_t *dst, size_t avail) {
+    if (avail > INT_MAX)
+        avail = INT_MAX;
+
+    if (conn->uring && !conn->tls.ssl)
+        return uring_conn_recv(conn, dst, avail);
+    if (conn->uring) {
+        for (;;) {
+            int n = tls_engine_read(&conn->tls, dst, avail);
+            if (n != 0 || (n = conn_feed_tls(conn)) <= 0)
+                return n;
+        }
+    }
+
+    if (!conn->tls.ssl) {
+        for (;;) {
+            ssize_t n = read(conn->fd, dst, avail);
+            if (n > 0) return (int)n;
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+            return -1;
+        }
+    }
+
+    return tls_engine_read_fd(&conn->tls, conn->fd, dst, avail);
+}
+
+// Silence allowed before a ping: stations that answer promptly are pinged
+// less and less often, up to the maximum
+static uint64_t conn_ping_interval(const event_loop_t *loop, const connection_t *conn) {
+    uint64_t interval = (uint64_t)loop->ping_interval_ms << conn->ping_shift;
+    return interval < loop->ping_interval_max_ms ? interval : loop->ping_interval_max_ms;
+}
+
+// Account for the answer to our last ping, if it has come: a prompt pong
+// doubles the interval, a slow one puts it back to the start
+static void conn_adapt_ping(event_loop_t *loop, connection_t *conn) {
+    conn_cold_t *cold = conn->cold;
+    if (!conn->ping_at || (int32_t)(cold->pong_at - conn->ping_at) < 0)
+        return;
+    uint64_t rtt = (uint64_t)(cold->pong_at - conn->ping_at) * TIMER_TICK_MS;
+    if (rtt > loop->pong_timeout_ms / 2)
+        conn->ping_shift = 0;
+    else if (conn_ping_interval(loop, conn) < loop->ping_interval_max_ms)
+        conn->ping_shift++;
+    conn->ping_at = 0;
+}
+
+void conn_timer_update(event_loop_t *loop, connection_t *conn) {
+    conn_cold_t *cold = conn->cold;
+    uint64_t delay = UINT64_MAX;
+
+    if (conn->state != CONN_OPEN) {
+        delay = loop->handshake_timeout_ms;
+    } else {
+        if (loop->ping_interval_ms) {
+            uint64_t silent = (uint64_t)(loop->timers.now - conn->last_rx) * TIMER_TICK_MS;
+            uint64_t limit = conn_ping_interval(loop, conn) + (conn->ping_sent ? loop->pong_timeout_ms : 0);
+            delay = silent < limit ? limit - silent : 0;
+        }
+        if (cold->ocpp.npending) {
+            uint64_t now = ocpp_clock_ms();
+            uint64_t next = ocpp_session_expire(&cold->ocpp, now);
+            if (next && next - now < delay)
+                delay = next - now;
+        }
+    }
+
+    if (delay == UINT64_MAX)
+        timer_cancel(&loop->timers, &cold->timer);
+    else
+        timer_arm(&loop->timers, &cold->timer, delay);
+}
+
+// A deadline passed: unfinished handshakes and closes are given up on, a
+// quiet station is pinged and dropped if it stays quiet
+static void conn_timeout(timer_wheel_t *w, wheel_timer_t *t) {
+    event_loop_t *loop = (event_loop_t *)((uintptr_t)w - offsetof(event_loop_t, timers));
+    connection_t *conn = ((conn_cold_t *)((uintptr_t)t - offsetof(conn_cold_t, timer)))->conn;
+
+    if (conn->state != CONN_OPEN) {
+        if (conn->state < CONN_OPEN) {
+            metric_inc(METRIC_DROPPED_HANDSHAKE);
+            LOG_WARN("Dropping connection stuck in its handshake (fd %d)", conn->fd);
+        }
+        conn_close(loop, conn);
+        return;
+    }
+    if (loop->ping_interval_ms) {
+        conn_adapt_ping(loop, conn);
+        uint64_t silent = (uint64_t)(w->now - conn->last_rx) * TIMER_TICK_MS;
+        uint64_t interval = conn_ping_interval(loop, conn);
+        if (conn->ping_sent && silent >= interval + loop->pong_timeout_ms) {
+            metric_inc(METRIC_DROPPED_PING);
+            LOG_WARN("Dropping station %s, no answer to ping", conn->cold->upgrade.station_id);
+            conn_close(loop, conn);
+            return;
+        }
+        if (!conn->ping_sent && silent >= interval) {
+            // Two bytes, queued inline
+            conn->ping_sent = 1;
+            conn->ping_at = w->now;
+            if (send_frame(conn, WS_OPCODE_PING, NULL, 0) < 0 || conn_flush(conn) < 0) {
+                conn_close(loop, conn);
+                return;
+            }
+        }
+    }
+    conn_timer_update(loop, conn);
+}
+
+// Handle whatever input is buffered, as far as back-pressure allows
+static int conn_process(event_loop_t *loop, connection_t *conn) {
+    if (conn->state == CONN_WS_HANDSHAKE) {
+        int rc = handle_handshake(conn);
+        if (rc <= 0)
+            return rc;
+        conn->state = CONN_OPEN;
+        conn_timer_update(loop, conn);
+    }
+    if (conn->state != CONN_OPEN && conn->state != CONN_CLOSE_WAIT)
+        return 0;
+    int rc = process_frames(conn);
+    if (rc > 0) {
+        // We started the close: the peer gets a handshake timeout to answer
+        if (conn->state == CONN_OPEN) {
+            conn->state = CONN_CLOSE_WAIT;
+            conn_timer_update(loop, conn);
+        }
+        return 0;
+    }
+    // Handlers may have sent CALLs that need to time out
+    if (rc == 0 && conn->state == CONN_OPEN && conn->cold->ocpp.npending)
+        conn_timer_update(loop, conn);
+    return rc;
+}
+
+// Read everything the kernel and OpenSSL have buffered. Edge-triggered epoll
+// only reports new data once, so we must drain until EAGAIN, unless the
+// station is throttled: then its bytes stay in the socket buffer and TCP
+// pushes back on it until our output drains.
+static int conn_read(event_loop_t *loop, connection_t *conn) {
+    for (;;) {
+        if (conn_process(loop, conn) < 0)
+            return -1;
+        if (!conn_writable(conn))
+            return 0;
+
+        size_t avail;
+        uint8_t *dst = ws_decoder_write_ptr(&conn->rx, &avail);
+        if (!dst)
+            return -1;  // peer sent more than we can hold without consuming
+
+        int n = conn_recv(conn, dst, avail);
+        if (n < 0)
+            return -1;
+        if (n == 0) {
+            ws_decoder_release(&conn->rx);
+            return 0;
+        }
+        ws_decoder_commit(&conn->rx, (size_t)n);
+        metric_add(METRIC_BYTES_RECEIVED, (uint64_t)n);
+        // Any traffic proves the station alive; its timer finds out when it fires
+        conn->last_rx = loop->timers.now;
+        conn->ping_sent = 0;
+    }
+}
+
+// Advance the connection's state machine as far as the socket allows
+int conn_drive(event_loop_t *loop, connection_t *conn) {
+    if (conn->state == CONN_TLS_ACCEPT) {
+        int rc = conn_handshake(conn);
+        if (rc < 0) {
+            ERR_clear_error();
+            metric_inc(METRIC_TLS_FAILED);
+            conn_close(loop, conn);
+            return -1;
+        }
+        if (rc == 0) {
+            // io_uring sends our flight only when asked to
+            if (conn_flush(conn) < 0) {
+                conn_close(loop, conn);
+                return -1;
+            }
+            return 0;
+        }
+        session_cache_count_handshake(conn->tls.ssl);
+        metric_inc(SSL_session_reused(conn->tls.ssl) ? METRIC_TLS_RESUMED : METRIC_TLS_FULL);
+        // With send offload every queued frame can go out in one writev
+        conn->ktls_tx = ktls_send_active(conn->tls.ssl);
+        conn->state = CONN_WS_HANDSHAKE;
+    }
+
+    for (;;) {
+        if (conn->state != CONN_CLOSING && conn_read(loop, conn) < 0) {
+            conn->state = CONN_CLOSING;
+            conn_timer_update(loop, conn);  // a peer that stops reading cannot hold us up
+        }
+
+        // Everything produced while handling this batch of input goes out together
+        int throttled = !conn_writable(conn);
+        if (conn_flush(conn) < 0 ||
+            (conn->state == CONN_CLOSING && conn->out.bytes == 0 && tls_engine_pending(&conn->tls) == 0)) {
+            conn_close(loop, conn);
+            return -1;
+        }
+
+        if (!conn_writable(conn)) {
+            if (loop->drop_slow && conn->state != CONN_CLOSING) {
+                metric_inc(METRIC_DROPPED_SLOW);
+                LOG_WARN("Dropping slow connection (fd %d, %zu bytes queued)", conn->fd, conn->out.bytes);
+                conn_close(loop, conn);
+                return -1;
+            }
+            return 0;  // resumed by EPOLLOUT (or a send completion) once the socket drains
+        }
+        // Drained below the low watermark: pick up the input we left behind
+        if (!throttled)
+            return 0;
+    }
+}
+
+connection_t *conn_open(event_loop_t *loop, int fd) {
+    connection_t *conn = conn_pool_alloc(&loop->conns);
+    if (!conn || (loop->ctx && tls_engine_init(&conn->tls, loop->ctx, 1,
+                                               loop->tls_on_socket ? fd : -1) < 0)) {
+        if (conn)
+            conn_pool_free(&loop->conns, conn);
+        close(fd);
+        return NULL;
+    }
+    conn->fd = fd;
+    conn->state = conn->tls.ssl ? CONN_TLS_ACCEPT : CONN_WS_HANDSHAKE;
+    ws_decoder_init(&conn->rx, 1, WS_DEFAULT_MAX_MESSAGE);
+    http_parser_init(&conn->cold->http, 0, HTTP_MAX_REQUEST_SIZE);
+    outq_init(&conn->out, &loop->out_limits);
+    conn->cold->conn = conn;
+    conn->last_rx = loop->timers.now;
+    metric_inc(METRIC_ACCEPTED);
+    metric_gauge_add(METRIC_CONNECTIONS, 1);
+    timer_init(&conn->cold->timer, conn_timeout);
+    conn_timer_update(loop, conn);
+    return conn;
+}
+
+// Out of descriptors, the pending connections would wait in the backlog
+// with nothing to wake an edge-triggered listener for them again. The spare
+// descriptor makes room to take one and close it. Returns 0 if there was
+// none to take (accept fails for want of a descriptor even then) or the
+// spare is gone.
+static int accept_refuse(event_loop_t *loop) {
+    if (loop->reserve_fd < 0)
+        return 0;
+    close(loop->reserve_fd);
+    int fd = accept4(loop->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd >= 0) {
+        close(fd);
+        metric_inc(METRIC_REFUSED_NO_FDS);
+    }
+    loop->reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return fd >= 0;
+}
+
+int event_loop_accept_failed(event_loop_t *loop, int err) {
+    if (err == EINTR || err == ECONNABORTED)
+        return 1;
+    if (err == EAGAIN || err == EWOULDBLOCK)
+        return 0;
+
+    // Every failure is counted, one line per interval says how many
+    uint64_t now = timer_clock_ms();
+    loop->accept_errors++;
+    if (!loop->accept_logged_ms || now - loop->accept_logged_ms >= ACCEPT_LOG_INTERVAL) {
+        LOG_ERROR("accept: %s (%u times since the last report)", strerror(err), loop->accept_errors);
+        loop->accept_logged_ms = now;
+        loop->accept_errors = 0;
+    }
+    if ((err == EMFILE || err == ENFILE) && accept_refuse(loop))
+        return 1;
+    if (!timer_armed(&loop->accept_timer))
+        timer_arm(&loop->timers, &loop->accept_timer, ACCEPT_RETRY_MS);
+    return 0;
+}
+
+static void accept_connections(event_loop_t *loop) {
+    for (;;) {
+        int fd = accept4(loop->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (event_loop_accept_failed(loop, errno))
+                continue;
+            return;
+        }
+
+        connection_t *conn = conn_open(loop, fd);
+        if (!conn)
+            continue;
+
+        // Register for both directions once; with EPOLLET we are only woken
+        // on transitions so there is no need to toggle EPOLLOUT later.
+        struct epoll_event ev = {
+            .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+            .data.u64 = conn_handle(conn)
+        };
+        if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            LOG_ERROR("epoll_ctl: %s", strerror(errno));
+            conn_free(loop, conn);
+            continue;
+        }
+        conn_drive(loop, conn);
+    }
+}
+
+static void accept_retry(timer_wheel_t *w, wheel_timer_t *t) {
+    event_loop_t *loop = (event_loop_t *)((uintptr_t)t - offsetof(event_loop_t, accept_timer));
+    (void)w;
+    if (loop->uring)
+        uring_loop_accept(loop);
+    else
+        accept_connections(loop);
+}
+
+int event_loop_init(event_loop_t *loop, int listen_fd, SSL_CTX *ctx) {
+    memset(loop, 0, sizeof(*loop));
+    conn_pool_init(&loop->conns);
+    loop->listen_fd = listen_fd;
+    loop->ctx = ctx;
+    outq_limits_init(&loop->out_limits, OUTQ_DEFAULT_HIGH_WATERMARK, OUTQ_DEFAULT_LOW_WATERMARK,
+                     OUTQ_DEFAULT_LIMIT);
+    timer_wheel_init(&loop->timers, timer_clock_ms());
+    loop->handshake_timeout_ms = CONN_DEFAULT_HANDSHAKE_TIMEOUT * 1000;
+    loop->ping_interval_ms = CONN_DEFAULT_PING_INTERVAL * 1000;
+    loop->ping_interval_max_ms = CONN_DEFAULT_PING_INTERVAL_MAX * 1000;
+    loop->pong_timeout_ms = CONN_DEFAULT_PONG_TIMEOUT * 1000;
+    sigprocmask(SIG_BLOCK, NULL, &loop->wait_mask);
+    timer_init(&loop->accept_timer, accept_retry);
+    loop->reserve_fd = -1;
+
+    int flags = fcntl(listen_fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return -1;
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epfd < 0)
+        return -1;
+
+    // The listener and the main process's eventfd are the only fds
+    // registered without a connection handle
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLET, .data.u64 = CONN_HANDLE_NONE };
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        close(loop->epfd);
+        return -1;
+    }
+    loop->ipc = worker_ipc_self();
+    if (loop->ipc) {
+        ev = (struct epoll_event){ .events = EPOLLIN, .data.u64 = LOOP_HANDLE_IPC };
+        if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->ipc->commands.efd, &ev) < 0) {
+            close(loop->epfd);
+            return -1;
+        }
+    }
+    loop->reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return 0;
+}
+
+int event_loop_timeout(event_loop_t *loop) {
+    if (loop->ipc && ipc_ring_sleep(&loop->ipc->commands) < 0)
+        return 0;
+    return timer_wheel_timeout(&loop->timers, timer_clock_ms());
+}
+
+// Commands go after the connections' own events, which may free up room
+// for their CALLs
+void event_loop_woken(event_loop_t *loop) {
+    if (!loop->ipc)
+        return;
+    ipc_ring_awake(&loop->ipc->commands);
+    commands_run(loop);
+}
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+void event_loop_stop_on(event_loop_t *loop, int signo) {
+    struct sigaction sa = { .sa_handler = on_stop_signal };
+    sigemptyset(&sa.sa_mask);
+    sigaction(signo, &sa, NULL);
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, signo);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+    sigdelset(&loop->wait_mask, signo);
+}
+
+int event_loop_stopping(void) {
+    return stop_requested;
+}
+
+static void epoll_loop_run(event_loop_t *loop) {
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!stop_requested) {
+        // Sleep until the next timer is due at the latest
+        int n = epoll_pwait(loop->epfd, events, MAX_EVENTS, event_loop_timeout(loop), &loop->wait_mask);
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR("epoll_wait: %s", strerror(errno));
+            return;
+        }
+        // Expired connections are closed first; their events in this batch are stale
+        timer_wheel_advance(&loop->timers, timer_clock_ms());
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u64 == CONN_HANDLE_NONE) {
+                accept_connections(loop);
+                continue;
+            }
+            if (events[i].data.u64 == LOOP_HANDLE_IPC) {
+                ipc_ring_clear_wakeup(&loop->ipc->commands);
+                continue;
+            }
+            // Closed earlier in this batch: the event is for a connection
+            // that no longer exists, even if its slot or fd is in use again
+            connection_t *conn = conn_pool_get(&loop->conns, events[i].data.u64);
+            if (!conn)
+                continue;
+            if (events[i].events & EPOLLERR) {
+                conn_close(loop, conn);
+                continue;
+            }
+            conn_drive(loop, conn);
+        }
+        event_loop_woken(loop);
+    }
+}
+
+void event_loop_run(event_loop_t *loop) {
+    if (loop->backend == EVENT_BACKEND_URING) {
+        int err = uring_loop_init(loop);
+        if (!err) {
+            uring_loop_run(loop);
+            return;
+        }
+        LOG_WARN("io_uring unavailable (%s), using epoll", strerror(err));
+        loop->backend = EVENT_BACKEND_EPOLL;
+    }
+    epoll_loop_run(loop);
+}
+
+void event_loop_destroy(event_loop_t *loop) {
+    uring_loop_destroy(loop);
+    if (loop->reserve_fd >= 0)
+        close(loop->reserve_fd);
+    loop->reserve_fd = -1;
+    if (loop->epfd >= 0)
+        close(loop->epfd);
+    loop->epfd = -1;
+    conn_pool_destroy(&loop->conns);
+}
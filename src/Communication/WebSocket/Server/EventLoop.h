@@ -0,0 +1,150 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <signal.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <time.h>
+#include <openssl/ssl.h>
+
+#include "WebSocketFrame.h"
+#include "TLSEngine.h"
+#include "OutQueue.h"
+#include "HttpParser.h"
+#include "Handshake.h"
+#include "OcppJ.h"
+#include "ConnPool.h"
+#include "TimerWheel.h"
+
+#define MAX_EVENTS 1024
+#define CONN_BUFFER_SIZE 4096
+
+// Defaults for the connection timers, in seconds
+#define CONN_DEFAULT_HANDSHAKE_TIMEOUT 10   // TLS and HTTP upgrade, and flushing before a close
+#define CONN_DEFAULT_PING_INTERVAL     60   // silence before a station is pinged
+#define CONN_DEFAULT_PING_INTERVAL_MAX 240  // stretched to this while pongs come back promptly
+#define CONN_DEFAULT_PONG_TIMEOUT      10   // then how long it has to show signs of life
+#define CONN_DEFAULT_CALL_TIMEOUT      30   // an answer to a CALL of ours
+
+// A listener that cannot accept (out of descriptors or memory) is retried
+// this much later
+#define ACCEPT_RETRY_MS     100
+// and says so at most this often
+#define ACCEPT_LOG_INTERVAL 10000
+
+// Per-connection state machine, advanced by the event loop
+typedef enum {
+    CONN_TLS_ACCEPT,    // TLS handshake still in progress (skipped without TLS)
+    CONN_WS_HANDSHAKE,  // waiting for the HTTP upgrade request
+    CONN_OPEN,          // exchanging WebSocket frames
+    CONN_CLOSE_WAIT,    // our close frame is queued, reading until the peer's
+    CONN_CLOSING        // flushing pending output, then close
+} conn_state_t;
+
+#define CONN_CACHE_LINE 64
+
+// What only the handshake and the OCPP layer use, kept out of the hot array
+typedef struct conn_cold {
+    ws_upgrade_t upgrade;       // station id and negotiated subprotocol
+    time_t connected_at;
+    uint32_t messages;          // received since the upgrade
+    uint8_t upgraded;           // ocpp has replaced http below
+    wheel_timer_t timer;        // the next deadline, whichever it is
+    struct connection *conn;    // the timer's way back
+    uint32_t pong_at;           // tick the last pong came in
+    ws_deflate_t deflate;       // permessage-deflate streams, once negotiated
+    union {
+        http_parser_t http;     // upgrade request, until the handshake completes
+        ocpp_session_t ocpp;    // set up once the upgrade is answered
+    };
+} conn_cold_t;
+
+// The fields every event looks at come first: the fd, the state, the ping
+// ticks and the decoder's buffer and cursors share the first cache line.
+// Connections live in a conn_pool_t.
+typedef struct connection {
+    alignas(CONN_CACHE_LINE) int fd;
+    uint32_t slot;              // index in the pool
+    uint32_t generation;        // see conn_handle_t
+    uint8_t state;              // conn_state_t
+    uint8_t ktls_tx;            // the kernel encrypts writes, the queue bypasses the engine
+    uint8_t ping_sent;          // silent past the ping interval, pinged
+    uint8_t ping_shift;         // the ping interval is doubled this many times
+    uint32_t last_rx;           // wheel tick of the last bytes received
+    uint32_t ping_at;           // tick our last ping went out, due back pong_timeout later; 0 once accounted for
+    ws_decoder_t rx;            // decrypted bytes not yet consumed
+    tls_engine_t tls;           // tls.ssl is NULL on a plain ws:// listener
+    struct uring_conn *uring;   // received buffers and I/O in flight, io_uring only
+    conn_cold_t *cold;
+    outq_t out;                 // frames waiting for the socket
+} connection_t;
+
+_Static_assert(offsetof(connection_t, rx.tail) + sizeof(size_t) <= CONN_CACHE_LINE,
+               "the receive cursors belong in the first cache line");
+
+typedef enum {
+    EVENT_BACKEND_EPOLL,    // readiness: read/write from the loop
+    EVENT_BACKEND_URING     // completions: the kernel reads and writes for us
+} event_backend_t;
+
+typedef struct event_loop {
+    event_backend_t backend;
+    int epfd;
+    struct uring *uring; // NULL unless running on io_uring
+    int listen_fd;
+    SSL_CTX *ctx;       // NULL to serve plain TCP
+    int tls_on_socket;  // bind OpenSSL to the fd so the kernel can take records over
+    conn_pool_t conns;
+    outq_limits_t out_limits;
+    int drop_slow;      // close stations whose queue stays above the high watermark
+    // One timer per connection. Reads only note the tick, the timer works
+    // out on expiry whether the station has really been quiet.
+    timer_wheel_t timers;
+    uint32_t handshake_timeout_ms;
+    uint32_t ping_interval_ms;  // 0 never pings
+    uint32_t ping_interval_max_ms;
+    uint32_t pong_timeout_ms;
+    struct worker_ipc *ipc;     // commands from the main process, NULL when run on its own
+    sigset_t wait_mask;         // the signal mask while the backend sleeps
+    int reserve_fd;             // given up to refuse connections once out of descriptors
+    wheel_timer_t accept_timer; // accepting again after an error
+    uint64_t accept_logged_ms;  // last accept error logged
+    uint32_t accept_errors;     // since then
+} event_loop_t;
+
+int event_loop_init(event_loop_t *loop, int listen_fd, SSL_CTX *ctx);
+// Runs on loop->backend, falling back to epoll if io_uring cannot be set up
+void event_loop_run(event_loop_t *loop);
+// Return from event_loop_run once signo arrives. It is blocked outside the
+// backend's wait, so it cannot slip in between the check and the sleep.
+void event_loop_stop_on(event_loop_t *loop, int signo);
+int event_loop_stopping(void);
+void event_loop_destroy(event_loop_t *loop);
+
+// For the backends: how long they may sleep, until the next timer or not at
+// all if commands are waiting, and what to do once they wake
+int event_loop_timeout(event_loop_t *loop);
+void event_loop_woken(event_loop_t *loop);
+
+// For the backends: what to do about an accept that failed with err. Returns
+// 1 to accept again straight away, 0 to stop: on EAGAIN until the listener
+// is readable, after an error until the loop's accept timer resumes it.
+int event_loop_accept_failed(event_loop_t *loop, int err);
+
+// For the backends: set up a connection for an accepted fd (closing the fd on
+// failure), advance it as far as its transport allows (-1 once it has been
+// closed and must not be touched), and release it for good.
+connection_t *conn_open(event_loop_t *loop, int fd);
+int conn_drive(event_loop_t *loop, connection_t *conn);
+void conn_free(event_loop_t *loop, connection_t *conn);
+// Re-arm the connection's timer for whichever of its deadlines comes first.
+// Needed after sending a CALL so that it times out.
+void conn_timer_update(event_loop_t *loop, connection_t *conn);
+
+// Queue a copy of data for the connection; flushed as soon as the socket allows
+int conn_send(connection_t *conn, const void *data, size_t len);
+// False while the output queue is above its high watermark. Producers should
+// hold back until it drains; the loop stops reading the station meanwhile.
+int conn_writable(const connection_t *conn);
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "Handshake.h"
+
+// Server preference is irrelevant: the first offer we support wins
+static const char *const supported_subprotocols[] = { "ocpp2.0.1", "ocpp1.6" };
+
+static int ws_handshake_reject(int status, char *response, size_t *response_len) {
+    const char *reason = "Bad Request";
+    const char *extra = "";
+
+    switch (status) {
+    case 404: reason = "Not Found"; break;
+    case 405: reason = "Method Not Allowed"; break;
+    case 426: reason = "Upgrade Required"; extra = "Sec-WebSocket-Version: 13\r\n"; break;
+    case 431: reason = "Request Header Fields Too Large"; break;
+    case 505: reason = "HTTP Version Not Supported"; break;
+    default: status = 400; break;
+    }
+
+    *response_len = (size_t)snprintf(response, HANDSHAKE_RESPONSE_SIZE,
+             "HTTP/1.1 %d %s\r\n"
+             "%s"
+             "Connection: close\r\n"
+             "Content-Length: 0\r\n"
+             "\r\n",
+             status, reason, extra);
+    return -1;
+}
+
+static int select_subprotocol(const char *token, size_t len, void *arg) {
+    ws_upgrade_t *up = arg;
+    for (size_t i = 0; i < sizeof(supported_subprotocols) / sizeof(supported_subprotocols[0]); i++) {
+        if (strlen(supported_subprotocols[i]) == len && memcmp(token, supported_subprotocols[i], len) == 0) {
+            up->subprotocol = supported_subprotocols[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    const ws_deflate_config_t *cfg;
+    ws_deflate_params_t *params;
+} deflate_offer_t;
+
+// Offers come in order of the client's preference; the first we can honour wins
+static int select_deflate(const char *token, size_t len, void *arg) {
+    deflate_offer_t *offer = arg;
+    return ws_deflate_accept(token, len, offer->cfg, offer->params);
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// The charge point identity is the last segment of the path, percent-decoded
+static int extract_station_id(const char *target, size_t len, char *out) {
+    const char *end = target + len;
+    for (const char *c = target; c < end; c++) {
+        if (*c == '?' || *c == '#') {
+            end = c;
+            break;
+        }
+    }
+    const char *seg = end;
+    while (seg > target && seg[-1] != '/') seg--;
+
+    size_t n = 0;
+    for (const char *c = seg; c < end; c++) {
+        char ch = *c;
+        if (ch == '%') {
+            if (end - c < 3 || hex_value(c[1]) < 0 || hex_value(c[2]) < 0) return -1;
+            ch = (char)(hex_value(c[1]) << 4 | hex_value(c[2]));
+            c += 2;
+        }
+        if ((unsigned char)ch < 0x21 || (unsigned char)ch > 0x7E || n == STATION_ID_MAX) return -1;
+        out[n++] = ch;
+    }
+    out[n] = '\0';
+    return n > 0 ? 0 : -1;
+}
+
+// A valid key is 16 random bytes in base64
+static int valid_websocket_key(const char *key, size_t len) {
+    uint8_t nonce[WS_KEY_LEN / 4 * 3];
+    return len == WS_KEY_LEN && ws_base64_decode(key, len, nonce) == 16;
+}
+
+int ws_handshake_process(http_parser_t *p, const char *buf, size_t len, const ws_deflate_config_t *deflate,
+                         ws_upgrade_t *up, char *response, size_t *response_len) {
+    int rc = http_parse(p, buf, len);
+    if (rc == 0) return 0;
+    if (rc < 0) return ws_handshake_reject(p->error_status, response, response_len);
+
+    if (p->method.len != 3 || memcmp(buf + p->method.off, "GET", 3) != 0)
+        return ws_handshake_reject(405, response, response_len);
+    if (p->minor_version < 1 || !http_header(p, HTTP_HDR_HOST))
+        return ws_handshake_reject(400, response, response_len);
+    if (!http_header_has_token(p, buf, HTTP_HDR_UPGRADE, "websocket") ||
+        !http_header_has_token(p, buf, HTTP_HDR_CONNECTION, "upgrade"))
+        return ws_handshake_reject(400, response, response_len);
+
+    const http_header_t *version = http_header(p, HTTP_HDR_SEC_WEBSOCKET_VERSION);
+    if (!version || version->value.len != 2 || memcmp(buf + version->value.off, "13", 2) != 0)
+        return ws_handshake_reject(426, response, response_len);
+
+    const http_header_t *key = http_header(p, HTTP_HDR_SEC_WEBSOCKET_KEY);
+    if (!key || !valid_websocket_key(buf + key->value.off, key->value.len))
+        return ws_handshake_reject(400, response, response_len);
+
+    if (extract_station_id(buf + p->target.off, p->target.len, up->station_id) < 0)
+        return ws_handshake_reject(404, response, response_len);
+
+    up->subprotocol = NULL;
+    up->subprotocol_offered = http_header(p, HTTP_HDR_SEC_WEBSOCKET_PROTOCOL) != NULL;
+    http_header_each_token(p, buf, HTTP_HDR_SEC_WEBSOCKET_PROTOCOL, select_subprotocol, up);
+
+    up->deflate = (ws_deflate_params_t){ 0 };
+    if (deflate && deflate->enabled) {
+        deflate_offer_t offer = { deflate, &up->deflate };
+        http_header_each_token(p, buf, HTTP_HDR_SEC_WEBSOCKET_EXTENSIONS, select_deflate, &offer);
+    }
+    char accept_key[WS_ACCEPT_LEN + 1];
+    ws_accept_key(buf + key->value.off, accept_key);
+
+    int n = snprintf(response, HANDSHAKE_RESPONSE_SIZE,
+             "HTTP/1.1 101 Switching Protocols\r\n"
+             "Upgrade: websocket\r\n"
+             "Connection: Upgrade\r\n"
+             "Sec-WebSocket-Accept: %s\r\n",
+             accept_key);
+    if (up->subprotocol)
+        n += snprintf(response + n, HANDSHAKE_RESPONSE_SIZE - (size_t)n,
+                      "Sec-WebSocket-Protocol: %s\r\n", up->subprotocol);
+    if (up->deflate.enabled) {
+        char extension[WS_DEFLATE_PARAMS_SIZE];
+        ws_deflate_format(&up->deflate, 1, extension, sizeof(extension));
+        n += snprintf(response + n, HANDSHAKE_RESPONSE_SIZE - (size_t)n,
+                      "Sec-WebSocket-Extensions: %s\r\n", extension);
+    }
+    n += snprintf(response + n, HANDSHAKE_RESPONSE_SIZE - (size_t)n, "\r\n");
+
+    *response_len = (size_t)n;
+    return 1;
+}
@@ -0,0 +1,27 @@
+#ifndef HANDSHAKE_H
+#define HANDSHAKE_H
+
+#include <stddef.h>
+
+#include "HttpParser.h"
+#include "HandshakeCrypto.h"
+#include "Deflate.h"
+
+#define STATION_ID_MAX 48   // OCPP identifierString[48]
+#define HANDSHAKE_RESPONSE_SIZE 512
+
+typedef struct {
+    char station_id[STATION_ID_MAX + 1];  // last path segment of the request URL
+    const char *subprotocol;              // negotiated OCPP version, NULL if none
+    int subprotocol_offered;              // the client asked for one at all
+    ws_deflate_params_t deflate;          // permessage-deflate, if both sides wanted it
+} ws_upgrade_t;
+
+// Feed the bytes received so far. Returns 1 when the upgrade was accepted,
+// 0 if the request is still incomplete and -1 if it was rejected. On 1 and -1
+// response holds what to send back. deflate (NULL: never) says whether and
+// how permessage-deflate may be accepted.
+int ws_handshake_process(http_parser_t *p, const char *buf, size_t len, const ws_deflate_config_t *deflate,
+                         ws_upgrade_t *up, char *response, size_t *response_len);
+
+#endif
@@ -0,0 +1,660 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "IoUring.h"
+#include "BufferPool.h"
+#include "WorkerIpc.h"
+#include "Log.h"
+
+#ifdef WS_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// What a completion is for, in the low bits of user_data under the pointer
+// (calloc's alignment leaves at least three)
+enum { OP_ACCEPT, OP_RECV, OP_SEND, OP_CANCEL, OP_IPC };
+#define OP_MASK 7u
+
+enum { RECV_IDLE, RECV_ARMED, RECV_CANCELLING };
+
+struct uring {
+    int fd;
+    int listen_fd;
+    int accepting;              // the multishot accept is armed
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned sq_entries;
+    unsigned sq_local_tail;     // entries prepared, published on submit
+    unsigned sq_submitted;
+    const sigset_t *wait_mask;  // the loop's, while io_uring_enter waits
+    void *rings;
+    size_t rings_size;
+    size_t sqes_size;
+
+    // Provided receive buffers, handed back to the kernel once consumed
+    struct io_uring_buf_ring *buf_ring;
+    uint8_t *bufs;
+    uint16_t buf_tail;
+    int buf_next[URING_BUF_COUNT];      // per-connection receive queues
+    uint32_t buf_len[URING_BUF_COUNT];
+
+    struct uring_conn *ready;   // connections to drive once the batch is reaped
+    struct uring_conn *stalled; // found no free entry, driven again after the next submit
+};
+
+struct uring_conn {
+    struct uring *ring;
+    connection_t *conn;
+    struct uring_conn *next_ready;
+    int queued;                 // on the ready or the stalled list
+    int rx_head, rx_tail;       // received buffers in arrival order, -1 when none
+    size_t rx_off;              // bytes of rx_head already consumed
+    unsigned ops;               // submissions still owed a final completion
+    int recv_state;
+    int eof;                    // the peer is gone: report it once rx is drained
+    int dead;                   // closed, freed when ops reaches zero
+    int failed;                 // a send failed, the next flush reports it
+    int send_ops;               // linked sends in flight
+    size_t send_bytes;          // what they have sent so far
+    struct msghdr msg[URING_SEND_LINKS];
+    struct iovec *iov;          // gather lists of the sends in flight, plain connections only
+    uint8_t (*inline_copy)[OUTQ_INLINE_SIZE];  // the queue's inline pieces they send, after iov
+};
+
+#define URING_SEND_IOV (URING_SEND_LINKS * OUTQ_MAX_IOV)
+
+static int sys_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned min_complete, unsigned flags,
+                     const void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_register(int fd, unsigned op, void *arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, nr);
+}
+
+static void uring_close(struct uring *r) {
+    if (r->buf_ring)
+        munmap(r->buf_ring, URING_BUF_COUNT * sizeof(struct io_uring_buf));
+    if (r->bufs)
+        munmap(r->bufs, (size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_size);
+    if (r->rings)
+        munmap(r->rings, r->rings_size);
+    if (r->fd >= 0)
+        close(r->fd);
+}
+
+static int uring_open(struct uring *r, unsigned entries) {
+    // Only this thread submits, and it reaps completions in io_uring_enter,
+    // so the kernel can defer its work to then instead of interrupting us.
+    // Kernels before 6.0 lack multishot receive anyway.
+    static const unsigned flag_sets[] = {
+        IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN |
+            IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+        IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER
+    };
+    struct io_uring_params p;
+
+    r->fd = -1;
+    for (size_t i = 0; i < sizeof(flag_sets) / sizeof(flag_sets[0]) && r->fd < 0; i++) {
+        memset(&p, 0, sizeof(p));
+        p.flags = flag_sets[i];
+        r->fd = sys_setup(entries, &p);
+        if (r->fd < 0 && errno != EINVAL)
+            return errno;
+    }
+    if (r->fd < 0 || !(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP) ||
+        !(p.features & IORING_FEAT_EXT_ARG))
+        return EOPNOTSUPP;
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->rings_size = sq_size > cq_size ? sq_size : cq_size;
+    r->rings = mmap(NULL, r->rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    r->fd, IORING_OFF_SQ_RING);
+    if (r->rings == MAP_FAILED) {
+        r->rings = NULL;
+        return errno;
+    }
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        return errno;
+    }
+
+    uint8_t *base = r->rings;
+    r->sq_head = (unsigned *)(base + p.sq_off.head);
+    r->sq_tail = (unsigned *)(base + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(base + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(base + p.sq_off.array);
+    r->cq_head = (unsigned *)(base + p.cq_off.head);
+    r->cq_tail = (unsigned *)(base + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(base + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(base + p.cq_off.cqes);
+    r->sq_entries = p.sq_entries;
+    r->sq_local_tail = r->sq_submitted = *r->sq_tail;
+    return 0;
+}
+
+static void uring_buf_recycle(struct uring *r, int bid) {
+    struct io_uring_buf *buf = &r->buf_ring->bufs[r->buf_tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (uintptr_t)(r->bufs + (size_t)bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = (uint16_t)bid;
+    __atomic_store_n(&r->buf_ring->tail, ++r->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int uring_register_buffers(struct uring *r) {
+    r->buf_ring = mmap(NULL, URING_BUF_COUNT * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    r->bufs = mmap(NULL, (size_t)URING_BUF_COUNT * URING_BUF_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r->buf_ring == MAP_FAILED || r->bufs == MAP_FAILED) {
+        int err = errno;
+        if (r->buf_ring == MAP_FAILED) r->buf_ring = NULL;
+        if (r->bufs == MAP_FAILED) r->bufs = NULL;
+        return err;
+    }
+
+    struct io_uring_buf_reg reg = {
+        .ring_addr = (uintptr_t)r->buf_ring,
+        .ring_entries = URING_BUF_COUNT,
+        .bgid = 0
+    };
+    if (sys_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        return errno;
+    for (int bid = 0; bid < URING_BUF_COUNT; bid++)
+        uring_buf_recycle(r, bid);
+    return 0;
+}
+
+// Hand prepared entries to the kernel, optionally waiting for completions
+// for up to timeout_ms (-1: for as long as it takes). Returns the number
+// submitted or -errno, -ETIME if the wait timed out with nothing submitted.
+static int uring_submit(struct uring *r, unsigned wait, int timeout_ms) {
+    __atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+    struct __kernel_timespec ts = { timeout_ms / 1000, (long long)(timeout_ms % 1000) * 1000000 };
+    struct io_uring_getevents_arg arg = {
+        .sigmask = (uintptr_t)r->wait_mask,
+        .sigmask_sz = _NSIG / 8,
+        .ts = timeout_ms >= 0 ? (uintptr_t)&ts : 0
+    };
+    int n = sys_enter(r->fd, r->sq_local_tail - r->sq_submitted, wait,
+                      wait ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0,
+                      wait ? &arg : NULL, wait ? sizeof(arg) : 0);
+    if (n < 0)
+        return -errno;
+    r->sq_submitted += (unsigned)n;
+    return n;
+}
+
+// Free entries, after handing the prepared ones to the kernel if fewer than
+// want are left
+static unsigned uring_sq_space(struct uring *r, unsigned want) {
+    unsigned used = r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (r->sq_entries - used < want) {
+        uring_submit(r, 0, -1);
+        used = r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    }
+    return r->sq_entries - used;
+}
+
+static struct io_uring_sqe *uring_sqe(struct uring *r, int op, int fd, uint64_t user_data) {
+    if (r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+        uring_submit(r, 0, -1);
+        if (r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries)
+            return NULL;
+    }
+    unsigned idx = r->sq_local_tail++ & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)op;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+    r->sq_array[idx] = idx;
+    return sqe;
+}
+
+static uint64_t uring_tag(struct uring_conn *uc, unsigned op) {
+    return (uintptr_t)uc | op;
+}
+
+static int uring_arm_accept(struct uring *r) {
+    struct io_uring_sqe *sqe = uring_sqe(r, IORING_OP_ACCEPT, r->listen_fd, OP_ACCEPT);
+    if (!sqe)
+        return -1;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    r->accepting = 1;
+    return 0;
+}
+
+// The main process's eventfd, polled for as long as the ring lives
+static int uring_arm_ipc(struct uring *r, int efd) {
+    struct io_uring_sqe *sqe = uring_sqe(r, IORING_OP_POLL_ADD, efd, OP_IPC);
+    if (!sqe)
+        return -1;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    return 0;
+}
+
+static void uring_stall(struct uring *r, struct uring_conn *uc);
+
+static void uring_arm_recv(struct uring_conn *uc) {
+    struct io_uring_sqe *sqe = uring_sqe(uc->ring, IORING_OP_RECV, uc->conn->fd, uring_tag(uc, OP_RECV));
+    if (!sqe) {
+        uring_stall(uc->ring, uc);
+        return;
+    }
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    uc->recv_state = RECV_ARMED;
+    uc->ops++;
+}
+
+// A throttled station stops receiving so its bytes wait in the socket buffer
+// (and TCP pushes back) instead of pinning shared receive buffers
+static void uring_cancel_recv(struct uring_conn *uc) {
+    struct io_uring_sqe *sqe = uring_sqe(uc->ring, IORING_OP_ASYNC_CANCEL, -1, uring_tag(uc, OP_CANCEL));
+    if (!sqe) {
+        uring_stall(uc->ring, uc);
+        return;
+    }
+    sqe->addr = uring_tag(uc, OP_RECV);
+    uc->recv_state = RECV_CANCELLING;
+    uc->ops++;
+}
+
+static void uring_ready(struct uring *r, struct uring_conn *uc) {
+    if (uc->queued)
+        return;
+    uc->queued = 1;
+    uc->next_ready = r->ready;
+    r->ready = uc;
+}
+
+// The ring was full: nothing may be pending to bring the connection back
+static void uring_stall(struct uring *r, struct uring_conn *uc) {
+    if (uc->queued)
+        return;
+    uc->queued = 1;
+    uc->next_ready = r->stalled;
+    r->stalled = uc;
+}
+
+static void uring_conn_release(event_loop_t *loop, struct uring_conn *uc) {
+    while (uc->rx_head >= 0) {
+        int bid = uc->rx_head;
+        uc->rx_head = uc->ring->buf_next[bid];
+        uring_buf_recycle(uc->ring, bid);
+    }
+    connection_t *conn = uc->conn;
+    buf_pool_put(uc->iov);
+    free(uc);
+    conn->uring = NULL;
+    conn_free(loop, conn);
+}
+
+// With the submission queue full, the loop's accept timer tries again
+static void uring_accept_again(event_loop_t *loop, struct uring *r) {
+    if (!r->accepting && uring_arm_accept(r) < 0)
+        timer_arm(&loop->timers, &loop->accept_timer, ACCEPT_RETRY_MS);
+}
+
+static void uring_accepted(event_loop_t *loop, struct uring *r, int res, int more) {
+    if (!more)
+        r->accepting = 0;
+    // Re-armed at once an error would only come back: it waits for the
+    // accept timer instead
+    if (res < 0) {
+        if (res == -EAGAIN || event_loop_accept_failed(loop, -res))
+            uring_accept_again(loop, r);
+        return;
+    }
+    uring_accept_again(loop, r);
+
+    connection_t *conn = conn_open(loop, res);
+    if (!conn)
+        return;
+    struct uring_conn *uc = calloc(1, sizeof(*uc));
+    if (!uc) {
+        conn_free(loop, conn);
+        return;
+    }
+    uc->ring = r;
+    uc->conn = conn;
+    uc->rx_head = uc->rx_tail = -1;
+    conn->uring = uc;
+    uring_arm_recv(uc);
+}
+
+static void uring_complete(event_loop_t *loop, struct uring *r, const struct io_uring_cqe *cqe) {
+    unsigned op = cqe->user_data & OP_MASK;
+    struct uring_conn *uc = (struct uring_conn *)(uintptr_t)(cqe->user_data & ~(uint64_t)OP_MASK);
+    int more = cqe->flags & IORING_CQE_F_MORE;
+
+    if (op == OP_ACCEPT) {
+        uring_accepted(loop, r, cqe->res, more);
+        return;
+    }
+    if (op == OP_IPC) {
+        ipc_ring_clear_wakeup(&loop->ipc->commands);
+        if (!more)
+            uring_arm_ipc(r, loop->ipc->commands.efd);
+        return;
+    }
+
+    if (op == OP_RECV) {
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            int bid = (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            if (uc->dead || cqe->res <= 0) {
+                uring_buf_recycle(r, bid);
+            } else {
+                r->buf_len[bid] = (uint32_t)cqe->res;
+                r->buf_next[bid] = -1;
+                if (uc->rx_tail >= 0)
+                    r->buf_next[uc->rx_tail] = bid;
+                else
+                    uc->rx_head = bid;
+                uc->rx_tail = bid;
+            }
+        } else if (cqe->res == 0 ||
+                   (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED)) {
+            uc->eof = 1;
+        }
+        // Out of buffers or cancelled: re-armed once the station may read again
+        if (!more) {
+            uc->recv_state = RECV_IDLE;
+            uc->ops--;
+        }
+    } else if (op == OP_SEND) {
+        if (cqe->res >= 0)
+            uc->send_bytes += (size_t)cqe->res;
+        else if (cqe->res != -ECANCELED)  // the rest of a broken chain
+            uc->failed = 1;
+        uc->ops--;
+        if (--uc->send_ops == 0) {
+            // Gather lists are only held while sends are in flight
+            buf_pool_put(uc->iov);
+            uc->iov = NULL;
+        }
+        if (uc->send_ops == 0 && !uc->dead) {
+            if (uc->conn->tls.ssl)
+                tls_engine_consume(&uc->conn->tls, uc->send_bytes);
+            else
+                outq_consume(&uc->conn->out, uc->send_bytes);
+        }
+    } else {
+        uc->ops--;
+    }
+
+    if (uc->dead) {
+        if (uc->ops == 0 && !uc->queued)
+            uring_conn_release(loop, uc);
+        return;
+    }
+    uring_ready(r, uc);
+}
+
+int uring_probe(void) {
+    struct uring *r = calloc(1, sizeof(*r));
+    if (!r)
+        return ENOMEM;
+    int err = uring_open(r, 8);
+    if (!err)
+        err = uring_register_buffers(r);
+    uring_close(r);
+    free(r);
+    return err;
+}
+
+int uring_loop_init(event_loop_t *loop) {
+    struct uring *r = calloc(1, sizeof(*r));
+    if (!r)
+        return ENOMEM;
+    r->listen_fd = loop->listen_fd;
+    int err = uring_open(r, URING_ENTRIES);
+    if (!err)
+        err = uring_register_buffers(r);
+    if (!err && (uring_arm_accept(r) < 0 || (loop->ipc && uring_arm_ipc(r, loop->ipc->commands.efd) < 0)))
+        err = EBUSY;
+    if (err) {
+        uring_close(r);
+        free(r);
+        return err;
+    }
+    r->wait_mask = &loop->wait_mask;
+    loop->uring = r;
+    return 0;
+}
+
+void uring_loop_run(event_loop_t *loop) {
+    struct uring *r = loop->uring;
+
+    while (!event_loop_stopping()) {
+        // Every send and re-arm prepared in the last pass goes in with the
+        // wait, which ends when the next timer is due at the latest
+        int rc = uring_submit(r, 1, r->stalled ? 0 : event_loop_timeout(loop));
+        if (rc < 0 && rc != -EINTR && rc != -EAGAIN && rc != -EBUSY && rc != -ETIME) {
+            LOG_ERROR("io_uring_enter: %s", strerror(-rc));
+            return;
+        }
+        // Before the completions, so that new connections arm from the current
+        // tick; the ready list is empty, timed out connections just go
+        timer_wheel_advance(&loop->timers, timer_clock_ms());
+        while (r->stalled) {
+            struct uring_conn *uc = r->stalled;
+            r->stalled = uc->next_ready;
+            uc->queued = 0;
+            uring_ready(r, uc);
+        }
+
+        unsigned head = *r->cq_head;
+        unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+            uring_complete(loop, r, &r->cqes[head & *r->cq_mask]);
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+        // Each connection runs once per batch, however many completions it got
+        while (r->ready) {
+            struct uring_conn *uc = r->ready;
+            r->ready = uc->next_ready;
+            uc->queued = 0;
+
+            // Closed while it waited on a list
+            if (uc->dead) {
+                if (uc->ops == 0)
+                    uring_conn_release(loop, uc);
+                continue;
+            }
+            if (conn_drive(loop, uc->conn) < 0)
+                continue;
+            if (!conn_writable(uc->conn)) {
+                if (uc->recv_state == RECV_ARMED)
+                    uring_cancel_recv(uc);
+            } else if (uc->recv_state == RECV_IDLE && !uc->eof) {
+                uring_arm_recv(uc);
+            }
+        }
+        event_loop_woken(loop);
+    }
+}
+
+void uring_loop_accept(event_loop_t *loop) {
+    uring_accept_again(loop, loop->uring);
+}
+
+void uring_loop_destroy(event_loop_t *loop) {
+    if (!loop->uring)
+        return;
+    uring_close(loop->uring);
+    free(loop->uring);
+    loop->uring = NULL;
+}
+
+int uring_conn_recv(connection_t *conn, uint8_t *dst, size_t avail) {
+    struct uring_conn *uc = conn->uring;
+    struct uring *r = uc->ring;
+    size_t copied = 0;
+
+    while (uc->rx_head >= 0 && copied < avail) {
+        int bid = uc->rx_head;
+        size_t n = r->buf_len[bid] - uc->rx_off;
+        if (n > avail - copied)
+            n = avail - copied;
+        memcpy(dst + copied, r->bufs + (size_t)bid * URING_BUF_SIZE + uc->rx_off, n);
+        copied += n;
+        uc->rx_off += n;
+        if (uc->rx_off == r->buf_len[bid]) {
+            uc->rx_head = r->buf_next[bid];
+            if (uc->rx_head < 0)
+                uc->rx_tail = -1;
+            uc->rx_off = 0;
+            uring_buf_recycle(r, bid);
+        }
+    }
+    if (copied)
+        return (int)copied;
+    return uc->eof ? -1 : 0;
+}
+
+int uring_conn_flush(connection_t *conn) {
+    struct uring_conn *uc = conn->uring;
+    struct uring *r = uc->ring;
+
+    if (uc->failed)
+        return -1;
+    if (uc->send_ops)
+        return 0;  // its completion flushes again
+    uc->send_bytes = 0;
+
+    // MSG_WAITALL: a short send would let the next link overtake its tail
+    if (conn->tls.ssl) {
+        // Encrypt until the engine is full, then send its records at once
+        if (outq_flush_tls(&conn->out, &conn->tls, -1) < 0)
+            return -1;
+        size_t len;
+        const uint8_t *data = tls_engine_output(&conn->tls, &len);
+        if (!data)
+            return 0;
+        struct io_uring_sqe *sqe = uring_sqe(r, IORING_OP_SEND, conn->fd, uring_tag(uc, OP_SEND));
+        if (!sqe) {
+            uring_stall(r, uc);
+            return 0;
+        }
+        sqe->addr = (uintptr_t)data;
+        sqe->len = (uint32_t)len;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        uc->send_ops = 1;
+        uc->ops++;
+        return 0;
+    }
+
+    if (conn->out.bytes == 0)
+        return 0;
+    if (!uc->iov) {
+        if (!(uc->iov = buf_pool_get(URING_SEND_IOV * (sizeof(*uc->iov) + OUTQ_INLINE_SIZE))))
+            return -1;
+        uc->inline_copy = (void *)(uc->iov + URING_SEND_IOV);
+    }
+    // The whole chain goes in one submission: a link submitted without its
+    // successor ends the chain, and the rest would race it on the socket
+    unsigned links = uring_sq_space(r, URING_SEND_LINKS);
+    if (links == 0) {
+        uring_stall(r, uc);
+        return 0;
+    }
+    if (links > URING_SEND_LINKS)
+        links = URING_SEND_LINKS;
+    // Copies of the inline pieces: replies queued meanwhile may move the queue's ring
+    int iovcnt = outq_gather_stable(&conn->out, uc->iov, (int)links * OUTQ_MAX_IOV, uc->inline_copy);
+    for (int i = 0, link = 0; i < iovcnt; i += OUTQ_MAX_IOV, link++) {
+        struct msghdr *msg = &uc->msg[link];
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_iov = uc->iov + i;
+        msg->msg_iovlen = iovcnt - i < OUTQ_MAX_IOV ? (size_t)(iovcnt - i) : OUTQ_MAX_IOV;
+
+        struct io_uring_sqe *sqe = uring_sqe(r, IORING_OP_SENDMSG, conn->fd, uring_tag(uc, OP_SEND));
+        sqe->addr = (uintptr_t)msg;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        if (i + OUTQ_MAX_IOV < iovcnt)
+            sqe->flags = IOSQE_IO_LINK;
+        uc->send_ops++;
+        uc->ops++;
+    }
+    return 0;
+}
+
+void uring_conn_close(event_loop_t *loop, connection_t *conn) {
+    struct uring_conn *uc = conn->uring;
+    // Whatever a send in flight holds is still in the engine: sending now
+    // would repeat it, so close_notify goes only from an idle connection
+    if (conn->tls.ssl && !uc->send_ops)
+        tls_engine_send_fd(&conn->tls, conn->fd);
+    uc->dead = 1;
+    if (uc->ops == 0 && !uc->queued) {
+        uring_conn_release(loop, uc);
+        return;
+    }
+    // Ends the receive and any send still in flight; their completions
+    // release the connection
+    shutdown(conn->fd, SHUT_RDWR);
+}
+
+#else
+
+int uring_probe(void) {
+    return ENOSYS;
+}
+
+int uring_loop_init(event_loop_t *loop) {
+    (void)loop;
+    return ENOSYS;
+}
+
+void uring_loop_run(event_loop_t *loop) {
+    (void)loop;
+}
+
+void uring_loop_destroy(event_loop_t *loop) {
+    (void)loop;
+}
+
+void uring_loop_accept(event_loop_t *loop) {
+    (void)loop;
+}
+
+int uring_conn_recv(connection_t *conn, uint8_t *dst, size_t avail) {
+    (void)conn; (void)dst; (void)avail;
+    return -1;
+}
+
+int uring_conn_flush(connection_t *conn) {
+    (void)conn;
+    return -1;
+}
+
+void uring_conn_close(event_loop_t *loop, connection_t *conn) {
+    conn_free(loop, conn);
+}
+
+#endif
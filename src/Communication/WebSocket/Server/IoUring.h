@@ -0,0 +1,38 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "EventLoop.h"
+
+#define URING_ENTRIES    1024   // submission queue depth
+#define URING_BUF_COUNT  256    // provided receive buffers, a power of two
+#define URING_BUF_SIZE   16384  // one full TLS record
+#define URING_SEND_LINKS 4      // linked sendmsg per flush, OUTQ_MAX_IOV segments each
+
+// 0 if the kernel offers everything the backend needs (multishot accept and
+// receive, provided buffer rings), otherwise an errno value saying why.
+// ENOSYS when the server was built without io_uring support.
+int uring_probe(void);
+
+// Completion-driven loop: one multishot accept, a multishot receive per
+// connection filling buffers from a shared ring, and all of an iteration's
+// sends submitted with the wait for the next completions. Returns an errno
+// value if the ring could not be set up.
+int uring_loop_init(event_loop_t *loop);
+void uring_loop_run(event_loop_t *loop);
+void uring_loop_destroy(event_loop_t *loop);
+// Take connections again after event_loop_accept_failed stopped the accept
+void uring_loop_accept(event_loop_t *loop);
+
+// Used by the connection state machine in place of read/write on the fd.
+// recv copies out bytes the kernel already delivered: 0 when there are none
+// yet, -1 once the peer is gone. flush submits a send of queued output if
+// none is in flight. close defers conn_free until the kernel has finished
+// with the connection's buffers.
+int uring_conn_recv(connection_t *conn, uint8_t *dst, size_t avail);
+int uring_conn_flush(connection_t *conn);
+void uring_conn_close(event_loop_t *loop, connection_t *conn);
+
+#endif
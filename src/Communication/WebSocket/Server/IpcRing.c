@@ -0,0 +1,116 @@
+#include <errno.h>
+#include <unistd.h>
+
+#include "IpcRing.h"
+
+// Header and payload, rounded up so every header stays aligned
+static uint32_t record_size(uint32_t len) {
+    return (uint32_t)(sizeof(ipc_record_t) + len + IPC_RECORD_ALIGN - 1) & ~(uint32_t)(IPC_RECORD_ALIGN - 1);
+}
+
+size_t ipc_ring_size(uint32_t capacity) {
+    return sizeof(ipc_ring_shm_t) + capacity;
+}
+
+void ipc_ring_attach(ipc_ring_t *r, void *mem, uint32_t capacity, int efd) {
+    r->shm = mem;
+    r->capacity = capacity;
+    r->efd = efd;
+    r->tail = r->cached_tail = __atomic_load_n(&r->shm->tail, __ATOMIC_ACQUIRE);
+    r->head = r->cached_head = __atomic_load_n(&r->shm->head, __ATOMIC_ACQUIRE);
+    r->reserved = NULL;
+}
+
+void *ipc_ring_reserve(ipc_ring_t *r, uint16_t type, uint32_t len) {
+    if (len > r->capacity / 4)
+        return NULL;
+    uint32_t size = record_size(len);
+    uint32_t off = (uint32_t)r->tail & (r->capacity - 1);
+    uint32_t pad = off + size > r->capacity ? r->capacity - off : 0;
+    if (r->tail + pad + size - r->cached_head > r->capacity) {
+        r->cached_head = __atomic_load_n(&r->shm->head, __ATOMIC_ACQUIRE);
+        if (r->tail + pad + size - r->cached_head > r->capacity)
+            return NULL;
+    }
+
+    // Records never wrap: the consumer skips the padding to the start
+    if (pad) {
+        ipc_record_t *fill = (ipc_record_t *)(r->shm->data + off);
+        fill->type = IPC_RECORD_PAD;
+        fill->len = pad - (uint32_t)sizeof(ipc_record_t);
+        r->tail += pad;
+        off = 0;
+    }
+    ipc_record_t *rec = (ipc_record_t *)(r->shm->data + off);
+    rec->type = type;
+    rec->len = len;
+    r->reserved = rec;
+    return rec + 1;
+}
+
+void ipc_ring_commit(ipc_ring_t *r, uint32_t len) {
+    ipc_record_t *rec = r->reserved;
+    if (len < rec->len)
+        rec->len = len;
+    r->reserved = NULL;
+    r->tail += record_size(rec->len);
+    __atomic_store_n(&r->shm->tail, r->tail, __ATOMIC_RELEASE);
+
+    // Pairs with the fence in ipc_ring_sleep: either the consumer sees the
+    // new tail before it blocks, or we see it asleep and wake it
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->shm->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&r->shm->sleeping, 0, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+        while (write(r->efd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+    }
+}
+
+uint32_t ipc_ring_room(ipc_ring_t *r) {
+    r->cached_head = __atomic_load_n(&r->shm->head, __ATOMIC_ACQUIRE);
+    return r->capacity - (uint32_t)(r->tail - r->cached_head);
+}
+
+uint32_t ipc_ring_depth(const ipc_ring_t *r) {
+    uint64_t head = __atomic_load_n(&r->shm->head, __ATOMIC_ACQUIRE);
+    return (uint32_t)(__atomic_load_n(&r->shm->tail, __ATOMIC_ACQUIRE) - head);
+}
+
+const ipc_record_t *ipc_ring_peek(ipc_ring_t *r) {
+    for (;;) {
+        if (r->head == r->cached_tail) {
+            r->cached_tail = __atomic_load_n(&r->shm->tail, __ATOMIC_ACQUIRE);
+            if (r->head == r->cached_tail)
+                return NULL;
+        }
+        uint32_t off = (uint32_t)r->head & (r->capacity - 1);
+        const ipc_record_t *rec = (const ipc_record_t *)(r->shm->data + off);
+        if (rec->type != IPC_RECORD_PAD)
+            return rec;
+        r->head += r->capacity - off;  // published with the next release
+    }
+}
+
+void ipc_ring_release(ipc_ring_t *r, const ipc_record_t *rec) {
+    r->head += record_size(rec->len);
+    __atomic_store_n(&r->shm->head, r->head, __ATOMIC_RELEASE);
+}
+
+int ipc_ring_sleep(ipc_ring_t *r) {
+    __atomic_store_n(&r->shm->sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->shm->tail, __ATOMIC_ACQUIRE) != r->head) {
+        __atomic_store_n(&r->shm->sleeping, 0, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+void ipc_ring_awake(ipc_ring_t *r) {
+    __atomic_store_n(&r->shm->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+void ipc_ring_clear_wakeup(ipc_ring_t *r) {
+    uint64_t count;
+    while (read(r->efd, &count, sizeof(count)) < 0 && errno == EINTR) {}
+}
@@ -0,0 +1,81 @@
+#ifndef IPC_RING_H
+#define IPC_RING_H
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IPC_CACHE_LINE 64
+#define IPC_RECORD_ALIGN 8
+
+// Single-producer single-consumer ring of variable-length records, in memory
+// two processes share. The producer writes a record in place and publishes
+// it by moving the tail; the consumer reads it in place and frees it by
+// moving the head. Neither side takes a lock or makes a system call, except
+// that the producer writes the consumer's eventfd when it finds it asleep.
+
+// The part in shared memory. Each counter has a cache line of its own so the
+// two sides only meet on the lines they actually hand over.
+typedef struct {
+    alignas(IPC_CACHE_LINE) uint64_t tail;  // bytes ever published
+    alignas(IPC_CACHE_LINE) uint64_t head;  // bytes ever consumed
+    alignas(IPC_CACHE_LINE) uint32_t sleeping;  // the consumer waits on its eventfd
+    alignas(IPC_CACHE_LINE) uint8_t data[];
+} ipc_ring_shm_t;
+
+typedef struct {
+    uint32_t len;               // payload bytes
+    uint16_t type;              // IPC_RECORD_PAD or the user's, which start at 1
+    uint16_t reserved;
+} ipc_record_t;
+
+#define IPC_RECORD_PAD 0        // fills the end of the ring when a record does not fit there
+
+// One side's view. Each process keeps its own; the cached counters spare it
+// reading the other side's line until it looks full or empty.
+typedef struct {
+    ipc_ring_shm_t *shm;
+    uint32_t capacity;          // data bytes, a power of two
+    int efd;                    // wakes the consumer
+    // Producer
+    uint64_t tail;
+    uint64_t cached_head;
+    ipc_record_t *reserved;     // written, not yet committed
+    // Consumer
+    uint64_t head;
+    uint64_t cached_tail;
+} ipc_ring_t;
+
+// Shared memory for a ring of capacity data bytes (a power of two, at least
+// 4096). Zeroed memory is an empty ring.
+size_t ipc_ring_size(uint32_t capacity);
+// Set up a view on mem, picking up wherever the ring's counters stand
+void ipc_ring_attach(ipc_ring_t *r, void *mem, uint32_t capacity, int efd);
+
+// Producer: room for a record of up to len bytes, or NULL if the ring is too
+// full (or len more than a quarter of it). One reservation at a time; commit
+// publishes it with its final length, at most len.
+void *ipc_ring_reserve(ipc_ring_t *r, uint16_t type, uint32_t len);
+void ipc_ring_commit(ipc_ring_t *r, uint32_t len);
+// Producer: bytes free for records
+uint32_t ipc_ring_room(ipc_ring_t *r);
+// Either side: bytes published and not yet consumed
+uint32_t ipc_ring_depth(const ipc_ring_t *r);
+
+// Consumer: the oldest record, NULL when there is none. It stays valid until
+// released.
+const ipc_record_t *ipc_ring_peek(ipc_ring_t *r);
+void ipc_ring_release(ipc_ring_t *r, const ipc_record_t *rec);
+
+static inline const void *ipc_record_data(const ipc_record_t *rec) {
+    return rec + 1;
+}
+
+// Consumer, before blocking on the eventfd: returns 0 if it may, -1 if
+// records came in meanwhile. ipc_ring_awake when the wait ends, and read the
+// eventfd whenever it polls readable.
+int ipc_ring_sleep(ipc_ring_t *r);
+void ipc_ring_awake(ipc_ring_t *r);
+void ipc_ring_clear_wakeup(ipc_ring_t *r);
+
+#endif
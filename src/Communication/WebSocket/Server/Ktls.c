@@ -0,0 +1,40 @@
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "Ktls.h"
+
+int ktls_probe(void) {
+#ifdef OPENSSL_NO_KTLS
+    return EOPNOTSUPP;
+#else
+    // The ULP can only be attached to an established connection
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    int err = 0;
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int cfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (lfd < 0 || cfd < 0 ||
+        bind(lfd, (struct sockaddr *)&addr, len) < 0 || listen(lfd, 1) < 0 ||
+        getsockname(lfd, (struct sockaddr *)&addr, &len) < 0 ||
+        connect(cfd, (struct sockaddr *)&addr, len) < 0 ||
+        setsockopt(cfd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) < 0)
+        err = errno;
+
+    if (cfd >= 0) close(cfd);
+    if (lfd >= 0) close(lfd);
+    return err;
+#endif
+}
+
+int ktls_send_active(SSL *ssl) {
+    return BIO_get_ktls_send(SSL_get_wbio(ssl)) > 0;
+}
+
+int ktls_recv_active(SSL *ssl) {
+    return BIO_get_ktls_recv(SSL_get_rbio(ssl)) > 0;
+}
@@ -0,0 +1,15 @@
+#ifndef KTLS_H
+#define KTLS_H
+
+#include <openssl/ssl.h>
+
+// 0 if this OpenSSL build and the running kernel can hand TLS records to the
+// kernel ("tls" TCP upper layer protocol), otherwise an errno value saying why
+int ktls_probe(void);
+
+// After the handshake: whether the kernel now encrypts what is written to the
+// socket, and decrypts what is read from it
+int ktls_send_active(SSL *ssl);
+int ktls_recv_active(SSL *ssl);
+
+#endif
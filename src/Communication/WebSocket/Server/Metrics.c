@@ -0,0 +1,169 @@
+#include <inttypes.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "Metrics.h"
+
+#define SHARD_WORDS (sizeof(metrics_shard_t) / sizeof(uint64_t))
+
+typedef struct {
+    const char *name;
+    const char *labels;
+    const char *help;
+} metric_info_t;
+
+#define METRIC_INFO(id, name, labels, help) { name, labels, help },
+static const metric_info_t counter_info[] = { METRIC_COUNTERS(METRIC_INFO) };
+static const metric_info_t gauge_info[] = { METRIC_GAUGES(METRIC_INFO) };
+static const metric_info_t histogram_info[] = { METRIC_HISTOGRAMS(METRIC_INFO) };
+#undef METRIC_INFO
+
+static const char *const opcode_names[16] = {
+    [0x0] = "continuation", [0x1] = "text", [0x2] = "binary",
+    [0x8] = "close", [0x9] = "ping", [0xA] = "pong"
+};
+static const char *const ocpp_type_names[METRIC_OCPP_TYPES] = { "call", "callresult", "callerror" };
+
+static metrics_shard_t private_shard;
+metrics_shard_t *metrics_self = &private_shard;
+
+static metrics_shard_t *shards;     // one per worker, shared
+static int nshards;
+static metrics_shard_t retired;     // what workers that have since died counted
+static uint64_t restarts;
+
+int metrics_init(int nworkers) {
+    if (nworkers <= 0)
+        return 0;
+    void *mem = mmap(NULL, (size_t)nworkers * sizeof(metrics_shard_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return -1;
+    shards = mem;
+    nshards = nworkers;
+    return 0;
+}
+
+void metrics_attach(int worker) {
+    if (worker >= 0 && worker < nshards)
+        metrics_self = &shards[worker];
+}
+
+// Every field is a 64-bit word, gauges included: two's complement sums them too
+static void shard_add(metrics_shard_t *sum, const metrics_shard_t *shard) {
+    uint64_t *dst = (uint64_t *)sum;
+    const uint64_t *src = (const uint64_t *)shard;
+    for (size_t i = 0; i < SHARD_WORDS; i++)
+        dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+void metrics_worker_exited(int worker) {
+    if (worker < 0 || worker >= nshards)
+        return;
+    shard_add(&retired, &shards[worker]);
+    memset(retired.gauges, 0, sizeof(retired.gauges));  // its connections went with it
+    memset(&shards[worker], 0, sizeof(shards[worker]));
+    restarts++;
+}
+
+static void write_header(FILE *out, const metric_info_t *m, const char *type) {
+    if (m->help[0])
+        fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", m->name, m->help, m->name, type);
+}
+
+static void write_value(FILE *out, const char *name, const char *labels, int64_t value, int is_signed) {
+    if (labels[0])
+        fprintf(out, "%s{%s} ", name, labels);
+    else
+        fprintf(out, "%s ", name);
+    if (is_signed)
+        fprintf(out, "%" PRId64 "\n", value);
+    else
+        fprintf(out, "%" PRIu64 "\n", (uint64_t)value);
+}
+
+// Upper bound of bucket i in nanoseconds; the last has none
+static uint64_t bucket_limit(unsigned i) {
+    if (i == 0)
+        return 1ull << METRIC_HIST_MIN_BITS;
+    unsigned j = i - 1;
+    unsigned msb = METRIC_HIST_MIN_BITS + (j >> METRIC_HIST_SUB_BITS);
+    uint64_t sub = (j & ((1u << METRIC_HIST_SUB_BITS) - 1)) + 1;
+    return ((1ull << METRIC_HIST_SUB_BITS) + sub) << (msb - METRIC_HIST_SUB_BITS);
+}
+
+static void write_histogram(FILE *out, const metric_info_t *m, const metric_hist_t *h) {
+    const char *sep = m->labels[0] ? "," : "";
+    write_header(out, m, "histogram");
+    uint64_t count = 0;
+    for (unsigned i = 0; i < METRIC_HIST_BUCKETS - 1; i++) {
+        count += h->buckets[i];
+        fprintf(out, "%s_bucket{%s%sle=\"%.9g\"} %" PRIu64 "\n", m->name, m->labels, sep,
+                (double)bucket_limit(i) / 1e9, count);
+    }
+    count += h->buckets[METRIC_HIST_BUCKETS - 1];
+    fprintf(out, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n", m->name, m->labels, sep, count);
+    if (m->labels[0]) {
+        fprintf(out, "%s_sum{%s} %.9f\n", m->name, m->labels, (double)h->sum / 1e9);
+        fprintf(out, "%s_count{%s} %" PRIu64 "\n", m->name, m->labels, count);
+    } else {
+        fprintf(out, "%s_sum %.9f\n", m->name, (double)h->sum / 1e9);
+        fprintf(out, "%s_count %" PRIu64 "\n", m->name, count);
+    }
+}
+
+void metrics_write(FILE *out) {
+    if (!shards)
+        return;
+    metrics_shard_t sum = retired;
+    for (int i = 0; i < nshards; i++)
+        shard_add(&sum, &shards[i]);
+
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        write_header(out, &counter_info[i], "counter");
+        write_value(out, counter_info[i].name, counter_info[i].labels, (int64_t)sum.counters[i], 0);
+    }
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        write_header(out, &gauge_info[i], "gauge");
+        write_value(out, gauge_info[i].name, gauge_info[i].labels, sum.gauges[i], 1);
+    }
+
+    static const char *const frame_families[2][2] = {
+        { "ws_frames_received_total", "WebSocket frames received by opcode, a fragmented message once" },
+        { "ws_frames_sent_total", "WebSocket frames sent by opcode" }
+    };
+    for (int sent = 0; sent < 2; sent++) {
+        const char *name = frame_families[sent][0];
+        fprintf(out, "# HELP %s %s\n# TYPE %s counter\n", name, frame_families[sent][1], name);
+        for (int op = 0; op < 16; op++) {
+            if (opcode_names[op])
+                fprintf(out, "%s{opcode=\"%s\"} %" PRIu64 "\n", name, opcode_names[op], sum.frames[sent][op]);
+        }
+    }
+
+    // Only the actions seen: most stations speak a handful of the ~80
+    fprintf(out, "# HELP ocpp_messages_received_total OCPP messages received by type and action\n"
+                 "# TYPE ocpp_messages_received_total counter\n");
+    for (int t = 0; t < METRIC_OCPP_TYPES; t++) {
+        for (int a = 0; a <= METRIC_OCPP_UNKNOWN; a++) {
+            if (sum.ocpp_received[t][a])
+                fprintf(out, "ocpp_messages_received_total{type=\"%s\",action=\"%s\"} %" PRIu64 "\n",
+                        ocpp_type_names[t], a < OCPP_ACTION_COUNT ? ocpp_action_name(a) : "unknown",
+                        sum.ocpp_received[t][a]);
+        }
+    }
+    fprintf(out, "# HELP ocpp_calls_sent_total CALLs sent to stations by action\n"
+                 "# TYPE ocpp_calls_sent_total counter\n");
+    for (int a = 0; a < OCPP_ACTION_COUNT; a++) {
+        if (sum.ocpp_calls_sent[a])
+            fprintf(out, "ocpp_calls_sent_total{action=\"%s\"} %" PRIu64 "\n", ocpp_action_name(a),
+                    sum.ocpp_calls_sent[a]);
+    }
+
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++)
+        write_histogram(out, &histogram_info[i], &sum.histograms[i]);
+
+    fprintf(out, "# HELP ws_worker_restarts_total Workers respawned after exiting\n"
+                 "# TYPE ws_worker_restarts_total counter\n"
+                 "ws_worker_restarts_total %" PRIu64 "\n", restarts);
+}
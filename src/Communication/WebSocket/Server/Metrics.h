@@ -0,0 +1,171 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "OcppActions.h"
+
+#define METRICS_CACHE_LINE 64
+
+// Every counter and gauge a worker records. X(ENUM_SUFFIX, "name", "labels",
+// "help"); consecutive entries with one name are the series of one family.
+#define METRIC_COUNTERS(X) \
+    X(ACCEPTED,           "ws_connections_accepted_total", "", "TCP connections accepted") \
+    X(CLOSED,             "ws_connections_closed_total", "", "Connections closed, for whatever reason") \
+    X(DROPPED_HANDSHAKE,  "ws_connections_dropped_total", "reason=\"handshake_timeout\"", "Connections the server gave up on") \
+    X(DROPPED_PING,       "ws_connections_dropped_total", "reason=\"ping_timeout\"", "") \
+    X(DROPPED_SLOW,       "ws_connections_dropped_total", "reason=\"slow_reader\"", "") \
+    X(REFUSED_NO_FDS,     "ws_connections_refused_total", "", "Connections closed on accept, out of file descriptors") \
+    X(TLS_FULL,           "ws_tls_handshakes_total", "resumed=\"false\"", "TLS handshakes completed") \
+    X(TLS_RESUMED,        "ws_tls_handshakes_total", "resumed=\"true\"", "") \
+    X(TLS_FAILED,         "ws_tls_handshake_failures_total", "", "TLS handshakes that failed") \
+    X(UPGRADES,           "ws_upgrades_total", "", "WebSocket upgrades answered") \
+    X(UPGRADES_REJECTED,  "ws_upgrade_failures_total", "", "Upgrade requests rejected") \
+    X(BYTES_RECEIVED,     "ws_received_bytes_total", "", "Bytes received, after TLS") \
+    X(BYTES_SENT,         "ws_sent_bytes_total", "", "Bytes queued for sending, before TLS") \
+    X(OCPP_MALFORMED,     "ocpp_malformed_messages_total", "", "Text messages that were not OCPP-J") \
+    X(COMMANDS,           "ws_commands_total", "", "Commands taken from the main process")
+
+#define METRIC_GAUGES(X) \
+    X(CONNECTIONS,        "ws_connections", "", "Connections open") \
+    X(STATIONS,           "ws_stations_connected", "", "Stations past the WebSocket upgrade") \
+    X(OUT_QUEUED,         "ws_output_queued_bytes", "", "Bytes waiting for the stations' sockets")
+
+// Latencies in nanoseconds, exported in seconds
+#define METRIC_HISTOGRAMS(X) \
+    X(DISPATCH,           "ocpp_dispatch_seconds", "", "Handling one OCPP message, reply included")
+
+typedef enum {
+#define METRIC_ENUM(id, name, labels, help) METRIC_##id,
+    METRIC_COUNTERS(METRIC_ENUM)
+#undef METRIC_ENUM
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+typedef enum {
+#define METRIC_ENUM(id, name, labels, help) METRIC_##id,
+    METRIC_GAUGES(METRIC_ENUM)
+#undef METRIC_ENUM
+    METRIC_GAUGE_COUNT
+} metric_gauge_t;
+
+typedef enum {
+#define METRIC_ENUM(id, name, labels, help) METRIC_##id,
+    METRIC_HISTOGRAMS(METRIC_ENUM)
+#undef METRIC_ENUM
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_t;
+
+// Log-linear buckets: 4 per power of two, so a value is placed within 19%,
+// from 256 ns (everything below shares the first bucket) to 2^36 ns, about
+// 69 s (everything above lands in the last)
+#define METRIC_HIST_SUB_BITS 2
+#define METRIC_HIST_MIN_BITS 8
+#define METRIC_HIST_MAX_BITS 36
+#define METRIC_HIST_BUCKETS  (((METRIC_HIST_MAX_BITS - METRIC_HIST_MIN_BITS) << METRIC_HIST_SUB_BITS) + 2)
+
+typedef struct {
+    uint64_t sum;
+    uint64_t buckets[METRIC_HIST_BUCKETS];  // the count is their total
+} metric_hist_t;
+
+// OCPP messages by type, as the ocppj_parse() type numbers them
+#define METRIC_OCPP_TYPES 3
+#define METRIC_OCPP_UNKNOWN OCPP_ACTION_COUNT   // the action of a reply nobody waited for
+
+// One worker's metrics, written by that worker alone and read by the main
+// process. Shards start on a cache line of their own, so the workers never
+// write to a line another one does.
+typedef struct {
+    alignas(METRICS_CACHE_LINE) uint64_t counters[METRIC_COUNTER_COUNT];
+    int64_t gauges[METRIC_GAUGE_COUNT];
+    uint64_t frames[2][16];     // [sent][opcode]
+    uint64_t ocpp_received[METRIC_OCPP_TYPES][OCPP_ACTION_COUNT + 1];
+    uint64_t ocpp_calls_sent[OCPP_ACTION_COUNT];
+    metric_hist_t histograms[METRIC_HISTOGRAM_COUNT];
+} metrics_shard_t;
+
+// The calling worker's shard; a private one until metrics_attach
+extern metrics_shard_t *metrics_self;
+
+// Recording is an add to memory only this process writes: no lock and no
+// atomic read-modify-write, only stores the main process can read untorn
+static inline void metric_store(uint64_t *p, uint64_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+static inline void metric_add(metric_counter_t c, uint64_t n) {
+    uint64_t *p = &metrics_self->counters[c];
+    metric_store(p, *p + n);
+}
+
+static inline void metric_inc(metric_counter_t c) {
+    metric_add(c, 1);
+}
+
+static inline void metric_gauge_add(metric_gauge_t g, int64_t delta) {
+    int64_t *p = &metrics_self->gauges[g];
+    __atomic_store_n(p, *p + delta, __ATOMIC_RELAXED);
+}
+
+static inline void metric_frame(int sent, uint8_t opcode) {
+    uint64_t *p = &metrics_self->frames[sent != 0][opcode & 0x0F];
+    metric_store(p, *p + 1);
+}
+
+// type is OCPP_CALL, OCPP_CALLRESULT or OCPP_CALLERROR; action may be
+// OCPP_ACTION_UNKNOWN
+static inline void metric_ocpp_received(int type, int action) {
+    if (action < 0)
+        action = METRIC_OCPP_UNKNOWN;
+    uint64_t *p = &metrics_self->ocpp_received[(unsigned)(type - 2) % METRIC_OCPP_TYPES][action];
+    metric_store(p, *p + 1);
+}
+
+static inline void metric_ocpp_call_sent(int action) {
+    uint64_t *p = &metrics_self->ocpp_calls_sent[action];
+    metric_store(p, *p + 1);
+}
+
+static inline unsigned metric_hist_bucket(uint64_t v) {
+    if (v < (1ull << METRIC_HIST_MIN_BITS))
+        return 0;
+    unsigned msb = 63 - (unsigned)__builtin_clzll(v);
+    if (msb >= METRIC_HIST_MAX_BITS)
+        return METRIC_HIST_BUCKETS - 1;
+    unsigned sub = (unsigned)(v >> (msb - METRIC_HIST_SUB_BITS)) & ((1u << METRIC_HIST_SUB_BITS) - 1);
+    return (((msb - METRIC_HIST_MIN_BITS) << METRIC_HIST_SUB_BITS) | sub) + 1;
+}
+
+static inline void metric_observe(metric_histogram_t h, uint64_t ns) {
+    metric_hist_t *hist = &metrics_self->histograms[h];
+    uint64_t *b = &hist->buckets[metric_hist_bucket(ns)];
+    metric_store(b, *b + 1);
+    metric_store(&hist->sum, hist->sum + ns);
+}
+
+// The clock latencies are measured on
+static inline uint64_t metrics_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Main process, before the workers are forked: a shard for each of them in
+// shared memory. Returns -1 if it could not be mapped; the workers then
+// record into memory of their own and nothing is exported.
+int metrics_init(int nworkers);
+// In worker id, after the fork: record into its shard
+void metrics_attach(int worker);
+// Main process, once a worker has been reaped and before its replacement
+// starts: keep what it counted, forget what it held open
+void metrics_worker_exited(int worker);
+
+// Main process: every worker's metrics summed, in the Prometheus text
+// exposition format
+void metrics_write(FILE *out);
+
+#endif
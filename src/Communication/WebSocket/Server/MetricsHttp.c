@@ -0,0 +1,271 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "MetricsHttp.h"
+#include "Metrics.h"
+#include "HttpParser.h"
+#include "TimerWheel.h"
+#include "WorkerIpc.h"
+
+#define METRICS_MAX_EVENTS 16
+#define METRICS_LISTEN 0            // epoll data of the listener; scrapers are pointers
+
+typedef struct scraper {
+    int fd;
+    int dead;                   // closed at the end of the pass
+    uint64_t deadline_ms;
+    char *out;                  // the whole response, once the request is in
+    size_t out_len, out_off;
+    struct scraper *next;
+    http_parser_t http;
+    size_t in_len;
+    char in[HTTP_MAX_REQUEST_SIZE];
+} scraper_t;
+
+static int epfd = -1;
+static int listen_fd = -1;
+static scraper_t *scrapers;
+static int nscrapers;
+
+static void scraper_free(scraper_t *s) {
+    close(s->fd);  // also leaves the epoll set
+    free(s->out);
+    free(s);
+    nscrapers--;
+}
+
+// What only the main process sees: how far behind each worker is
+static void write_supervisor_metrics(FILE *out) {
+    if (!worker_ipc_count())
+        return;
+    fprintf(out, "# HELP ws_ipc_queued_bytes Bytes waiting in the rings between the main process and a worker\n"
+                 "# TYPE ws_ipc_queued_bytes gauge\n");
+    for (int i = 0; i < worker_ipc_count(); i++) {
+        worker_ipc_t *w = worker_ipc_main(i);
+        fprintf(out, "ws_ipc_queued_bytes{worker=\"%d\",ring=\"commands\"} %u\n", i, ipc_ring_depth(&w->commands));
+        fprintf(out, "ws_ipc_queued_bytes{worker=\"%d\",ring=\"events\"} %u\n", i, ipc_ring_depth(&w->events));
+    }
+}
+
+static void respond(scraper_t *s, const char *status, const char *body, size_t body_len, int head_only) {
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %s\r\n"
+                     "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                     "Content-Length: %zu\r\n"
+                     "Connection: close\r\n\r\n", status, body_len);
+    if (head_only)
+        body_len = 0;
+    s->out = malloc((size_t)n + body_len);
+    if (!s->out) {
+        s->dead = 1;
+        return;
+    }
+    memcpy(s->out, header, (size_t)n);
+    memcpy(s->out + n, body, body_len);
+    s->out_len = (size_t)n + body_len;
+}
+
+static int slice_is(const char *buf, http_slice_t slice, const char *text) {
+    return slice.len == strlen(text) && memcmp(buf + slice.off, text, slice.len) == 0;
+}
+
+static void answer(scraper_t *s) {
+    const char *buf = s->in;
+    int head_only = slice_is(buf, s->http.method, "HEAD");
+    if (!head_only && !slice_is(buf, s->http.method, "GET")) {
+        respond(s, "405 Method Not Allowed", "", 0, 0);
+        return;
+    }
+    // The path, whatever query follows it
+    http_slice_t path = s->http.target;
+    const char *query = memchr(buf + path.off, '?', path.len);
+    if (query)
+        path.len = (uint16_t)(query - (buf + path.off));
+    if (!slice_is(buf, path, "/metrics")) {
+        static const char hint[] = "Not found, try /metrics\n";
+        respond(s, "404 Not Found", hint, sizeof(hint) - 1, head_only);
+        return;
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+    FILE *f = open_memstream(&body, &body_len);
+    if (!f) {
+        s->dead = 1;
+        return;
+    }
+    metrics_write(f);
+    write_supervisor_metrics(f);
+    if (fclose(f) != 0) {
+        free(body);
+        s->dead = 1;
+        return;
+    }
+    respond(s, "200 OK", body, body_len, head_only);
+    free(body);
+}
+
+static void scraper_write(scraper_t *s) {
+    while (s->out_off < s->out_len) {
+        ssize_t n = send(s->fd, s->out + s->out_off, s->out_len - s->out_off, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            s->out_off += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;  // EPOLLOUT picks it up
+        break;
+    }
+    s->dead = 1;  // all written, or never will be
+}
+
+static void scraper_read(scraper_t *s) {
+    while (!s->out) {
+        if (s->in_len == sizeof(s->in)) {
+            respond(s, "431 Request Header Fields Too Large", "", 0, 0);
+            break;
+        }
+        ssize_t n = read(s->fd, s->in + s->in_len, sizeof(s->in) - s->in_len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n <= 0) {
+            s->dead = 1;
+            return;
+        }
+        s->in_len += (size_t)n;
+        int rc = http_parse(&s->http, s->in, s->in_len);
+        if (rc < 0)
+            respond(s, "400 Bad Request", "", 0, 0);
+        else if (rc > 0)
+            answer(s);
+    }
+    if (!s->dead)
+        scraper_write(s);
+}
+
+static void accept_scrapers(void) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("metrics accept");
+            return;
+        }
+        scraper_t *s = nscrapers < METRICS_HTTP_MAX_CLIENTS ? malloc(sizeof(*s)) : NULL;
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = s };
+        if (!s || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            free(s);
+            close(fd);
+            continue;
+        }
+        memset(s, 0, offsetof(scraper_t, in));
+        s->fd = fd;
+        s->deadline_ms = timer_clock_ms() + METRICS_HTTP_TIMEOUT_MS;
+        http_parser_init(&s->http, 0, sizeof(s->in));
+        s->next = scrapers;
+        scrapers = s;
+        nscrapers++;
+    }
+}
+
+int metrics_http_init(int port) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        return -1;
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0)
+        goto fail;
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        goto fail;
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = METRICS_LISTEN };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0)
+        goto fail;
+    return 0;
+
+fail:;
+    int err = errno;
+    metrics_http_close();
+    errno = err;
+    return -1;
+}
+
+int metrics_http_fd(void) {
+    return epfd;
+}
+
+int metrics_http_timeout(void) {
+    uint64_t next = 0;
+    for (scraper_t *s = scrapers; s; s = s->next) {
+        if (!next || s->deadline_ms < next)
+            next = s->deadline_ms;
+    }
+    if (!next)
+        return -1;
+    uint64_t now = timer_clock_ms();
+    return next > now ? (int)(next - now) : 0;
+}
+
+void metrics_http_run(void) {
+    if (epfd < 0)
+        return;
+    struct epoll_event events[METRICS_MAX_EVENTS];
+    int n = epoll_wait(epfd, events, METRICS_MAX_EVENTS, 0);
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.u64 == METRICS_LISTEN) {
+            accept_scrapers();
+            continue;
+        }
+        scraper_t *s = events[i].data.ptr;
+        if (s->out)
+            scraper_write(s);
+        else
+            scraper_read(s);
+    }
+
+    uint64_t now = timer_clock_ms();
+    for (scraper_t **p = &scrapers; *p;) {
+        scraper_t *s = *p;
+        if (s->dead || s->deadline_ms <= now) {
+            *p = s->next;
+            scraper_free(s);
+            continue;
+        }
+        p = &s->next;
+    }
+}
+
+void metrics_http_close(void) {
+    while (scrapers) {
+        scraper_t *s = scrapers;
+        scrapers = s->next;
+        scraper_free(s);
+    }
+    if (epfd >= 0)
+        close(epfd);
+    if (listen_fd >= 0)
+        close(listen_fd);
+    epfd = listen_fd = -1;
+}
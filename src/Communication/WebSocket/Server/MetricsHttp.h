@@ -0,0 +1,21 @@
+#ifndef METRICS_HTTP_H
+#define METRICS_HTTP_H
+
+#define METRICS_HTTP_TIMEOUT_MS 5000    // for a scraper to send its request and take the answer
+#define METRICS_HTTP_MAX_CLIENTS 64
+
+// The main process's HTTP endpoint: GET /metrics answers with every worker's
+// metrics (Metrics.h) and the main process's own view of the workers, in the
+// Prometheus text format. One request per connection.
+
+// Listen on 127.0.0.1:port. Returns -1 with errno set on failure.
+int metrics_http_init(int port);
+// One fd to poll for everything the endpoint waits on, -1 if off
+int metrics_http_fd(void);
+// Milliseconds until a scraper that is taking too long is dropped, -1 for none
+int metrics_http_timeout(void);
+// Serve the scrapers, without blocking
+void metrics_http_run(void);
+void metrics_http_close(void);
+
+#endif
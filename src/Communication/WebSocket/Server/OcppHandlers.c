@@ -0,0 +1,156 @@
+#include "TLSServer.h"
+
+// OCPP dateTime: UTC, second resolution
+static void current_time(char *buf, size_t size) {
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(buf, size, "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+// Arrays in a parsed payload (meter values, sampled values) are carved out
+// of the message arena, sized so no valid payload runs out of room
+static void parse_begin(ocpp_session_t *s, ocpp_json_t *j, const ocpp_message_t *call) {
+    size_t size = call->payload.len * OCPP_SCRATCH_PER_BYTE;
+    if (size > OCPP_SCRATCH_MAX)
+        size = OCPP_SCRATCH_MAX;
+    void *scratch = arena_alloc(s->arena, size);
+    ocpp_json_init(j, call->payload.ptr, call->payload.len, scratch, scratch ? size : 0);
+}
+
+// Answer a payload the schema refused with the matching CALLERROR
+static int reject(ocpp_session_t *s, const ocpp_message_t *call, const ocpp_json_t *j) {
+    return ocpp_reply_error(s, call->id, ocpp_json_error_code(j->error, s->version), j->what);
+}
+
+// Replies are written straight into the pooled buffer their frame is sent
+// from, behind room for the CALLRESULT's head. NULL when out of memory.
+static char *reply_begin(ocpp_writer_t *w, size_t size) {
+    char *buf = buf_pool_get(OCPP_REPLY_HEADROOM + size + 1);
+    if (buf)
+        ocpp_writer_init(w, buf + OCPP_REPLY_HEADROOM, size);
+    return buf;
+}
+
+static int reply_written(ocpp_session_t *s, const ocpp_message_t *call, const ocpp_writer_t *w, char *buf) {
+    if (ocpp_writer_status(w) < 0) {
+        buf_pool_put(buf);
+        return ocpp_reply_error(s, call->id, "InternalError", "Response too large");
+    }
+    size_t len;
+    const char *text = ocpp_reply_frame(call, buf, w->len, &len);
+    return send_ocpp_buffer(s->transport, text, len, buf);
+}
+
+// The empty confirmation most actions get
+static int reply_empty(ocpp_session_t *s, const ocpp_message_t *call) {
+    ocpp_writer_t w;
+    char *buf = reply_begin(&w, 2);
+    if (!buf) return -1;
+    ocpp_write_raw(&w, "{}", 2);
+    return reply_written(s, call, &w, buf);
+}
+
+static int on_boot_notification(ocpp_session_t *s, const ocpp_message_t *call) {
+    connection_t *conn = s->transport;
+    char now[32], *buf;
+    ocpp_json_t j;
+    ocpp_writer_t w;
+    current_time(now, sizeof(now));
+    ocpp_str_t timestamp = { now, strlen(now) };
+    parse_begin(s, &j, call);
+
+    if (s->version == OCPP_V201) {
+        ocpp201_boot_notification_request_t req;
+        if (ocpp201_boot_notification_request_parse(&j, &req) < 0)
+            return reject(s, call, &j);
+        LOG_INFO("Station %s booted: %s %s", conn->cold->upgrade.station_id,
+                 LOG_SPAN(req.charging_station.vendor_name.ptr, req.charging_station.vendor_name.len),
+                 LOG_SPAN(req.charging_station.model.ptr, req.charging_station.model.len));
+        ocpp201_boot_notification_response_t resp = {
+            .current_time = timestamp,
+            .interval = OCPP_HEARTBEAT_INTERVAL,
+            .status = OCPP201_REGISTRATION_STATUS_ACCEPTED
+        };
+        if (!(buf = reply_begin(&w, 256))) return -1;
+        ocpp201_boot_notification_response_write(&w, &resp);
+    } else {
+        ocpp16_boot_notification_request_t req;
+        if (ocpp16_boot_notification_request_parse(&j, &req) < 0)
+            return reject(s, call, &j);
+        LOG_INFO("Station %s booted: %s %s", conn->cold->upgrade.station_id,
+                 LOG_SPAN(req.charge_point_vendor.ptr, req.charge_point_vendor.len),
+                 LOG_SPAN(req.charge_point_model.ptr, req.charge_point_model.len));
+        ocpp16_boot_notification_response_t resp = {
+            .status = OCPP16_BOOT_NOTIFICATION_STATUS_ACCEPTED,
+            .current_time = timestamp,
+            .interval = OCPP_HEARTBEAT_INTERVAL
+        };
+        if (!(buf = reply_begin(&w, 256))) return -1;
+        ocpp16_boot_notification_response_write(&w, &resp);
+    }
+    return reply_written(s, call, &w, buf);
+}
+
+static int on_heartbeat(ocpp_session_t *s, const ocpp_message_t *call) {
+    char now[32], *buf;
+    ocpp_json_t j;
+    ocpp_writer_t w;
+    current_time(now, sizeof(now));
+    ocpp_str_t timestamp = { now, strlen(now) };
+    parse_begin(s, &j, call);
+
+    if (s->version == OCPP_V201) {
+        ocpp201_heartbeat_request_t req;
+        if (ocpp201_heartbeat_request_parse(&j, &req) < 0)
+            return reject(s, call, &j);
+        ocpp201_heartbeat_response_t resp = { .current_time = timestamp };
+        if (!(buf = reply_begin(&w, 64))) return -1;
+        ocpp201_heartbeat_response_write(&w, &resp);
+    } else {
+        ocpp16_heartbeat_request_t req;
+        if (ocpp16_heartbeat_request_parse(&j, &req) < 0)
+            return reject(s, call, &j);
+        ocpp16_heartbeat_response_t resp = { .current_time = timestamp };
+        if (!(buf = reply_begin(&w, 64))) return -1;
+        ocpp16_heartbeat_response_write(&w, &resp);
+    }
+    return reply_written(s, call, &w, buf);
+}
+
+// MeterValues and StatusNotification confirmations are empty in 1.6 and
+// 2.0.1; the requests are only validated for now
+static int on_meter_values(ocpp_session_t *s, const ocpp_message_t *call) {
+    ocpp_json_t j;
+    int rc;
+    parse_begin(s, &j, call);
+    if (s->version == OCPP_V201) {
+        ocpp201_meter_values_request_t req;
+        rc = ocpp201_meter_values_request_parse(&j, &req);
+    } else {
+        ocpp16_meter_values_request_t req;
+        rc = ocpp16_meter_values_request_parse(&j, &req);
+    }
+    return rc < 0 ? reject(s, call, &j) : reply_empty(s, call);
+}
+
+static int on_status_notification(ocpp_session_t *s, const ocpp_message_t *call) {
+    ocpp_json_t j;
+    int rc;
+    parse_begin(s, &j, call);
+    if (s->version == OCPP_V201) {
+        ocpp201_status_notification_request_t req;
+        rc = ocpp201_status_notification_request_parse(&j, &req);
+    } else {
+        ocpp16_status_notification_request_t req;
+        rc = ocpp16_status_notification_request_parse(&j, &req);
+    }
+    return rc < 0 ? reject(s, call, &j) : reply_empty(s, call);
+}
+
+void ocpp_handlers_register(ocpp_router_t *router) {
+    ocpp_router_register(router, OCPP_ACTION_BOOT_NOTIFICATION, on_boot_notification);
+    ocpp_router_register(router, OCPP_ACTION_HEARTBEAT, on_heartbeat);
+    ocpp_router_register(router, OCPP_ACTION_METER_VALUES, on_meter_values);
+    ocpp_router_register(router, OCPP_ACTION_STATUS_NOTIFICATION, on_status_notification);
+}
@@ -0,0 +1,18 @@
+#ifndef OCPP_HANDLERS_H
+#define OCPP_HANDLERS_H
+
+#include "OcppJ.h"
+#include "OcppMessages.h"
+
+#define OCPP_HEARTBEAT_INTERVAL 300 // seconds, handed to stations at boot
+#define OCPP_MESSAGE_ARENA 65536    // per worker; bigger messages borrow from malloc
+// Scratch for the arrays of a parsed payload, per byte of it. The worst the
+// schemas allow is ~37: a 12-byte 2.0.1 sampledValue fills a 224-byte struct,
+// held twice while its array closes.
+#define OCPP_SCRATCH_PER_BYTE 40
+#define OCPP_SCRATCH_MAX (1024 * 1024)
+
+// The central system's answers to the CALLs stations send
+void ocpp_handlers_register(ocpp_router_t *router);
+
+#endif
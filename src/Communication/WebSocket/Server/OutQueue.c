@@ -0,0 +1,246 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "OutQueue.h"
+#include "BufferPool.h"
+#include "Metrics.h"
+
+// Workers are single threaded, so one gather buffer serves every connection.
+// A blocked record write is retried by gathering the same queued bytes again.
+static uint8_t tls_batch[OUTQ_TLS_BATCH];
+
+void outq_limits_init(outq_limits_t *l, size_t high_watermark, size_t low_watermark, size_t limit) {
+    l->high_watermark = high_watermark;
+    l->low_watermark = low_watermark < high_watermark ? low_watermark : high_watermark;
+    l->limit = limit > high_watermark ? limit : high_watermark;
+}
+
+void outq_init(outq_t *q, const outq_limits_t *limits) {
+    memset(q, 0, sizeof(*q));
+    q->limits = limits;
+}
+
+// Pushes and writes go through here so the worker's total follows every queue
+static void outq_account(outq_t *q, int64_t delta) {
+    q->bytes += delta;
+    metric_gauge_add(METRIC_OUT_QUEUED, delta);
+}
+
+static void outq_grew(outq_t *q) {
+    if (q->bytes >= q->limits->high_watermark)
+        q->over_high = 1;
+}
+
+static outq_item_t *outq_at(const outq_t *q, unsigned i) {
+    return &q->items[(q->head + i) % q->cap];
+}
+
+static const uint8_t *outq_item_data(const outq_item_t *item) {
+    return item->data ? item->data : item->inline_data;
+}
+
+static outq_item_t *outq_append(outq_t *q) {
+    if (q->count == q->cap) {
+        outq_item_t *items = buf_pool_get((q->cap ? q->cap * 2 : 8) * sizeof(*items));
+        if (!items) return NULL;
+        for (unsigned i = 0; i < q->count; i++)
+            items[i] = *outq_at(q, i);
+        buf_pool_put(q->items);
+        q->items = items;
+        q->cap = (unsigned)(buf_pool_size(items) / sizeof(*items));
+        q->head = 0;
+    }
+    outq_item_t *item = outq_at(q, q->count++);
+    memset(item, 0, sizeof(*item));
+    return item;
+}
+
+void outq_clear(outq_t *q) {
+    for (unsigned i = 0; i < q->count; i++) {
+        outq_item_t *item = outq_at(q, i);
+        if (item->release)
+            item->release(item->opaque);
+    }
+    buf_pool_put(q->items);
+    metric_gauge_add(METRIC_OUT_QUEUED, -(int64_t)q->bytes);
+    outq_init(q, q->limits);
+}
+
+int outq_push_frame(outq_t *q, const uint8_t *header, size_t header_len,
+                    const struct iovec *iov, int iovcnt,
+                    outq_release_fn release, void *opaque) {
+    unsigned count = q->count;
+    size_t bytes = q->bytes;
+    size_t total = header_len;
+    for (int i = 0; i < iovcnt; i++)
+        total += iov[i].iov_len;
+    if (q->bytes + total > q->limits->limit) goto fail;
+
+    outq_item_t *item = outq_append(q);
+    if (!item) goto fail;
+    memcpy(item->inline_data, header, header_len);
+    item->len = header_len;
+    outq_account(q, (int64_t)header_len);
+
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len == 0) continue;
+        if (!(item = outq_append(q))) goto fail;
+        item->data = iov[i].iov_base;
+        item->len = iov[i].iov_len;
+        outq_account(q, (int64_t)iov[i].iov_len);
+    }
+
+    // Whatever was queued last carries the release for the whole frame
+    item->release = release;
+    item->opaque = opaque;
+    outq_grew(q);
+    return 0;
+
+fail:
+    // Take back the pieces already queued: a flush before the close must not
+    // send part of a frame whose payload is about to be released
+    q->count = count;
+    outq_account(q, -(int64_t)(q->bytes - bytes));
+    if (release)
+        release(opaque);
+    return -1;
+}
+
+int outq_push_copy(outq_t *q, const void *data, size_t len) {
+    if (q->bytes + len > q->limits->limit) return -1;
+
+    if (len <= OUTQ_INLINE_SIZE) {
+        outq_item_t *item = outq_append(q);
+        if (!item) return -1;
+        memcpy(item->inline_data, data, len);
+        item->len = len;
+        outq_account(q, (int64_t)len);
+        outq_grew(q);
+        return 0;
+    }
+
+    void *copy = buf_pool_get(len);
+    if (!copy) return -1;
+    memcpy(copy, data, len);
+    outq_item_t *item = outq_append(q);
+    if (!item) {
+        buf_pool_put(copy);
+        return -1;
+    }
+    item->data = copy;
+    item->len = len;
+    item->release = buf_pool_put;
+    item->opaque = copy;
+    outq_account(q, (int64_t)len);
+    outq_grew(q);
+    return 0;
+}
+
+void outq_consume(outq_t *q, size_t n) {
+    outq_account(q, -(int64_t)n);
+    if (q->bytes <= q->limits->low_watermark)
+        q->over_high = 0;
+    while (n > 0) {
+        outq_item_t *item = outq_at(q, 0);
+        size_t left = item->len - q->head_off;
+        if (n < left) {
+            q->head_off += n;
+            return;
+        }
+        n -= left;
+        if (item->release)
+            item->release(item->opaque);
+        q->head = (q->head + 1) % q->cap;
+        q->count--;
+        q->head_off = 0;
+    }
+    // An idle connection keeps no ring
+    if (q->count == 0) {
+        buf_pool_put(q->items);
+        q->items = NULL;
+        q->cap = 0;
+        q->head = 0;
+    }
+}
+
+int outq_gather(const outq_t *q, struct iovec *iov, int max) {
+    int iovcnt = 0;
+    for (unsigned i = 0; i < q->count && iovcnt < max; i++) {
+        outq_item_t *item = outq_at(q, i);
+        size_t skip = i == 0 ? q->head_off : 0;
+        iov[iovcnt].iov_base = (void *)(outq_item_data(item) + skip);
+        iov[iovcnt].iov_len = item->len - skip;
+        iovcnt++;
+    }
+    return iovcnt;
+}
+
+int outq_gather_stable(const outq_t *q, struct iovec *iov, int max, uint8_t (*copies)[OUTQ_INLINE_SIZE]) {
+    int iovcnt = outq_gather(q, iov, max);
+    for (int i = 0; i < iovcnt; i++) {
+        if (outq_at(q, (unsigned)i)->data)
+            continue;
+        memcpy(copies[i], iov[i].iov_base, iov[i].iov_len);
+        iov[i].iov_base = copies[i];
+    }
+    return iovcnt;
+}
+
+int outq_flush_fd(outq_t *q, int fd) {
+    while (q->bytes > 0) {
+        struct iovec iov[OUTQ_MAX_IOV];
+        int iovcnt = outq_gather(q, iov, OUTQ_MAX_IOV);
+
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        outq_consume(q, (size_t)n);
+    }
+    return 0;
+}
+
+int outq_flush_tls(outq_t *q, tls_engine_t *tls, int fd) {
+    while (q->bytes > 0) {
+        size_t len = q->tls_pending;
+        if (!len)
+            len = q->bytes < OUTQ_TLS_BATCH ? q->bytes : OUTQ_TLS_BATCH;
+
+        // A piece large enough to fill the record on its own is written in
+        // place; otherwise the small frames are gathered into one record.
+        const uint8_t *src;
+        outq_item_t *first = outq_at(q, 0);
+        if (first->len - q->head_off >= len) {
+            src = outq_item_data(first) + q->head_off;
+        } else {
+            size_t copied = 0, skip = q->head_off;
+            for (unsigned i = 0; copied < len; i++, skip = 0) {
+                outq_item_t *item = outq_at(q, i);
+                size_t n = item->len - skip;
+                if (n > len - copied) n = len - copied;
+                memcpy(tls_batch + copied, outq_item_data(item) + skip, n);
+                copied += n;
+            }
+            src = tls_batch;
+        }
+
+        int n = tls_engine_write(tls, src, len);
+        if (n < 0)
+            return -1;
+        if (n == 0) {
+            // The engine is full of records: hand them to the socket and retry
+            q->tls_pending = len;
+            int sent = fd < 0 ? 0 : tls_engine_send_fd(tls, fd);
+            if (sent <= 0)
+                return sent;
+            continue;
+        }
+        q->tls_pending = 0;
+        outq_consume(q, (size_t)n);
+    }
+    return fd >= 0 && tls_engine_send_fd(tls, fd) < 0 ? -1 : 0;
+}
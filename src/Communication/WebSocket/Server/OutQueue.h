@@ -0,0 +1,80 @@
+#ifndef OUT_QUEUE_H
+#define OUT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "TLSEngine.h"
+
+#define OUTQ_INLINE_SIZE 16     // frame headers and close payloads are stored inline
+#define OUTQ_MAX_IOV     64     // segments handed to one writev
+#define OUTQ_TLS_BATCH   16384  // one full TLS record
+
+#define OUTQ_DEFAULT_HIGH_WATERMARK (64 * 1024)
+#define OUTQ_DEFAULT_LOW_WATERMARK  (16 * 1024)
+#define OUTQ_DEFAULT_LIMIT          (4 * 1024 * 1024)
+
+typedef void (*outq_release_fn)(void *opaque);
+
+// One contiguous piece of output. Payload fragments are referenced, not
+// copied; release(opaque) runs once the piece has been written.
+typedef struct {
+    const uint8_t *data;        // NULL when the bytes live in inline_data
+    size_t len;
+    outq_release_fn release;
+    void *opaque;
+    uint8_t inline_data[OUTQ_INLINE_SIZE];
+} outq_item_t;
+
+// Back-pressure thresholds, shared by all the queues of a loop
+typedef struct {
+    size_t high_watermark;      // at or above: the producer should pause
+    size_t low_watermark;       // drained to or below: the producer may resume
+    size_t limit;               // hard bound, pushes beyond it fail
+} outq_limits_t;
+
+typedef struct {
+    outq_item_t *items;         // ring of queued pieces, NULL while empty
+    unsigned head;
+    unsigned count;
+    unsigned cap;
+    size_t head_off;            // bytes of items[head] already written
+    size_t bytes;               // total bytes still queued
+    size_t tls_pending;         // length of a record write that must be retried
+    const outq_limits_t *limits;
+    int over_high;              // crossed high and not yet drained to low
+} outq_t;
+
+// Low is clamped to high, and limit raised to it
+void outq_limits_init(outq_limits_t *l, size_t high_watermark, size_t low_watermark, size_t limit);
+void outq_init(outq_t *q, const outq_limits_t *limits);
+// Release every queued piece without writing it
+void outq_clear(outq_t *q);
+
+// Queue one frame: the header is copied inline, each iov entry is referenced
+// in place and release(opaque) runs after the last one has been written.
+// Pushes fail once the queue would exceed its hard limit.
+int outq_push_frame(outq_t *q, const uint8_t *header, size_t header_len,
+                    const struct iovec *iov, int iovcnt,
+                    outq_release_fn release, void *opaque);
+// Queue raw bytes, copying them
+int outq_push_copy(outq_t *q, const void *data, size_t len);
+
+// Describe up to max queued segments, oldest first, for a gather write.
+// Returns the number of entries filled.
+int outq_gather(const outq_t *q, struct iovec *iov, int max);
+// The same, with the inline pieces copied to copies[i]: growing the queue
+// moves them, so a write that outlives the call must not point into it
+int outq_gather_stable(const outq_t *q, struct iovec *iov, int max, uint8_t (*copies)[OUTQ_INLINE_SIZE]);
+// Drop n written bytes from the front, releasing finished pieces
+void outq_consume(outq_t *q, size_t n);
+
+// Write as much as the transport accepts. Plain sockets get one writev for
+// the whole queue; TLS gets one record per batch, and the records collected
+// in the engine go to fd together (fd < 0 leaves them in the engine for the
+// caller to send). Return 0 when drained or blocked, -1 on a fatal error.
+int outq_flush_fd(outq_t *q, int fd);
+int outq_flush_tls(outq_t *q, tls_engine_t *tls, int fd);
+
+#endif
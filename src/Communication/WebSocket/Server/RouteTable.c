@@ -0,0 +1,290 @@
+#include <inttypes.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "RouteTable.h"
+
+#define ROUTE_VERSION_MASK 0xFFFFFFu    // the count; the top byte names the writer
+#define ROUTE_READ_TRIES   64           // a slot still being written after that is passed over
+#define ROUTE_SET_ATTEMPTS 8            // scans of a station's slots lost to other writers
+#define ROUTE_ID_WORDS     (STATION_ID_MAX / 8)
+
+#define STAT_ADD(field, n) __atomic_fetch_add(&table->stats.field, (n), __ATOMIC_RELAXED)
+
+// Linear probing in shared memory mapped before the workers fork. A station
+// keeps to the ROUTE_PROBES slots from its hash; slots are never emptied
+// again, only left without a route for the next station to take, so a
+// lookup may stop at the first slot that has never been used.
+typedef struct {
+    uint64_t mask;              // slots - 1
+    route_stats_t stats;
+    route_slot_t slots[];
+} route_table_t;
+
+typedef struct {
+    uint64_t id[ROUTE_ID_WORDS];
+    uint8_t len;
+    uint64_t hash;
+} route_key_t;
+
+// A slot as one reader saw it, consistently
+typedef struct {
+    uint32_t version;
+    uint16_t worker;
+    uint8_t id_len;
+    conn_handle_t handle;
+    uint64_t id[ROUTE_ID_WORDS];
+} slot_view_t;
+
+static route_table_t *table;
+static size_t table_size;
+static uint32_t self;             // this worker, in the versions of the slots it writes
+
+int route_table_init(unsigned max_stations) {
+    if (max_stations == 0)
+        return 0;
+    uint64_t slots = 256;
+    while (slots < 2 * (uint64_t)max_stations)
+        slots *= 2;
+    size_t size = sizeof(route_table_t) + slots * sizeof(route_slot_t);
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return -1;
+    table = mem;    // zero filled: every slot unused
+    table->mask = slots - 1;
+    table_size = size;
+    return 0;
+}
+
+void route_table_attach(int worker) {
+    self = (uint32_t)worker;
+}
+
+static void route_key(route_key_t *k, const char *station, size_t len) {
+    memset(k->id, 0, sizeof(k->id));
+    memcpy(k->id, station, len);
+    k->len = (uint8_t)len;
+    // FNV-1a, then a finaliser so that the low bits picking the slot depend
+    // on every byte
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (uint8_t)station[i]) * 1099511628211ull;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    k->hash = h;
+}
+
+static route_slot_t *route_slot(const route_key_t *k, uint64_t probe) {
+    return &table->slots[(k->hash + probe) & table->mask];
+}
+
+static int slot_read(const route_slot_t *slot, slot_view_t *v) {
+    for (int i = 0; i < ROUTE_READ_TRIES; i++) {
+        uint32_t before = __atomic_load_n(&slot->version, __ATOMIC_ACQUIRE);
+        if (before & 1)
+            continue;
+        v->worker = __atomic_load_n(&slot->worker, __ATOMIC_RELAXED);
+        v->id_len = __atomic_load_n(&slot->id_len, __ATOMIC_RELAXED);
+        v->handle = __atomic_load_n(&slot->handle, __ATOMIC_RELAXED);
+        for (int w = 0; w < ROUTE_ID_WORDS; w++)
+            v->id[w] = __atomic_load_n(&slot->id[w], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->version, __ATOMIC_RELAXED) == before) {
+            v->version = before;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int slot_holds(const slot_view_t *v, const route_key_t *k) {
+    return v->id_len == k->len && memcmp(v->id, k->id, sizeof(k->id)) == 0;
+}
+
+// Take the slot for writing if it is still as the caller read it
+static int slot_lock(route_slot_t *slot, uint32_t version, uint32_t owner, uint32_t *busy) {
+    uint32_t odd = ((version + 1) & ROUTE_VERSION_MASK) | owner << 24;
+    if (!__atomic_compare_exchange_n(&slot->version, &version, odd, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return -1;
+    __atomic_thread_fence(__ATOMIC_RELEASE);  // the odd version goes out before any of the writes
+    *busy = odd;
+    return 0;
+}
+
+static void slot_unlock(route_slot_t *slot, uint32_t busy) {
+    __atomic_store_n(&slot->version, (busy + 1) & ROUTE_VERSION_MASK, __ATOMIC_RELEASE);
+}
+
+// Point the slot, as seen, at the station's connection on this worker
+static int slot_write(route_slot_t *slot, const slot_view_t *seen, const route_key_t *k, conn_handle_t handle) {
+    uint32_t busy;
+    if (slot_lock(slot, seen->version, self, &busy) < 0)
+        return -1;
+    if (!slot_holds(seen, k)) {
+        for (int w = 0; w < ROUTE_ID_WORDS; w++)
+            __atomic_store_n(&slot->id[w], k->id[w], __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->id_len, k->len, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&slot->worker, (uint16_t)self, __ATOMIC_RELAXED);
+    // Counted next to the handle, so that a worker killed here leaves the
+    // count as the supervisor's sweep expects it
+    if (seen->handle == CONN_HANDLE_NONE)
+        STAT_ADD(stations, 1);
+    __atomic_store_n(&slot->handle, handle, __ATOMIC_RELAXED);
+    slot_unlock(slot, busy);
+    return 0;
+}
+
+int route_table_set(const char *station, size_t len, conn_handle_t handle) {
+    if (!table || len == 0 || len > STATION_ID_MAX)
+        return -1;
+    route_key_t key;
+    route_key(&key, station, len);
+
+    for (int attempt = 0; attempt < ROUTE_SET_ATTEMPTS; attempt++) {
+        route_slot_t *free_slot = NULL;
+        slot_view_t free_view, v;
+        int found = 0;
+        for (uint64_t i = 0; i < ROUTE_PROBES; i++) {
+            route_slot_t *slot = route_slot(&key, i);
+            if (slot_read(slot, &v) < 0)
+                continue;
+            // Reconnected: the route moves to the new connection
+            if (slot_holds(&v, &key)) {
+                found = 1;
+                if (slot_write(slot, &v, &key, handle) == 0)
+                    return 0;
+                break;
+            }
+            if (!free_slot && (v.id_len == 0 || v.handle == CONN_HANDLE_NONE)) {
+                free_slot = slot;
+                free_view = v;
+            }
+            if (v.id_len == 0)
+                break;
+        }
+        if (found)
+            continue;
+        if (!free_slot)
+            break;
+        if (slot_write(free_slot, &free_view, &key, handle) == 0)
+            return 0;
+    }
+    STAT_ADD(overflows, 1);
+    return -1;
+}
+
+void route_table_clear(const char *station, size_t len, conn_handle_t handle) {
+    if (!table || len == 0 || len > STATION_ID_MAX)
+        return;
+    route_key_t key;
+    route_key(&key, station, len);
+
+    for (int attempt = 0; attempt < ROUTE_SET_ATTEMPTS; attempt++) {
+        int raced = 0;
+        for (uint64_t i = 0; i < ROUTE_PROBES; i++) {
+            route_slot_t *slot = route_slot(&key, i);
+            slot_view_t v;
+            uint32_t busy;
+            if (slot_read(slot, &v) < 0) {
+                raced = 1;
+                continue;
+            }
+            if (v.id_len == 0)
+                break;
+            if (!slot_holds(&v, &key) || v.worker != self || v.handle != handle)
+                continue;
+            if (slot_lock(slot, v.version, self, &busy) < 0) {
+                raced = 1;
+                break;
+            }
+            __atomic_store_n(&slot->handle, CONN_HANDLE_NONE, __ATOMIC_RELAXED);
+            STAT_ADD(stations, -1);
+            slot_unlock(slot, busy);
+            return;
+        }
+        if (!raced)
+            return;
+    }
+}
+
+int route_table_lookup(const char *station, size_t len, route_t *out) {
+    if (!table || len == 0 || len > STATION_ID_MAX)
+        return -1;
+    route_key_t key;
+    route_key(&key, station, len);
+
+    for (uint64_t i = 0; i < ROUTE_PROBES; i++) {
+        slot_view_t v;
+        if (slot_read(route_slot(&key, i), &v) < 0)
+            continue;
+        if (v.id_len == 0)
+            break;
+        if (v.handle != CONN_HANDLE_NONE && slot_holds(&v, &key)) {
+            out->worker = v.worker;
+            out->handle = v.handle;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int route_table_incomplete(void) {
+    return !table || __atomic_load_n(&table->stats.overflows, __ATOMIC_RELAXED) != 0;
+}
+
+void route_table_worker_exited(int worker) {
+    if (!table)
+        return;
+    uint32_t owner = (uint32_t)worker;
+    for (uint64_t i = 0; i <= table->mask; i++) {
+        route_slot_t *slot = &table->slots[i];
+        uint32_t version = __atomic_load_n(&slot->version, __ATOMIC_ACQUIRE);
+
+        // It died writing this slot: whatever it got to, the slot routes nowhere now
+        if ((version & 1) && version >> 24 == owner) {
+            if (__atomic_load_n(&slot->handle, __ATOMIC_RELAXED) != CONN_HANDLE_NONE)
+                STAT_ADD(stations, -1);
+            __atomic_store_n(&slot->handle, CONN_HANDLE_NONE, __ATOMIC_RELAXED);
+            slot_unlock(slot, version);
+            continue;
+        }
+
+        // Its connections went with it. A station already back on another
+        // worker has moved its route there, which the version catches.
+        for (int attempt = 0; attempt < ROUTE_SET_ATTEMPTS; attempt++) {
+            slot_view_t v;
+            uint32_t busy;
+            if (slot_read(slot, &v) < 0 || v.worker != owner || v.handle == CONN_HANDLE_NONE)
+                break;
+            if (slot_lock(slot, v.version, owner, &busy) == 0) {
+                __atomic_store_n(&slot->handle, CONN_HANDLE_NONE, __ATOMIC_RELAXED);
+                slot_unlock(slot, busy);
+                STAT_ADD(stations, -1);
+                break;
+            }
+        }
+    }
+    STAT_ADD(sweeps, 1);
+}
+
+void route_table_stats(route_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!table)
+        return;
+    out->stations = __atomic_load_n(&table->stats.stations, __ATOMIC_RELAXED);
+    out->overflows = __atomic_load_n(&table->stats.overflows, __ATOMIC_RELAXED);
+    out->sweeps = __atomic_load_n(&table->stats.sweeps, __ATOMIC_RELAXED);
+}
+
+void route_table_report(FILE *out) {
+    if (!table)
+        return;
+    route_stats_t s;
+    route_table_stats(&s);
+    fprintf(out, "Station routes: %" PRIu64 " connected, %" PRIu64 " overflowed, %" PRIu64
+            " dead workers swept (%" PRIu64 " slots, %zu KiB)\n",
+            s.stations, s.overflows, s.sweeps, table->mask + 1, table_size / 1024);
+}
@@ -0,0 +1,68 @@
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include <stdalign.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "ConnPool.h"
+#include "Handshake.h"
+
+#define ROUTE_DEFAULT_STATIONS 65536
+#define ROUTE_PROBES 128            // slots a station can sit from its hash
+#define ROUTE_CACHE_LINE 64
+
+// Which worker holds a station's connection, and which one it is there
+typedef struct {
+    int worker;
+    conn_handle_t handle;
+} route_t;
+
+// One cache line per station. Readers take no lock: they read the slot
+// between two loads of its version and retry if it moved. A writer makes the
+// version odd with a compare-and-swap, stamping its worker id in the top
+// byte, so two writers never share a slot and the supervisor knows whose
+// half-written slots to release when a worker dies.
+typedef struct {
+    alignas(ROUTE_CACHE_LINE) uint32_t version;
+    uint16_t worker;
+    uint8_t id_len;             // 0 until the slot is first used: the end of every probe
+    uint8_t reserved;
+    conn_handle_t handle;       // CONN_HANDLE_NONE once the station has gone; the slot is reused
+    uint64_t id[STATION_ID_MAX / 8];  // zero padded
+} route_slot_t;
+
+typedef struct {
+    uint64_t stations;          // routed now
+    uint64_t overflows;         // stations that found no free slot and cannot be routed
+    uint64_t sweeps;            // workers whose routes were dropped when they died
+} route_stats_t;
+
+// Main process, before the workers are forked: shared memory for up to
+// max_stations stations (the table gets twice as many slots, rounded up to a
+// power of two). 0 turns routing off. Returns -1 if it could not be mapped.
+int route_table_init(unsigned max_stations);
+// In worker id, after the fork: the routes it sets are its own
+void route_table_attach(int worker);
+
+// Worker: the station is now at handle on this worker, whatever it was
+// before. Returns -1 if the table is off or has no room for it.
+int route_table_set(const char *station, size_t len, conn_handle_t handle);
+// Worker: the connection has closed. Leaves the route alone if the station
+// has reconnected since.
+void route_table_clear(const char *station, size_t len, conn_handle_t handle);
+// Anyone: the station's route, or -1 if it is not connected. Two connections
+// for one station at once may both be routed; the lookup finds one of them.
+int route_table_lookup(const char *station, size_t len, route_t *out);
+// False while a lookup's miss means the station is not connected: the table
+// is on and every station so far has found a slot
+int route_table_incomplete(void);
+
+// Supervisor, once a worker has been reaped and before its replacement starts:
+// drop its routes and release any slot it died writing
+void route_table_worker_exited(int worker);
+
+void route_table_stats(route_stats_t *out);
+void route_table_report(FILE *out);
+
+#endif
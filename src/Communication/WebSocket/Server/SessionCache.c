@@ -0,0 +1,363 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include "SessionCache.h"
+#include "Ktls.h"
+
+#define SESSION_LOCK_STRIPES 64
+
+#define STAT_INC(field) __atomic_fetch_add(&store->stats.field, 1, __ATOMIC_RELAXED)
+
+typedef struct {
+    uint8_t name[16];
+    uint8_t aes_key[32];
+    uint8_t hmac_key[32];
+    time_t created;
+    int valid;
+} ticket_key_t;
+
+typedef struct {
+    time_t expires;             // 0 when the slot is free
+    uint16_t der_len;
+    uint8_t id_len;
+    uint8_t id[SESSION_MAX_ID];
+    uint8_t der[SESSION_MAX_DER];
+} session_slot_t;
+
+// Lives in anonymous shared memory mapped before the workers fork. Sessions
+// sit in SESSION_WAYS-slot sets picked by a hash of the session id; a full set
+// overwrites the session closest to expiry.
+typedef struct {
+    pthread_mutex_t locks[SESSION_LOCK_STRIPES];   // guard the sets, by set index
+    pthread_mutex_t key_lock;                      // guards keys[]
+    unsigned nsets;
+    unsigned ticket_rotate;
+    long lifetime;                                 // session timeout in seconds
+    ticket_key_t keys[2];                          // current, previous
+    session_stats_t stats;
+    session_slot_t slots[];
+} session_store_t;
+
+static session_store_t *store;
+
+// Robust mutexes: a worker that dies holding one leaves at worst a torn slot,
+// which fails to decode, or torn ticket keys, which fail to decrypt until the
+// next rotation. Either way clients just fall back to a full handshake.
+static void store_lock(pthread_mutex_t *m) {
+    if (pthread_mutex_lock(m) == EOWNERDEAD)
+        pthread_mutex_consistent(m);
+}
+
+static int store_mutex_init(pthread_mutex_t *m) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int rc = pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return rc;
+}
+
+static int ticket_key_generate(ticket_key_t *key, time_t now) {
+    if (RAND_bytes(key->name, sizeof(key->name)) != 1 ||
+        RAND_bytes(key->aes_key, sizeof(key->aes_key)) != 1 ||
+        RAND_bytes(key->hmac_key, sizeof(key->hmac_key)) != 1)
+        return -1;
+    key->created = now;
+    key->valid = 1;
+    return 0;
+}
+
+int session_cache_init(unsigned slots, unsigned ticket_rotate) {
+    unsigned nsets = (slots + SESSION_WAYS - 1) / SESSION_WAYS;
+    size_t size = sizeof(*store) + (size_t)nsets * SESSION_WAYS * sizeof(session_slot_t);
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return -1;
+    session_store_t *s = mem;   // zero filled: every slot starts free
+
+    for (int i = 0; i < SESSION_LOCK_STRIPES; i++) {
+        if (store_mutex_init(&s->locks[i]) != 0)
+            goto fail;
+    }
+    if (store_mutex_init(&s->key_lock) != 0)
+        goto fail;
+
+    s->nsets = nsets;
+    s->ticket_rotate = ticket_rotate;
+    s->lifetime = ticket_rotate ? ticket_rotate : SESSION_TICKET_DEFAULT_ROTATE;
+    if (ticket_rotate && ticket_key_generate(&s->keys[0], time(NULL)) < 0)
+        goto fail;
+
+    store = s;
+    return 0;
+
+fail:
+    munmap(mem, size);
+    errno = EAGAIN;
+    return -1;
+}
+
+static uint32_t session_hash(const uint8_t *id, unsigned len) {
+    uint32_t h = 2166136261u;
+    for (unsigned i = 0; i < len; i++)
+        h = (h ^ id[i]) * 16777619u;
+    return h;
+}
+
+static session_slot_t *session_set(const uint8_t *id, unsigned id_len, pthread_mutex_t **lock) {
+    unsigned set = session_hash(id, id_len) % store->nsets;
+    *lock = &store->locks[set % SESSION_LOCK_STRIPES];
+    return &store->slots[(size_t)set * SESSION_WAYS];
+}
+
+static int session_slot_matches(const session_slot_t *slot, const uint8_t *id, unsigned id_len) {
+    return slot->expires && slot->id_len == id_len && memcmp(slot->id, id, id_len) == 0;
+}
+
+static int session_new_cb(SSL *ssl, SSL_SESSION *sess) {
+    // A stateless TLS 1.3 ticket already carries the whole session
+    if (SSL_version(ssl) == TLS1_3_VERSION && !(SSL_get_options(ssl) & SSL_OP_NO_TICKET))
+        return 0;
+
+    unsigned id_len;
+    const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+    if (id_len == 0 || id_len > SESSION_MAX_ID)
+        return 0;
+
+    // Serialise outside the lock
+    uint8_t der[SESSION_MAX_DER];
+    int der_len = i2d_SSL_SESSION(sess, NULL);
+    if (der_len <= 0 || der_len > SESSION_MAX_DER) {
+        STAT_INC(cache_oversize);
+        return 0;
+    }
+    unsigned char *p = der;
+    i2d_SSL_SESSION(sess, &p);
+
+    time_t now = time(NULL);
+    pthread_mutex_t *lock;
+    session_slot_t *set = session_set(id, id_len, &lock);
+
+    store_lock(lock);
+    session_slot_t *victim = NULL;
+    for (int i = 0; i < SESSION_WAYS; i++) {
+        if (session_slot_matches(&set[i], id, id_len)) {
+            victim = &set[i];
+            break;
+        }
+        if (!victim || set[i].expires < victim->expires)
+            victim = &set[i];
+    }
+    int evicted = victim->expires > now && !session_slot_matches(victim, id, id_len);
+
+    victim->expires = (time_t)(SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess));
+    victim->id_len = (uint8_t)id_len;
+    memcpy(victim->id, id, id_len);
+    victim->der_len = (uint16_t)der_len;
+    memcpy(victim->der, der, (size_t)der_len);
+    pthread_mutex_unlock(lock);
+
+    STAT_INC(cache_stores);
+    if (evicted)
+        STAT_INC(cache_evictions);
+    return 0;   // nothing kept a reference to sess
+}
+
+static SSL_SESSION *session_get_cb(SSL *ssl, const unsigned char *id, int id_len, int *copy) {
+    (void)ssl;
+    *copy = 0;  // the session is decoded fresh, the caller owns it
+    if (id_len <= 0 || id_len > SESSION_MAX_ID) {
+        STAT_INC(cache_misses);
+        return NULL;
+    }
+
+    uint8_t der[SESSION_MAX_DER];
+    size_t der_len = 0;
+    time_t now = time(NULL);
+    pthread_mutex_t *lock;
+    session_slot_t *set = session_set(id, (unsigned)id_len, &lock);
+
+    store_lock(lock);
+    for (int i = 0; i < SESSION_WAYS; i++) {
+        if (session_slot_matches(&set[i], id, (unsigned)id_len) && set[i].expires > now) {
+            der_len = set[i].der_len;
+            memcpy(der, set[i].der, der_len);
+            break;
+        }
+    }
+    pthread_mutex_unlock(lock);
+
+    const unsigned char *p = der;
+    SSL_SESSION *sess = der_len ? d2i_SSL_SESSION(NULL, &p, (long)der_len) : NULL;
+    if (sess)
+        STAT_INC(cache_hits);
+    else
+        STAT_INC(cache_misses);
+    return sess;
+}
+
+static void session_remove_cb(SSL_CTX *ctx, SSL_SESSION *sess) {
+    (void)ctx;
+    unsigned id_len;
+    const unsigned char *id = SSL_SESSION_get_id(sess, &id_len);
+    if (id_len == 0 || id_len > SESSION_MAX_ID)
+        return;
+
+    pthread_mutex_t *lock;
+    session_slot_t *set = session_set(id, id_len, &lock);
+    store_lock(lock);
+    for (int i = 0; i < SESSION_WAYS; i++) {
+        if (session_slot_matches(&set[i], id, id_len))
+            set[i].expires = 0;
+    }
+    pthread_mutex_unlock(lock);
+}
+
+// Called with key_lock held. Whichever worker first notices the current key
+// has aged out replaces it; the old one keeps decrypting for one more period.
+static void ticket_rotate_if_due(time_t now) {
+    if (now - store->keys[0].created < (time_t)store->ticket_rotate)
+        return;
+
+    ticket_key_t next;
+    if (ticket_key_generate(&next, now) < 0)
+        return;
+    store->keys[1] = store->keys[0];
+    store->keys[0] = next;
+    OPENSSL_cleanse(&next, sizeof(next));
+    STAT_INC(ticket_key_rotations);
+}
+
+// Stateless tickets (RFC 5077) and TLS 1.3 PSK tickets: AES-256-CBC plus
+// HMAC-SHA256 under keys every worker shares. Returns 2 for tickets under the
+// previous key so the client gets a fresh one.
+static int ticket_key_cb(SSL *ssl, unsigned char key_name[16], unsigned char iv[EVP_MAX_IV_LENGTH],
+                         EVP_CIPHER_CTX *cipher, EVP_MAC_CTX *mac, int enc) {
+    (void)ssl;
+    ticket_key_t key;
+    int rc = 1;
+
+    store_lock(&store->key_lock);
+    ticket_rotate_if_due(time(NULL));
+    if (enc || memcmp(key_name, store->keys[0].name, sizeof(store->keys[0].name)) == 0) {
+        key = store->keys[0];
+    } else if (store->keys[1].valid && memcmp(key_name, store->keys[1].name, sizeof(store->keys[1].name)) == 0) {
+        key = store->keys[1];
+        rc = 2;
+    } else {
+        rc = 0;
+    }
+    pthread_mutex_unlock(&store->key_lock);
+
+    if (rc == 0) {
+        STAT_INC(tickets_rejected);
+        return 0;
+    }
+
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac_key, sizeof(key.hmac_key)),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *)"SHA256", 0),
+        OSSL_PARAM_construct_end()
+    };
+
+    if (enc) {
+        memcpy(key_name, key.name, sizeof(key.name));
+        if (RAND_bytes(iv, 16) != 1 ||
+            !EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key.aes_key, iv))
+            rc = -1;
+    } else if (!EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key.aes_key, iv)) {
+        rc = -1;
+    }
+    if (rc > 0 && !EVP_MAC_CTX_set_params(mac, params))
+        rc = -1;
+    OPENSSL_cleanse(&key, sizeof(key));
+
+    if (rc > 0) {
+        if (enc)
+            STAT_INC(tickets_issued);
+        else if (rc == 2)
+            STAT_INC(tickets_renewed);
+        else
+            STAT_INC(tickets_accepted);
+    }
+    return rc;
+}
+
+void session_cache_attach(SSL_CTX *ctx) {
+    static const unsigned char sid_ctx[] = "WebSocket";
+    SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx) - 1);
+    if (!store)
+        return;
+
+    SSL_CTX_set_timeout(ctx, store->lifetime);
+    if (store->nsets) {
+        // Every lookup goes to the shared store, so any worker can resume
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+        SSL_CTX_sess_set_new_cb(ctx, session_new_cb);
+        SSL_CTX_sess_set_get_cb(ctx, session_get_cb);
+        SSL_CTX_sess_set_remove_cb(ctx, session_remove_cb);
+    }
+
+    if (store->ticket_rotate)
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticket_key_cb);
+    else
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);  // TLS 1.3 then issues stateful tickets
+
+    // A charge point holds a single connection, one ticket per handshake will do
+    SSL_CTX_set_num_tickets(ctx, 1);
+}
+
+void session_cache_count_handshake(SSL *ssl) {
+    if (!store)
+        return;
+    if (SSL_session_reused(ssl))
+        STAT_INC(resumed_handshakes);
+    else
+        STAT_INC(full_handshakes);
+    if (ktls_send_active(ssl))
+        STAT_INC(ktls_send);
+    if (ktls_recv_active(ssl))
+        STAT_INC(ktls_recv);
+}
+
+void session_cache_stats(session_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!store)
+        return;
+    // All counters are uint64_t; a snapshot need not be consistent across them
+    const uint64_t *src = (const uint64_t *)&store->stats;
+    uint64_t *dst = (uint64_t *)out;
+    for (size_t i = 0; i < sizeof(*out) / sizeof(uint64_t); i++)
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+void session_cache_report(FILE *out) {
+    if (!store)
+        return;
+
+    session_stats_t s;
+    session_cache_stats(&s);
+    uint64_t total = s.full_handshakes + s.resumed_handshakes;
+    fprintf(out, "TLS handshakes: %" PRIu64 " full, %" PRIu64 " resumed (%.1f%% hit rate)\n",
+            s.full_handshakes, s.resumed_handshakes,
+            total ? 100.0 * (double)s.resumed_handshakes / (double)total : 0.0);
+    fprintf(out, "Session cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " stores, %"
+            PRIu64 " evictions, %" PRIu64 " oversize\n",
+            s.cache_hits, s.cache_misses, s.cache_stores, s.cache_evictions, s.cache_oversize);
+    fprintf(out, "Session tickets: %" PRIu64 " issued, %" PRIu64 " accepted, %" PRIu64 " renewed, %"
+            PRIu64 " rejected, %" PRIu64 " key rotations\n",
+            s.tickets_issued, s.tickets_accepted, s.tickets_renewed, s.tickets_rejected,
+            s.ticket_key_rotations);
+    if (s.ktls_send || s.ktls_recv)
+        fprintf(out, "Kernel TLS: %" PRIu64 " connections with send offload, %" PRIu64 " with receive offload\n",
+                s.ktls_send, s.ktls_recv);
+}
@@ -0,0 +1,47 @@
+#ifndef SESSION_CACHE_H
+#define SESSION_CACHE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <openssl/ssl.h>
+
+#define SESSION_CACHE_DEFAULT_SLOTS   16384
+#define SESSION_TICKET_DEFAULT_ROTATE 43200  // seconds a ticket key stays current
+#define SESSION_MAX_ID    SSL_MAX_SSL_SESSION_ID_LENGTH
+#define SESSION_MAX_DER   768                // larger sessions are not cached
+#define SESSION_WAYS      4                  // slots probed per lookup
+
+// Monotonic counters shared by every worker, updated atomically
+typedef struct {
+    uint64_t full_handshakes;
+    uint64_t resumed_handshakes;
+    uint64_t cache_hits;            // session id found in the shared store
+    uint64_t cache_misses;
+    uint64_t cache_stores;
+    uint64_t cache_evictions;       // a live session was overwritten
+    uint64_t cache_oversize;        // too large for a slot
+    uint64_t tickets_issued;
+    uint64_t tickets_accepted;
+    uint64_t tickets_renewed;       // decrypted with the previous key
+    uint64_t tickets_rejected;      // unknown or retired key
+    uint64_t ticket_key_rotations;
+    uint64_t ktls_send;             // handshakes that ended with kernel record offload
+    uint64_t ktls_recv;
+} session_stats_t;
+
+// Set up the store in the main process, before the workers are forked, so
+// every worker (and every respawned one) maps the same memory. slots == 0
+// disables the shared session-id cache; ticket_rotate == 0 disables stateless
+// tickets, leaving TLS 1.3 to resume from the cache instead. Returns -1 if the
+// memory could not be mapped.
+int session_cache_init(unsigned slots, unsigned ticket_rotate);
+
+// Worker side: resume sessions in ctx from the shared store and tickets
+void session_cache_attach(SSL_CTX *ctx);
+// Account for a completed server handshake, resumption and kTLS offload
+void session_cache_count_handshake(SSL *ssl);
+
+void session_cache_stats(session_stats_t *out);
+void session_cache_report(FILE *out);
+
+#endif
@@ -1,59 +1,228 @@
+#define _GNU_SOURCE
 #include "TLSServer.h"
 
+// CALL handlers, registered once per worker
+static ocpp_router_t ocpp_router;
+
+// Scratch for handling one message, reset after every dispatch
+static arena_t message_arena;
+
+static void count_ocpp_message(const ocpp_message_t *msg) {
+    if (msg)
+        metric_ocpp_received(msg->type, msg->action);
+    else
+        metric_inc(METRIC_OCPP_MALFORMED);
+}
+
+// OCPP-J transport: every message is one text frame. With permessage-deflate
+// the compressor writes the frame's buffer. Returns 1 once the frame is
+// queued that way, 0 if the text goes as it is.
+static int send_ocpp_deflated(connection_t *conn, const struct iovec *iov, int iovcnt) {
+    if (!conn->cold->deflate.params.enabled)
+        return 0;
+    uint8_t *packed;
+    size_t packed_len;
+    int rc = ws_deflate_message(&conn->cold->deflate, iov, iovcnt, 0, &packed, &packed_len);
+    if (rc <= 0) return rc;
+    struct iovec whole = { packed, packed_len };
+    return send_frame_iov(conn, WS_OPCODE_TEXT | WS_RSV1, &whole, 1, buf_pool_put, packed) < 0 ? -1 : 1;
+}
+
+// The session's CALLs and CALLERRORs: the pieces are only borrowed, so they
+// are joined into a pooled buffer returned once written
+static int send_ocpp(void *transport, const struct iovec *iov, int iovcnt) {
+    connection_t *conn = transport;
+    int rc = send_ocpp_deflated(conn, iov, iovcnt);
+    if (rc) return rc < 0 ? -1 : 0;
+
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++)
+        len += iov[i].iov_len;
+    char *text = buf_pool_get(len);
+    if (!text) return -1;
+    size_t off = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(text + off, iov[i].iov_base, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+    struct iovec whole = { text, len };
+    return send_frame_iov(conn, WS_OPCODE_TEXT, &whole, 1, buf_pool_put, text);
+}
+
+int send_ocpp_buffer(connection_t *conn, const char *text, size_t len, void *buf) {
+    struct iovec whole = { (void *)text, len };
+    int rc = send_ocpp_deflated(conn, &whole, 1);
+    if (rc) {
+        buf_pool_put(buf);
+        return rc < 0 ? -1 : 0;
+    }
+    return send_frame_iov(conn, WS_OPCODE_TEXT, &whole, 1, buf_pool_put, buf);
+}
+
 // Handle WebSocket Handshake
-int handle_handshake(SSL *ssl) {
-    char buffer[BUFFER_SIZE];
-    SSL_read(ssl, buffer, sizeof(buffer));
-
-    char *key_start = strstr(buffer, "Sec-WebSocket-Key: ");
-    if (!key_start) return 0;
-
-    key_start += strlen("Sec-WebSocket-Key: ");
-    char sec_websocket_key[25];
-    sscanf(key_start, "%24s", sec_websocket_key);
-
-    char accept_key[SHA_DIGEST_LENGTH];
-    char concat_key[128];
-    snprintf(concat_key, sizeof(concat_key), "%s%s", sec_websocket_key, WEBSOCKET_MAGIC_GUID);
-
-    SHA1((unsigned char *)concat_key, strlen(concat_key), (unsigned char *)accept_key);
-    char *accept_key_base64 = base64_encode((unsigned char *)accept_key, SHA_DIGEST_LENGTH);
-
-    char response[BUFFER_SIZE];
-    snprintf(response, sizeof(response),
-             "HTTP/1.1 101 Switching Protocols\r\n"
-             "Upgrade: websocket\r\n"
-             "Connection: Upgrade\r\n"
-             "Sec-WebSocket-Accept: %s\r\n"
-             "\r\n",
-             accept_key_base64);
-
-    SSL_write(ssl, response, strlen(response));
-    free(accept_key_base64);
+// Returns 1 once the upgrade is answered, 0 if the request is still incomplete
+// and -1 if it has to be rejected.
+int handle_handshake(connection_t *conn) {
+    conn_cold_t *cold = conn->cold;
+    char response[HANDSHAKE_RESPONSE_SIZE];
+    size_t avail, response_len;
+    const uint8_t *data = ws_decoder_peek(&conn->rx, &avail);
+    if (!data) return 0;
+
+    int rc = ws_handshake_process(&cold->http, (const char *)data, avail, &server_config.deflate,
+                                  &cold->upgrade, response, &response_len);
+    if (rc == 0) return 0;
+    if (conn_send(conn, response, response_len) < 0 || rc < 0) {
+        metric_inc(METRIC_UPGRADES_REJECTED);
+        return -1;
+    }
+    ws_decoder_consume(&conn->rx, cold->http.length);
+
+    // OCPP: a station offering only versions we do not speak gets the upgrade
+    // without Sec-WebSocket-Protocol and is closed right away
+    if (cold->upgrade.subprotocol_offered && !cold->upgrade.subprotocol) {
+        metric_inc(METRIC_UPGRADES_REJECTED);
+        send_close(conn, WS_CLOSE_PROTOCOL_ERROR);
+        return -1;
+    }
+
+    LOG_INFO("Station %s connected (%s%s)", cold->upgrade.station_id,
+             cold->upgrade.subprotocol ? cold->upgrade.subprotocol : "no subprotocol",
+             cold->upgrade.deflate.enabled ? ", deflate" : "");
+    ws_deflate_init(&cold->deflate, &cold->upgrade.deflate, 1);
+    conn->rx.deflate = cold->upgrade.deflate.enabled;
+    // The request is parsed, the session takes the parser's place
+    ocpp_session_init(&cold->ocpp, &ocpp_router, ocpp_version_from_subprotocol(cold->upgrade.subprotocol),
+                      send_ocpp, conn);
+    cold->ocpp.arena = &message_arena;
+    cold->ocpp.call_timeout_ms = server_config.call_timeout * 1000;
+    cold->upgraded = 1;
+    cold->connected_at = time(NULL);
+    metric_inc(METRIC_UPGRADES);
+    metric_gauge_add(METRIC_STATIONS, 1);
+    // Commands for the station find this worker, and this connection, from now on
+    route_table_set(cold->upgrade.station_id, strlen(cold->upgrade.station_id), conn_handle(conn));
     return 1;
 }
 
-// Send a WebSocket Frame
-void send_frame(SSL *ssl, const char *message) {
-    size_t len = strlen(message);
-    unsigned char frame[BUFFER_SIZE] = {0};
-    frame[0] = 0x81;  // FIN=1, opcode=1 (text frame)
-    frame[1] = len;   // Assuming payload length < 126
-    memcpy(frame + 2, message, len);
-    SSL_write(ssl, frame, len + 2);
+server_config_t server_config = {
+    .port = PORT,
+    .plain = 0,
+    .out_high_watermark = OUTQ_DEFAULT_HIGH_WATERMARK,
+    .out_low_watermark = OUTQ_DEFAULT_LOW_WATERMARK,
+    .drop_slow = 0,
+    .session_cache_slots = SESSION_CACHE_DEFAULT_SLOTS,
+    .ticket_rotate = SESSION_TICKET_DEFAULT_ROTATE,
+    .ktls = 0,
+    .io_uring = 0,
+    .handshake_timeout = CONN_DEFAULT_HANDSHAKE_TIMEOUT,
+    .ping_interval = CONN_DEFAULT_PING_INTERVAL,
+    .ping_interval_max = CONN_DEFAULT_PING_INTERVAL_MAX,
+    .pong_timeout = CONN_DEFAULT_PONG_TIMEOUT,
+    .call_timeout = CONN_DEFAULT_CALL_TIMEOUT,
+    .max_stations = ROUTE_DEFAULT_STATIONS,
+    .deflate = { .enabled = 0, .max_window_bits = WS_DEFLATE_MAX_WINDOW, .no_context_takeover = 0 }
+};
+
+// Send a WebSocket Frame made of payload fragments that are written in place.
+// release(opaque) runs once the frame is on the wire (or the connection dies).
+int send_frame_iov(connection_t *conn, uint8_t opcode, const struct iovec *iov, int iovcnt,
+                   outq_release_fn release, void *opaque) {
+    uint64_t len = 0;
+    for (int i = 0; i < iovcnt; i++)
+        len += iov[i].iov_len;
+
+    uint8_t header[WS_MAX_HEADER_SIZE];
+    size_t header_len = ws_build_frame_header(header, opcode, 1, len, NULL);  // servers never mask
+    metric_frame(1, opcode);
+    metric_add(METRIC_BYTES_SENT, header_len + len);
+    return outq_push_frame(&conn->out, header, header_len, iov, iovcnt, release, opaque);
 }
 
-// Receive a WebSocket Frame
-void receive_frame(SSL *ssl, char *buffer) {
-    unsigned char frame[BUFFER_SIZE] = {0};
-    SSL_read(ssl, frame, BUFFER_SIZE);
-    size_t len = frame[1] & 0x7F;  // Get payload length
-    memcpy(buffer, frame + 2, len);
-    buffer[len] = '\0';
+// Send a WebSocket Frame, copying a small payload
+int send_frame(connection_t *conn, uint8_t opcode, const void *payload, size_t len) {
+    uint8_t header[WS_MAX_HEADER_SIZE];
+    size_t header_len = ws_build_frame_header(header, opcode, 1, len, NULL);
+
+    metric_frame(1, opcode);
+    if (conn_send(conn, header, header_len) < 0) return -1;
+    return len ? conn_send(conn, payload, len) : 0;
 }
 
-// WebSocket Server Main Function
-void websocket_server() {
+// Send a Close frame carrying a status code, starting the close handshake
+int send_close(connection_t *conn, uint16_t code) {
+    uint8_t frame[WS_MAX_CONTROL_FRAME];
+    metric_frame(1, WS_OPCODE_CLOSE);
+    return conn_send(conn, frame, ws_build_close(&conn->rx, code, NULL, frame));
+}
+
+// Handle every complete message sitting in the read buffer. Returns 1 once
+// we have started an orderly close and wait for the peer's close frame.
+int process_frames(connection_t *conn) {
+    ws_message_t msg;
+    int rc = 0;
+
+    // A throttled station's requests wait in the buffer until its replies drain
+    while (conn_writable(conn) && (rc = ws_decoder_next(&conn->rx, &msg)) > 0) {
+        metric_frame(0, msg.opcode);
+        // Pings, pongs and closes are answered here, from the stack, and
+        // never reach the OCPP layer
+        if (WS_IS_CONTROL(msg.opcode)) {
+            uint8_t reply[WS_MAX_CONTROL_FRAME];
+            size_t reply_len;
+            int closed = ws_control_frame(&conn->rx, &msg, NULL, reply, &reply_len);
+            if (reply_len)
+                metric_frame(1, msg.opcode == WS_OPCODE_PING ? WS_OPCODE_PONG : WS_OPCODE_CLOSE);
+            if (reply_len && conn_send(conn, reply, reply_len) < 0)
+                return -1;
+            if (msg.opcode == WS_OPCODE_PONG)
+                conn->cold->pong_at = conn->last_rx;
+            if (closed)
+                return -1;  // flushed, then closed
+            continue;
+        }
+        // Until the peer answers our close, its messages are dropped
+        if (conn->rx.close_sent)
+            continue;
+
+        // OCPP-J is JSON text only
+        if (msg.opcode != WS_OPCODE_TEXT) {
+            send_close(conn, WS_CLOSE_UNSUPPORTED);
+            return 1;
+        }
+
+        const uint8_t *text = msg.payload;
+        size_t len = msg.len;
+        if (msg.compressed &&
+            ws_inflate_message(&conn->cold->deflate, msg.payload, msg.len, conn->rx.max_message, &text, &len) < 0) {
+            send_close(conn, conn->cold->deflate.close_code);
+            return -1;
+        }
+        // The decoder could not look inside compressed text
+        if (msg.compressed && !ws_utf8_valid(text, len)) {
+            send_close(conn, WS_CLOSE_INVALID_DATA);
+            return -1;
+        }
+
+        conn->cold->messages++;
+        LOG_DEBUG("Received from %s: %s", conn->cold->upgrade.station_id, LOG_SPAN(text, len));
+        uint64_t started = metrics_clock_ns();
+        int failed = ocpp_session_dispatch(&conn->cold->ocpp, (const char *)text, len) < 0;
+        metric_observe(METRIC_DISPATCH, metrics_clock_ns() - started);
+        if (failed)
+            return -1;
+    }
+
+    // A protocol violation fails the connection: there is no waiting for
+    // an answer from a peer we can no longer parse
+    if (rc < 0) {
+        send_close(conn, conn->rx.close_code);
+        return -1;
+    }
+    return conn->rx.close_sent ? 1 : 0;
+}
+
+static SSL_CTX *create_server_context() {
     SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
     if (!ctx) {
         perror("Unable to create SSL context");
@@ -61,6 +230,14 @@ void websocket_server() {
     }
 
     SSL_CTX_set_ecdh_auto(ctx, 1);
+    // Non-blocking writes may be partial and retried from a moved buffer;
+    // idle connections give their record buffers back to the allocator.
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                          SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                          SSL_MODE_RELEASE_BUFFERS);
+    // OpenSSL keeps records in user space for ciphers the kernel cannot do
+    if (server_config.ktls)
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
 
     // Load server certificate and private key
     if (SSL_CTX_use_certificate_file(ctx, "server.crt", SSL_FILETYPE_PEM) <= 0 ||
@@ -69,15 +246,47 @@ void websocket_server() {
         exit(EXIT_FAILURE);
     }
 
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    // Reconnecting stations resume on whichever worker accepts them
+    session_cache_attach(ctx);
+    return ctx;
+}
+
+// WebSocket Server Main Function
+void websocket_server() {
+    // Records are formatted and written by a thread of this worker's own
+    if (log_start() < 0)
+        perror("Unable to start the log thread, logging synchronously");
+
+    SSL_library_init();
+    OpenSSL_add_all_algorithms();
+    SSL_load_error_strings();
+
+    ocpp_router_init(&ocpp_router);
+    ocpp_handlers_register(&ocpp_router);
+    ocpp_router.observe = count_ocpp_message;
+    arena_init(&message_arena, OCPP_MESSAGE_ARENA);
+
+    SSL_CTX *ctx = NULL;
+    if (!server_config.plain)
+        ctx = create_server_context();
+
+    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (server_fd == -1) {
         perror("Unable to create socket");
         exit(EXIT_FAILURE);
     }
 
+    // Every worker binds its own listener; the kernel balances accepts across them
+    int opt = 1;
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("Unable to set SO_REUSEPORT");
+        exit(EXIT_FAILURE);
+    }
+
     struct sockaddr_in addr = {
         .sin_family = AF_INET,
-        .sin_port = htons(PORT),
+        .sin_port = htons(server_config.port),
         .sin_addr.s_addr = INADDR_ANY
     };
 
@@ -86,85 +295,45 @@ void websocket_server() {
         exit(EXIT_FAILURE);
     }
 
-    if (listen(server_fd, 1) < 0) {
+    if (listen(server_fd, SOMAXCONN) < 0) {
         perror("Unable to listen");
         exit(EXIT_FAILURE);
     }
 
-    printf("Server is listening on port %d\n", PORT);
-
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    int client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
-    if (client_fd < 0) {
-        perror("Unable to accept");
-        exit(EXIT_FAILURE);
-    }
-
-    SSL *ssl = SSL_new(ctx);
-    SSL_set_fd(ssl, client_fd);
+    // A peer resetting mid-write must not kill the whole server
+    signal(SIGPIPE, SIG_IGN);
 
-    if (SSL_accept(ssl) <= 0) {
-        ERR_print_errors_fp(stderr);
-    } else {
-        printf("Client connected via TLS\n");
-
-        if (handle_handshake(ssl)) {
-            char buffer[BUFFER_SIZE];
-            receive_frame(ssl, buffer);
-            printf("Received: %s\n", buffer);
-
-            cJSON *response_json = cJSON_CreateObject();
-            cJSON_AddStringToObject(response_json, "status", "Accepted");
-            cJSON_AddStringToObject(response_json, "currentTime", "2024-12-26T12:00:00Z");
-            const char *response = cJSON_PrintUnformatted(response_json);
-
-            send_frame(ssl, response);
-            cJSON_Delete(response_json);
-        }
+    // Every station holds a descriptor; take as many as we are allowed
+    struct rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0 && nofile.rlim_cur < nofile.rlim_max) {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
     }
 
-    SSL_shutdown(ssl);
-    SSL_free(ssl);
-    close(client_fd);
-    SSL_CTX_free(ctx);
-}
-
-char *base64_encode(const unsigned char *input, int length) {
-    static const char encoding_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    char *encoded_data = malloc(((length + 2) / 3) * 4 + 1);
-    if (!encoded_data) return NULL;
-
-    int i, j;
-    for (i = 0, j = 0; i < length;) {
-        uint32_t octet_a = i < length ? (unsigned char)input[i++] : 0;
-        uint32_t octet_b = i < length ? (unsigned char)input[i++] : 0;
-        uint32_t octet_c = i < length ? (unsigned char)input[i++] : 0;
-
-        uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
-
-        encoded_data[j++] = encoding_table[(triple >> 18) & 0x3F];
-        encoded_data[j++] = encoding_table[(triple >> 12) & 0x3F];
-        encoded_data[j++] = encoding_table[(triple >> 6) & 0x3F];
-        encoded_data[j++] = encoding_table[triple & 0x3F];
-    }
-
-    static const int mod_table[] = {0, 2, 1};
-    for (int k = 0; k < mod_table[length % 3]; k++) {
-        encoded_data[--j] = '=';
+    event_loop_t loop;
+    if (event_loop_init(&loop, server_fd, ctx) < 0) {
+        perror("Unable to create event loop");
+        exit(EXIT_FAILURE);
     }
-
-    encoded_data[j] = '\0';
-    return encoded_data;
-}
-
-
-int main(int argc, char **argv) {
-    SSL_library_init();
-    OpenSSL_add_all_algorithms();
-    SSL_load_error_strings();
-
-    websocket_server();
-
-    return 0;
+    outq_limits_init(&loop.out_limits, server_config.out_high_watermark, server_config.out_low_watermark,
+                     OUTQ_DEFAULT_LIMIT);
+    loop.drop_slow = server_config.drop_slow;
+    loop.tls_on_socket = server_config.ktls;
+    loop.backend = server_config.io_uring ? EVENT_BACKEND_URING : EVENT_BACKEND_EPOLL;
+    loop.handshake_timeout_ms = server_config.handshake_timeout * 1000;
+    loop.ping_interval_ms = server_config.ping_interval * 1000;
+    loop.ping_interval_max_ms = server_config.ping_interval_max > server_config.ping_interval ?
+                                server_config.ping_interval_max * 1000 : loop.ping_interval_ms;
+    loop.pong_timeout_ms = server_config.pong_timeout * 1000;
+
+    // Stopped, not killed, so that what its log ring holds still goes out
+    event_loop_stop_on(&loop, SIGTERM);
+    LOG_INFO("Server %d is listening on port %d%s", (int)getpid(), server_config.port,
+             ctx ? "" : " (plain ws)");
+    event_loop_run(&loop);
+
+    event_loop_destroy(&loop);
+    close(server_fd);
+    if (ctx)
+        SSL_CTX_free(ctx);
 }
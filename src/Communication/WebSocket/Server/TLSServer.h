@@ -10,19 +10,57 @@
 #include <arpa/inet.h>
 #include <openssl/sha.h>
 #include <time.h>
-#include <cjson/cJSON.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+#include "EventLoop.h"
+#include "WebSocketFrame.h"
+#include "BufferPool.h"
+#include "Handshake.h"
+#include "SessionCache.h"
+#include "Ktls.h"
+#include "IoUring.h"
+#include "OcppHandlers.h"
+#include "RouteTable.h"
+#include "Metrics.h"
+#include "Log.h"
 
 #define PORT 12345
 #define BUFFER_SIZE 1024
-#define WEBSOCKET_MAGIC_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+typedef struct {
+    int port;
+    int plain;  // serve ws:// without TLS (OCPP security profile 1)
+    size_t out_high_watermark;  // per-connection output back-pressure thresholds
+    size_t out_low_watermark;
+    int drop_slow;              // drop stations instead of pausing them
+    unsigned session_cache_slots;  // TLS sessions shared across workers, 0 = off
+    unsigned ticket_rotate;     // session ticket key lifetime in seconds, 0 = no tickets
+    int ktls;                   // let the kernel do record encryption where it can
+    int io_uring;               // completion-based I/O instead of epoll readiness
+    unsigned handshake_timeout; // seconds to finish the TLS and HTTP handshakes
+    unsigned ping_interval;     // seconds of silence before a station is pinged, 0 = never
+    unsigned ping_interval_max; // stretched up to this for stations that answer promptly
+    unsigned pong_timeout;      // seconds it then has to show signs of life
+    unsigned call_timeout;      // seconds a CALL of ours waits for its answer, 0 = forever
+    unsigned max_stations;      // stations the cross-worker route table holds, 0 = no table
+    ws_deflate_config_t deflate;  // permessage-deflate, off unless asked for
+} server_config_t;
+
+// Set by the main process before the workers are forked
+extern server_config_t server_config;
 
 // Function declarations
 void websocket_server();
-int handle_handshake(SSL *ssl);
-void send_frame(SSL *ssl, const char *message);
-void receive_frame(SSL *ssl, char *buffer);
-
-char *base64_encode(const unsigned char *input, int length);
+int handle_handshake(connection_t *conn);
+int process_frames(connection_t *conn);
+int send_frame(connection_t *conn, uint8_t opcode, const void *payload, size_t len);
+int send_frame_iov(connection_t *conn, uint8_t opcode, const struct iovec *iov, int iovcnt,
+                   outq_release_fn release, void *opaque);
+// An OCPP-J message written in place in buf, a buffer from buf_pool_get that
+// the connection takes over, whether or not it could be queued
+int send_ocpp_buffer(connection_t *conn, const char *text, size_t len, void *buf);
+int send_close(connection_t *conn, uint16_t code);
 
 #endif
 
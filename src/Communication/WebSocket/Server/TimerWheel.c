@@ -0,0 +1,152 @@
+#include "TimerWheel.h"
+
+#include <limits.h>
+#include <time.h>
+
+#define SLOT_MASK  (TIMER_WHEEL_SLOTS - 1)
+#define WHEEL_SPAN (1u << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+uint64_t timer_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void timer_wheel_init(timer_wheel_t *w, uint64_t now_ms) {
+    *w = (timer_wheel_t){ .origin_ms = now_ms };
+}
+
+void timer_init(wheel_timer_t *t, wheel_timer_fn fn) {
+    *t = (wheel_timer_t){ .fn = fn };
+}
+
+// Slot for t relative to the current tick: the lowest level whose span
+// covers the distance, indexed by that level's digit of the expiry
+static void place(timer_wheel_t *w, wheel_timer_t *t) {
+    uint32_t delta = t->expires - w->now;
+    if ((int32_t)delta < 0) {
+        t->expires = w->now;
+        delta = 0;
+    }
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= 1u << (TIMER_WHEEL_BITS * (level + 1)))
+        level++;
+    unsigned slot = (t->expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK;
+
+    wheel_timer_t **head = &w->slots[level][slot];
+    t->next = *head;
+    if (t->next)
+        t->next->pprev = &t->next;
+    t->pprev = head;
+    *head = t;
+    w->occupied[level] |= 1ull << slot;
+}
+
+static void unlink_timer(timer_wheel_t *w, wheel_timer_t *t) {
+    *t->pprev = t->next;
+    if (t->next)
+        t->next->pprev = t->pprev;
+    // The head of a slot that is now empty clears its bit
+    wheel_timer_t **first = &w->slots[0][0];
+    if (!t->next && t->pprev >= first && t->pprev < first + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS) {
+        size_t index = (size_t)(t->pprev - first);
+        w->occupied[index / TIMER_WHEEL_SLOTS] &= ~(1ull << (index % TIMER_WHEEL_SLOTS));
+    }
+    t->pprev = NULL;
+}
+
+void timer_arm(timer_wheel_t *w, wheel_timer_t *t, uint64_t delay_ms) {
+    if (t->pprev)
+        unlink_timer(w, t);
+    else
+        w->armed++;
+    uint64_t ticks = (delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    t->expires = w->now + (uint32_t)(ticks < WHEEL_SPAN ? ticks : WHEEL_SPAN - 1);
+    place(w, t);
+}
+
+void timer_cancel(timer_wheel_t *w, wheel_timer_t *t) {
+    if (!t->pprev)
+        return;
+    unlink_timer(w, t);
+    w->armed--;
+}
+
+// Redistribute the slot of the given level that the current tick has reached
+static void cascade(timer_wheel_t *w, int level) {
+    unsigned slot = (w->now >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK;
+    wheel_timer_t *t = w->slots[level][slot];
+    w->slots[level][slot] = NULL;
+    w->occupied[level] &= ~(1ull << slot);
+    while (t) {
+        wheel_timer_t *next = t->next;
+        place(w, t);
+        t = next;
+    }
+}
+
+int timer_wheel_timeout(const timer_wheel_t *w, uint64_t now_ms) {
+    if (!w->armed)
+        return -1;
+    // The next occupied level 0 slot, or the next cascade if there is none
+    unsigned index = w->now & SLOT_MASK;
+    uint64_t pending = index ? w->occupied[0] >> index : 1;
+    uint32_t ticks = pending ? (uint32_t)__builtin_ctzll(pending) : TIMER_WHEEL_SLOTS - index;
+    uint64_t at = w->origin_ms + (uint64_t)(w->now + ticks) * TIMER_TICK_MS;
+    if (at <= now_ms)
+        return 0;
+    return at - now_ms < INT_MAX ? (int)(at - now_ms) : INT_MAX;
+}
+
+size_t timer_wheel_advance(timer_wheel_t *w, uint64_t now_ms) {
+    if (now_ms < w->origin_ms)
+        return 0;
+    uint32_t target = (uint32_t)((now_ms - w->origin_ms) / TIMER_TICK_MS);
+
+    // Collect every due slot first, in expiry order, then fire the batch
+    wheel_timer_t *due = NULL, **tail = &due;
+    while ((int32_t)(target - w->now) >= 0) {
+        if (!w->armed) {
+            w->now = target + 1;
+            break;
+        }
+        unsigned index = w->now & SLOT_MASK;
+        if (index) {
+            // Skip straight to the next occupied slot or the next cascade
+            uint64_t pending = w->occupied[0] >> index;
+            uint32_t skip = pending ? (uint32_t)__builtin_ctzll(pending) : TIMER_WHEEL_SLOTS - index;
+            if (skip) {
+                uint32_t left = target - w->now + 1;
+                w->now += skip < left ? skip : left;
+                continue;
+            }
+        } else {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                cascade(w, level);
+                if ((w->now >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK)
+                    break;
+            }
+        }
+
+        wheel_timer_t *t = w->slots[0][index];
+        w->slots[0][index] = NULL;
+        w->occupied[0] &= ~(1ull << index);
+        for (; t; t = t->next) {
+            t->pprev = tail;
+            *tail = t;
+            tail = &t->next;
+        }
+        w->now++;
+    }
+
+    // Callbacks may cancel timers still waiting in the batch; pprev keeps that O(1)
+    size_t fired = 0;
+    wheel_timer_t *t;
+    while ((t = due)) {
+        unlink_timer(w, t);
+        w->armed--;
+        fired++;
+        t->fn(w, t);
+    }
+    return fired;
+}
@@ -0,0 +1,54 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIMER_TICK_MS      100  // resolution: timers fire up to a tick late, never early
+#define TIMER_WHEEL_BITS   6    // 64 slots per level
+#define TIMER_WHEEL_SLOTS  (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4    // 64^4 ticks, about 19 days
+
+typedef struct wheel_timer wheel_timer_t;
+typedef struct timer_wheel timer_wheel_t;
+typedef void (*wheel_timer_fn)(timer_wheel_t *w, wheel_timer_t *t);
+
+// Embedded in whatever it times. Arming, re-arming and cancelling are O(1).
+struct wheel_timer {
+    wheel_timer_t *next;
+    wheel_timer_t **pprev;      // NULL while not armed
+    wheel_timer_fn fn;
+    uint32_t expires;           // tick
+};
+
+// Hierarchical timing wheel: level 0 holds the next 64 ticks one slot each,
+// every further level 64 times the span of the one below, and a slot is
+// redistributed a level down when time reaches it. Due timers are collected
+// a whole slot at a time and fired together; empty stretches are skipped
+// using a bitmap of occupied slots, so an idle wheel costs nothing per tick.
+struct timer_wheel {
+    wheel_timer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_LEVELS];
+    uint32_t now;               // next tick to process
+    uint64_t origin_ms;         // clock reading of tick 0
+    size_t armed;
+};
+
+// Monotonic milliseconds
+uint64_t timer_clock_ms(void);
+
+void timer_wheel_init(timer_wheel_t *w, uint64_t now_ms);
+void timer_init(wheel_timer_t *t, wheel_timer_fn fn);
+// (Re)arm t to fire after delay_ms, counted from the wheel's current tick
+void timer_arm(timer_wheel_t *w, wheel_timer_t *t, uint64_t delay_ms);
+void timer_cancel(timer_wheel_t *w, wheel_timer_t *t);
+static inline int timer_armed(const wheel_timer_t *t) { return t->pprev != NULL; }
+
+// Milliseconds from now_ms until the wheel has work, -1 if nothing is armed.
+// Meant as the event loop's wait timeout.
+int timer_wheel_timeout(const timer_wheel_t *w, uint64_t now_ms);
+// Fire every timer due by now_ms. A callback may arm or cancel any timer,
+// its own included. Returns the number fired.
+size_t timer_wheel_advance(timer_wheel_t *w, uint64_t now_ms);
+
+#endif
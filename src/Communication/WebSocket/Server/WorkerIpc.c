@@ -0,0 +1,89 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+#include "WorkerIpc.h"
+
+static worker_ipc_t *channels;  // the main process's ends; each worker's copy after the fork
+static int nchannels;
+static worker_ipc_t *self;
+
+static void close_eventfds(worker_ipc_t *c) {
+    if (c->commands.efd >= 0)
+        close(c->commands.efd);
+    if (c->events.efd >= 0)
+        close(c->events.efd);
+    c->commands.efd = c->events.efd = -1;
+}
+
+int worker_ipc_init(int nworkers) {
+    size_t ring = ipc_ring_size(WORKER_IPC_RING_SIZE);
+    size_t size = ring * 2 * (size_t)nworkers;
+
+    // A named memfd rather than an anonymous mapping, so the rings are easy
+    // to tell apart in /proc/<pid>/maps. Fresh pages are zero: empty rings.
+    int fd = memfd_create("WebSocketIpc", MFD_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    if (ftruncate(fd, (off_t)size) < 0) {
+        close(fd);
+        return -1;
+    }
+    uint8_t *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        return -1;
+
+    worker_ipc_t *c = calloc((size_t)nworkers, sizeof(*c));
+    if (!c)
+        goto fail;
+    for (int i = 0; i < nworkers; i++) {
+        int to_worker = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        int to_main = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ipc_ring_attach(&c[i].commands, mem + ring * 2 * (size_t)i, WORKER_IPC_RING_SIZE, to_worker);
+        ipc_ring_attach(&c[i].events, mem + ring * (2 * (size_t)i + 1), WORKER_IPC_RING_SIZE, to_main);
+        if (to_worker < 0 || to_main < 0) {
+            for (int j = 0; j <= i; j++)
+                close_eventfds(&c[j]);
+            free(c);
+            goto fail;
+        }
+    }
+    channels = c;
+    nchannels = nworkers;
+    return 0;
+
+fail:;
+    int err = errno;
+    munmap(mem, size);
+    errno = err;
+    return -1;
+}
+
+worker_ipc_t *worker_ipc_main(int id) {
+    return id >= 0 && id < nchannels ? &channels[id] : NULL;
+}
+
+int worker_ipc_count(void) {
+    return nchannels;
+}
+
+void worker_ipc_attach(int id) {
+    if (id < 0 || id >= nchannels)
+        return;
+    for (int i = 0; i < nchannels; i++) {
+        if (i != id)
+            close_eventfds(&channels[i]);
+    }
+    // The copy of the main process's view is stale on our sides of the rings
+    self = &channels[id];
+    ipc_ring_attach(&self->commands, self->commands.shm, WORKER_IPC_RING_SIZE, self->commands.efd);
+    ipc_ring_attach(&self->events, self->events.shm, WORKER_IPC_RING_SIZE, self->events.efd);
+}
+
+worker_ipc_t *worker_ipc_self(void) {
+    return self;
+}
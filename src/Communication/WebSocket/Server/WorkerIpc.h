@@ -0,0 +1,69 @@
+#ifndef WORKER_IPC_H
+#define WORKER_IPC_H
+
+#include <stdint.h>
+
+#include "IpcRing.h"
+#include "Handshake.h"
+#include "ConnPool.h"
+
+#define WORKER_IPC_RING_SIZE (1u << 20)  // bytes each way, per worker; touched pages only
+
+// A pair of rings between the main process and each worker, mapped before
+// the workers are forked. The main process produces commands and consumes
+// events; a worker the other way round. A respawned worker picks up where
+// the one before it left off.
+typedef struct worker_ipc {
+    ipc_ring_t commands;        // main -> worker
+    ipc_ring_t events;          // worker -> main
+} worker_ipc_t;
+
+// What the records carry; ipc_record_t.type
+enum {
+    IPC_MSG_CALL = 1,           // ipc_call_t: send a CALL to stations
+    IPC_MSG_CALL_SENT,          // ipc_call_sent_t: once per IPC_MSG_CALL, when it has gone out
+    IPC_MSG_CALL_RESULT         // ipc_call_result_t: once per station it went to
+};
+
+typedef struct {
+    uint32_t tag;               // the main process's, echoed in what comes back
+    int16_t action;             // ocpp_action_t
+    uint8_t station_len;        // 0 for every station of the worker
+    conn_handle_t handle;       // the station's connection if the route table knew it, else CONN_HANDLE_NONE
+    char station[STATION_ID_MAX];
+    char payload[];             // JSON object, up to the end of the record
+} ipc_call_t;
+
+typedef struct {
+    uint32_t tag;
+    uint32_t sent;              // results to expect
+    uint32_t busy;              // stations already waiting on OCPP_MAX_PENDING of our CALLs
+} ipc_call_sent_t;
+
+typedef enum {
+    IPC_CALL_ANSWERED,          // text is the CALLRESULT's payload
+    IPC_CALL_REJECTED,          // text is the CALLERROR's code, description and details
+    IPC_CALL_NO_ANSWER          // timed out or disconnected first
+} ipc_call_status_t;
+
+typedef struct {
+    uint32_t tag;
+    uint8_t status;             // ipc_call_status_t
+    uint8_t station_len;
+    char station[STATION_ID_MAX];
+    char text[];                // up to the end of the record
+} ipc_call_result_t;
+
+// Main process, before forking: the rings and their eventfds. Returns -1
+// with errno set if they could not be set up.
+int worker_ipc_init(int nworkers);
+// The main process's end of worker id's channel, NULL without channels
+worker_ipc_t *worker_ipc_main(int id);
+int worker_ipc_count(void);
+
+// In worker id, after the fork: take over its end and close the rest
+void worker_ipc_attach(int id);
+// The worker's own channel, NULL if it runs without a main process
+worker_ipc_t *worker_ipc_self(void);
+
+#endif
@@ -1,9 +1,258 @@
+#include <getopt.h>
+
 #include "ProcessUtils.h"
+#include "TLSServer.h"
+#include "WorkerIpc.h"
+#include "Control.h"
+#include "MetricsHttp.h"
+
+static void Usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-w workers] [-p port] [--plain]\n", prog);
+	fprintf(stderr, "  -w, --workers N   number of server worker processes (default: one per core)\n");
+	fprintf(stderr, "  -p, --port N      listening port (default: %d)\n", PORT);
+	fprintf(stderr, "      --plain       serve ws:// without TLS\n");
+	fprintf(stderr, "      --out-high N  pause a station once N bytes are queued for it (default: %d)\n", OUTQ_DEFAULT_HIGH_WATERMARK);
+	fprintf(stderr, "      --out-low N   resume it once its queue drains to N bytes (default: %d)\n", OUTQ_DEFAULT_LOW_WATERMARK);
+	fprintf(stderr, "      --drop-slow   drop stations above the high watermark instead of pausing them\n");
+	fprintf(stderr, "      --session-cache N  TLS sessions kept for resumption across workers, 0 to disable (default: %d)\n", SESSION_CACHE_DEFAULT_SLOTS);
+	fprintf(stderr, "      --ticket-rotate S  rotate session ticket keys every S seconds, 0 to disable tickets (default: %d)\n", SESSION_TICKET_DEFAULT_ROTATE);
+	fprintf(stderr, "      --ktls        let the kernel encrypt and decrypt TLS records where supported\n");
+	fprintf(stderr, "      --io-uring    use io_uring completions instead of epoll where supported\n");
+	fprintf(stderr, "      --handshake-timeout S  drop connections not upgraded after S seconds (default: %d)\n", CONN_DEFAULT_HANDSHAKE_TIMEOUT);
+	fprintf(stderr, "      --ping-interval S  ping stations silent for S seconds, 0 to disable (default: %d)\n", CONN_DEFAULT_PING_INTERVAL);
+	fprintf(stderr, "      --ping-interval-max S  stretch the interval up to S seconds while pongs come back promptly (default: %d)\n", CONN_DEFAULT_PING_INTERVAL_MAX);
+	fprintf(stderr, "      --pong-timeout S   drop them if still silent S seconds later (default: %d)\n", CONN_DEFAULT_PONG_TIMEOUT);
+	fprintf(stderr, "      --call-timeout S   give up on a CALL's answer after S seconds, 0 to wait forever (default: %d)\n", CONN_DEFAULT_CALL_TIMEOUT);
+	fprintf(stderr, "      --deflate     compress messages with stations offering permessage-deflate\n");
+	fprintf(stderr, "      --deflate-window-bits N  largest deflate window, 9 to 15, in either direction (default: %d)\n", WS_DEFLATE_MAX_WINDOW);
+	fprintf(stderr, "      --deflate-no-context-takeover  start every message afresh so connections hold no compression state\n");
+	fprintf(stderr, "      --max-stations N  stations routed to their worker for control commands, 0 to ask every worker (default: %d)\n", ROUTE_DEFAULT_STATIONS);
+	fprintf(stderr, "      --control PATH  take commands for the stations on a Unix socket (see Control.h)\n");
+	fprintf(stderr, "      --metrics PORT  serve Prometheus metrics at http://127.0.0.1:PORT/metrics\n");
+	fprintf(stderr, "      --log-level L  debug, info, warn, error or off (default: info)\n");
+	fprintf(stderr, "Send SIGUSR1 to the main process to print TLS resumption and station route counters,\n"
+	                "SIGUSR2 to switch to debug logging and back.\n");
+}
+
+/* A byte count of at least 1: digits only, no sign or trailing garbage */
+static int ParseBytes(const char *arg, size_t *out)
+{
+	char *end;
+	if (*arg < '0' || *arg > '9')
+		return -1;
+	errno = 0;
+	unsigned long long n = strtoull(arg, &end, 10);
+	if (*end || errno == ERANGE || n == 0 || n > SIZE_MAX)
+		return -1;
+	*out = (size_t)n;
+	return 0;
+}
 
 int main(int argc, char *argv[]) /* Main Program for TLS Websocket*/
 {
+	static const struct option longOpts[] = {
+		{"workers", required_argument, NULL, 'w'},
+		{"port", required_argument, NULL, 'p'},
+		{"plain", no_argument, NULL, 'P'},
+		{"out-high", required_argument, NULL, 'H'},
+		{"out-low", required_argument, NULL, 'L'},
+		{"drop-slow", no_argument, NULL, 'D'},
+		{"session-cache", required_argument, NULL, 'S'},
+		{"ticket-rotate", required_argument, NULL, 'T'},
+		{"ktls", no_argument, NULL, 'K'},
+		{"io-uring", no_argument, NULL, 'U'},
+		{"handshake-timeout", required_argument, NULL, 'A'},
+		{"ping-interval", required_argument, NULL, 'I'},
+		{"ping-interval-max", required_argument, NULL, 'M'},
+		{"pong-timeout", required_argument, NULL, 'O'},
+		{"call-timeout", required_argument, NULL, 'C'},
+		{"deflate", no_argument, NULL, 'Z'},
+		{"deflate-window-bits", required_argument, NULL, 'B'},
+		{"deflate-no-context-takeover", no_argument, NULL, 'N'},
+		{"control", required_argument, NULL, 'X'},
+		{"max-stations", required_argument, NULL, 'R'},
+		{"metrics", required_argument, NULL, 'E'},
+		{"log-level", required_argument, NULL, 'G'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	int workerCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	const char *controlPath = NULL;
+	int metricsPort = 0;
+	int logLevel = LOG_LEVEL_INFO;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "w:p:h", longOpts, NULL)) != -1) {
+		switch (opt) {
+		case 'w':
+			workerCount = atoi(optarg);
+			if (workerCount < 1 || workerCount > MAX_WORKERS) {
+				fprintf(stderr, "Worker count must be between 1 and %d\n", MAX_WORKERS);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'p':
+			server_config.port = atoi(optarg);
+			if (server_config.port < 1 || server_config.port > 65535) {
+				fprintf(stderr, "Invalid port %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'P':
+			server_config.plain = 1;
+			break;
+		case 'H':
+			if (ParseBytes(optarg, &server_config.out_high_watermark) < 0) {
+				fprintf(stderr, "Invalid --out-high %s\n", optarg);
+				Usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'L':
+			if (ParseBytes(optarg, &server_config.out_low_watermark) < 0) {
+				fprintf(stderr, "Invalid --out-low %s\n", optarg);
+				Usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'D':
+			server_config.drop_slow = 1;
+			break;
+		case 'S':
+			server_config.session_cache_slots = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'T':
+			server_config.ticket_rotate = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'K':
+			server_config.ktls = 1;
+			break;
+		case 'U':
+			server_config.io_uring = 1;
+			break;
+		case 'A':
+			server_config.handshake_timeout = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'I':
+			server_config.ping_interval = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'M':
+			server_config.ping_interval_max = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'O':
+			server_config.pong_timeout = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'C':
+			server_config.call_timeout = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'Z':
+			server_config.deflate.enabled = 1;
+			break;
+		case 'B':
+			server_config.deflate.max_window_bits = atoi(optarg);
+			if (server_config.deflate.max_window_bits < WS_DEFLATE_MIN_WINDOW ||
+			    server_config.deflate.max_window_bits > WS_DEFLATE_MAX_WINDOW) {
+				fprintf(stderr, "--deflate-window-bits must be between %d and %d\n",
+					WS_DEFLATE_MIN_WINDOW, WS_DEFLATE_MAX_WINDOW);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'N':
+			server_config.deflate.no_context_takeover = 1;
+			break;
+		case 'X':
+			controlPath = optarg;
+			break;
+		case 'R':
+			server_config.max_stations = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'E':
+			metricsPort = atoi(optarg);
+			if (metricsPort < 1 || metricsPort > 65535) {
+				fprintf(stderr, "Invalid metrics port %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'G':
+			logLevel = log_parse_level(optarg);
+			if (logLevel < 0) {
+				fprintf(stderr, "Invalid log level %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			Usage(argv[0]);
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if (server_config.out_low_watermark >= server_config.out_high_watermark) {
+		fprintf(stderr, "--out-low (%zu) must be below --out-high (%zu)\n",
+			server_config.out_low_watermark, server_config.out_high_watermark);
+		Usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (server_config.handshake_timeout == 0) {
+		fprintf(stderr, "--handshake-timeout must be at least one second\n");
+		return EXIT_FAILURE;
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	/* Without the kernel module every connection would silently stay in user space */
+	if (server_config.ktls && !server_config.plain) {
+		int err = ktls_probe();
+		if (err) {
+			fprintf(stderr, "Kernel TLS unavailable (%s), using user-space TLS\n", strerror(err));
+			server_config.ktls = 0;
+		}
+	}
+
+	/* Offloaded connections leave the socket to OpenSSL, which io_uring cannot share */
+	if (server_config.io_uring && server_config.ktls) {
+		fprintf(stderr, "--io-uring does not combine with kernel TLS, using epoll\n");
+		server_config.io_uring = 0;
+	}
+	if (server_config.io_uring) {
+		int err = uring_probe();
+		if (err) {
+			fprintf(stderr, "io_uring unavailable (%s), using epoll\n", strerror(err));
+			server_config.io_uring = 0;
+		}
+	}
+
+	/* Mapped before forking so every worker resumes every other worker's sessions */
+	if (!server_config.plain &&
+	    session_cache_init(server_config.session_cache_slots, server_config.ticket_rotate) < 0)
+		perror("Unable to create the shared TLS session cache");
+
+	/* Also mapped before forking: the log level, which SIGUSR2 changes for every worker */
+	if (log_share_level() < 0)
+		perror("Unable to share the log level with the workers");
+	log_set_level((log_level_t)logLevel);
+
+	/* And commands to the workers and what comes back */
+	if (worker_ipc_init(workerCount) < 0)
+		perror("Unable to create the worker channels");
+	if (route_table_init(server_config.max_stations) < 0)
+		perror("Unable to create the station route table");
+	if (controlPath && control_init(controlPath, server_config.call_timeout) < 0) {
+		fprintf(stderr, "Unable to listen on %s: %s\n", controlPath, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (metricsPort) {
+		if (metrics_init(workerCount) < 0 || metrics_http_init(metricsPort) < 0) {
+			fprintf(stderr, "Unable to serve metrics on port %d: %s\n", metricsPort, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		printf("Metrics at http://127.0.0.1:%d/metrics\n", metricsPort);
+	}
+
 	SetProcessName("WebSocketMain");
-	SpawnOtherProcess();
-	while(1){};
+	SpawnOtherProcess(workerCount);
+	SuperviseWorkers();
+	if (controlPath)
+		unlink(controlPath);
 	return 0;
 }
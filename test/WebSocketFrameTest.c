@@ -0,0 +1,148 @@
+// Codec checks for the frame decoder: UTF-8 validation of text messages
+// across fragments and of close reasons.
+// Usage: WebSocketFrameTest (exits non-zero on the first failure)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WebSocketFrame.h"
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static const uint8_t mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+// Append one masked client frame to the decoder, as a server receives it
+static void feed(ws_decoder_t *d, uint8_t opcode, int fin, const char *payload, size_t len) {
+    uint8_t frame[WS_MAX_HEADER_SIZE + 256];
+    size_t n = ws_build_frame_header(frame, opcode, fin, len, mask);
+    memcpy(frame + n, payload, len);
+    ws_mask(frame + n, len, mask, 0);
+    n += len;
+
+    size_t avail;
+    uint8_t *dst = ws_decoder_write_ptr(d, &avail);
+    if (!dst || avail < n) {
+        fprintf(stderr, "no room for a %zu byte frame\n", n);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(dst, frame, n);
+    ws_decoder_commit(d, n);
+}
+
+// Decode a text message sent as the given fragments; returns what
+// ws_decoder_next ended with
+static int decode_text(const char *const *fragments, int count, ws_decoder_t *d, ws_message_t *msg) {
+    ws_decoder_init(d, 1, 0);
+    for (int i = 0; i < count; i++)
+        feed(d, i ? WS_OPCODE_CONTINUATION : WS_OPCODE_TEXT, i == count - 1,
+             fragments[i], strlen(fragments[i]));
+    return ws_decoder_next(d, msg);
+}
+
+static void test_fragmented_text(void) {
+    ws_decoder_t d;
+    ws_message_t msg;
+
+    // U+00E9 and U+1F600 each split across a fragment boundary
+    const char *split[] = { "caf\xC3", "\xA9 \xF0\x9F", "\x98", "\x80" };
+    CHECK(decode_text(split, 4, &d, &msg) == 1);
+    CHECK(msg.opcode == WS_OPCODE_TEXT);
+    CHECK(msg.len == 10 && memcmp(msg.payload, "caf\xC3\xA9 \xF0\x9F\x98\x80", 10) == 0);
+    ws_decoder_free(&d);
+
+    // The message ends inside a sequence
+    const char *truncated[] = { "caf\xC3", "" };
+    CHECK(decode_text(truncated, 2, &d, &msg) == -1);
+    CHECK(d.close_code == WS_CLOSE_INVALID_DATA);
+    ws_decoder_free(&d);
+
+    // The continuation byte that completes a split sequence is wrong
+    const char *bad_tail[] = { "caf\xC3", "(" };
+    CHECK(decode_text(bad_tail, 2, &d, &msg) == -1);
+    CHECK(d.close_code == WS_CLOSE_INVALID_DATA);
+    ws_decoder_free(&d);
+}
+
+static void test_invalid_text(void) {
+    static const char *const invalid[] = {
+        "\xC0\xAF",                       // overlong '/'
+        "\xE0\x80\xAF",                   // overlong '/', three bytes
+        "\xF0\x80\x80\xAF",               // and four
+        "\xED\xA0\x80",                   // UTF-16 surrogate
+        "\xF4\x90\x80\x80",               // past U+10FFFF
+        "\xF5\x80\x80\x80",
+        "\x80",                           // stray continuation byte
+        "[2,\"1\",\"Heartbeat\",{}]\xFF",   // after a run of ASCII
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        ws_decoder_t d;
+        ws_message_t msg;
+        CHECK(decode_text(&invalid[i], 1, &d, &msg) == -1);
+        CHECK(d.close_code == WS_CLOSE_INVALID_DATA);
+        ws_decoder_free(&d);
+    }
+
+    // Binary messages are not text
+    ws_decoder_t d;
+    ws_message_t msg;
+    ws_decoder_init(&d, 1, 0);
+    feed(&d, WS_OPCODE_BINARY, 1, "\xC0\xAF", 2);
+    CHECK(ws_decoder_next(&d, &msg) == 1);
+    ws_decoder_free(&d);
+}
+
+// The incremental check reaches the same verdict however the input is cut
+static void test_utf8_split_anywhere(void) {
+    static const char text[] = "OCPP \xE2\x82\xAC 12,50 \xF0\x9F\x94\x8C \xC3\xA9t\xC3\xA9 \xEF\xBF\xBD";
+    size_t len = sizeof(text) - 1;
+    CHECK(ws_utf8_valid((const uint8_t *)text, len));
+    for (size_t cut = 0; cut <= len; cut++) {
+        uint32_t state = 0;
+        CHECK(ws_utf8_check(&state, (const uint8_t *)text, cut) == 0);
+        CHECK(ws_utf8_check(&state, (const uint8_t *)text + cut, len - cut) == 0);
+        CHECK((state & 0xFF) == 0);
+    }
+}
+
+// A close whose reason is not UTF-8 is answered with 1007
+static void test_close_reason(void) {
+    ws_decoder_t d;
+    ws_message_t msg;
+    uint8_t out[WS_MAX_CONTROL_FRAME];
+    size_t out_len;
+
+    ws_decoder_init(&d, 1, 0);
+    feed(&d, WS_OPCODE_CLOSE, 1, "\x03\xE8" "bye \xC3\xA9", 8);
+    CHECK(ws_decoder_next(&d, &msg) == 1);
+    CHECK(ws_control_frame(&d, &msg, NULL, out, &out_len) == 1);
+    CHECK(out_len == 4 && out[2] == 0x03 && out[3] == 0xE8);
+    ws_decoder_free(&d);
+
+    ws_decoder_init(&d, 1, 0);
+    feed(&d, WS_OPCODE_CLOSE, 1, "\x03\xE8" "bye \xC0\xAF", 8);
+    CHECK(ws_decoder_next(&d, &msg) == 1);
+    CHECK(ws_control_frame(&d, &msg, NULL, out, &out_len) == 1);
+    CHECK(out_len == 4 && ((out[2] << 8) | out[3]) == WS_CLOSE_INVALID_DATA);
+    ws_decoder_free(&d);
+}
+
+int main(void) {
+    test_fragmented_text();
+    test_invalid_text();
+    test_utf8_split_anywhere();
+    test_close_reason();
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("WebSocketFrameTest: all checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,456 @@
+#!/usr/bin/env python3
+"""Generate OCPP message structs, parsers and writers from the JSON schemas.
+
+Every schema under Docs/schemas/ocpp1.6 and Docs/schemas/ocpp2.0.1 becomes a
+C struct with a one-pass parser and a serializer built on OcppJson.h:
+
+    tools/ocpp_codegen.py [--schemas Docs/schemas] [--out src/Communication/OCPP]
+
+writes OcppMessages.h and OcppMessages.c. Re-run it after adding schemas; the
+output is checked in so building does not need Python.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+VERSIONS = [("ocpp1.6", "ocpp16"), ("ocpp2.0.1", "ocpp201")]
+
+C_KEYWORDS = {"auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else",
+              "enum", "extern", "float", "for", "goto", "if", "int", "long", "register", "return",
+              "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union",
+              "unsigned", "void", "volatile", "while"}
+
+# Keywords that carry no constraint the parser has to enforce
+IGNORED = {"$schema", "$id", "id", "title", "comment", "description", "javaType", "definitions",
+           "default", "additionalItems", "type", "properties", "required", "additionalProperties",
+           "enum", "format", "maxLength", "items", "minItems", "maxItems", "$ref"}
+
+
+def snake(name):
+    out = ""
+    for i, c in enumerate(name):
+        nxt = name[i + 1:i + 2]
+        # A lone lower-case lead (kWh, eMAID) and a lone trailing capital
+        # (SoC) stay attached to their neighbours
+        if c.isupper() and i > 1 and (name[i - 1].islower() or name[i - 1].isdigit()) and nxt.isalpha():
+            out += "_"
+        elif c.isupper() and i > 0 and name[i - 1].isupper() and nxt.islower():
+            out += "_"  # the end of an acronym: EVCommunication
+        out += c
+    return re.sub(r"[^A-Za-z0-9]+", "_", out).strip("_").lower()
+
+
+def constant(value):
+    return snake(value).upper()
+
+
+def cap(name):
+    return name[:1].upper() + name[1:]
+
+
+def c_str(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+class Enum:
+    def __init__(self, prefix, name, values):
+        self.name = name
+        self.cname = "%s_%s" % (prefix, snake(name))
+        self.values = values
+        self.consts = ["%s_%s_%s" % (prefix.upper(), snake(name).upper(), constant(v)) for v in values]
+        if len(set(self.consts)) != len(self.consts):
+            raise SystemExit("enum %s: values collide as C names" % name)
+
+
+class Field:
+    """One property: kind is str, datetime, int, number, bool, enum, struct
+    or raw, wrapped in an array when array is set."""
+
+    def __init__(self, name, kind, ref=None, max_len=0, required=False):
+        self.name = name
+        self.cname = snake(name)
+        if self.cname in C_KEYWORDS:
+            self.cname += "_"
+        self.kind = kind
+        self.ref = ref
+        self.max_len = max_len
+        self.required = required
+        self.array = False
+        self.min_items = 0
+        self.max_items = 0
+
+
+class Struct:
+    def __init__(self, prefix, name, message=False):
+        self.name = name
+        self.cname = "%s_%s" % (prefix, snake(name))
+        self.message = message
+        self.fields = []
+
+
+class Version:
+    def __init__(self, prefix):
+        self.prefix = prefix
+        self.enums = {}
+        self.structs = {}
+        self.order = []     # structs, dependencies first
+        self.shapes = {}    # type name -> schema it came from, to catch clashes
+
+    def claim(self, name, schema):
+        shape = json.dumps(schema, sort_keys=True)
+        if self.shapes.setdefault(name, shape) != shape:
+            raise SystemExit("%s: %s is defined differently by two schemas" % (self.prefix, name))
+        return name in self.structs or name in self.enums
+
+    def enum(self, name, schema):
+        if not self.claim(name, schema):
+            self.enums[name] = Enum(self.prefix, name, schema["enum"])
+        return self.enums[name]
+
+    def struct(self, name, schema, root, message=False):
+        if self.claim(name, schema):
+            return self.structs[name]
+        st = Struct(self.prefix, name, message)
+        self.structs[name] = st
+        required = set(schema.get("required", []))
+        for key in schema:
+            if key not in IGNORED:
+                print("%s: %s: ignoring '%s'" % (self.prefix, name, key), file=sys.stderr)
+        for prop, sub in schema.get("properties", {}).items():
+            st.fields.append(self.field(name, prop, sub, root, prop in required))
+        if len(st.fields) > 32:
+            raise SystemExit("%s: more than 32 properties" % name)
+        self.order.append(st)
+        return st
+
+    def resolve(self, schema, root):
+        if "$ref" in schema:
+            name = schema["$ref"].split("/")[-1]
+            return name, root["definitions"][name]
+        return None, schema
+
+    def field(self, owner, prop, schema, root, required):
+        ref_name, schema = self.resolve(schema, root)
+        if schema.get("type") == "array":
+            items_ref, items = self.resolve(schema["items"], root)
+            f = self.scalar(owner, prop, items_ref, items, root, required)
+            f.array = True
+            f.min_items = schema.get("minItems", 0)
+            f.max_items = schema.get("maxItems", 0)
+            return f
+        return self.scalar(owner, prop, ref_name, schema, root, required)
+
+    def scalar(self, owner, prop, ref_name, schema, root, required):
+        t = schema.get("type")
+        if "enum" in schema:
+            # Shared definitions are named by the schema; inline enums by where they are
+            name = schema.get("javaType") or (ref_name or re.sub(r"(Request|Response)$", "", owner) + cap(prop))
+            return Field(prop, "enum", self.enum(re.sub(r"(Enum|EnumType)$", "", name), schema), required=required)
+        if t == "string":
+            kind = "datetime" if schema.get("format") == "date-time" else "str"
+            return Field(prop, kind, max_len=schema.get("maxLength", 0), required=required)
+        if t in ("integer", "number", "boolean"):
+            return Field(prop, {"integer": "int", "number": "number", "boolean": "bool"}[t], required=required)
+        if t == "object":
+            if schema.get("additionalProperties", True) is not False:
+                return Field(prop, "raw", required=required)  # open to vendor data, kept as text
+            name = schema.get("javaType") or (re.sub(r"Type$", "", ref_name) if ref_name else cap(prop))
+            return Field(prop, "struct", self.struct(name, schema, root), required=required)
+        raise SystemExit("%s.%s: unsupported schema %s" % (owner, prop, json.dumps(schema)))
+
+
+def load(schemas_dir):
+    versions = []
+    for dirname, prefix in VERSIONS:
+        v = Version(prefix)
+        path = os.path.join(schemas_dir, dirname)
+        for fn in sorted(os.listdir(path)):
+            if not fn.endswith(".json"):
+                continue
+            with open(os.path.join(path, fn)) as f:
+                schema = json.load(f)
+            name = fn[:-5]
+            if not name.endswith(("Request", "Response")):
+                name += "Request"  # 1.6 names requests after the action alone
+            v.struct(name, schema, schema, message=True)
+        versions.append(v)
+    return versions
+
+
+def c_type(f):
+    if f.kind in ("str", "datetime", "raw"):
+        return "ocpp_str_t"
+    if f.kind in ("enum", "struct"):
+        return f.ref.cname + "_t"
+    return {"int": "int", "number": "double", "bool": "bool"}[f.kind]
+
+
+def emit_header(versions):
+    out = ["// Generated by tools/ocpp_codegen.py from Docs/schemas. Do not edit.",
+           "#ifndef OCPP_MESSAGES_H", "#define OCPP_MESSAGES_H", "", '#include "OcppJson.h"', "",
+           "// Strings are JSON text as it appears between the quotes, escapes and",
+           "// all. Optional properties have a has_ flag, arrays a _count.", ""]
+    for v in versions:
+        out.append("// %s" % {"ocpp16": "OCPP 1.6", "ocpp201": "OCPP 2.0.1"}[v.prefix])
+        out.append("")
+        for e in v.enums.values():
+            out.append("typedef enum {")
+            out += ["    %s%s" % (c, "," if i + 1 < len(e.consts) else "") for i, c in enumerate(e.consts)]
+            out.append("} %s_t;" % e.cname)
+            out.append("")
+        for st in v.order:
+            if st.message:
+                out.append("// %s" % st.name)
+            out.append("typedef struct {")
+            if not st.fields:
+                out.append("    char unused;                // the payload is an empty object")
+            for f in st.fields:
+                if not f.required:
+                    out.append("    bool has_%s;" % f.cname)
+                if f.array:
+                    out.append("    %s *%s;" % (c_type(f), f.cname))
+                    out.append("    size_t %s_count;" % f.cname)
+                else:
+                    out.append("    %s %s;" % (c_type(f), f.cname))
+            out.append("} %s_t;" % st.cname)
+            out.append("")
+        for e in v.enums.values():
+            out.append("const char *%s_name(%s_t v);" % (e.cname, e.cname))
+        out.append("")
+        for st in v.order:
+            if st.message:
+                out.append("int %s_parse(ocpp_json_t *j, %s_t *v);" % (st.cname, st.cname))
+                out.append("int %s_write(ocpp_writer_t *w, const %s_t *v);" % (st.cname, st.cname))
+        out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def emit_match(out, fn, ret, candidates):
+    """A switch on the length, then memcmp, mapping a raw string to an index"""
+    out.append("static int %s(ocpp_str_t s) {" % fn)
+    out.append("    switch (s.len) {")
+    by_len = {}
+    for value, result in candidates:
+        by_len.setdefault(len(value.encode()), []).append((value, result))
+    for n in sorted(by_len):
+        out.append("    case %d:" % n)
+        for value, result in by_len[n]:
+            out.append("        if (memcmp(s.ptr, %s, %d) == 0)" % (c_str(value), n))
+            out.append("            return %s;" % result)
+        out.append("        break;")
+    out.append("    }")
+    out.append("    return %s;" % ret)
+    out.append("}")
+    out.append("")
+
+
+def parse_call(f, target):
+    what = c_str(f.name)
+    if f.kind == "str":
+        return "ocpp_json_string(j, %s, %d, %s)" % (target, f.max_len, what)
+    if f.kind == "datetime":
+        return "ocpp_json_datetime(j, %s, %s)" % (target, what)
+    if f.kind == "raw":
+        return "ocpp_json_raw_object(j, %s, %s)" % (target, what)
+    if f.kind in ("int", "number", "bool"):
+        return "ocpp_json_%s(j, %s, %s)" % (f.kind, target, what)
+    return "parse_%s(j, %s, %s)" % (f.ref.cname, target, what)
+
+
+def write_stmt(f, value):
+    if f.kind in ("str", "datetime", "raw"):
+        if f.kind == "raw":
+            return "ocpp_write_raw(w, %s.ptr, %s.len);" % (value, value)
+        return "ocpp_write_str(w, %s);" % value
+    if f.kind in ("int", "number", "bool"):
+        return "ocpp_write_%s(w, %s);" % (f.kind, value)
+    if f.kind == "enum":
+        return "ocpp_write_str(w, %s_strs[%s]);" % (f.ref.cname, value)
+    return "write_%s(w, &%s);" % (f.ref.cname, value)
+
+
+def emit_parse(out, st):
+    fields = st.cname + "_fields"
+    if st.fields:
+        out.append("static const char *const %s[] = {" % fields)
+        out.append("    " + ", ".join(c_str(f.name) for f in st.fields))
+        out.append("};")
+        out.append("")
+        emit_match(out, st.cname + "_field", "-1", [(f.name, str(i)) for i, f in enumerate(st.fields)])
+
+    out.append("static int parse_%s(ocpp_json_t *j, %s_t *v, const char *what) {" % (st.cname, st.cname))
+    if st.fields:
+        out.append("    uint32_t seen = 0;")
+    out.append("    ocpp_str_t key;")
+    out.append("    int rc;")
+    out.append("")
+    out.append("    memset(v, 0, sizeof(*v));")
+    out.append("    if (ocpp_json_object_begin(j, what) < 0)")
+    out.append("        return -1;")
+    out.append("    while ((rc = ocpp_json_next_key(j, &key)) > 0) {")
+    if not st.fields:
+        out.append('        return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");')
+        out.append("    }")
+        out.append("    return rc;")
+        out.append("}")
+        out.append("")
+        return
+    out.append("        int f = %s_field(key);" % st.cname)
+    out.append("        if (f < 0)")
+    out.append('            return ocpp_json_fail(j, OCPP_JSON_FORMAT, "unknown property");')
+    out.append("        if (seen & 1u << f)")
+    out.append("            return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, %s[f]);" % fields)
+    out.append("        seen |= 1u << f;")
+    out.append("        switch (f) {")
+    for i, f in enumerate(st.fields):
+        body = []
+        if f.array:
+            what = c_str(f.name)
+            items = "v->%s" % f.cname
+            body.append("ocpp_json_array_t a;")
+            body.append("%s *item;" % c_type(f))
+            body.append("if (ocpp_json_array_begin(j, &a, %s) < 0)" % what)
+            body.append("    return -1;")
+            body.append("while ((rc = ocpp_json_array_next(j)) > 0) {")
+            if f.max_items:
+                body.append("    if (a.count == %d)" % f.max_items)
+                body.append("        return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, %s);" % what)
+            body.append("    if (!(item = ocpp_json_array_push(j, &a, sizeof(*item))))")
+            body.append("        return -1;")
+            body.append("    if (%s < 0)" % parse_call(f, "item"))
+            body.append("        return -1;")
+            body.append("}")
+            body.append("if (rc < 0)")
+            body.append("    return -1;")
+            body.append("%s = ocpp_json_array_end(j, &a, sizeof(*%s));" % (items, items))
+            body.append("if (j->error)")
+            body.append("    return -1;")
+            if f.min_items:
+                body.append("if (a.count < %d)" % f.min_items)
+                body.append("    return ocpp_json_fail(j, OCPP_JSON_OCCURRENCE, %s);" % what)
+            body.append("v->%s_count = a.count;" % f.cname)
+        else:
+            body.append("if (%s < 0)" % parse_call(f, "&v->%s" % f.cname))
+            body.append("    return -1;")
+        if not f.required:
+            body.append("v->has_%s = true;" % f.cname)
+        if f.array:
+            out.append("        case %d: {" % i)
+            out += ["            " + line for line in body]
+            out.append("            break;")
+            out.append("        }")
+        else:
+            out.append("        case %d:" % i)
+            out += ["            " + line for line in body]
+            out.append("            break;")
+    out.append("        }")
+    out.append("    }")
+    out.append("    if (rc < 0)")
+    out.append("        return -1;")
+    mask = sum(1 << i for i, f in enumerate(st.fields) if f.required)
+    if mask:
+        out.append("    if ((seen & 0x%xu) != 0x%xu)" % (mask, mask))
+        out.append("        return ocpp_json_missing(j, seen, 0x%xu, %s);" % (mask, fields))
+    out.append("    return 0;")
+    out.append("}")
+    out.append("")
+
+
+def emit_write(out, st):
+    out.append("static void write_%s(ocpp_writer_t *w, const %s_t *v) {" % (st.cname, st.cname))
+    if not st.fields:
+        out.append("    (void)v;")
+        out.append('    ocpp_write_raw(w, "{}", 2);')
+        out.append("}")
+        out.append("")
+        return
+    out.append("    int members = 0;")
+    out.append("")
+    out.append('    ocpp_write_raw(w, "{", 1);')
+    for f in st.fields:
+        key = '"%s":' % f.name
+        lines = ["ocpp_write_key(w, &members, %s, %d);" % (c_str(key), len(key))]
+        if f.array:
+            lines.append('ocpp_write_raw(w, "[", 1);')
+            lines.append("for (size_t i = 0; i < v->%s_count; i++) {" % f.cname)
+            lines.append("    if (i)")
+            lines.append('        ocpp_write_raw(w, ",", 1);')
+            lines.append("    " + write_stmt(f, "v->%s[i]" % f.cname))
+            lines.append("}")
+            lines.append('ocpp_write_raw(w, "]", 1);')
+        else:
+            lines.append(write_stmt(f, "v->%s" % f.cname))
+        if f.required:
+            out += ["    " + line for line in lines]
+        else:
+            out.append("    if (v->has_%s) {" % f.cname)
+            out += ["        " + line for line in lines]
+            out.append("    }")
+    out.append('    ocpp_write_raw(w, "}", 1);')
+    out.append("}")
+    out.append("")
+
+
+def emit_source(versions):
+    out = ["// Generated by tools/ocpp_codegen.py from Docs/schemas. Do not edit.",
+           "#include <string.h>", "", '#include "OcppMessages.h"', ""]
+    for v in versions:
+        for e in v.enums.values():
+            out.append("static const ocpp_str_t %s_strs[] = {" % e.cname)
+            out += ["    { %s, %d }," % (c_str(val), len(val.encode())) for val in e.values]
+            out.append("};")
+            out.append("")
+            out.append("const char *%s_name(%s_t v) {" % (e.cname, e.cname))
+            out.append("    return %s_strs[v].ptr;" % e.cname)
+            out.append("}")
+            out.append("")
+            emit_match(out, "match_" + e.cname, "-1", list(zip(e.values, e.consts)))
+            out.append("static int parse_%s(ocpp_json_t *j, %s_t *out, const char *what) {" % (e.cname, e.cname))
+            out.append("    ocpp_str_t s;")
+            out.append("    if (ocpp_json_string(j, &s, 0, what) < 0)")
+            out.append("        return -1;")
+            out.append("    int v = match_%s(s);" % e.cname)
+            out.append("    if (v < 0)")
+            out.append("        return ocpp_json_fail(j, OCPP_JSON_PROPERTY, what);")
+            out.append("    *out = (%s_t)v;" % e.cname)
+            out.append("    return 0;")
+            out.append("}")
+            out.append("")
+        for st in v.order:
+            emit_parse(out, st)
+            emit_write(out, st)
+            if st.message:
+                out.append("int %s_parse(ocpp_json_t *j, %s_t *v) {" % (st.cname, st.cname))
+                out.append('    if (parse_%s(j, v, "payload") < 0)' % st.cname)
+                out.append("        return -1;")
+                out.append("    return ocpp_json_end(j);")
+                out.append("}")
+                out.append("")
+                out.append("int %s_write(ocpp_writer_t *w, const %s_t *v) {" % (st.cname, st.cname))
+                out.append("    write_%s(w, v);" % st.cname)
+                out.append("    return ocpp_writer_status(w);")
+                out.append("}")
+                out.append("")
+    return "\n".join(out).rstrip("\n") + "\n"
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--schemas", default=os.path.join(root, "Docs", "schemas"))
+    ap.add_argument("--out", default=os.path.join(root, "src", "Communication", "OCPP"))
+    args = ap.parse_args()
+
+    versions = load(args.schemas)
+    with open(os.path.join(args.out, "OcppMessages.h"), "w") as f:
+        f.write(emit_header(versions))
+    with open(os.path.join(args.out, "OcppMessages.c"), "w") as f:
+        f.write(emit_source(versions))
+
+
+if __name__ == "__main__":
+    main()